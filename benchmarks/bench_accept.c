@@ -0,0 +1,164 @@
+#include "../include/server.h"
+#include "bench_common.h"
+#include <sys/wait.h>
+
+#define STORM_CLIENTS 10000
+#define STORM_DEADLINE_S 20
+
+typedef struct
+{
+    const char* name;
+    int backlog;
+    int drain;
+} StormConfig;
+
+static const StormConfig STORM_CONFIGS[] = {
+    {"backlog 5, one accept per event", 5, 0},
+    {"backlog 5, accept4 loop", 5, 1},
+    {"backlog 4096, one accept per event", TCP_DEFAULT_BACKLOG, 0},
+    {"backlog 4096, accept4 loop", TCP_DEFAULT_BACKLOG, 1},
+};
+
+static double elapsed_s(struct timespec start, struct timespec end)
+{
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void on_client_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+}
+
+// The accept path before the loop: one connection per readiness event
+static void accept_one(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    ServerWorker* worker = (ServerWorker*)data;
+    struct sockaddr_storage client_addr;
+    int client_fd = accept_tcp_connection(fd, (struct sockaddr*)&client_addr, sizeof(client_addr));
+    if (client_fd != -1 && event_loop_add(worker->loop, client_fd, EVENT_READ, on_client_ready, worker) == -1)
+    {
+        remove_tcp_client(client_fd);
+        close(client_fd);
+    }
+}
+
+static void accept_all(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    handle_new_tcp_connection(fd, (ServerWorker*)data);
+}
+
+static void collect_client(TCPConnection* conn, void* arg)
+{
+    int* fds = (int*)arg;
+    fds[fds[0]++ + 1] = conn->fd;
+}
+
+// Opens every connection at once, like clients reconnecting after a broadcast, and holds them until told to exit
+static void run_storm_clients(struct sockaddr_in address, int done_fd)
+{
+    for (int i = 0; i < STORM_CLIENTS; i++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd == -1 || (connect(fd, (struct sockaddr*)&address, sizeof(address)) == -1 && errno != EINPROGRESS))
+        {
+            _exit(EXIT_FAILURE);
+        }
+    }
+    char byte;
+    while (read(done_fd, &byte, 1) == -1 && errno == EINTR)
+    {
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+/*
+ * A child process (so that both ends fit in the descriptor limit) connects STORM_CLIENTS clients at once while the
+ * server admits them from a listener with the given backlog. Connections that overflow the listen queue have their
+ * SYN or handshake dropped and are only retried by the client's kernel after 1, 3, 7... seconds.
+ */
+static void run_storm(FILE* out, const StormConfig* config)
+{
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    ServerWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.loop = event_loop_create(EVENT_BACKEND_EPOLL);
+    int done[2];
+    if (listener == -1 || bind(listener, (struct sockaddr*)&address, address_len) == -1 ||
+        getsockname(listener, (struct sockaddr*)&address, &address_len) == -1 ||
+        listen(listener, config->backlog) == -1 || worker.loop == NULL || pipe(done) == -1 ||
+        event_loop_add(worker.loop, listener, EVENT_READ, config->drain ? accept_all : accept_one, &worker) == -1)
+    {
+        perror("storm setup");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t initial = tcp_connection_count();
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(done[1]);
+        run_storm_clients(address, done[0]);
+    }
+    close(done[0]);
+
+    now = start;
+    while (tcp_connection_count() - initial < STORM_CLIENTS && elapsed_s(start, now) < STORM_DEADLINE_S)
+    {
+        event_loop_run_once(worker.loop, 100);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    size_t admitted = tcp_connection_count() - initial;
+    fprintf(out, "%-34s: %5zu of %d clients admitted in %6.3f s\n", config->name, admitted, STORM_CLIENTS,
+            elapsed_s(start, now));
+
+    close(done[1]);
+    waitpid(child, NULL, 0);
+    int* fds = malloc((tcp_connection_count() + 1) * sizeof(int));
+    if (fds == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    fds[0] = 0;
+    tcp_connection_for_each(collect_client, fds);
+    for (int i = 1; i <= fds[0]; i++)
+    {
+        remove_tcp_client(fds[i]);
+        close(fds[i]);
+    }
+    free(fds);
+    event_loop_destroy(worker.loop);
+    close(listener);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_accept");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (start_event_logger() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "Connection storm of %d clients, gave up after %d s\n", STORM_CLIENTS, STORM_DEADLINE_S);
+    for (size_t i = 0; i < sizeof(STORM_CONFIGS) / sizeof(STORM_CONFIGS[0]); i++)
+    {
+        run_storm(out, &STORM_CONFIGS[i]);
+    }
+    stop_event_logger();
+    return EXIT_SUCCESS;
+}
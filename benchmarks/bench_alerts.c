@@ -0,0 +1,187 @@
+#include "../include/alert_fifo.h"
+#include "../include/alert_ring.h"
+#include "../lib/eventLoop/include/event_loop.h"
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#define ALERTS 20000
+#define ALERT_PERIOD_NS 50000
+
+typedef struct
+{
+    const char* name;
+    int burst;
+} AlertScenario;
+
+static const AlertScenario ALERT_SCENARIOS[] = {
+    {"one alert every 50 us", 1},
+    {"bursts of 64 alerts", 64},
+};
+
+typedef struct
+{
+    AlertFifo fifo;
+    AlertRing ring;
+    int64_t* latencies;
+    int received;
+} AlertConsumer;
+
+static int64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int compare_latencies(const void* a, const void* b)
+{
+    int64_t left = *(const int64_t*)a;
+    int64_t right = *(const int64_t*)b;
+    return (left > right) - (left < right);
+}
+
+// The records carry the monotonic time they were sent at instead of the wall clock
+static void record_latency(const AlertRecord* alert, void* arg)
+{
+    AlertConsumer* consumer = (AlertConsumer*)arg;
+    if (consumer->received < ALERTS)
+    {
+        consumer->latencies[consumer->received++] = now_ns() - alert->timestamp;
+    }
+}
+
+static void on_fifo_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    AlertConsumer* consumer = (AlertConsumer*)data;
+    alert_fifo_read(&consumer->fifo, record_latency, consumer);
+}
+
+static void on_ring_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    AlertConsumer* consumer = (AlertConsumer*)data;
+    alert_ring_drain(&consumer->ring, record_latency, consumer);
+}
+
+// Sends the alerts from another process like the sensors do, through the FIFO when ring is NULL
+static void run_producer(const AlertScenario* scenario, const char* fifo_path, AlertRing* ring)
+{
+    int fd = ring == NULL ? open(fifo_path, O_WRONLY) : -1;
+    if (ring == NULL && fd == -1)
+    {
+        _exit(EXIT_FAILURE);
+    }
+    const struct timespec pause = {0, (long)ALERT_PERIOD_NS * scenario->burst};
+    for (int sent = 0; sent < ALERTS; sent += scenario->burst)
+    {
+        nanosleep(&pause, NULL);
+        for (int i = 0; i < scenario->burst; i++)
+        {
+            AlertRecord record;
+            alert_record_init(&record, ALERT_SENSOR_NORTH, 39.5f, 0);
+            record.timestamp = now_ns();
+            if (ring == NULL)
+            {
+                if (write(fd, &record, sizeof(record)) != sizeof(record))
+                {
+                    _exit(EXIT_FAILURE);
+                }
+            }
+            else
+            {
+                while (alert_ring_push(ring, &record) == -1)
+                {
+                    sched_yield();
+                }
+            }
+        }
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+static void run_case(const AlertScenario* scenario, AlertTransport transport, const char* fifo_path)
+{
+    static AlertConsumer consumer;
+    consumer.fifo.fd = -1;
+    consumer.ring = (AlertRing)ALERT_RING_INITIALIZER;
+    consumer.latencies = malloc(sizeof(int64_t) * ALERTS);
+    consumer.received = 0;
+    EventLoop* loop = event_loop_create(EVENT_BACKEND_EPOLL);
+    if (consumer.latencies == NULL || loop == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    int setup;
+    if (transport == ALERT_TRANSPORT_FIFO)
+    {
+        setup = alert_fifo_open(&consumer.fifo, fifo_path) == -1
+                    ? -1
+                    : event_loop_add(loop, consumer.fifo.fd, EVENT_READ, on_fifo_ready, &consumer);
+    }
+    else
+    {
+        setup = alert_ring_create(&consumer.ring) == -1
+                    ? -1
+                    : event_loop_add(loop, consumer.ring.event_fd, EVENT_READ, on_ring_ready, &consumer);
+    }
+    if (setup == -1)
+    {
+        perror("alert transport setup");
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        run_producer(scenario, fifo_path, transport == ALERT_TRANSPORT_RING ? &consumer.ring : NULL);
+    }
+    while (consumer.received < ALERTS)
+    {
+        event_loop_run_once(loop, 1000);
+    }
+    waitpid(child, NULL, 0);
+
+    qsort(consumer.latencies, ALERTS, sizeof(int64_t), compare_latencies);
+    printf("%-22s %-4s: p50 %7.2f us, p99 %7.2f us, max %8.2f us\n", scenario->name,
+           alert_transport_name(transport), (double)consumer.latencies[ALERTS / 2] / 1e3,
+           (double)consumer.latencies[ALERTS * 99 / 100] / 1e3, (double)consumer.latencies[ALERTS - 1] / 1e3);
+
+    event_loop_destroy(loop);
+    alert_fifo_close(&consumer.fifo);
+    alert_ring_destroy(&consumer.ring);
+    free(consumer.latencies);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/bench_alerts_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    char fifo_path[sizeof(dir) + 16];
+    snprintf(fifo_path, sizeof(fifo_path), "%s/alerts_fifo", dir);
+    if (mkfifo(fifo_path, 0666) == -1)
+    {
+        perror("mkfifo");
+        return EXIT_FAILURE;
+    }
+
+    printf("Latency of %d alerts from a sensors process to the event loop\n", ALERTS);
+    for (size_t i = 0; i < sizeof(ALERT_SCENARIOS) / sizeof(ALERT_SCENARIOS[0]); i++)
+    {
+        run_case(&ALERT_SCENARIOS[i], ALERT_TRANSPORT_FIFO, fifo_path);
+        run_case(&ALERT_SCENARIOS[i], ALERT_TRANSPORT_RING, fifo_path);
+    }
+
+    unlink(fifo_path);
+    rmdir(dir);
+    return EXIT_SUCCESS;
+}
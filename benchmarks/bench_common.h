@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file bench_common.h
+ * @brief Helpers shared by the benchmarks.
+ */
+
+/**
+ * @brief Time between two clock_gettime() readings.
+ *
+ * @param start The first reading.
+ * @param end The second reading.
+ * @return The elapsed time in nanoseconds.
+ */
+static inline double elapsed_ns(struct timespec start, struct timespec end)
+{
+    return (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+}
+
+/**
+ * @brief Keeps the server logs out of the user's home and its chatter out of the results.
+ *
+ * HOME is pointed to a new temporary directory, and stdout and stderr are sent to /dev/null.
+ *
+ * @param name Name of the benchmark, prefix of the temporary directory.
+ * @return An unbuffered stream on the original stdout to print the results to, or NULL on failure.
+ */
+static inline FILE* bench_quiet_server_output(const char* name)
+{
+    char home[64];
+    snprintf(home, sizeof(home), "/tmp/%s_XXXXXX", name);
+    if (mkdtemp(home) == NULL)
+    {
+        perror("mkdtemp");
+        return NULL;
+    }
+    setenv("HOME", home, 1);
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    if (out == NULL || freopen("/dev/null", "w", stdout) == NULL || freopen("/dev/null", "w", stderr) == NULL)
+    {
+        return NULL;
+    }
+    setvbuf(out, NULL, _IONBF, 0);
+    return out;
+}
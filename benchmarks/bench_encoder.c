@@ -0,0 +1,68 @@
+#include "../include/json_encoder.h"
+#include "bench_common.h"
+#include <time.h>
+
+#define ITERATIONS 200000
+
+// Same shape as the response to a summary request
+static cJSON* create_summary(void)
+{
+    cJSON* summary = cJSON_CreateObject();
+    cJSON* alerts = cJSON_AddObjectToObject(summary, "alerts");
+    cJSON_AddNumberToObject(alerts, "north_entry", 3);
+    cJSON_AddNumberToObject(alerts, "east_entry", 0);
+    cJSON_AddNumberToObject(alerts, "west_entry", 1);
+    cJSON_AddNumberToObject(alerts, "south_entry", 7);
+    cJSON* supplies = cJSON_AddObjectToObject(summary, "supplies");
+    cJSON* food = cJSON_AddObjectToObject(supplies, "food");
+    cJSON_AddNumberToObject(food, "meat", 120);
+    cJSON_AddNumberToObject(food, "vegetables", 80);
+    cJSON_AddNumberToObject(food, "fruits", 45);
+    cJSON_AddNumberToObject(food, "water", 300);
+    cJSON* medicine = cJSON_AddObjectToObject(supplies, "medicine");
+    cJSON_AddNumberToObject(medicine, "antibiotics", 12);
+    cJSON_AddNumberToObject(medicine, "analgesics", 30);
+    cJSON_AddNumberToObject(medicine, "bandages", 64);
+    cJSON* emergency = cJSON_AddObjectToObject(summary, "emergency");
+    cJSON_AddStringToObject(emergency, "last_keepalived", "2024-05-01 10:00:00");
+    cJSON_AddStringToObject(emergency, "last_event", "Server failure. Emergency notification sent to all clients.");
+    return summary;
+}
+
+static void run_malloc_case(FILE* out, const char* name, cJSON* json, int pretty)
+{
+    size_t bytes = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        char* printed = pretty ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+        bytes = strlen(printed);
+        free(printed);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "%-24s %8.1f ns/message, %4zu bytes\n", name, elapsed_ns(start, end) / ITERATIONS, bytes);
+}
+
+int main(void)
+{
+    cJSON* summary = create_summary();
+
+    printf("Encoding of a summary response, %d messages\n", ITERATIONS);
+    run_malloc_case(stdout, "cJSON_Print + free", summary, 1);
+    run_malloc_case(stdout, "PrintUnformatted + free", summary, 0);
+
+    size_t bytes = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        json_encode(summary, &bytes);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%-24s %8.1f ns/message, %4zu bytes\n", "json_encode (reused)", elapsed_ns(start, end) / ITERATIONS, bytes);
+
+    json_encoder_release();
+    cJSON_Delete(summary);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include "../lib/eventLoop/include/event_loop.h"
+#include "bench_common.h"
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define WAKEUPS 20000
+
+static const int IDLE_CONNECTIONS[] = {10, 1000, 10000};
+
+// Reads the token written to the active pipe so it is not reported again
+static void on_active_ready(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    char token;
+    if (read(fd, &token, 1) == 1)
+    {
+        (*(long*)data)++;
+    }
+}
+
+static void on_idle_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+}
+
+/*
+ * Idle connections are modeled with eventfds that never become readable, so every descriptor costs one slot in the
+ * interest set exactly like an idle TCP client. The active pipe is created last, which is the worst case for select.
+ */
+static void run_case(EventBackend backend, int idle)
+{
+    int* idle_fds = malloc(sizeof(int) * (size_t)idle);
+    EventLoop* loop = event_loop_create(backend);
+    if (idle_fds == NULL || loop == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    int registered = 0;
+    for (; registered < idle; registered++)
+    {
+        idle_fds[registered] = eventfd(0, EFD_NONBLOCK);
+        if (idle_fds[registered] == -1 ||
+            event_loop_add(loop, idle_fds[registered], EVENT_READ, on_idle_ready, NULL) == -1)
+        {
+            if (idle_fds[registered] != -1)
+            {
+                close(idle_fds[registered]);
+            }
+            break;
+        }
+    }
+
+    int active[2];
+    long handled = 0;
+    if (registered < idle || pipe(active) == -1 ||
+        event_loop_add(loop, active[0], EVENT_READ, on_active_ready, &handled) == -1)
+    {
+        printf("%-7s %6d idle: unsupported (%s)\n", event_loop_backend_name(backend), idle, strerror(errno));
+    }
+    else
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < WAKEUPS; i++)
+        {
+            if (write(active[1], "x", 1) != 1)
+            {
+                perror("write");
+                break;
+            }
+            event_loop_run_once(loop, -1);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("%-7s %6d idle: %9.1f ns/wakeup (%ld handled)\n", event_loop_backend_name(backend), idle,
+               elapsed_ns(start, end) / WAKEUPS, handled);
+        close(active[0]);
+        close(active[1]);
+    }
+
+    for (int i = 0; i < registered; i++)
+    {
+        close(idle_fds[i]);
+    }
+    free(idle_fds);
+    event_loop_destroy(loop);
+}
+
+int main(void)
+{
+    // 10k idle connections need more descriptors than the usual soft limit
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    printf("Event loop wakeup cost, %d wakeups per case\n", WAKEUPS);
+    for (size_t i = 0; i < sizeof(IDLE_CONNECTIONS) / sizeof(IDLE_CONNECTIONS[0]); i++)
+    {
+        run_case(EVENT_BACKEND_EPOLL, IDLE_CONNECTIONS[i]);
+        run_case(EVENT_BACKEND_SELECT, IDLE_CONNECTIONS[i]);
+    }
+    return 0;
+}
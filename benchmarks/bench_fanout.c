@@ -0,0 +1,144 @@
+#include "../include/server.h"
+#include "bench_common.h"
+
+#define ROUNDS 200
+#define FIRST_FAKE_FD 1000
+
+// Topics of the i-th client: one entry each, and the power outages for one client in ten
+static uint32_t client_topics(size_t i)
+{
+    return ALERT_TOPIC_BIT(i % ALERT_SENSOR_COUNT) | (i % 10 == 0 ? ALERT_TOPIC_BIT(ALERT_TOPIC_POWER) : 0);
+}
+
+// Copy of every client, then filtered at send time: what the broadcast did before the subscriber lists
+static size_t collect_by_scan(const UDPClientRegistry* registry, AlertTopic topic, UDPClientEntry* clients)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < registry->capacity; i++)
+    {
+        if (registry->slots[i].used)
+        {
+            clients[count++] = registry->slots[i];
+        }
+    }
+    size_t targets = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        targets += (clients[i].topics & ALERT_TOPIC_BIT(topic)) != 0;
+    }
+    return targets;
+}
+
+/*
+ * One north entry alert among n UDP clients spread over the topics: the clients to send to are gathered by scanning
+ * the whole table, or from the subscriber list of the topic. The time is what the broadcast spends holding the
+ * registry lock.
+ */
+static void run_udp(FILE* out, size_t n)
+{
+    UDPClientRegistry registry = UDP_REGISTRY_INITIALIZER(n);
+    UDPClientEntry* clients = malloc(sizeof(UDPClientEntry) * n);
+    if (clients == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons((uint16_t)(1024 + i % 60000)),
+                                      .sin_addr.s_addr = htonl((uint32_t)(0x0A000000 + i / 60000))};
+        udp_registry_touch(&registry, (struct sockaddr*)&address, sizeof(address), 3, 0);
+        udp_registry_subscribe(&registry, (struct sockaddr*)&address, sizeof(address), client_topics(i));
+    }
+
+    size_t scanned = 0, collected = 0;
+    struct timespec start, middle, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        scanned += collect_by_scan(&registry, ALERT_TOPIC_NORTH_ENTRY, clients);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &middle);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        collected += udp_registry_collect(&registry, ALERT_TOPIC_NORTH_ENTRY, clients);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "udp %7zu clients: %6zu targets, %10.1f ns full scan, %10.1f ns subscribers\n", registry.count,
+            scanned / ROUNDS, elapsed_ns(start, middle) / ROUNDS, elapsed_ns(middle, end) / ROUNDS);
+    if (scanned != collected)
+    {
+        fprintf(out, "udp subscribers differ from the scan: %zu vs %zu\n", collected / ROUNDS, scanned / ROUNDS);
+    }
+    udp_registry_clear(&registry);
+    free(clients);
+}
+
+static void count_target(TCPConnection* conn, void* arg)
+{
+    (void)conn;
+    (*(size_t*)arg)++;
+}
+
+static void count_if_subscribed(TCPConnection* conn, void* arg)
+{
+    *(size_t*)arg += (conn->topics & ALERT_TOPIC_BIT(ALERT_TOPIC_NORTH_ENTRY)) != 0;
+}
+
+// The same alert among n TCP connections, on descriptors that are never used for I/O
+static void run_tcp(FILE* out, int n)
+{
+    int opened = 0;
+    while (opened < n && tcp_connection_open(FIRST_FAKE_FD + opened) != NULL)
+    {
+        tcp_connection_subscribe(tcp_connection_get(FIRST_FAKE_FD + opened), client_topics((size_t)opened));
+        opened++;
+    }
+    if (opened == n)
+    {
+        size_t scanned = 0, visited = 0;
+        struct timespec start, middle, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            tcp_connection_for_each(count_if_subscribed, &scanned);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &middle);
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            tcp_connection_for_each_subscriber(ALERT_TOPIC_NORTH_ENTRY, count_target, &visited);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        fprintf(out, "tcp %7d clients: %6zu targets, %10.1f ns full scan, %10.1f ns subscribers\n", n,
+                scanned / ROUNDS, elapsed_ns(start, middle) / ROUNDS, elapsed_ns(middle, end) / ROUNDS);
+    }
+    else
+    {
+        fprintf(out, "tcp %7d clients: skipped, descriptors past %d are over the limit\n", n,
+                FIRST_FAKE_FD + opened);
+    }
+    for (int i = 0; i < opened; i++)
+    {
+        tcp_connection_close(FIRST_FAKE_FD + i);
+    }
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_fanout");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "Clients to notify of a north entry alert, %d rounds per case\n", ROUNDS);
+    const size_t sizes[] = {1000, 10000, 100000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        run_udp(out, sizes[i]);
+    }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        run_tcp(out, (int)sizes[i]);
+    }
+    return EXIT_SUCCESS;
+}
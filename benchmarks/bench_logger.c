@@ -0,0 +1,66 @@
+#include "../include/server.h"
+#include "bench_common.h"
+
+#define SYNC_EVENTS 20000
+#define ASYNC_EVENTS 200000
+#define ASYNC_BURST 1024
+
+/*
+ * Cost of log_event() as seen by a request handler. Asynchronous events are logged in bursts smaller than the ring and
+ * the logger is flushed between bursts, outside of the measured time, so no event is dropped.
+ */
+static double time_events(int events, int burst)
+{
+    char message[BUFFER_256];
+    double ns = 0;
+    for (int done = 0; done < events; done += burst)
+    {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < burst; i++)
+        {
+            snprintf(message, sizeof(message), "Status request from TCP client 127.0.0.1 (%d)", done + i);
+            log_event(message);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns += elapsed_ns(start, end);
+        if (atomic_load(&event_logger.running))
+        {
+            logger_flush(&event_logger);
+        }
+    }
+    return ns / events;
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_logger");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "log_event() cost per call\n");
+    fprintf(out, "%-28s %8.1f ns/event\n", "synchronous (fopen/fclose)", time_events(SYNC_EVENTS, SYNC_EVENTS));
+
+    const LoggerFsyncPolicy policies[] = {LOGGER_FSYNC_NONE, LOGGER_FSYNC_BATCH};
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+    {
+        server_config.log_fsync_policy = policies[i];
+        if (start_event_logger() == -1)
+        {
+            return EXIT_FAILURE;
+        }
+        double ns = time_events(ASYNC_EVENTS, ASYNC_BURST);
+        LoggerStats stats;
+        logger_get_stats(&event_logger, &stats);
+        stop_event_logger();
+
+        char name[64];
+        snprintf(name, sizeof(name), "asynchronous (fsync %s)", logger_fsync_policy_name(policies[i]));
+        fprintf(out, "%-28s %8.1f ns/event, %llu writes, %llu dropped\n", name, ns,
+                (unsigned long long)stats.batches, (unsigned long long)stats.dropped);
+    }
+    fclose(out);
+    return EXIT_SUCCESS;
+}
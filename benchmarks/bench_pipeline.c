@@ -0,0 +1,130 @@
+#include "../include/server.h"
+#include "bench_common.h"
+
+#define REQUESTS_PER_DEPTH 4096
+
+static const int PIPELINE_DEPTHS[] = {1, 8, 64};
+
+// Reads length-prefixed responses until 'expected' of them have arrived
+static int read_responses(int fd, int expected)
+{
+    static char buffer[1 << 20];
+    size_t len = 0;
+    int responses = 0;
+    while (responses < expected)
+    {
+        ssize_t received = recv(fd, buffer + len, sizeof(buffer) - len, 0);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        len += (size_t)received;
+
+        size_t offset = 0;
+        while (len - offset >= FRAME_LENGTH_HEADER)
+        {
+            const unsigned char* header = (const unsigned char*)buffer + offset;
+            size_t payload_len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) |
+                                 (size_t)header[3];
+            if (len - offset < FRAME_LENGTH_HEADER + payload_len)
+            {
+                break;
+            }
+            offset += FRAME_LENGTH_HEADER + payload_len;
+            responses++;
+        }
+        memmove(buffer, buffer + offset, len - offset);
+        len -= offset;
+    }
+    return responses;
+}
+
+/*
+ * The client and the server ends of a socketpair live in the same thread: the client writes 'depth' status requests
+ * back-to-back, the server handles them in one check_tcp_clients_messages() call and the client reads every response.
+ */
+static void run_depth(FILE* out, int depth)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+    {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    if (add_tcp_client(fds[0], "127.0.0.1") == -1)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    const char* request = "{\"message\":\"status\"}";
+    size_t request_len = strlen(request);
+    size_t frame_len = FRAME_LENGTH_HEADER + request_len;
+    char* batch = malloc(1 + frame_len * (size_t)depth);
+    if (batch == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < depth; i++)
+    {
+        char* frame = batch + 1 + frame_len * (size_t)i;
+        frame[0] = 0;
+        frame[1] = 0;
+        frame[2] = (char)(request_len >> 8);
+        frame[3] = (char)request_len;
+        memcpy(frame + FRAME_LENGTH_HEADER, request, request_len);
+    }
+
+    // The magic byte negotiates length-prefixed framing with the first batch
+    batch[0] = FRAMING_LENGTH_PREFIX_MAGIC;
+    char* first = batch;
+    size_t first_len = 1 + frame_len * (size_t)depth;
+
+    int rounds = REQUESTS_PER_DEPTH / depth;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < rounds; round++)
+    {
+        const char* data = round == 0 ? first : batch + 1;
+        size_t data_len = round == 0 ? first_len : first_len - 1;
+        if (send(fds[1], data, data_len, 0) != (ssize_t)data_len || !check_tcp_clients_messages(fds[0]) ||
+            read_responses(fds[1], depth) != depth)
+        {
+            fprintf(out, "depth %d: round %d failed\n", depth, round);
+            exit(EXIT_FAILURE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int requests = rounds * depth;
+    double ns = elapsed_ns(start, end);
+    fprintf(out, "depth %3d: %8.0f req/s, %6.2f us/request\n", depth, requests / (ns / 1e9), ns / 1e3 / requests);
+
+    remove_tcp_client(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+    free(batch);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_pipeline");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    init_shared_memory_supplies();
+    // Log like the server does, through the asynchronous logger
+    if (start_event_logger() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "Pipelined status requests over one connection, %d requests per depth\n", REQUESTS_PER_DEPTH);
+    for (size_t i = 0; i < sizeof(PIPELINE_DEPTHS) / sizeof(PIPELINE_DEPTHS[0]); i++)
+    {
+        run_depth(out, PIPELINE_DEPTHS[i]);
+    }
+    stop_event_logger();
+    return EXIT_SUCCESS;
+}
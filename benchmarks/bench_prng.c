@@ -0,0 +1,75 @@
+#include "../lib/prng/include/prng.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DRAWS_PER_THREAD 2000000
+
+static const int THREAD_COUNTS[] = {1, 4};
+
+static double elapsed_s(struct timespec start, struct timespec end)
+{
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// The sums are returned so that the draws are not optimized away
+static void* draw_rand(void* arg)
+{
+    unsigned long sum = 0;
+    for (int i = 0; i < DRAWS_PER_THREAD; i++)
+    {
+        sum += (unsigned long)(rand() % 40);
+    }
+    *(unsigned long*)arg = sum;
+    return NULL;
+}
+
+static void* draw_prng(void* arg)
+{
+    Prng* rng = prng_thread();
+    unsigned long sum = 0;
+    for (int i = 0; i < DRAWS_PER_THREAD; i++)
+    {
+        sum += prng_below(rng, 40);
+    }
+    *(unsigned long*)arg = sum;
+    return NULL;
+}
+
+static void run_case(const char* name, void* (*draw)(void*), int threads)
+{
+    pthread_t workers[4];
+    unsigned long sums[4];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++)
+    {
+        if (pthread_create(&workers[i], NULL, draw, &sums[i]) != 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    unsigned long total = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+        total += sums[i];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%-14s %d thread(s): %7.1f M draws/s (checksum %lu)\n", name, threads,
+           (double)DRAWS_PER_THREAD * threads / elapsed_s(start, end) / 1e6, total % 1000);
+}
+
+int main(void)
+{
+    srand(42);
+    prng_set_seed(42);
+    printf("Random numbers below 40, %d draws per thread\n", DRAWS_PER_THREAD);
+    for (size_t i = 0; i < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); i++)
+    {
+        run_case("rand()", draw_rand, THREAD_COUNTS[i]);
+        run_case("prng_thread()", draw_prng, THREAD_COUNTS[i]);
+    }
+    return EXIT_SUCCESS;
+}
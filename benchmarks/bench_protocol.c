@@ -0,0 +1,76 @@
+#include "../include/server.h"
+#include "bench_common.h"
+
+#define REQUESTS 100000
+
+// Stands in for a transport: the responses are only counted
+static void count_reply(const char* response, size_t len, void* arg)
+{
+    (void)response;
+    *(size_t*)arg += len;
+}
+
+/*
+ * Every request is read and processed exactly as a transport would, through request_scan() and protocol_handle(),
+ * with no socket involved: what is left is the cost of the request processing itself.
+ */
+static void run_request(FILE* out, const char* name, const char* data, int stateless)
+{
+    size_t reply_bytes = 0;
+    // An authenticated connection, or a datagram whose update is authorized by its token
+    ProtocolSession session = {stateless ? PROTOCOL_UDP : PROTOCOL_TCP, "127.0.0.1", stateless, !stateless, count_reply,
+                               &reply_bytes, 0, NULL};
+    size_t len = strlen(data);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        Request request;
+        if (request_scan(data, len, &request) == -1 || protocol_handle(&session, &request) != PROTOCOL_DONE)
+        {
+            fprintf(out, "%s request rejected\n", name);
+            return;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "%-14s %8.1f ns/request, %5zu response bytes/request\n", name, elapsed_ns(start, end) / REQUESTS,
+            reply_bytes / REQUESTS);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_protocol");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    init_shared_memory_supplies();
+    // Log like the server does, through the asynchronous logger
+    if (start_event_logger() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "Requests processed by the protocol core without sockets, %d per message\n", REQUESTS);
+    run_request(out, "status", "{\"message\":\"status\"}", 0);
+    run_request(out, "summary", "{\"message\":\"summary\"}", 0);
+    run_request(out, "update", "{\"message\":\"update\",\"food\":{\"meat\":1},\"medicine\":{\"bandages\":1}}", 0);
+    run_request(out, "stats", "{\"message\":\"stats\"}", 0);
+
+    if (auth_token_init() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+    char token[AUTH_TOKEN_LEN + 1];
+    auth_token_issue("127.0.0.1", time(NULL), token);
+    char update[BUFFER_256];
+    snprintf(update, sizeof(update),
+             "{\"message\":\"update\",\"hostname\":\"h\",\"token\":\"%s\",\"food\":{\"meat\":1},"
+             "\"medicine\":{\"bandages\":1}}",
+             token);
+    run_request(out, "update (token)", update, 1);
+    stop_event_logger();
+    return EXIT_SUCCESS;
+}
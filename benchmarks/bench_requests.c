@@ -0,0 +1,151 @@
+#include "../include/server.h"
+#include "bench_common.h"
+#include <netinet/tcp.h>
+
+#define REQUESTS_PER_RUN 20000
+
+static void on_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+}
+
+// Reads one length-prefixed response
+static int read_response(int fd)
+{
+    char buffer[BUFFER_SIZE];
+    size_t len = 0;
+    while (len < FRAME_LENGTH_HEADER)
+    {
+        ssize_t received = recv(fd, buffer + len, FRAME_LENGTH_HEADER - len, 0);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        len += (size_t)received;
+    }
+    const unsigned char* header = (const unsigned char*)buffer;
+    size_t remaining =
+        ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+    while (remaining > 0)
+    {
+        ssize_t received = recv(fd, buffer, remaining < sizeof(buffer) ? remaining : sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        remaining -= (size_t)received;
+    }
+    return 0;
+}
+
+/*
+ * A loopback TCP client sends small status requests one at a time and waits for every response, while the same thread
+ * serves the accepted connection like a worker does. With 'resolve' set the cached address of the connection is
+ * cleared before every request, so each one pays a getpeername() and an inet_ntop() again, as every request did before
+ * the address was kept in the connection state.
+ */
+static void run_requests(FILE* out, const char* name, int resolve)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if (listener == -1 || bind(listener, (struct sockaddr*)&address, address_len) == -1 ||
+        getsockname(listener, (struct sockaddr*)&address, &address_len) == -1 || listen(listener, 1) == -1)
+    {
+        perror("listener setup");
+        exit(EXIT_FAILURE);
+    }
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client == -1 || connect(client, (struct sockaddr*)&address, address_len) == -1)
+    {
+        perror("client setup");
+        exit(EXIT_FAILURE);
+    }
+    int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_storage peer;
+    int server_fd = accept_tcp_connection(listener, (struct sockaddr*)&peer, sizeof(peer));
+    ServerWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.loop = event_loop_create(EVENT_BACKEND_EPOLL);
+    if (server_fd == -1 || worker.loop == NULL || event_loop_add(worker.loop, server_fd, EVENT_READ, on_ready, NULL))
+    {
+        perror("server setup");
+        exit(EXIT_FAILURE);
+    }
+    TCPConnection* conn = tcp_connection_get(server_fd);
+
+    const char* request = "{\"message\":\"status\"}";
+    size_t request_len = strlen(request);
+    char frame[1 + FRAME_LENGTH_HEADER + BUFFER_256];
+    frame[0] = FRAMING_LENGTH_PREFIX_MAGIC;
+    frame[1] = 0;
+    frame[2] = 0;
+    frame[3] = (char)(request_len >> 8);
+    frame[4] = (char)request_len;
+    memcpy(frame + 1 + FRAME_LENGTH_HEADER, request, request_len);
+    size_t frame_len = FRAME_LENGTH_HEADER + request_len;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < REQUESTS_PER_RUN; i++)
+    {
+        if (resolve)
+        {
+            conn->peer[0] = '\0';
+        }
+        // The magic byte negotiates length-prefixed framing with the first request
+        const char* data = i == 0 ? frame : frame + 1;
+        size_t data_len = i == 0 ? frame_len + 1 : frame_len;
+        if (send(client, data, data_len, 0) != (ssize_t)data_len)
+        {
+            fprintf(out, "%s: request %d failed\n", name, i);
+            exit(EXIT_FAILURE);
+        }
+        handle_tcp_socket_activity(server_fd, &worker);
+        if (read_response(client) == -1)
+        {
+            fprintf(out, "%s: response %d failed\n", name, i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = elapsed_ns(start, end);
+    fprintf(out, "%-8s: %8.0f req/s, %6.2f us/request\n", name, REQUESTS_PER_RUN / (ns / 1e9),
+            ns / 1e3 / REQUESTS_PER_RUN);
+
+    event_loop_remove(worker.loop, server_fd);
+    remove_tcp_client(server_fd);
+    close(server_fd);
+    event_loop_destroy(worker.loop);
+    close(client);
+    close(listener);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_requests");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    init_shared_memory_supplies();
+    if (start_event_logger() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "Small status requests over loopback TCP, one at a time, %d requests per run\n", REQUESTS_PER_RUN);
+    run_requests(out, "resolved", 1);
+    run_requests(out, "cached", 0);
+    stop_event_logger();
+    return EXIT_SUCCESS;
+}
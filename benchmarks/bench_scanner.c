@@ -0,0 +1,100 @@
+#include "../include/request_scanner.h"
+#include "bench_common.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS 500000
+
+// What the server used to do per request: build the tree, look the fields up and compare the message with strcmp
+static int dispatch_with_cjson(const char* data, size_t len)
+{
+    cJSON* json = cJSON_ParseWithLength(data, len);
+    if (json == NULL)
+    {
+        return -1;
+    }
+    int type = REQUEST_NO_MESSAGE;
+    cJSON* message = cJSON_GetObjectItem(json, "message");
+    if (cJSON_IsString(message))
+    {
+        const char* value = message->valuestring;
+        if (strcmp(value, "authenticateme") == 0)
+        {
+            type = REQUEST_AUTHENTICATE;
+        }
+        else if (strcmp(value, "status") == 0)
+        {
+            type = REQUEST_STATUS;
+        }
+        else if (strcmp(value, "update") == 0)
+        {
+            type = REQUEST_UPDATE;
+            cJSON* food = cJSON_GetObjectItem(json, "food");
+            cJSON* water = cJSON_GetObjectItem(food, "water");
+            type += cJSON_IsNumber(water) ? water->valueint : 0;
+        }
+        else if (strcmp(value, "summary") == 0)
+        {
+            type = REQUEST_SUMMARY;
+        }
+        else if (strcmp(value, "stats") == 0)
+        {
+            type = REQUEST_STATS;
+        }
+        else
+        {
+            type = REQUEST_UNKNOWN;
+        }
+    }
+    else if (message != NULL)
+    {
+        type = REQUEST_INVALID;
+    }
+    cJSON* hostname = cJSON_GetObjectItem(json, "hostname");
+    type += cJSON_IsString(hostname) ? (int)strlen(hostname->valuestring) : 0;
+    cJSON_Delete(json);
+    return type;
+}
+
+static int dispatch_with_scanner(const char* data, size_t len)
+{
+    Request request;
+    if (request_scan(data, len, &request) == -1)
+    {
+        return -1;
+    }
+    return (int)request.type + (int)request.hostname_len + request.food.water;
+}
+
+static void run_case(FILE* out, const char* name, const char* request, int (*dispatch)(const char*, size_t))
+{
+    size_t len = strlen(request);
+    long checksum = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        checksum += dispatch(request, len);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "  %-16s %8.1f ns/request (checksum %ld)\n", name, elapsed_ns(start, end) / ITERATIONS, checksum);
+}
+
+int main(void)
+{
+    const char* requests[][2] = {
+        {"status", "{\"message\": \"status\", \"hostname\": \"client-01\"}"},
+        {"update",
+         "{\"message\": \"update\", \"hostname\": \"ubuntu\", \"food\": {\"meat\": 10, \"vegetables\": 5, "
+         "\"fruits\": 3, \"water\": 20}, \"medicine\": {\"antibiotics\": 2, \"analgesics\": 4, \"bandages\": 8}}"},
+    };
+
+    printf("Reading and dispatching a request, %d requests\n", ITERATIONS);
+    for (size_t i = 0; i < sizeof(requests) / sizeof(requests[0]); i++)
+    {
+        printf("%s (%zu bytes)\n", requests[i][0], strlen(requests[i][1]));
+        run_case(stdout, "cJSON + strcmp", requests[i][1], dispatch_with_cjson);
+        run_case(stdout, "request_scan", requests[i][1], dispatch_with_scanner);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "../lib/alertInfection/include/sensor_bank.h"
+#include "../lib/prng/include/prng.h"
+#include "bench_common.h"
+
+#define SENSORS 100000
+#define TICKS 200
+#define ALERT_PROBABILITY 0.001f
+
+// Counts the alerts instead of writing them, only the simulation is measured
+static void count_alert(const AlertRecord* record, void* arg)
+{
+    (void)record;
+    (*(long*)arg)++;
+}
+
+// One Sensor struct per sensor, updated with get_temperature() and checked one by one
+static void run_structs(FILE* out)
+{
+    Sensor* sensors = malloc(sizeof(Sensor) * SENSORS);
+    if (sensors == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < SENSORS; i++)
+    {
+        sensors[i].id = (AlertSensor)(i % ALERT_SENSOR_COUNT);
+        snprintf(sensors[i].name, sizeof(sensors[i].name), "%s", alert_sensor_name(sensors[i].id));
+    }
+
+    long alerts = 0;
+    set_alert_sink(count_alert, &alerts);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int tick = 0; tick < TICKS; tick++)
+    {
+        update_sensor_values(sensors, SENSORS);
+        check_temperature_threshold(sensors, SENSORS);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "%-26s: %8.1f us per tick, %6ld alerts\n", "Sensor structs",
+            elapsed_ns(start, end) / TICKS / 1e3, alerts);
+    free(sensors);
+}
+
+static void run_bank(FILE* out)
+{
+    SensorBank bank;
+    if (sensor_bank_init(&bank, SENSORS, 42, ALERT_PROBABILITY) == -1)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    long alerts = 0;
+    set_alert_sink(count_alert, &alerts);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int tick = 0; tick < TICKS; tick++)
+    {
+        sensor_bank_update(&bank);
+        sensor_bank_check_threshold(&bank);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(out, "%-26s: %8.1f us per tick, %6ld alerts\n", "SensorBank", elapsed_ns(start, end) / TICKS / 1e3,
+            alerts);
+    sensor_bank_free(&bank);
+}
+
+int main(void)
+{
+    prng_set_seed(42);
+    set_alert_probability(ALERT_PROBABILITY);
+    printf("Update and threshold check of %d sensors, %d ticks\n", SENSORS, TICKS);
+    run_structs(stdout);
+    run_bank(stdout);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "../include/server.h"
+#include "bench_common.h"
+#include <poll.h>
+
+#define FLOOD_PACKETS 50000
+#define FLOOD_BURST 64
+#define IDLE_TIMEOUT_MS 300
+
+typedef struct
+{
+    int fd;
+    UDPBatch* batch;
+    atomic_int stop;
+    int wakeups;
+    double cpu_ns;
+} FloodServer;
+
+typedef struct
+{
+    int fd;
+    int answered;
+    struct timespec last;
+} FloodReceiver;
+
+// Serves the socket like a worker does, until the flood is over
+static void* serve(void* arg)
+{
+    FloodServer* server = (FloodServer*)arg;
+    struct pollfd ready = {.fd = server->fd, .events = POLLIN, .revents = 0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    while (!atomic_load(&server->stop))
+    {
+        if (poll(&ready, 1, 50) > 0)
+        {
+            handle_udp_socket_activity(server->fd, server->batch);
+            server->wakeups++;
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    server->cpu_ns = elapsed_ns(start, end);
+    return NULL;
+}
+
+// Counts the responses until none arrived for IDLE_TIMEOUT_MS
+static void* receive_responses(void* arg)
+{
+    FloodReceiver* receiver = (FloodReceiver*)arg;
+    char buffer[BUFFER_SIZE];
+    struct pollfd ready = {.fd = receiver->fd, .events = POLLIN, .revents = 0};
+    while (poll(&ready, 1, IDLE_TIMEOUT_MS) > 0)
+    {
+        while (recv(receiver->fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0)
+        {
+            receiver->answered++;
+            clock_gettime(CLOCK_MONOTONIC, &receiver->last);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * A client floods the server socket with status requests, in bursts of FLOOD_BURST datagrams, while the server thread
+ * drains it either one datagram per wakeup or in batches. Requests lost because the socket buffer overflowed are never
+ * answered and count as drops.
+ */
+static void run_flood(FILE* out, const char* name, int batched)
+{
+    FloodServer server = {.fd = socket(AF_INET, SOCK_DGRAM, 0), .batch = batched ? udp_batch_create() : NULL,
+                          .wakeups = 0, .cpu_ns = 0};
+    FloodReceiver receiver = {.fd = socket(AF_INET, SOCK_DGRAM, 0), .answered = 0};
+    atomic_init(&server.stop, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if (server.fd == -1 || receiver.fd == -1 || (batched && server.batch == NULL) ||
+        bind(server.fd, (struct sockaddr*)&address, address_len) == -1 ||
+        getsockname(server.fd, (struct sockaddr*)&address, &address_len) == -1)
+    {
+        perror("flood setup");
+        exit(EXIT_FAILURE);
+    }
+
+    const char* request = "{\"message\":\"status\",\"hostname\":\"bench\"}";
+    struct iovec iov = {.iov_base = (void*)request, .iov_len = strlen(request)};
+    struct mmsghdr burst[FLOOD_BURST];
+    memset(burst, 0, sizeof(burst));
+    for (int i = 0; i < FLOOD_BURST; i++)
+    {
+        burst[i].msg_hdr.msg_name = &address;
+        burst[i].msg_hdr.msg_namelen = address_len;
+        burst[i].msg_hdr.msg_iov = &iov;
+        burst[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    pthread_t server_thread;
+    pthread_t receiver_thread;
+    pthread_create(&server_thread, NULL, serve, &server);
+    pthread_create(&receiver_thread, NULL, receive_responses, &receiver);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    receiver.last = start;
+    int sent = 0;
+    while (sent < FLOOD_PACKETS)
+    {
+        int result = sendmmsg(receiver.fd, burst, FLOOD_BURST, 0);
+        if (result > 0)
+        {
+            sent += result;
+        }
+    }
+
+    pthread_join(receiver_thread, NULL);
+    atomic_store(&server.stop, 1);
+    pthread_join(server_thread, NULL);
+
+    double ns = elapsed_ns(start, receiver.last);
+    fprintf(out, "%-8s: %8.0f responses/s, %6.2f%% dropped (%d of %d answered), %5.2f us server CPU/response, ",
+            name, receiver.answered / (ns / 1e9), 100.0 * (sent - receiver.answered) / sent, receiver.answered, sent,
+            server.cpu_ns / 1e3 / receiver.answered);
+    fprintf(out, "%d wakeups\n", server.wakeups);
+
+    udp_batch_destroy(server.batch);
+    close(server.fd);
+    close(receiver.fd);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_udp");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    init_shared_memory_supplies();
+    if (start_event_logger() == -1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "UDP flood of %d status requests in bursts of %d, batches of up to %d datagrams\n", FLOOD_PACKETS,
+            FLOOD_BURST, UDP_BATCH_SIZE);
+    run_flood(out, "single", 0);
+    run_flood(out, "batched", 1);
+    stop_event_logger();
+    return EXIT_SUCCESS;
+}
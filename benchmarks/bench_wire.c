@@ -0,0 +1,177 @@
+#include "../include/server.h"
+#include "bench_common.h"
+
+#define ITERATIONS 200000
+
+// Writes a message into the buffer and returns its length, 0 on failure
+typedef size_t (*Encoder)(uint8_t* buffer, size_t size);
+
+// Reads a message back the way its receiver does, returns a value depending on its content
+typedef long (*Decoder)(const uint8_t* data, size_t len);
+
+static const AlertRecord bench_alert = {ALERT_RECORD_VERSION, ALERT_SENSOR_NORTH, 395, {0}, 1700000000};
+
+static cJSON* update_request;
+
+static size_t encode_json(cJSON* json, uint8_t* buffer, size_t size)
+{
+    size_t len = 0;
+    const char* text = json == NULL ? NULL : json_encode(json, &len);
+    if (text == NULL || len >= size)
+    {
+        len = 0;
+    }
+    else
+    {
+        memcpy(buffer, text, len);
+    }
+    cJSON_Delete(json);
+    return len;
+}
+
+static size_t status_json(uint8_t* buffer, size_t size)
+{
+    return encode_json(create_status_json(), buffer, size);
+}
+
+static size_t summary_json(uint8_t* buffer, size_t size)
+{
+    return encode_json(create_summary_json(), buffer, size);
+}
+
+static size_t alert_text(uint8_t* buffer, size_t size)
+{
+    return (size_t)alert_record_format(&bench_alert, (char*)buffer, size);
+}
+
+static size_t alert_wire(uint8_t* buffer, size_t size)
+{
+    return encode_alert_wire(&bench_alert, buffer, size);
+}
+
+// A client sends its update as a printed cJSON tree, or encodes the same tree
+static size_t update_json(uint8_t* buffer, size_t size)
+{
+    if (!cJSON_PrintPreallocated(update_request, (char*)buffer, (int)size, 0))
+    {
+        return 0;
+    }
+    return strlen((const char*)buffer);
+}
+
+static size_t update_wire(uint8_t* buffer, size_t size)
+{
+    return wire_encode_json_request(update_request, buffer, size);
+}
+
+// What a client does with a JSON response
+static long parse_json(const uint8_t* data, size_t len)
+{
+    cJSON* json = cJSON_ParseWithLength((const char*)data, len);
+    long items = json == NULL ? -1 : cJSON_GetArraySize(json);
+    cJSON_Delete(json);
+    return items;
+}
+
+// What a client does with a binary response: every field read in place, the integers decoded
+static long walk_wire(const uint8_t* data, size_t len)
+{
+    WireReader reader;
+    WireField field;
+    int type;
+    long sum = 0;
+    if (wire_reader_init(&reader, data, len, &type) == -1)
+    {
+        return -1;
+    }
+    while (wire_next_field(&reader, &field) == 1)
+    {
+        int64_t value;
+        sum += wire_field_int(&field, &value) == 0 ? (long)value : (long)field.len;
+    }
+    return sum;
+}
+
+static long scan_request(const uint8_t* data, size_t len)
+{
+    Request request;
+    return request_scan((const char*)data, len, &request) == -1 ? -1 : request.food.meat + request.medicine.bandages;
+}
+
+static long read_wire_request(const uint8_t* data, size_t len)
+{
+    Request request;
+    return request_from_wire((const char*)data, len, &request) == -1 ? -1
+                                                                      : request.food.meat + request.medicine.bandages;
+}
+
+static void run_case(FILE* out, const char* name, Encoder encode, Decoder decode)
+{
+    uint8_t message[WIRE_MAX_MESSAGE];
+    size_t len = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        len = encode(message, sizeof(message));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (len == 0)
+    {
+        fprintf(out, "%s could not be encoded\n", name);
+        return;
+    }
+    double encode_ns = elapsed_ns(start, end) / ITERATIONS;
+
+    // Alerts in text are displayed as they are: nothing to decode
+    if (decode == NULL)
+    {
+        fprintf(out, "%-16s %8.1f ns encode, %10s, %4zu bytes\n", name, encode_ns, "-", len);
+        return;
+    }
+    long checksum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        checksum += decode(message, len);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (checksum < 0)
+    {
+        fprintf(out, "%s could not be decoded\n", name);
+        return;
+    }
+    fprintf(out, "%-16s %8.1f ns encode, %6.1f ns decode, %4zu bytes\n", name, encode_ns,
+            elapsed_ns(start, end) / ITERATIONS, len);
+}
+
+int main(void)
+{
+    FILE* out = bench_quiet_server_output("bench_wire");
+    if (out == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    init_shared_memory_supplies();
+    update_request = cJSON_Parse("{\"message\":\"update\",\"hostname\":\"ubuntu\",\"food\":{\"meat\":10,\"water\":-5},"
+                                 "\"medicine\":{\"bandages\":3}}");
+    if (update_request == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "JSON vs binary messages, %d per case\n", ITERATIONS);
+    run_case(out, "status json", status_json, parse_json);
+    run_case(out, "status binary", encode_status_wire, walk_wire);
+    run_case(out, "summary json", summary_json, parse_json);
+    run_case(out, "summary binary", encode_summary_wire, walk_wire);
+    run_case(out, "alert text", alert_text, NULL);
+    run_case(out, "alert binary", alert_wire, walk_wire);
+    run_case(out, "update json", update_json, scan_request);
+    run_case(out, "update binary", update_wire, read_wire_request);
+
+    cJSON_Delete(update_request);
+    json_encoder_release();
+    return EXIT_SUCCESS;
+}
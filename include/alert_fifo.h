@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../lib/alertInfection/include/alertInfection.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @file alert_fifo.h
+ * @brief Reader of the alerts FIFO.
+ *
+ * The FIFO is opened once, read-write and non-blocking: holding a write end means it never reports end-of-file when
+ * the sensors process reopens it or restarts, and no alert is lost between two events. Writers send one AlertRecord
+ * per write(), so the stream is split by record size and a record cut by the end of a read is completed by the next
+ * one.
+ */
+
+#define ALERT_FIFO_BUFFER_SIZE (256 * sizeof(AlertRecord))
+#define ALERT_FIFO_MAX_READS 16
+
+/**
+ * @brief Called for every alert read from the FIFO.
+ *
+ * @param alert The alert, valid only during the call.
+ * @param arg The argument given to alert_fifo_read().
+ */
+typedef void (*AlertHandler)(const AlertRecord* alert, void* arg);
+
+/**
+ * @struct AlertFifo
+ * @brief Open FIFO and the beginning of a record not received yet.
+ *
+ * @var AlertFifo::fd
+ * Descriptor of the FIFO, -1 when closed.
+ *
+ * @var AlertFifo::buffer
+ * Bytes read and not handled yet.
+ *
+ * @var AlertFifo::len
+ * Number of bytes in buffer.
+ *
+ * @var AlertFifo::invalid
+ * Number of records dropped because of their version or sensor.
+ */
+typedef struct
+{
+    int fd;
+    char buffer[ALERT_FIFO_BUFFER_SIZE];
+    size_t len;
+    unsigned long invalid;
+} AlertFifo;
+
+/**
+ * @brief Opens the FIFO for the lifetime of the reader.
+ *
+ * @param fifo The reader.
+ * @param path Path of an existing FIFO.
+ * @return 0 on success, -1 on error.
+ */
+int alert_fifo_open(AlertFifo* fifo, const char* path);
+
+/**
+ * @brief Closes the FIFO and drops a partial record.
+ *
+ * @param fifo The reader, may be closed already.
+ */
+void alert_fifo_close(AlertFifo* fifo);
+
+/**
+ * @brief Reads the FIFO until it is empty, or ALERT_FIFO_MAX_READS times, and handles every complete record.
+ *
+ * Records failing alert_record_valid() are dropped and counted.
+ *
+ * @param fifo The reader.
+ * @param handler Called for every alert, in order.
+ * @param arg Passed to the handler.
+ * @return Number of alerts handled, -1 on error.
+ */
+int alert_fifo_read(AlertFifo* fifo, AlertHandler handler, void* arg);
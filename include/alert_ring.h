@@ -0,0 +1,135 @@
+#pragma once
+
+#include "alert_fifo.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+/**
+ * @file alert_ring.h
+ * @brief Single-producer/single-consumer ring of alert records in shared memory.
+ *
+ * Alternative to the alerts FIFO ('-a ring'). The ring is mapped MAP_SHARED before the sensors process is forked, so
+ * the child pushes records into the memory the server reads, without a system call per alert. An eventfd inherited
+ * the same way wakes the consumer: the producer only writes it when the ring was empty, since a non-empty ring has a
+ * wakeup pending already, so a burst costs one wakeup instead of one per alert.
+ *
+ * The producer only writes head and the consumer only writes tail. Both are sequentially consistent so that when the
+ * producer sees a stale tail, the consumer is guaranteed to see the new head before it goes back to sleep.
+ */
+
+#define ALERT_RING_CAPACITY 1024
+#define ALERT_RING_RETRY_NS 100000
+
+/**
+ * @enum AlertTransport
+ * @brief How the sensors process sends its alerts to the server.
+ *
+ * @var AlertTransport::ALERT_TRANSPORT_FIFO
+ * Records written to the named FIFO. Default transport, also open to other writers.
+ *
+ * @var AlertTransport::ALERT_TRANSPORT_RING
+ * Records pushed into the shared AlertRing.
+ */
+typedef enum
+{
+    ALERT_TRANSPORT_FIFO,
+    ALERT_TRANSPORT_RING
+} AlertTransport;
+
+_Static_assert((ALERT_RING_CAPACITY & (ALERT_RING_CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+
+/**
+ * @struct AlertRingShared
+ * @brief Part of the ring mapped in both processes.
+ *
+ * @var AlertRingShared::head
+ * Number of records pushed, written by the producer. On its own cache line.
+ *
+ * @var AlertRingShared::tail
+ * Number of records popped, written by the consumer. On its own cache line.
+ *
+ * @var AlertRingShared::slots
+ * Records, at position % ALERT_RING_CAPACITY.
+ */
+typedef struct
+{
+    _Alignas(64) atomic_uint_fast64_t head;
+    _Alignas(64) atomic_uint_fast64_t tail;
+    _Alignas(64) AlertRecord slots[ALERT_RING_CAPACITY];
+} AlertRingShared;
+
+/**
+ * @struct AlertRing
+ * @brief Handle on the ring, valid in the process that created it and in its children.
+ *
+ * @var AlertRing::shared
+ * The shared mapping, NULL when the ring is not created.
+ *
+ * @var AlertRing::event_fd
+ * eventfd signaled by the producer, watched by the consumer.
+ */
+typedef struct
+{
+    AlertRingShared* shared;
+    int event_fd;
+} AlertRing;
+
+#define ALERT_RING_INITIALIZER                                                                                         \
+    {                                                                                                                  \
+        NULL, -1                                                                                                       \
+    }
+
+/**
+ * @brief Maps an empty ring and creates its eventfd. Must be called before forking the producer.
+ *
+ * @param ring The ring.
+ * @return 0 on success, -1 on error.
+ */
+int alert_ring_create(AlertRing* ring);
+
+/**
+ * @brief Unmaps the ring and closes its eventfd in the calling process.
+ *
+ * @param ring The ring, may not be created.
+ */
+void alert_ring_destroy(AlertRing* ring);
+
+/**
+ * @brief Pushes a record, from the producer only, and wakes the consumer if the ring was empty.
+ *
+ * @param ring The ring.
+ * @param record The record.
+ * @return 0 on success, -1 if the ring is full (the record is not pushed).
+ */
+int alert_ring_push(AlertRing* ring, const AlertRecord* record);
+
+/**
+ * @brief Consumes the wakeup and handles every record in the ring, from the consumer only.
+ *
+ * Records failing alert_record_valid() are skipped.
+ *
+ * @param ring The ring.
+ * @param handler Called for every alert, in order.
+ * @param arg Passed to the handler.
+ * @return Number of alerts handled.
+ */
+int alert_ring_drain(AlertRing* ring, AlertHandler handler, void* arg);
+
+/**
+ * @brief Parses the name of an alert transport ("fifo" or "ring").
+ *
+ * @param name The name.
+ * @param transport Output transport.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int alert_transport_parse(const char* name, AlertTransport* transport);
+
+/**
+ * @brief Name of an alert transport.
+ *
+ * @param transport The transport.
+ * @return "fifo" or "ring".
+ */
+const char* alert_transport_name(AlertTransport transport);
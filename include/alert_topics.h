@@ -0,0 +1,128 @@
+#pragma once
+
+#include "../lib/alertInfection/include/alertInfection.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALERT_TOPIC_LIST_MIN_CAPACITY 16
+
+/**
+ * @file alert_topics.h
+ * @brief Topics of the notifications pushed to the clients, and the subscriber lists behind them.
+ *
+ * Every notification belongs to one topic: the alerts of an entry sensor to the topic of that entry, the power
+ * outage notifications to ALERT_TOPIC_POWER. A client subscribes to a set of topics with a "subscribe" request, e.g.
+ * {"message":"subscribe","topics":["north_entry","power"]}; "temperature" names the alerts of every entry, which are
+ * the only kind the sensors raise, and "all" every topic. Clients that never subscribe receive everything.
+ *
+ * The TCP and UDP registries keep, per topic, a packed list of the clients subscribed to it, so a notification is
+ * sent by walking the list of its topic only, whatever the number of other clients.
+ */
+
+/**
+ * @enum AlertTopic
+ * @brief Topic of a notification. The entry topics have the values of the AlertSensor of their entry.
+ */
+typedef enum
+{
+    ALERT_TOPIC_NORTH_ENTRY,
+    ALERT_TOPIC_SOUTH_ENTRY,
+    ALERT_TOPIC_WEST_ENTRY,
+    ALERT_TOPIC_EAST_ENTRY,
+    ALERT_TOPIC_POWER,
+    ALERT_TOPIC_COUNT
+} AlertTopic;
+
+_Static_assert(ALERT_TOPIC_NORTH_ENTRY == (int)ALERT_SENSOR_NORTH &&
+                   ALERT_TOPIC_SOUTH_ENTRY == (int)ALERT_SENSOR_SOUTH &&
+                   ALERT_TOPIC_WEST_ENTRY == (int)ALERT_SENSOR_WEST && ALERT_TOPIC_EAST_ENTRY == (int)ALERT_SENSOR_EAST,
+               "entry topics must follow the sensors");
+
+/** Set of topics holding only the given one. */
+#define ALERT_TOPIC_BIT(topic) (1u << (topic))
+
+/** Every topic, what clients receive until they subscribe. */
+#define ALERT_TOPICS_ALL ((1u << ALERT_TOPIC_COUNT) - 1)
+
+/** The alerts of every entry. */
+#define ALERT_TOPICS_TEMPERATURE ((1u << ALERT_SENSOR_COUNT) - 1)
+
+/**
+ * @struct AlertTopicList
+ * @brief Packed array of the subscribers of a topic, in no particular order.
+ *
+ * Members are fixed-size values chosen by the registry (a connection, a client key). A member removed from the
+ * middle is replaced by the last one, so the registry records the position of each of its clients in every list.
+ *
+ * @var AlertTopicList::members
+ * The members.
+ *
+ * @var AlertTopicList::count
+ * Number of members.
+ *
+ * @var AlertTopicList::capacity
+ * Number of members the array can hold.
+ */
+typedef struct
+{
+    void* members;
+    size_t count;
+    size_t capacity;
+} AlertTopicList;
+
+/**
+ * @brief Topics named in a subscription.
+ *
+ * @param name A topic name ("north_entry", "power"...) or group name ("temperature", "all"), not NUL-terminated.
+ * @param len Length of the name.
+ * @return The set of topics, 0 if the name is unknown.
+ */
+uint32_t alert_topics_lookup(const char* name, size_t len);
+
+/**
+ * @brief Name of a topic, e.g. "north_entry".
+ *
+ * @param topic The topic.
+ * @return The name.
+ */
+const char* alert_topic_name(AlertTopic topic);
+
+/**
+ * @brief Appends a member to a list.
+ *
+ * @param list The list.
+ * @param member The member, copied.
+ * @param size Size of a member.
+ * @return Position of the member, or -1 if the list could not grow.
+ */
+long alert_topic_list_add(AlertTopicList* list, const void* member, size_t size);
+
+/**
+ * @brief Removes the member at a position by moving the last member into its place.
+ *
+ * @param list The list.
+ * @param index Position of the member.
+ * @param size Size of a member.
+ * @return 1 if another member moved to index and its position must be updated, 0 otherwise.
+ */
+int alert_topic_list_remove(AlertTopicList* list, size_t index, size_t size);
+
+/**
+ * @brief Member at a position.
+ *
+ * @param list The list.
+ * @param index The position.
+ * @param size Size of a member.
+ * @return The member, valid until the list is modified.
+ */
+void* alert_topic_list_at(const AlertTopicList* list, size_t index, size_t size);
+
+/**
+ * @brief Removes every member and frees the array. The list can be used again afterwards.
+ *
+ * @param list The list.
+ */
+void alert_topic_list_clear(AlertTopicList* list);
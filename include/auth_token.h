@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @file auth_token.h
+ * @brief Session tokens given to the clients that authenticate.
+ *
+ * A token is the time it was issued followed by a SipHash-2-4 MAC of that time and of the address of the client,
+ * keyed with a secret drawn when the server starts. The server keeps nothing per token: checking one is a single MAC
+ * computation, so datagrams, which have no connection to remember the authentication, carry their token instead.
+ * A token is only valid from the address it was issued to, for AUTH_TOKEN_TTL_SECONDS. An IPv4 address and its
+ * IPv4-mapped IPv6 form count as the same address.
+ *
+ * Tokens are AUTH_TOKEN_LEN lowercase hexadecimal characters: 8 for the time, 16 for the MAC.
+ */
+
+#define AUTH_TOKEN_LEN 24
+#define AUTH_TOKEN_TTL_SECONDS 3600
+#define AUTH_KEY_SIZE 16
+
+/**
+ * @brief Draws a new secret key, which invalidates every token issued before.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int auth_token_init(void);
+
+/**
+ * @brief Sets the secret key, for reproducible tokens.
+ *
+ * @param key The key.
+ */
+void auth_token_set_key(const uint8_t key[AUTH_KEY_SIZE]);
+
+/**
+ * @brief Issues a token to a client.
+ *
+ * @param peer Address of the client.
+ * @param now Current time.
+ * @param token Output token, NUL-terminated.
+ */
+void auth_token_issue(const char* peer, time_t now, char token[AUTH_TOKEN_LEN + 1]);
+
+/**
+ * @brief Checks a token presented by a client.
+ *
+ * @param token The token, not necessarily NUL-terminated.
+ * @param len Length of the token.
+ * @param peer Address of the client.
+ * @param now Current time.
+ * @return 1 if the token was issued to this address and has not expired, 0 otherwise.
+ */
+int auth_token_verify(const char* token, size_t len, const char* peer, time_t now);
+
+/**
+ * @brief SipHash-2-4 of a message.
+ *
+ * @param key The key.
+ * @param data The message.
+ * @param len Length of the message.
+ * @return The 64-bit MAC.
+ */
+uint64_t siphash24(const uint8_t key[AUTH_KEY_SIZE], const void* data, size_t len);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../lib/cJSON/include/cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_ENCODER_INITIAL_SIZE 1024
+#define JSON_ENCODER_MAX_SIZE (1024 * 1024)
+
+/**
+ * @file json_encoder.h
+ * @brief Encoder of the JSON messages sent by the server.
+ *
+ * Messages are printed with cJSON_PrintPreallocated() into a buffer owned by the calling thread, which is reused by
+ * every message of that thread: no allocation per response once the buffer has grown to the largest message.
+ * Output is compact by default; pretty printing is a debugging option.
+ */
+
+/**
+ * @brief Selects compact (0, default) or pretty-printed (1) output for every thread.
+ *
+ * @param pretty Whether to indent the output.
+ */
+void json_encoder_set_pretty(int pretty);
+
+/**
+ * @brief Encodes a JSON object into the buffer of the calling thread.
+ *
+ * The returned string is valid until the next call from the same thread; callers that keep it must copy it.
+ *
+ * @param json The object to encode.
+ * @param len Output length of the encoded string, without the terminator. May be NULL.
+ * @return The encoded string, or NULL if the object could not be printed within JSON_ENCODER_MAX_SIZE bytes.
+ */
+const char* json_encode(cJSON* json, size_t* len);
+
+/**
+ * @brief Releases the buffer of the calling thread, before it exits.
+ */
+void json_encoder_release(void);
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "auth_token.h"
+#include "request_scanner.h"
+#include <stddef.h>
+
+/**
+ * @file protocol.h
+ * @brief Request processing shared by every transport.
+ *
+ * The TCP, UDP and Unix handlers only read requests and deliver responses: what a request does, what it answers and
+ * who may update the supplies is decided here, once. A transport describes its client with a ProtocolSession and
+ * receives the encoded responses through the reply callback of the session, so the core runs the same with a socket,
+ * a batch of datagrams or no socket at all. Whether they are encoded in JSON or in binary is a property of the session.
+ */
+
+/** Response to a successful authentication, with the session token, in compact JSON. */
+#define PROTOCOL_AUTH_SUCCESS_FORMAT "{\"message\":\"auth_success\",\"token\":\"%s\"}"
+
+/** Response to a failed authentication, in compact JSON. */
+#define PROTOCOL_AUTH_FAILURE "{\"message\":\"auth_failure\"}"
+
+/**
+ * @enum ProtocolTransport
+ * @brief Transport a session belongs to, used in the logs.
+ */
+typedef enum
+{
+    PROTOCOL_TCP,
+    PROTOCOL_UDP,
+    PROTOCOL_UNIX
+} ProtocolTransport;
+
+/**
+ * @enum ProtocolResult
+ * @brief Outcome of a request.
+ *
+ * @var ProtocolResult::PROTOCOL_DONE
+ * The request was processed, whether or not it was allowed.
+ *
+ * @var ProtocolResult::PROTOCOL_REJECTED
+ * The request lacks the fields every request must have and was ignored.
+ *
+ * @var ProtocolResult::PROTOCOL_CLOSE
+ * The client failed to authenticate, connection-oriented transports close the connection.
+ */
+typedef enum
+{
+    PROTOCOL_DONE,
+    PROTOCOL_REJECTED,
+    PROTOCOL_CLOSE
+} ProtocolResult;
+
+/**
+ * @brief Delivers an encoded response to the client of a session.
+ *
+ * @param response The response: NUL-terminated JSON, or a binary message for binary sessions. Only valid during the
+ * call.
+ * @param len Length of the response.
+ * @param arg The reply_arg of the session.
+ */
+typedef void (*ProtocolReplySink)(const char* response, size_t len, void* arg);
+
+/**
+ * @brief Replaces the alert topics the client of a session is subscribed to.
+ *
+ * @param topics AlertTopic bits.
+ * @param arg The reply_arg of the session.
+ * @return The topics the client is now subscribed to.
+ */
+typedef uint32_t (*ProtocolSubscribeSink)(uint32_t topics, void* arg);
+
+/**
+ * @struct ProtocolSession
+ * @brief A client as seen by the request processing.
+ *
+ * @var ProtocolSession::transport
+ * Transport of the client.
+ *
+ * @var ProtocolSession::peer
+ * Address of the client, for the logs. Tokens are bound to it.
+ *
+ * @var ProtocolSession::stateless
+ * Whether every request stands on its own (datagrams): requests without a hostname are then rejected, as nothing else
+ * identifies the client.
+ *
+ * @var ProtocolSession::authenticated
+ * Whether the session is authenticated, checked before anything else on updates. Set by a successful authenticateme
+ * or by a valid token in a request. Stateless sessions do not keep it: each of their updates must carry its token.
+ *
+ * @var ProtocolSession::reply
+ * Receives the responses.
+ *
+ * @var ProtocolSession::reply_arg
+ * Argument of reply.
+ *
+ * @var ProtocolSession::binary
+ * Whether the client speaks the binary encoding of wire_format.h: responses are then binary messages, built on the
+ * spot instead of taken from the JSON response caches.
+ *
+ * @var ProtocolSession::subscribe
+ * Applies subscribe requests, NULL for transports that deliver no notifications: the request is then invalid.
+ */
+typedef struct
+{
+    ProtocolTransport transport;
+    const char* peer;
+    int stateless;
+    int authenticated;
+    ProtocolReplySink reply;
+    void* reply_arg;
+    int binary;
+    ProtocolSubscribeSink subscribe;
+} ProtocolSession;
+
+/**
+ * @brief Processes a request.
+ *
+ * @param session The client. Its authenticated flag is updated by authenticateme requests.
+ * @param request The request, read by request_scan() or request_from_json().
+ * @return The outcome of the request.
+ */
+ProtocolResult protocol_handle(ProtocolSession* session, const Request* request);
+
+/**
+ * @brief Name of a transport in the logs, e.g. "TCP".
+ *
+ * @param transport The transport.
+ * @return The name.
+ */
+const char* protocol_transport_name(ProtocolTransport transport);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../lib/cJSON/include/cJSON.h"
+#include "../lib/suppliesData/include/supplies_module.h"
+#include "../lib/wireFormat/include/wire_format.h"
+#include "alert_topics.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @file request_scanner.h
+ * @brief Allocation-free reader of the JSON requests sent by the clients.
+ *
+ * Requests are small objects with a fixed schema, so instead of building a cJSON tree (one malloc per node) the
+ * scanner walks the received bytes once and pulls out "message", "hostname", "token", "food.*", "medicine.*" and
+ * "topics".
+ * Strings are not copied: the hostname and the token point into the received buffer. Names are resolved by a switch on their length and first
+ * character, which tells every known name apart, followed by a single comparison.
+ *
+ * The scanner returns the same Request as request_from_json() on the cJSON tree of the same bytes. It gives up on
+ * anything where that would take more than the fast path: escaped strings, duplicated or differently cased known
+ * names, non-integer supply amounts or a value that is not an object. The caller then parses the request with cJSON.
+ *
+ * Clients speaking the binary encoding of wire_format.h are read by request_from_wire() into the same Request.
+ */
+
+/**
+ * @enum RequestType
+ * @brief Value of the "message" field of a request.
+ *
+ * @var RequestType::REQUEST_NO_MESSAGE
+ * No "message" field.
+ *
+ * @var RequestType::REQUEST_INVALID
+ * A "message" field that is not a string.
+ *
+ * @var RequestType::REQUEST_UNKNOWN
+ * A string that is not a known message.
+ */
+typedef enum
+{
+    REQUEST_NO_MESSAGE,
+    REQUEST_INVALID,
+    REQUEST_UNKNOWN,
+    REQUEST_AUTHENTICATE,
+    REQUEST_STATUS,
+    REQUEST_UPDATE,
+    REQUEST_SUMMARY,
+    REQUEST_STATS,
+    REQUEST_SUBSCRIBE
+} RequestType;
+
+/**
+ * @struct Request
+ * @brief Fields of a request used by the server.
+ *
+ * @var Request::type
+ * The message.
+ *
+ * @var Request::has_hostname
+ * Whether the request has a "hostname" field, of any type.
+ *
+ * @var Request::hostname
+ * The hostname when it is a string, NULL otherwise. Not NUL-terminated, valid as long as the scanned buffer or the
+ * cJSON tree.
+ *
+ * @var Request::hostname_len
+ * Length of the hostname.
+ *
+ * @var Request::token
+ * The session token when the "token" field is a string, NULL otherwise. Not NUL-terminated, like the hostname.
+ *
+ * @var Request::token_len
+ * Length of the token.
+ *
+ * @var Request::food
+ * Deltas of the "food" object, 0 for the missing ones.
+ *
+ * @var Request::medicine
+ * Deltas of the "medicine" object, 0 for the missing ones.
+ *
+ * @var Request::topics
+ * AlertTopic bits named by the strings of the "topics" array, unknown names left out. ALERT_TOPICS_ALL when there is
+ * no such array.
+ */
+typedef struct
+{
+    RequestType type;
+    int has_hostname;
+    const char* hostname;
+    size_t hostname_len;
+    const char* token;
+    size_t token_len;
+    FoodSupply food;
+    MedicineSupply medicine;
+    uint32_t topics;
+} Request;
+
+/**
+ * @brief Scans a request without allocating.
+ *
+ * @param data The received bytes, not necessarily NUL-terminated. Bytes after the end of the object are ignored.
+ * @param len Number of bytes.
+ * @param request Output request.
+ * @return 0 on success, -1 if the request must be parsed with cJSON instead (including when it is not valid JSON).
+ */
+int request_scan(const char* data, size_t len, Request* request);
+
+/**
+ * @brief Reads a request from its cJSON tree, for the requests request_scan() gives up on.
+ *
+ * @param json The parsed request.
+ * @param request Output request, its hostname and token point into the tree.
+ */
+void request_from_json(cJSON* json, Request* request);
+
+/**
+ * @brief Reads a binary request (wire_format.h) without allocating.
+ *
+ * @param data The message.
+ * @param len Length of the message.
+ * @param request Output request, its hostname and token point into the message.
+ * @return 0 on success, -1 if the message is malformed.
+ */
+int request_from_wire(const char* data, size_t len, Request* request);
+
+/**
+ * @brief Message of a name, e.g. REQUEST_STATUS for "status".
+ *
+ * @param name The name, not NUL-terminated.
+ * @param len Length of the name.
+ * @return The message, REQUEST_UNKNOWN if the name is not one.
+ */
+RequestType request_type_lookup(const char* name, size_t len);
+
+/**
+ * @brief Checks the hostname of a request.
+ *
+ * @param request The request.
+ * @param hostname The expected hostname.
+ * @return 1 if the request has exactly this hostname, 0 otherwise.
+ */
+int request_hostname_is(const Request* request, const char* hostname);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../lib/cJSON/include/cJSON.h"
+#include "json_encoder.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * @file response_cache.h
+ * @brief Encoded responses reused until the state they describe changes.
+ *
+ * A cache holds the encoded bytes of one response (e.g. status or summary) together with the version of the state it
+ * was built from. Readers pass the current version: as long as it matches, they get the cached bytes without building
+ * or encoding anything. The first reader after a change rebuilds the response.
+ */
+
+#define RESPONSE_CACHE_INITIALIZER(builder)                                                                            \
+    {                                                                                                                  \
+        PTHREAD_RWLOCK_INITIALIZER, builder, 0, 0, NULL, 0, 0, 0, 0                                                    \
+    }
+
+/**
+ * @brief Builds the JSON object of a cached response from the current state.
+ *
+ * @return A new object, deleted by the cache, or NULL on error.
+ */
+typedef cJSON* (*ResponseBuilder)(void);
+
+/**
+ * @struct ResponseCache
+ * @brief Encoded response and the version of the state it was built from.
+ *
+ * @var ResponseCache::lock
+ * Readers hold it while they use the cached bytes; rebuilds replace them under the write lock.
+ *
+ * @var ResponseCache::build
+ * Builder of the response.
+ *
+ * @var ResponseCache::valid
+ * Whether data holds a response.
+ *
+ * @var ResponseCache::version
+ * Version of the state data was built from.
+ *
+ * @var ResponseCache::data
+ * Encoded response, NUL-terminated.
+ *
+ * @var ResponseCache::len
+ * Length of the encoded response.
+ *
+ * @var ResponseCache::capacity
+ * Allocated size of data.
+ *
+ * @var ResponseCache::hits
+ * Reads served from the cached bytes.
+ *
+ * @var ResponseCache::rebuilds
+ * Responses built because the version changed.
+ */
+typedef struct
+{
+    pthread_rwlock_t lock;
+    ResponseBuilder build;
+    int valid;
+    uint64_t version;
+    char* data;
+    size_t len;
+    size_t capacity;
+    atomic_ullong hits;
+    atomic_ullong rebuilds;
+} ResponseCache;
+
+/**
+ * @brief Returns the encoded response for the given state version, rebuilding it if the cache is older.
+ *
+ * On success the cache stays read-locked until response_cache_release(): the bytes must not be used after it.
+ *
+ * @param cache The cache.
+ * @param version Current version of the state. Versions only grow.
+ * @param len Output length of the response.
+ * @return The encoded response (never older than version), or NULL if it could not be built (the cache is not locked).
+ */
+const char* response_cache_acquire(ResponseCache* cache, uint64_t version, size_t* len);
+
+/**
+ * @brief Releases the response returned by response_cache_acquire().
+ *
+ * @param cache The cache.
+ */
+void response_cache_release(ResponseCache* cache);
+
+/**
+ * @brief Frees the cached response. The cache can be used again afterwards.
+ *
+ * @param cache The cache.
+ */
+void response_cache_clear(ResponseCache* cache);
@@ -1,20 +1,36 @@
 #pragma once
 
 #include "../lib/alertInfection/include/alertInfection.h"
+#include "../lib/alertInfection/include/sensor_bank.h"
 #include "../lib/cJSON/include/cJSON.h"
 #include "../lib/emergNotif/include/emergNotif.h"
+#include "../lib/eventLogger/include/event_logger.h"
+#include "../lib/eventLoop/include/event_loop.h"
+#include "../lib/prng/include/prng.h"
 #include "../lib/socketSetup/include/socket_setup.h"
 #include "../lib/suppliesData/include/supplies_module.h"
+#include "alert_fifo.h"
+#include "alert_ring.h"
+#include "alert_topics.h"
+#include "json_encoder.h"
+#include "protocol.h"
+#include "request_scanner.h"
+#include "response_cache.h"
+#include "tcp_connection.h"
+#include "udp_batch.h"
+#include "udp_registry.h"
 #include <arpa/inet.h>
 #include <bits/getopt_core.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/select.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <time.h>
@@ -25,9 +41,16 @@
 #define BUFFER_256 256
 #define BUFFER_64 64
 #define DEFAULT_PORT -1
-#define MAX_CONNECTIONS 5
+#define TCP_DEFAULT_BACKLOG 4096
+#define TCP_MAX_BACKLOG 65535
+#define TCP_ACCEPT_BATCH 256
 #define MAX_CLIENTS 5
-#define NUM_SENSORS 4
+#define MAX_WORKERS 64
+#define NUM_SENSORS ALERT_SENSOR_COUNT
+#define SENSOR_DEFAULT_PERIOD_MS 30000
+#define SENSOR_MAX_PERIOD_MS 3600000
+#define PRNG_STREAM_SENSORS (1ULL << 32)
+#define PRNG_STREAM_POWER_OUTAGE ((1ULL << 32) + 1)
 #define SHARED_MEM_PORTS "/port_shared_memory"
 #define ADMIN_USER "ubuntu"
 #define SOCK_PATH "/tmp/socket"
@@ -41,25 +64,6 @@
  * @brief Data structures for TCP clients, UDP clients, and emergency alerts.
  */
 
-/**
- * @struct TCPClientList
- * @brief Structure to hold a list of TCP clients.
- *
- * This structure maintains an array of file descriptors for connected TCP clients
- * and keeps track of the number of clients.
- *
- * @var TCPClientList::client_fds
- * Array of file descriptors for connected clients.
- *
- * @var TCPClientList::num_clients
- * Number of currently connected clients.
- */
-typedef struct
-{
-    int client_fds[MAX_CLIENTS];
-    int num_clients;
-} TCPClientList;
-
 /**
  * @enum AddressFamily
  * @brief Enumeration for address families (IPv4 or IPv6).
@@ -96,6 +100,9 @@ typedef enum
  *
  * @var UDPClientData::family
  * Address family (IPv4 or IPv6).
+ *
+ * @var UDPClientData::binary
+ * Whether the datagram of the client was a binary message.
  */
 typedef struct
 {
@@ -103,26 +110,37 @@ typedef struct
     struct sockaddr_storage client_addr; // Client address structure
     socklen_t addr_len;                  // Size of the client address structure
     AddressFamily family;                // Address family (IPv4 or IPv6)
+    int binary;                          // Encoding of the alerts sent to the client
 } UDPClientData;
 
 /**
- * @struct UDPClientList
- * @brief Structure to hold the list of UDP clients.
+ * @struct BroadcastMessage
+ * @brief A notification for the clients subscribed to its topic, in both encodings: each client gets the one it
+ * speaks.
+ *
+ * @var BroadcastMessage::topic
+ * AlertTopic of the notification.
+ *
+ * @var BroadcastMessage::text
+ * The notification for the JSON clients.
  *
- * This structure maintains an array of UDPClientData structures
- * and keeps track of the number of connected UDP clients.
+ * @var BroadcastMessage::text_len
+ * Length of text.
  *
- * @var UDPClientList::clients
- * Array to store UDP clients.
+ * @var BroadcastMessage::binary
+ * The notification as a binary message (wire_format.h).
  *
- * @var UDPClientList::num_clients
- * Number of connected UDP clients.
+ * @var BroadcastMessage::binary_len
+ * Length of binary.
  */
 typedef struct
 {
-    UDPClientData clients[MAX_CLIENTS]; // Array to store UDP clients
-    int num_clients;                    // Number of connected UDP clients
-} UDPClientList;
+    AlertTopic topic;
+    const char* text;
+    size_t text_len;
+    const uint8_t* binary;
+    size_t binary_len;
+} BroadcastMessage;
 
 /**
  * @struct EntryAlertsCount
@@ -131,24 +149,12 @@ typedef struct
  * This structure keeps track of the number of alerts for each entry point
  * (north, south, east, and west).
  *
- * @var EntryAlertsCount::north
- * Number of alerts in the north entry point.
- *
- * @var EntryAlertsCount::south
- * Number of alerts in the south entry point.
- *
- * @var EntryAlertsCount::east
- * Number of alerts in the east entry point.
- *
- * @var EntryAlertsCount::west
- * Number of alerts in the west entry point.
+ * @var EntryAlertsCount::entries
+ * Number of alerts of every entry point, indexed by the AlertSensor of the entry.
  */
 typedef struct
 {
-    int north;
-    int south;
-    int east;
-    int west;
+    int entries[ALERT_SENSOR_COUNT];
 } EntryAlertsCount;
 
 /**
@@ -170,11 +176,173 @@ typedef struct
     char last_event[100];     // To store event description
 } EmergencyInfo;
 
+/**
+ * @struct ServerConfig
+ * @brief Runtime options selected from the command line.
+ *
+ * @var ServerConfig::event_backend
+ * Readiness backend of the event loop (epoll by default, select as fallback).
+ *
+ * @var ServerConfig::num_workers
+ * Number of worker threads, each one running its own event loop ('-w <threads>').
+ *
+ * @var ServerConfig::slow_consumer_policy
+ * What to do with TCP clients whose output queue is full ('-s drop-oldest|disconnect|coalesce').
+ *
+ * @var ServerConfig::output_queue_limit
+ * Maximum bytes queued for a TCP client ('-q <bytes>').
+ *
+ * @var ServerConfig::log_flush_interval_ms
+ * Maximum time an event waits before the logger writes it ('-l <ms>').
+ *
+ * @var ServerConfig::log_fsync_policy
+ * Whether the logger syncs every batch to disk ('-f none|batch').
+ *
+ * @var ServerConfig::pretty_json
+ * Whether responses are pretty-printed instead of compact, for debugging ('-d').
+ *
+ * @var ServerConfig::udp_client_ttl
+ * Seconds after which a silent UDP client stops receiving the alerts ('-t <seconds>').
+ *
+ * @var ServerConfig::tcp_backlog
+ * Length of the listen queue of the TCP sockets ('-b <connections>'), capped by net.core.somaxconn.
+ *
+ * @var ServerConfig::alert_transport
+ * How the sensors process sends its alerts ('-a fifo|ring'), the FIFO by default.
+ *
+ * @var ServerConfig::sensor_count
+ * Number of sensors simulated by the sensors process ('-n <sensors>'), one per entry by default.
+ *
+ * @var ServerConfig::sensor_period_ms
+ * Time between two updates of the sensors ('-i <ms>').
+ *
+ * @var ServerConfig::alert_probability
+ * Probability that an update gives a sensor a temperature high enough to raise an alert ('-r <probability>').
+ *
+ * @var ServerConfig::random_seed
+ * Seed of the simulations ('-g <seed>'), the same seed gives the same sensor readings and power outages. Negative until
+ * taken from the clock by main().
+ */
+typedef struct
+{
+    EventBackend event_backend;
+    int num_workers;
+    SlowConsumerPolicy slow_consumer_policy;
+    size_t output_queue_limit;
+    int log_flush_interval_ms;
+    LoggerFsyncPolicy log_fsync_policy;
+    int pretty_json;
+    int udp_client_ttl;
+    int tcp_backlog;
+    AlertTransport alert_transport;
+    int sensor_count;
+    int sensor_period_ms;
+    float alert_probability;
+    long long random_seed;
+} ServerConfig;
+
+extern ServerConfig server_config;
+
+/** Last keepalive and last event, reported in the summary. */
+extern EmergencyInfo emergency_info;
+
+/** UDP clients heard from, the recipients of the notifications. Guarded by a lock of the server. */
+extern UDPClientRegistry udp_clients;
+
+/** Asynchronous logger used by log_event() once started. */
+extern Logger event_logger;
+
+/** Encoded responses to status and summary requests, rebuilt on the first request after a change. */
+extern ResponseCache status_cache;
+extern ResponseCache summary_cache;
+
+/** Alerts FIFO, opened by start_server() and read by check_alerts(). */
+extern AlertFifo alert_fifo;
+
+/** Alerts ring, created by create_infection_alerts_process() with '-a ring' and drained by check_alert_ring(). */
+extern AlertRing alert_ring;
+
+/**
+ * @struct ServerWorker
+ * @brief A reactor thread with its own event loop and its own SO_REUSEPORT listeners.
+ *
+ * The kernel spreads incoming TCP connections and UDP flows among the workers' sockets, so each client is served
+ * by a single worker. The first worker runs on the main thread and also serves the alerts FIFO and the Unix socket.
+ *
+ * @var ServerWorker::id
+ * Index of the worker (0 is the main thread).
+ *
+ * @var ServerWorker::thread
+ * Thread running the worker (unused for worker 0).
+ *
+ * @var ServerWorker::loop
+ * Event loop owned by the worker.
+ *
+ * @var ServerWorker::tcp_socket_fd
+ * TCP listening socket of the worker.
+ *
+ * @var ServerWorker::udp_socket_fd
+ * UDP socket of the worker.
+ *
+ * @var ServerWorker::wakeup_fd
+ * Eventfd used by other threads to hand over clients with pending output.
+ *
+ * @var ServerWorker::pending_lock
+ * Protects pending_fds.
+ *
+ * @var ServerWorker::pending_fds
+ * Clients of this worker whose output queue was filled by another thread.
+ *
+ * @var ServerWorker::num_pending
+ * Number of entries in pending_fds.
+ *
+ * @var ServerWorker::pending_capacity
+ * Allocated entries of pending_fds.
+ *
+ * @var ServerWorker::udp_batch
+ * Datagrams received and replies sent together on udp_socket_fd, NULL if it could not be allocated.
+ */
+typedef struct
+{
+    int id;
+    pthread_t thread;
+    EventLoop* loop;
+    int tcp_socket_fd;
+    int udp_socket_fd;
+    int wakeup_fd;
+    pthread_mutex_t pending_lock;
+    int* pending_fds;
+    size_t num_pending;
+    size_t pending_capacity;
+    UDPBatch* udp_batch;
+} ServerWorker;
+
 /**
  * @brief Initializes the server and starts listening for incoming connections.
+ *
+ * Every listening socket and the alerts FIFO are registered in an EventLoop, which only dispatches the descriptors
+ * that are ready.
  */
 void start_server(int tcp_port, int udp_port);
 
+/**
+ * @brief Creates the listeners and the event loop of a worker.
+ *
+ * @param worker The worker to initialize.
+ * @param id Index of the worker.
+ * @param tcp_port The TCP port shared by every worker (SO_REUSEPORT).
+ * @param udp_port The UDP port shared by every worker (SO_REUSEPORT).
+ */
+void init_server_worker(ServerWorker* worker, int id, int tcp_port, int udp_port);
+
+/**
+ * @brief Runs the event loop of a worker until the server shuts down.
+ *
+ * @param arg Pointer to the ServerWorker.
+ * @return Always NULL.
+ */
+void* run_server_worker(void* arg);
+
 /**
  * @brief Creates a Unix domain socket and configures it to listen on the specified path.
  *
@@ -189,27 +357,43 @@ void handle_unix_socket_activity(int sockfd, const char* client_type, int connec
 /**
  * @brief Handles activity on a TCP socket, including receiving messages from the client.
  *
- * @param sockfd The file descriptor of the TCP socket.
- * @param addr Pointer to a sockaddr structure containing client address information.
- * @param addrlen Size of the sockaddr structure.
- * @param client_type A string indicating the type of client (e.g., "TCP")
- * @param max_clients The maximum number of clients that can be handled by the server.
+ * On error or disconnection the client is unregistered from the event loop and closed.
+ *
+ * @param client_fd The file descriptor of the connected TCP client.
+ * @param worker The worker whose event loop serves the client.
  * @return void
  */
-void handle_tcp_socket_activity(int client_fd, fd_set* master_fds);
+void handle_tcp_socket_activity(int client_fd, ServerWorker* worker);
+
+/**
+ * @brief Drains the output queue of a TCP client and watches the socket for writability while output is pending.
+ *
+ * Clients marked by SLOW_CONSUMER_DISCONNECT and clients whose socket failed are closed. Must run on the owner worker.
+ *
+ * @param client_fd The file descriptor of the connected TCP client.
+ * @param worker The worker whose event loop serves the client.
+ */
+void service_tcp_output(int client_fd, ServerWorker* worker);
+
+/**
+ * @brief Asks the owner worker of a connection to service its output queue.
+ *
+ * Used by threads that queue messages on connections they do not own, such as the alert broadcast.
+ *
+ * @param conn The connection with pending output.
+ */
+void notify_tcp_owner(TCPConnection* conn);
 
 /**
  * @brief Handles activity on a UDP socket.
  *
- * This function receives data from a UDP socket, processes it, and prints the received message
- * along with the client type.
+ * This function receives every datagram already waiting on the socket (up to UDP_BATCH_SIZE) with one call, processes
+ * them and sends their responses with one call.
  *
  * @param sockfd The socket file descriptor.
- * @param addr Pointer to the socket address structure.
- * @param addrlen Length of the socket address structure.
- * @param client_type The type of client (e.g., "IPv4", "IPv6", "Unix").
+ * @param batch Buffers of the worker, or NULL to receive and answer a single datagram.
  */
-void handle_udp_socket_activity(int sockfd);
+void handle_udp_socket_activity(int sockfd, UDPBatch* batch);
 
 /**
  * @brief Cleans up the Unix domain socket file.
@@ -234,10 +418,13 @@ void sigint_handler();
 /**
  * @brief Accepts a connection on a TCP socket.
  *
+ * The connection is accepted with accept4(), already non-blocking and close-on-exec, and registered as a TCP client.
+ *
  * @param sockfd The socket file descriptor.
  * @param addr Pointer to the socket address structure.
  * @param addrlen Length of the socket address structure.
- * @return int The file descriptor of the accepted connection, or -1 on error.
+ * @return int The file descriptor of the accepted connection, or -1 on error. errno is EAGAIN when no connection is
+ * pending and EMFILE when the client can not be registered.
  */
 int accept_tcp_connection(int sockfd, struct sockaddr* addr, socklen_t addrlen);
 
@@ -282,15 +469,44 @@ void share_ports_shared_memory(int tcp_port, int udp_port);
 int get_selected_port(int sockfd);
 
 /**
- * @brief Receives a JSON object from the client.
+ * @brief Processes a single request received from a TCP client.
  *
- * This function receives a JSON object from the client over the provided socket file descriptor.
+ * @param client_fd The file descriptor of the client socket.
+ * @param received_json The parsed request. Ownership stays with the caller.
+ * @return 1 if the connection must be kept, 0 if it must be closed (e.g. failed authentication).
+ */
+int process_tcp_request(int client_fd, cJSON* received_json);
+
+/**
+ * @brief Processes a single request received from a TCP client, once read by request_scan() or request_from_json().
  *
- * @param sockfd The socket file descriptor to receive data from.
- * @return A pointer to the cJSON object containing the received JSON data, or NULL if an error occurs or no data is
- * received.
+ * @param client_fd The file descriptor of the client socket.
+ * @param request The request.
+ * @return 1 if the connection must be kept, 0 if it must be closed (e.g. failed authentication).
+ */
+int dispatch_tcp_request(int client_fd, const Request* request);
+
+/**
+ * @brief Sends a message to a TCP client, framed as negotiated by its connection.
+ *
+ * Delimited connections get a trailing newline, length-prefixed connections a 4-byte big-endian length header.
+ * The message is copied into the output queue of the connection and written without blocking; whatever the socket
+ * does not accept is drained by the owner worker once the socket is writable.
+ *
+ * @param sockfd The socket file descriptor of the client.
+ * @param message The payload to send.
+ * @param message_len Length of the payload.
+ * @param kind TCPMessageKind of the message, used by SLOW_CONSUMER_COALESCE.
+ * @return 0 if the message was sent or queued, -1 if it was dropped or on error.
+ */
+int send_tcp_message(int sockfd, const char* message, size_t message_len, int kind);
+
+/**
+ * @brief Creates a JSON object with the counters of the TCP output queues.
+ *
+ * @return The counters (queued bytes, dropped, coalesced messages and slow consumer disconnects).
  */
-cJSON* receive_tcp_json(int sockfd);
+cJSON* create_stats_json(void);
 
 /**
  * @brief Sends a JSON object to the client.
@@ -303,6 +519,16 @@ cJSON* receive_tcp_json(int sockfd);
  */
 void send_json_to_tcp_client(int sockfd, cJSON* json);
 
+/**
+ * @brief Sends an already encoded JSON message to the client (batched while a read is being processed).
+ *
+ * @param sockfd The socket file descriptor to send data to.
+ * @param json_string The encoded message, NUL-terminated.
+ * @param json_len Length of the message.
+ * @param kind TCPMessageKind of the message, used by SLOW_CONSUMER_COALESCE.
+ */
+void send_encoded_to_tcp_client(int sockfd, const char* json_string, size_t json_len, int kind);
+
 /**
  * @brief Sends a JSON object to the client over UDP.
  *
@@ -317,11 +543,25 @@ void send_json_to_tcp_client(int sockfd, cJSON* json);
 void send_json_to_udp_client(int sockfd, struct sockaddr* client_addr, socklen_t client_addrlen, cJSON* json_response);
 
 /**
- * @brief Receives and processes messages from the client on TCP.
+ * @brief Sends an already encoded JSON message to the client over UDP.
+ *
+ * @param sockfd The socket file descriptor to send data to.
+ * @param client_addr Pointer to the sockaddr structure containing client address information.
+ * @param client_addrlen Length of the sockaddr structure.
+ * @param json_string The encoded message.
+ * @param json_len Length of the message.
+ */
+void send_encoded_to_udp_client(int sockfd, struct sockaddr* client_addr, socklen_t client_addrlen,
+                                const char* json_string, size_t json_len);
+
+/**
+ * @brief Receives data from a TCP client and processes every complete request it carries.
+ *
+ * The data is appended to the reassembly buffer of the connection, so one read may deliver several requests and a
+ * request may span several reads.
  *
  * @param client_fd The file descriptor of the client socket.
- * @param client_type A string indicating the type of client (e.g., "TCP").
- * @return Returns 1 if the message is successfully received and processed, 0 otherwise.
+ * @return Returns 1 if the connection must be kept, 0 on disconnection, error or protocol violation.
  */
 int check_tcp_clients_messages(int client_fd);
 
@@ -352,7 +592,43 @@ void get_udp_client_info(struct sockaddr_storage* client_addr, char* client_ip,
 cJSON* receive_udp_json(int sockfd, struct sockaddr_storage* client_addr, socklen_t* client_addrlen);
 
 /**
- * @brief Processes messages from the UDP clients.
+ * @brief Parses a datagram received from a UDP client.
+ *
+ * @param buffer The NUL-terminated datagram.
+ * @param client_addr Pointer to the sockaddr_storage structure containing client address information.
+ * @return A pointer to the parsed cJSON object, or NULL if the datagram is not valid JSON.
+ */
+cJSON* parse_udp_json(const char* buffer, struct sockaddr_storage* client_addr);
+
+/**
+ * @brief Processes a request received from a UDP client and deletes it.
+ *
+ * @param sockfd The socket file descriptor the request was received on.
+ * @param received_json The parsed request.
+ * @param client_addr Pointer to the sockaddr_storage structure containing client address information.
+ * @param client_addrlen Length of the client address.
+ * @param replies Batch the response is queued in, or NULL to send it right away.
+ * @return Returns 1 if the request is valid, 0 otherwise.
+ */
+int handle_udp_json(int sockfd, cJSON* received_json, struct sockaddr_storage* client_addr, socklen_t client_addrlen,
+                    UDPBatch* replies);
+
+/**
+ * @brief Processes a request received from a UDP client, once read by request_scan() or request_from_json().
+ *
+ * @param sockfd The socket file descriptor the request was received on.
+ * @param request The request.
+ * @param client_addr Pointer to the sockaddr_storage structure containing client address information.
+ * @param client_addrlen Length of the client address.
+ * @param replies Batch the response is queued in, or NULL to send it right away.
+ * @param binary Whether the request was a binary message, the response is then binary too.
+ * @return Returns 1 if the request is valid, 0 otherwise.
+ */
+int dispatch_udp_request(int sockfd, const Request* request, struct sockaddr_storage* client_addr,
+                         socklen_t client_addrlen, UDPBatch* replies, int binary);
+
+/**
+ * @brief Receives and processes a single message from the UDP clients.
  *
  * @param sockfd The socket file descriptor.
  * @return Returns 1 if the message is successfully received and processed, 0 otherwise.
@@ -374,6 +650,9 @@ void redirect_output_to_parent();
  * This function parses command line arguments to extract TCP and UDP ports.
  * It expects the arguments to be provided in the format '-p tcp <tcp_port>' and '-p udp <udp_port>'.
  * If any of the ports are not specified, they will remain uninitialized (-1).
+ * '-e epoll|select' selects the event loop backend, '-w <threads>' the number of workers, '-s <policy>' the slow
+ * consumer policy, '-q <bytes>' the output queue limit of TCP clients, '-l <ms>' the flush interval of the logger and
+ * '-f none|batch' its fsync policy and '-d' pretty-printed responses, all stored in server_config.
  *
  * @param argc The number of command line arguments.
  * @param argv An array of strings containing the command line arguments.
@@ -383,16 +662,17 @@ void redirect_output_to_parent();
 void parse_command_line_arguments(int argc, char* argv[], int* tcp_port, int* udp_port);
 
 /**
- * @brief Handles a new TCP connection.
+ * @brief Handles new TCP connections.
  *
- * This function is responsible for accepting a new TCP connection on the specified
- * TCP socket file descriptor and performing any necessary actions upon successful
- * connection establishment.
+ * This function accepts the connections pending on the specified TCP socket, up to TCP_ACCEPT_BATCH per call so
+ * that a reconnection storm does not starve the connected clients, and registers them in the worker's event loop.
+ * The listening socket must be non-blocking.
  *
  * @param tcp_socket_fd The file descriptor of the TCP socket where the new connection will be accepted.
+ * @param worker The worker whose event loop serves the accepted client.
  * @return None
  */
-void handle_new_tcp_connection(int tcp_socket_fd);
+void handle_new_tcp_connection(int tcp_socket_fd, ServerWorker* worker);
 
 /**
  * @brief Converts food and medicine supplies into a JSON object.
@@ -419,11 +699,26 @@ Sensor* initiateAlertModule();
 /**
  * @brief Checks for alerts in the FIFO and handles them.
  *
- * This function reads any available alerts from the FIFO and prints them to the standard output. It should be called
- * when there is an alert message in the FIFO.
+ * This function reads the alerts available in the FIFO, without reopening it, and handles each one with
+ * handle_alert(). It should be called when there is an alert message in the FIFO.
  */
 void check_alerts();
 
+/**
+ * @brief Handles the alerts pushed into the ring by the sensors process.
+ *
+ * Used instead of check_alerts() with '-a ring', when the ring's eventfd is readable.
+ */
+void check_alert_ring();
+
+/**
+ * @brief Handles one alert: logs it, records it in the emergency info, sends it to every client and counts it for
+ * its entry.
+ *
+ * @param alert The alert record, with a valid sensor.
+ */
+void handle_alert(const AlertRecord* alert);
+
 /**
  * @brief Cleans up the FIFO by removing it from the file system.
  *
@@ -444,81 +739,89 @@ void cleanup_fifo(const char* fifo_path);
 int fifo_not_empty(int fd);
 
 /**
- * @brief Adds a TCP client to the list of connected clients.
+ * @brief Adds a TCP client to the connected clients.
  *
- * This function adds a TCP client represented by the given file descriptor
- * to the list of connected clients. It checks if there is space available
- * in the client list before adding the client.
+ * This function creates the connection state of the client (see tcp_connection_open()) in O(1). The number of clients
+ * is only limited by the descriptors the process may open.
  *
  * @param client_fd The file descriptor of the TCP client to add.
- * @param tcp_clients_list A pointer to the TCPClientList structure representing the list of connected TCP clients.
+ * @param client_ip Printable address of the client, kept with its state.
+ * @return 0 on success, -1 if the state could not be created (the descriptor is left open).
  */
-void add_tcp_client(int client_fd, TCPClientList* tcp_clients_list);
+int add_tcp_client(int client_fd, const char* client_ip);
 
 /**
- * @brief Removes a TCP client from the list of connected clients.
+ * @brief Removes a TCP client from the connected clients and releases its state, in O(1).
  *
- * This function removes a TCP client represented by the given file descriptor
- * from the list of connected clients. It searches for the client in the list
- * and removes it if found.
+ * The descriptor itself is not closed.
  *
  * @param client_fd The file descriptor of the TCP client to remove.
- * @param tcp_clients A pointer to the TCPClientList structure representing the list of connected TCP clients.
  */
-void remove_tcp_client(int client_fd, TCPClientList* tcp_clients);
+void remove_tcp_client(int client_fd);
 
 /**
- * @brief Sends a message to all connected TCP clients.
+ * @brief Sends a message to the TCP clients subscribed to its topic.
  *
- * This function sends the given message to all TCP clients currently connected
- * to the server. It iterates over the list of connected clients and sends the
- * message to each client.
+ * Only the subscribers of the topic are visited, and the message is queued for each of them, so a slow client never
+ * blocks the others. Binary connections get the binary form. Clients that have not sent their first byte yet are
+ * skipped: their framing, and so the form of the message, is not known until then.
  *
- * @param message The message to send to all connected TCP clients.
+ * @param message The message to send.
  */
-void send_to_all_tcp_clients(const char* message);
+void publish_to_tcp_clients(const BroadcastMessage* message);
 
 /**
- * @brief Adds a UDP client to the list of connected clients.
+ * @brief Adds a UDP client to the registry of clients, or refreshes the time it was last seen.
  *
- * This function adds a UDP client represented by the provided UDPClientData structure
- * to the list of connected clients. If there is space available in the client list,
- * the client is added to the list.
+ * Clients are identified by their whole address (family, address, port), so IPv6 peers are told apart correctly.
+ * Idle clients are swept from the registry every quarter of the TTL.
  *
- * @param udp_clients A pointer to the UDPClientList structure representing the list of connected UDP clients.
+ * @param udp_clients A pointer to the registry of UDP clients.
  * @param client The UDPClientData structure representing the UDP client to be added.
  */
-void add_udp_client(UDPClientList* udp_clients, UDPClientData client);
+void add_udp_client(UDPClientRegistry* udp_clients, UDPClientData client);
 
 /**
- * @brief Removes a UDP client from the list of connected clients.
+ * @brief Removes a UDP client from the registry of clients.
  *
- * This function removes a UDP client represented by the provided file descriptor
- * from the list of connected clients. It searches for the client in the list
- * and removes it if found. The function also shifts the remaining clients to fill
- * the gap left by the removed client.
- *
- * @param udp_clients A pointer to the UDPClientList structure representing the list of connected UDP clients.
- * @param sockfd The file descriptor of the UDP client to be removed.
+ * @param udp_clients A pointer to the registry of UDP clients.
+ * @param client_addr Address of the client to be removed.
+ * @param addr_len Length of the address.
+ * @return 1 if the client was removed, 0 if it was not registered.
  */
-void remove_udp_client(UDPClientList* udp_clients, int sockfd);
+int remove_udp_client(UDPClientRegistry* udp_clients, struct sockaddr_storage* client_addr, socklen_t addr_len);
 
 /**
- * @brief Sends a message to all connected UDP clients.
+ * @brief Sends a message to the UDP clients subscribed to its topic.
  *
- * This function sends the provided message to all UDP clients currently connected
- * to the server. It iterates over the list of connected clients and sends the
- * message to each client using the sendto() system call.
+ * Expired clients are swept first. The subscribers of the topic are copied under the lock of the registry, then the
+ * message is sent with one sendmmsg() call per UDP_BATCH_SIZE clients of the same socket. Clients whose last datagram
+ * was binary get the binary form.
  *
- * @param udp_clients A pointer to the UDPClientList structure representing the list of connected UDP clients.
+ * @param udp_clients A pointer to the registry of UDP clients.
  * @param message A pointer to the message to be sent.
- * @param message_len The length of the message to be sent.
  */
-void send_to_all_udp_clients(UDPClientList* udp_clients, const char* message, size_t message_len);
+void publish_to_udp_clients(UDPClientRegistry* udp_clients, const BroadcastMessage* message);
+
+/**
+ * @brief Starts the asynchronous logger of the server, creating the log directory if needed.
+ *
+ * Until it is started (and in forked child processes) log_event() writes synchronously.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int start_event_logger();
+
+/**
+ * @brief Writes the pending events and stops the asynchronous logger.
+ */
+void stop_event_logger();
 
 /**
  * @brief Logs an event message to a log file.
  *
+ * Queued to the asynchronous logger when it runs, so request handlers never wait for the file.
+ *
  * @param message The message to be logged.
  */
 void log_event(const char* message);
@@ -538,6 +841,18 @@ void log_event_json(cJSON* json);
  */
 void get_tcp_client_ip(int client_fd, char* client_ip);
 
+/**
+ * @brief Returns the printable address of a TCP client without a system call once it is known.
+ *
+ * The address is resolved when the client is accepted and kept in its connection state, so requests never call
+ * getpeername(). Descriptors without connection state are resolved into the fallback buffer.
+ *
+ * @param client_fd The file descriptor of the TCP client.
+ * @param fallback Buffer of INET6_ADDRSTRLEN characters, used when the descriptor has no connection state.
+ * @return The address of the client, valid while its connection is open.
+ */
+const char* get_tcp_client_peer(int client_fd, char* fallback);
+
 /**
  * @brief Accepts a connection on a Unix domain socket.
  *
@@ -555,9 +870,9 @@ int accept_unix_connection(int sockfd, struct sockaddr* addr, socklen_t addrlen)
 /**
  * @brief Creates a child process for handling infection alerts.
  *
- * It initializes necessary resources, such as sensors, and periodically checks for
- * temperature thresholds. If a threshold is exceeded, it writes to a FIFO file.
- * This function makes use of functions defined in the "alertInfection.h" library.
+ * It initializes necessary resources, such as a SensorBank of server_config.sensor_count sensors, and checks for
+ * temperature thresholds every server_config.sensor_period_ms. If a threshold is exceeded, it sends an alert through
+ * the selected transport. This function makes use of functions defined in the "alertInfection.h" library.
  *
  * @return void
  */
@@ -583,10 +898,10 @@ void initialize_entry_alerts_count(EntryAlertsCount* ealerts);
 /**
  * @brief Retrieves the number of alerts for a specific entry point.
  *
- * @param entry The entry point for which to retrieve the alert count ("NORTH", "SOUTH", "EAST", or "WEST").
+ * @param entry The sensor of the entry point for which to retrieve the alert count.
  * @return The number of alerts for the specified entry point, or -1 if the entry is invalid.
  */
-int get_alerts_for_entry(const char* entry);
+int get_alerts_for_entry(AlertSensor entry);
 
 /**
  * @brief Creates a JSON summary containing information about alerts, supplies, and emergency events.
@@ -596,13 +911,54 @@ int get_alerts_for_entry(const char* entry);
 cJSON* create_summary_json();
 
 /**
- * @brief Detects the entry point based on the alert message.
+ * @brief Creates the JSON response to a status request: a snapshot of the supplies.
+ *
+ * @return A cJSON object with the supplies, or NULL if they could not be read.
+ */
+cJSON* create_status_json(void);
+
+/**
+ * @brief Encodes the binary response to a status request.
+ *
+ * @param buffer Output buffer.
+ * @param size Size of the buffer, WIRE_MAX_MESSAGE is enough.
+ * @return Length of the message, 0 if the supplies could not be read or the buffer is too small.
+ */
+size_t encode_status_wire(uint8_t* buffer, size_t size);
+
+/**
+ * @brief Encodes the binary response to a summary request, the same snapshot create_summary_json() describes.
+ *
+ * @param buffer Output buffer.
+ * @param size Size of the buffer, WIRE_MAX_MESSAGE is enough.
+ * @return Length of the message, 0 if the buffer is too small.
+ */
+size_t encode_summary_wire(uint8_t* buffer, size_t size);
+
+/**
+ * @brief Encodes the binary notification of an alert.
+ *
+ * @param alert The alert.
+ * @param buffer Output buffer.
+ * @param size Size of the buffer, WIRE_MAX_MESSAGE is enough.
+ * @return Length of the message, 0 if the buffer is too small.
+ */
+size_t encode_alert_wire(const AlertRecord* alert, uint8_t* buffer, size_t size);
+
+/**
+ * @brief Version of the state described by a status response. Changes with every update of the supplies.
+ *
+ * @return The current version.
+ */
+uint64_t get_status_version(void);
+
+/**
+ * @brief Version of the state described by a summary response. Changes with the supplies, the alert counters and the
+ * emergency info.
  *
- * @param alert_message The alert message to analyze.
- * @return A string representing the detected entry point ("NORTH", "SOUTH", "EAST", or "WEST"), or NULL if no valid
- * entry point is found in the message.
+ * @return The current version.
  */
-const char* detect_entry(const char* alert_message);
+uint64_t get_summary_version(void);
 
 /**
  * @brief Updates the emergency information with the latest keepalive timestamp and event.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cJSON.h"
+#include "wire_format.h"
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <getopt.h>
@@ -19,9 +20,11 @@
 #define SERVER_IP_V6_LOOP "::1"
 #define SHARED_MEM_PORT "/port_shared_memory"
 #define BUFFER_SIZE 1024
+#define RECEIVE_BUFFER_SIZE 8192
 #define DEFAULT_PORT -1
 #define OS_RELEASE_PATH "/etc/os-release"
 #define OS_RELEASE_ID_FIELD 3
+#define FRAME_HEADER_SIZE 4
 
 /**
  * @struct PortInfo
@@ -84,7 +87,8 @@ void disconnect(int sockfd);
 /**
  * @brief Sends a JSON message to the server.
  *
- * This function sends a JSON message to the server over the established connection.
+ * This function sends a JSON message to the server over the established connection, as a single line of
+ * newline-delimited JSON. With -b the message is sent as a length-prefixed binary message instead.
  *
  * @param sockfd The socket file descriptor.
  * @param json A cJSON object representing the JSON message to send.
@@ -121,8 +125,9 @@ void handle_user_input(int sockfd);
 /**
  * @brief Receives a JSON message from the server.
  *
- * This function receives a JSON message from the server over the established connection
- * and processes it accordingly.
+ * This function receives data from the server over the established connection and processes every complete
+ * newline-delimited message in it; a partial message is kept for the next call. With -b it receives a binary
+ * message, converted to JSON.
  *
  * @param sockfd The socket file descriptor.
  */
@@ -0,0 +1,494 @@
+#pragma once
+
+#include "../lib/wireFormat/include/wire_format.h"
+#include "alert_topics.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define MAX_FRAME_SIZE 65536
+#define FRAME_LENGTH_HEADER 4
+#define FRAMING_LENGTH_PREFIX_MAGIC 0x00
+#define INPUT_BUFFER_INITIAL 4096
+#define BUFFER_READ_SIZE 4096
+#define CONNECTION_CHUNK_SIZE 1024
+#define CONNECTION_DEFAULT_MAX_FDS (1024 * 1024)
+#define CONNECTION_SLAB_SIZE 64
+#define TCP_PEER_ADDRESS_SIZE 48
+#define OUTPUT_QUEUE_SLOTS 64
+#define OUTPUT_QUEUE_DEFAULT_LIMIT (256 * 1024)
+#define OUTPUT_MAX_IOV 1020
+#define OUTPUT_SPARE_BUFFERS 8
+#define OUTPUT_BUFFER_MIN 512
+#define OUTPUT_SPARE_MAX_CAPACITY (64 * 1024)
+
+/**
+ * @file tcp_connection.h
+ * @brief Per-connection state of TCP clients and framing of the TCP protocol.
+ *
+ * Three framings are supported, negotiated with the first byte sent by the client:
+ * - Delimited (default): JSON objects, optionally separated by newlines. A frame ends at the brace that closes the
+ *   top-level object, so both newline-delimited JSON and pretty-printed objects are accepted.
+ * - Length-prefixed: the client sends FRAMING_LENGTH_PREFIX_MAGIC first, then every frame is a 4-byte big-endian
+ *   length followed by the payload.
+ * - Binary: the client sends WIRE_MAGIC first, then frames are length-prefixed and carry messages of wire_format.h
+ *   instead of JSON, in both directions.
+ *
+ * Responses use the framing of the connection: a trailing newline or a 4-byte length header.
+ *
+ * Client sockets are non-blocking. Outbound messages wait in a bounded ring per connection, drained whenever the socket
+ * is writable. A client that does not keep up is handled by the configured SlowConsumerPolicy. Messages are copied into
+ * buffers recycled by the connection, so a steady stream of responses does not allocate.
+ *
+ * Connections are indexed by file descriptor, for every descriptor RLIMIT_NOFILE allows. Their records come from slabs
+ * and are recycled through a free list; the open ones are also packed in an array, so opening, closing and iterating
+ * never scan. Each AlertTopic has its own packed array of the connections subscribed to it, which broadcasts walk.
+ */
+
+/**
+ * @enum FramingMode
+ * @brief Framing negotiated by a TCP connection.
+ *
+ * @var FramingMode::FRAMING_PENDING
+ * No byte received yet.
+ *
+ * @var FramingMode::FRAMING_DELIMITED
+ * JSON objects delimited by their closing brace or by newlines.
+ *
+ * @var FramingMode::FRAMING_LENGTH_PREFIXED
+ * 4-byte big-endian length followed by the payload.
+ *
+ * @var FramingMode::FRAMING_BINARY
+ * Length-prefixed frames of binary messages.
+ */
+typedef enum
+{
+    FRAMING_PENDING,
+    FRAMING_DELIMITED,
+    FRAMING_LENGTH_PREFIXED,
+    FRAMING_BINARY
+} FramingMode;
+
+/**
+ * @enum SlowConsumerPolicy
+ * @brief What to do when the output queue of a connection is full.
+ *
+ * @var SlowConsumerPolicy::SLOW_CONSUMER_DROP_OLDEST
+ * Evict the oldest queued messages that have not started to be sent. Default policy.
+ *
+ * @var SlowConsumerPolicy::SLOW_CONSUMER_DISCONNECT
+ * Drop the new message and mark the connection to be closed.
+ *
+ * @var SlowConsumerPolicy::SLOW_CONSUMER_COALESCE
+ * Replace a queued message the new one supersedes, one of the same TCPMessageKind (latest state wins); drop the new
+ * message if there is none, or if it supersedes nothing (TCP_MESSAGE_RESPONSE).
+ */
+typedef enum
+{
+    SLOW_CONSUMER_DROP_OLDEST,
+    SLOW_CONSUMER_DISCONNECT,
+    SLOW_CONSUMER_COALESCE
+} SlowConsumerPolicy;
+
+/**
+ * @enum TCPMessageKind
+ * @brief Kind of an outbound message: SLOW_CONSUMER_COALESCE only replaces a message by a newer one of the same kind.
+ *
+ * @var TCPMessageKind::TCP_MESSAGE_RESPONSE
+ * Response that supersedes no other (update, authentication, statistics, subscription). Never coalesced.
+ *
+ * @var TCPMessageKind::TCP_MESSAGE_STATUS
+ * Response to a status request: the supplies at the time it was built.
+ *
+ * @var TCPMessageKind::TCP_MESSAGE_SUMMARY
+ * Response to a summary request.
+ *
+ * @var TCPMessageKind::TCP_MESSAGE_NOTIFICATION
+ * Notification of the first AlertTopic. Each topic has its own kind, TCP_MESSAGE_TOPIC(topic).
+ */
+typedef enum
+{
+    TCP_MESSAGE_RESPONSE,
+    TCP_MESSAGE_STATUS,
+    TCP_MESSAGE_SUMMARY,
+    TCP_MESSAGE_NOTIFICATION
+} TCPMessageKind;
+
+/** Kind of the notifications of a topic: the alerts of an entry supersede each other, not those of another entry. */
+#define TCP_MESSAGE_TOPIC(topic) (TCP_MESSAGE_NOTIFICATION + (int)(topic))
+
+/**
+ * @struct TCPOutputStats
+ * @brief Counters of the outbound queues of every connection.
+ *
+ * @var TCPOutputStats::queued_bytes
+ * Bytes currently waiting in the queues.
+ *
+ * @var TCPOutputStats::dropped_messages
+ * Messages discarded because a queue was full.
+ *
+ * @var TCPOutputStats::coalesced_messages
+ * Queued messages replaced by a newer one of the same kind.
+ *
+ * @var TCPOutputStats::slow_consumer_disconnects
+ * Connections marked to be closed by SLOW_CONSUMER_DISCONNECT.
+ */
+typedef struct
+{
+    uint64_t queued_bytes;
+    uint64_t dropped_messages;
+    uint64_t coalesced_messages;
+    uint64_t slow_consumer_disconnects;
+} TCPOutputStats;
+
+/**
+ * @struct PendingResponse
+ * @brief Framed message waiting in the output queue of a connection.
+ *
+ * @var PendingResponse::payload
+ * Message payload, in a buffer owned by the queue.
+ *
+ * @var PendingResponse::payload_len
+ * Length of the payload.
+ *
+ * @var PendingResponse::payload_capacity
+ * Allocated size of the payload buffer.
+ *
+ * @var PendingResponse::header
+ * Length header (length-prefixed framing only).
+ *
+ * @var PendingResponse::header_len
+ * Length of the header, 0 for delimited framing.
+ *
+ * @var PendingResponse::trailer
+ * Trailer of the frame ("\n" or "").
+ *
+ * @var PendingResponse::trailer_len
+ * Length of the trailer.
+ *
+ * @var PendingResponse::sent
+ * Bytes of the framed message already written to the socket.
+ *
+ * @var PendingResponse::kind
+ * TCPMessageKind of the message.
+ */
+typedef struct
+{
+    char* payload;
+    size_t payload_len;
+    size_t payload_capacity;
+    unsigned char header[FRAME_LENGTH_HEADER];
+    size_t header_len;
+    const char* trailer;
+    size_t trailer_len;
+    size_t sent;
+    int kind;
+} PendingResponse;
+
+/**
+ * @struct TCPConnection
+ * @brief State of a connected TCP client, including its reassembly buffer.
+ *
+ * @var TCPConnection::fd
+ * File descriptor of the client.
+ *
+ * @var TCPConnection::framing
+ * Negotiated FramingMode (atomic: read by the thread broadcasting alerts).
+ *
+ * @var TCPConnection::input
+ * Reassembly buffer with the bytes received and not yet consumed.
+ *
+ * @var TCPConnection::input_len
+ * Number of valid bytes in input.
+ *
+ * @var TCPConnection::input_capacity
+ * Allocated size of input.
+ *
+ * @var TCPConnection::frame_start
+ * Offset of the first byte of the next frame.
+ *
+ * @var TCPConnection::scan_offset
+ * Offset up to which the delimited scanner has already looked.
+ *
+ * @var TCPConnection::depth
+ * Nesting depth of the object being scanned.
+ *
+ * @var TCPConnection::in_string
+ * Whether the scanner is inside a JSON string.
+ *
+ * @var TCPConnection::escaped
+ * Whether the previous byte was a backslash inside a string.
+ *
+ * @var TCPConnection::batching
+ * Whether responses are being collected instead of sent (set while a read is processed).
+ *
+ * @var TCPConnection::owner
+ * Id of the worker whose event loop serves the connection, -1 if none.
+ *
+ * @var TCPConnection::write_interest
+ * Whether the owner watches the socket for writability (owner thread only).
+ *
+ * @var TCPConnection::overflowed
+ * Set when SLOW_CONSUMER_DISCONNECT decided to close the connection.
+ *
+ * @var TCPConnection::out_lock
+ * Protects the output queue, which the owner and the thread broadcasting alerts both fill.
+ *
+ * @var TCPConnection::out
+ * Ring of queued messages.
+ *
+ * @var TCPConnection::out_head
+ * Index of the oldest queued message.
+ *
+ * @var TCPConnection::out_count
+ * Number of queued messages.
+ *
+ * @var TCPConnection::out_bytes
+ * Framed bytes queued and not yet sent.
+ *
+ * @var TCPConnection::spare
+ * Payload buffers of sent messages, kept for the next ones (protected by out_lock).
+ *
+ * @var TCPConnection::spare_capacity
+ * Allocated size of each spare buffer.
+ *
+ * @var TCPConnection::spare_count
+ * Number of spare buffers.
+ *
+ * @var TCPConnection::peer
+ * Printable address of the client, set when it is accepted.
+ *
+ * @var TCPConnection::authenticated
+ * Whether the client sent a request as the administrator.
+ *
+ * @var TCPConnection::bytes_received
+ * Bytes received from the client (owner thread only).
+ *
+ * @var TCPConnection::bytes_sent
+ * Bytes written to the client (protected by out_lock).
+ *
+ * @var TCPConnection::frames_received
+ * Complete requests extracted from the input (owner thread only).
+ *
+ * @var TCPConnection::topics
+ * AlertTopic bits the client is subscribed to, every topic until it subscribes (protected by the registry).
+ *
+ * @var TCPConnection::topic_index
+ * Position of the connection among the subscribers of each topic of topics.
+ *
+ * @var TCPConnection::registry_index
+ * Position of the connection among the open ones.
+ *
+ * @var TCPConnection::next_free
+ * Next record of the free list, while the record is unused.
+ */
+typedef struct TCPConnection
+{
+    int fd;
+    atomic_int framing;
+    char* input;
+    size_t input_len;
+    size_t input_capacity;
+    size_t frame_start;
+    size_t scan_offset;
+    int depth;
+    int in_string;
+    int escaped;
+    int batching;
+    atomic_int owner;
+    int write_interest;
+    atomic_int overflowed;
+    pthread_mutex_t out_lock;
+    PendingResponse out[OUTPUT_QUEUE_SLOTS];
+    size_t out_head;
+    size_t out_count;
+    size_t out_bytes;
+    char* spare[OUTPUT_SPARE_BUFFERS];
+    size_t spare_capacity[OUTPUT_SPARE_BUFFERS];
+    size_t spare_count;
+    char peer[TCP_PEER_ADDRESS_SIZE];
+    int authenticated;
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t frames_received;
+    uint32_t topics;
+    size_t topic_index[ALERT_TOPIC_COUNT];
+    size_t registry_index;
+    struct TCPConnection* next_free;
+} TCPConnection;
+
+/**
+ * @brief Creates the state of a newly accepted TCP client.
+ *
+ * @param fd The file descriptor of the client.
+ * @return The new connection, or NULL on failure.
+ */
+TCPConnection* tcp_connection_open(int fd);
+
+/**
+ * @brief Looks up the connection of a file descriptor in O(1).
+ *
+ * @param fd The file descriptor of the client.
+ * @return The connection, or NULL if the descriptor has none.
+ */
+TCPConnection* tcp_connection_get(int fd);
+
+/**
+ * @brief Releases the state of a TCP client. The descriptor itself is not closed.
+ *
+ * @param fd The file descriptor of the client.
+ */
+void tcp_connection_close(int fd);
+
+/**
+ * @brief Counts the open connections.
+ *
+ * @return Number of connections opened and not closed.
+ */
+size_t tcp_connection_count(void);
+
+/**
+ * @brief Calls a function on every open connection.
+ *
+ * Connections can't be opened or closed meanwhile: the visitor must not open or close any.
+ *
+ * @param visit The function, called with each connection and arg.
+ * @param arg Argument passed to visit.
+ */
+void tcp_connection_for_each(void (*visit)(TCPConnection* conn, void* arg), void* arg);
+
+/**
+ * @brief Replaces the topics a connection is subscribed to. New connections are subscribed to every topic.
+ *
+ * @param conn The connection.
+ * @param topics AlertTopic bits.
+ * @return 0 on success, -1 if a subscriber list could not grow: the connection then misses the topics that did not fit.
+ */
+int tcp_connection_subscribe(TCPConnection* conn, uint32_t topics);
+
+/**
+ * @brief Calls a function on every connection subscribed to a topic, without looking at the others.
+ *
+ * Connections can't be opened, closed or change their subscriptions meanwhile: the visitor must do none of these.
+ *
+ * @param topic The topic.
+ * @param visit The function, called with each connection and arg.
+ * @param arg Argument passed to visit.
+ */
+void tcp_connection_for_each_subscriber(AlertTopic topic, void (*visit)(TCPConnection* conn, void* arg), void* arg);
+
+/**
+ * @brief Receives available bytes from the socket into the reassembly buffer.
+ *
+ * @param conn The connection.
+ * @return Number of bytes received, 0 if the peer closed the connection, -1 on error (errno is EAGAIN if the
+ * non-blocking socket had nothing to read).
+ */
+ssize_t tcp_connection_read(TCPConnection* conn);
+
+/**
+ * @brief Appends bytes to the reassembly buffer, as if they had been received.
+ *
+ * @param conn The connection.
+ * @param data The bytes to append.
+ * @param len Number of bytes.
+ * @return 0 on success, -1 if memory could not be allocated.
+ */
+int tcp_connection_append(TCPConnection* conn, const char* data, size_t len);
+
+/**
+ * @brief Extracts the next complete frame from the reassembly buffer.
+ *
+ * The returned frame points into the buffer and stays valid until the next read or append.
+ *
+ * @param conn The connection.
+ * @param frame Output pointer to the payload of the frame.
+ * @param frame_len Output length of the payload.
+ * @return 1 if a frame was extracted, 0 if more bytes are needed, -1 on a protocol error (frame over MAX_FRAME_SIZE).
+ */
+int tcp_connection_next_frame(TCPConnection* conn, const char** frame, size_t* frame_len);
+
+/**
+ * @brief Builds the header and trailer that frame a response for the given mode.
+ *
+ * @param framing The framing of the connection.
+ * @param payload_len Length of the response payload.
+ * @param header Output buffer of at least FRAME_LENGTH_HEADER bytes.
+ * @param header_len Output length of the header.
+ * @param trailer Output pointer to the trailer ("\n" or "").
+ * @param trailer_len Output length of the trailer.
+ */
+void tcp_frame_response(int framing, size_t payload_len, unsigned char* header, size_t* header_len,
+                        const char** trailer, size_t* trailer_len);
+
+/**
+ * @brief Sets how full output queues are handled.
+ *
+ * @param policy The slow consumer policy.
+ * @param limit Maximum framed bytes queued per connection.
+ */
+void tcp_connection_set_output_policy(SlowConsumerPolicy policy, size_t limit);
+
+/**
+ * @brief Parses a slow consumer policy name ("drop-oldest", "disconnect" or "coalesce").
+ *
+ * @param name The policy name.
+ * @param policy Output policy.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int tcp_connection_parse_policy(const char* name, SlowConsumerPolicy* policy);
+
+/**
+ * @brief Returns the printable name of a slow consumer policy.
+ *
+ * @param policy The policy.
+ * @return The policy name.
+ */
+const char* tcp_connection_policy_name(SlowConsumerPolicy policy);
+
+/**
+ * @brief Adds a message to the output queue of the connection, framed as negotiated.
+ *
+ * When the queue is full (OUTPUT_QUEUE_SLOTS messages or the configured byte limit) the slow consumer policy applies.
+ * A message is always accepted by an empty queue, whatever its size.
+ *
+ * @param conn The connection.
+ * @param payload The message, copied into a buffer of the queue.
+ * @param payload_len Length of the message.
+ * @param kind TCPMessageKind of the message, or TCP_MESSAGE_TOPIC() of a notification.
+ * @return 0 if the message was queued, -1 if it was dropped.
+ */
+int tcp_connection_queue(TCPConnection* conn, const char* payload, size_t payload_len, int kind);
+
+/**
+ * @brief Writes as much of the output queue as the socket accepts, with one gathered write (sendmsg) per
+ * OUTPUT_MAX_IOV buffers. Never blocks.
+ *
+ * @param conn The connection.
+ * @return Number of bytes sent (0 if the socket is full), or -1 on error.
+ */
+ssize_t tcp_connection_flush(TCPConnection* conn);
+
+/**
+ * @brief Tells whether the connection still has queued output.
+ *
+ * @param conn The connection.
+ * @return 1 if output is pending, 0 otherwise.
+ */
+int tcp_connection_has_output(TCPConnection* conn);
+
+/**
+ * @brief Reads the counters of the output queues.
+ *
+ * @param stats Output counters.
+ */
+void tcp_connection_get_stats(TCPOutputStats* stats);
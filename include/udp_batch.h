@@ -0,0 +1,131 @@
+#pragma once
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/**
+ * @file udp_batch.h
+ * @brief Batched UDP receive and send.
+ *
+ * A batch receives up to UDP_BATCH_SIZE datagrams with one recvmmsg() call. The replies to them are copied into the
+ * batch and sent with one sendmmsg() call, so a burst of requests costs two system calls per batch instead of two per
+ * datagram.
+ */
+
+#define UDP_BATCH_SIZE 32
+#define UDP_DATAGRAM_SIZE 1024
+#define UDP_REPLY_MIN_CAPACITY 4096
+
+/**
+ * @struct UDPBatch
+ * @brief Datagrams received together and the replies queued for them.
+ *
+ * @var UDPBatch::messages
+ * Headers of the received datagrams (msg_len holds their length).
+ *
+ * @var UDPBatch::iovecs
+ * One iovec per receive buffer.
+ *
+ * @var UDPBatch::addresses
+ * Sender of every received datagram.
+ *
+ * @var UDPBatch::buffers
+ * Receive buffers, NUL-terminated after udp_batch_receive().
+ *
+ * @var UDPBatch::num_received
+ * Datagrams received by the last udp_batch_receive().
+ *
+ * @var UDPBatch::replies
+ * Headers of the queued replies.
+ *
+ * @var UDPBatch::reply_iovecs
+ * One iovec per queued reply, pointing into reply_data when the batch is flushed.
+ *
+ * @var UDPBatch::reply_addresses
+ * Destination of every queued reply.
+ *
+ * @var UDPBatch::reply_offsets
+ * Offset of every queued reply in reply_data.
+ *
+ * @var UDPBatch::num_replies
+ * Number of queued replies.
+ *
+ * @var UDPBatch::reply_data
+ * Copies of the queued replies, one after the other.
+ *
+ * @var UDPBatch::reply_len
+ * Bytes used in reply_data.
+ *
+ * @var UDPBatch::reply_capacity
+ * Allocated size of reply_data, kept between batches.
+ */
+typedef struct
+{
+    struct mmsghdr messages[UDP_BATCH_SIZE];
+    struct iovec iovecs[UDP_BATCH_SIZE];
+    struct sockaddr_storage addresses[UDP_BATCH_SIZE];
+    char buffers[UDP_BATCH_SIZE][UDP_DATAGRAM_SIZE];
+    unsigned int num_received;
+
+    struct mmsghdr replies[UDP_BATCH_SIZE];
+    struct iovec reply_iovecs[UDP_BATCH_SIZE];
+    struct sockaddr_storage reply_addresses[UDP_BATCH_SIZE];
+    size_t reply_offsets[UDP_BATCH_SIZE];
+    unsigned int num_replies;
+    char* reply_data;
+    size_t reply_len;
+    size_t reply_capacity;
+} UDPBatch;
+
+/**
+ * @brief Allocates an empty batch.
+ *
+ * @return The batch, or NULL on error.
+ */
+UDPBatch* udp_batch_create(void);
+
+/**
+ * @brief Frees a batch and its reply buffer.
+ *
+ * @param batch The batch, may be NULL.
+ */
+void udp_batch_destroy(UDPBatch* batch);
+
+/**
+ * @brief Receives the datagrams already waiting on a socket, up to UDP_BATCH_SIZE, without blocking.
+ *
+ * Datagrams longer than UDP_DATAGRAM_SIZE - 1 bytes are truncated.
+ *
+ * @param batch The batch. Replies queued for the previous datagrams must have been flushed.
+ * @param sockfd The UDP socket.
+ * @return Number of datagrams received, 0 if none was waiting, -1 on error.
+ */
+int udp_batch_receive(UDPBatch* batch, int sockfd);
+
+/**
+ * @brief Copies a reply into the batch, to be sent by udp_batch_flush().
+ *
+ * @param batch The batch.
+ * @param address Destination of the reply.
+ * @param address_len Length of the destination address.
+ * @param data The reply.
+ * @param len Length of the reply.
+ * @return 0 on success, -1 if the batch is full or out of memory (the reply is not queued).
+ */
+int udp_batch_queue_reply(UDPBatch* batch, const struct sockaddr* address, socklen_t address_len, const char* data,
+                          size_t len);
+
+/**
+ * @brief Sends every queued reply with sendmmsg() and empties the queue.
+ *
+ * A reply the kernel refuses is skipped, the ones after it are still sent.
+ *
+ * @param batch The batch.
+ * @param sockfd The UDP socket.
+ * @return Number of replies sent.
+ */
+int udp_batch_flush(UDPBatch* batch, int sockfd);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cJSON.h"
+#include "wire_format.h"
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <getopt.h>
@@ -11,6 +12,7 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #define SHARED_MEM_PORT "/port_shared_memory"
@@ -18,6 +20,8 @@
 #define DEFAULT_PORT -1
 #define OS_RELEASE_PATH "/etc/os-release"
 #define OS_RELEASE_ID_FIELD 3
+#define SESSION_TOKEN_SIZE 64
+#define AUTH_TIMEOUT_SECONDS 2
 
 // Structure to store the TCP and UDP port numbers
 struct PortInfo
@@ -77,7 +81,7 @@ void send_to_server_v4(int sockfd, const char* message, const struct sockaddr_in
 void disconnect(int sockfd);
 
 /**
- * @brief Sends a JSON object to the server.
+ * @brief Sends a JSON object to the server, or its binary form with -b.
  *
  * @param sockfd The socket file descriptor.
  * @param json The cJSON object to send.
@@ -119,6 +123,15 @@ void handle_server_messages(int sockfd);
  */
 void receive_and_handle_json(int sockfd);
 
+/**
+ * @brief Authenticates with the server and keeps the session token it returns, which authorizes the updates.
+ *
+ * @param sockfd The socket file descriptor.
+ * @param ipv6 Whether the server address is IPv6.
+ * @return 0 if the server issued a token, -1 otherwise.
+ */
+int authenticate(int sockfd, int ipv6);
+
 /**
  * @brief Handles user input and sends requests to the server accordingly.
  *
@@ -126,6 +139,14 @@ void receive_and_handle_json(int sockfd);
  */
 void handle_user_input(int sockfd, int ipv6);
 
+/**
+ * @brief Handles a received message, JSON or binary.
+ *
+ * @param buffer The received message, NUL-terminated.
+ * @param len Length of the message.
+ */
+void handle_received_message(const char* buffer, size_t len);
+
 /**
  * @brief Handles the received JSON message.
  *
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "alert_topics.h"
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#define UDP_REGISTRY_MIN_CAPACITY 64
+#define UDP_REGISTRY_DEFAULT_MAX_CLIENTS 65536
+#define UDP_CLIENT_DEFAULT_TTL 300
+#define UDP_CLIENT_MAX_TTL 86400
+
+/**
+ * @file udp_registry.h
+ * @brief Registry of the UDP clients that receive the alerts.
+ *
+ * Clients are stored in an open-addressing hash table with linear probing, keyed on the whole (family, address, port,
+ * scope) of the peer, so insertion, lookup and removal take constant time. Removals shift the following entries back
+ * instead of leaving tombstones. The table doubles when it is 3/4 full, up to max_clients entries.
+ *
+ * Every datagram refreshes the last time its client was seen; clients idle for longer than the TTL are swept.
+ *
+ * Each AlertTopic has a packed list of the keys of the clients subscribed to it, so alerts are sent without scanning
+ * the table. Entries move within the table but keep their position in the lists.
+ *
+ * The registry is not synchronized: callers share it under a lock.
+ */
+
+#define UDP_REGISTRY_INITIALIZER(max)                                                                                  \
+    {                                                                                                                  \
+        NULL, 0, 0, max, 0, {{NULL, 0, 0}}                                                                             \
+    }
+
+/**
+ * @struct UDPClientKey
+ * @brief Identity of a UDP peer. Unused bytes are zero, so keys compare with memcmp().
+ *
+ * @var UDPClientKey::address
+ * IPv6 address, or IPv4 address in the first 4 bytes.
+ *
+ * @var UDPClientKey::scope_id
+ * Scope of link-local IPv6 addresses, 0 otherwise.
+ *
+ * @var UDPClientKey::port
+ * Port, in network byte order.
+ *
+ * @var UDPClientKey::family
+ * AF_INET or AF_INET6.
+ */
+typedef struct
+{
+    uint8_t address[16];
+    uint32_t scope_id;
+    uint16_t port;
+    uint16_t family;
+} UDPClientKey;
+
+/**
+ * @struct UDPClientEntry
+ * @brief Slot of the registry.
+ *
+ * @var UDPClientEntry::key
+ * Identity of the client.
+ *
+ * @var UDPClientEntry::hash
+ * Hash of the key, kept to find the home slot of the entry when the table is resized or an entry is removed.
+ *
+ * @var UDPClientEntry::used
+ * Whether the slot holds a client.
+ *
+ * @var UDPClientEntry::sockfd
+ * Socket the client was heard on, used to send to it.
+ *
+ * @var UDPClientEntry::binary
+ * Whether the last datagram of the client was a binary message (wire_format.h): alerts are sent to it in that
+ * encoding. 0 for new clients.
+ *
+ * @var UDPClientEntry::addr_len
+ * Length of the address.
+ *
+ * @var UDPClientEntry::address
+ * Address of the client, as received.
+ *
+ * @var UDPClientEntry::last_seen
+ * Last time a datagram was received from the client.
+ *
+ * @var UDPClientEntry::topics
+ * AlertTopic bits the client is subscribed to, every topic until it subscribes.
+ *
+ * @var UDPClientEntry::topic_index
+ * Position of the client among the subscribers of each topic of topics.
+ */
+typedef struct
+{
+    UDPClientKey key;
+    uint64_t hash;
+    int used;
+    int sockfd;
+    int binary;
+    socklen_t addr_len;
+    union
+    {
+        struct sockaddr sa;
+        struct sockaddr_in v4;
+        struct sockaddr_in6 v6;
+    } address;
+    time_t last_seen;
+    uint32_t topics;
+    uint32_t topic_index[ALERT_TOPIC_COUNT];
+} UDPClientEntry;
+
+/**
+ * @struct UDPClientRegistry
+ * @brief Hash table of UDP clients.
+ *
+ * @var UDPClientRegistry::slots
+ * Table of capacity slots, allocated on the first insertion.
+ *
+ * @var UDPClientRegistry::capacity
+ * Number of slots, a power of two.
+ *
+ * @var UDPClientRegistry::count
+ * Number of clients.
+ *
+ * @var UDPClientRegistry::max_clients
+ * Maximum number of clients.
+ *
+ * @var UDPClientRegistry::last_sweep
+ * Time of the last udp_registry_expire().
+ *
+ * @var UDPClientRegistry::topics
+ * UDPClientKey of the subscribers of each topic.
+ */
+typedef struct
+{
+    UDPClientEntry* slots;
+    size_t capacity;
+    size_t count;
+    size_t max_clients;
+    time_t last_sweep;
+    AlertTopicList topics[ALERT_TOPIC_COUNT];
+} UDPClientRegistry;
+
+/**
+ * @brief Builds the key of a peer address.
+ *
+ * @param address The address (AF_INET or AF_INET6).
+ * @param addr_len Length of the address.
+ * @param key Output key.
+ * @return 0 on success, -1 if the family is not supported or the address is truncated.
+ */
+int udp_client_key(const struct sockaddr* address, socklen_t addr_len, UDPClientKey* key);
+
+/**
+ * @brief Adds a client, or refreshes its last_seen and socket if it is already registered.
+ *
+ * @param registry The registry.
+ * @param address Address of the client.
+ * @param addr_len Length of the address.
+ * @param sockfd Socket the client was heard on.
+ * @param now Current time.
+ * @return 1 if the client was added, subscribed to every topic, 0 if it was refreshed, -1 if the registry is full or
+ * the address is invalid.
+ */
+int udp_registry_touch(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len, int sockfd,
+                       time_t now);
+
+/**
+ * @brief Looks up a client.
+ *
+ * @param registry The registry.
+ * @param address Address of the client.
+ * @param addr_len Length of the address.
+ * @return The entry of the client, valid until the registry is modified, or NULL if it is not registered.
+ */
+UDPClientEntry* udp_registry_find(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len);
+
+/**
+ * @brief Removes a client.
+ *
+ * @param registry The registry.
+ * @param address Address of the client.
+ * @param addr_len Length of the address.
+ * @return 1 if the client was removed, 0 if it was not registered.
+ */
+int udp_registry_remove(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len);
+
+/**
+ * @brief Removes the clients not seen for more than ttl seconds.
+ *
+ * @param registry The registry.
+ * @param now Current time.
+ * @param ttl Idle time after which a client expires.
+ * @return Number of clients removed.
+ */
+size_t udp_registry_expire(UDPClientRegistry* registry, time_t now, time_t ttl);
+
+/**
+ * @brief Replaces the topics a client is subscribed to.
+ *
+ * @param registry The registry.
+ * @param address Address of the client.
+ * @param addr_len Length of the address.
+ * @param topics AlertTopic bits.
+ * @return 0 on success, -1 if the client is not registered or a subscriber list could not grow: the client then misses
+ * the topics that did not fit.
+ */
+int udp_registry_subscribe(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len,
+                           uint32_t topics);
+
+/**
+ * @brief Copies the clients subscribed to a topic, without looking at the others.
+ *
+ * @param registry The registry.
+ * @param topic The topic.
+ * @param clients Output array, with room for registry->topics[topic].count entries.
+ * @return Number of clients copied.
+ */
+size_t udp_registry_collect(UDPClientRegistry* registry, AlertTopic topic, UDPClientEntry* clients);
+
+/**
+ * @brief Removes every client and frees the table. The registry can be used again afterwards.
+ *
+ * @param registry The registry.
+ */
+void udp_registry_clear(UDPClientRegistry* registry);
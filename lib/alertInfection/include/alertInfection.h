@@ -1,4 +1,8 @@
+#pragma once
+
 #include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,34 +12,152 @@
 #define FIFO_PATH "/tmp/alerts_fifo"
 #define BUFFER_SIZE 1024
 #define THRESHOLD_TEMP 38.0
+#define ALERT_RECORD_VERSION 1
+#define ALERT_TEXT_SIZE 64
+#define ALERT_DEFAULT_PROBABILITY 0.001f
+
+/**
+ * @brief Sensors of the shelter, one per entry. Alert records and alert counters are indexed by it.
+ */
+typedef enum
+{
+    ALERT_SENSOR_NORTH,
+    ALERT_SENSOR_SOUTH,
+    ALERT_SENSOR_WEST,
+    ALERT_SENSOR_EAST,
+    ALERT_SENSOR_COUNT
+} AlertSensor;
 
 // Struct for sensor data
 typedef struct
 {
+    AlertSensor id;
     char name[20];
     float temperature;
 } Sensor;
 
 /**
- * @brief Sends an alert message via FIFO.
+ * @struct AlertRecord
+ * @brief Alert as written to the FIFO, in host byte order: both ends run on the same machine.
+ *
+ * The layout has no padding and is far below PIPE_BUF, so every record is written with one atomic write() and the
+ * reader splits the stream by size.
+ *
+ * @var AlertRecord::version
+ * ALERT_RECORD_VERSION.
+ *
+ * @var AlertRecord::sensor
+ * AlertSensor that raised the alert.
+ *
+ * @var AlertRecord::temperature
+ * Temperature in tenths of degree Celsius.
+ *
+ * @var AlertRecord::reserved
+ * Zero, keeps the timestamp aligned.
+ *
+ * @var AlertRecord::timestamp
+ * When the alert was raised, in seconds since the epoch.
+ */
+typedef struct
+{
+    uint8_t version;
+    uint8_t sensor;
+    int16_t temperature;
+    uint8_t reserved[4];
+    int64_t timestamp;
+} AlertRecord;
+
+_Static_assert(sizeof(AlertRecord) == 16, "alert records must not be padded");
+_Static_assert(sizeof(AlertRecord) <= PIPE_BUF, "alert records must be written atomically");
+
+/**
+ * @brief Delivers an alert record through another transport than the FIFO.
+ *
+ * @param record The record.
+ * @param arg The argument given to set_alert_sink().
+ */
+typedef void (*AlertSink)(const AlertRecord* record, void* arg);
+
+/**
+ * @brief Sends an alert record via FIFO, or through the sink set with set_alert_sink().
  *
- * This function sends an alert message containing information about the high temperature detected at a particular
- * sensor.
+ * This function sends an AlertRecord with the high temperature detected at a particular sensor. The FIFO is opened by
+ * the first alert and stays open; every record is written with a single write() so that records of concurrent writers
+ * never interleave.
  *
  * @param temperature The temperature value triggering the alert.
- * @param sensor_name The name of the sensor where the high temperature was detected.
+ * @param sensor The sensor where the high temperature was detected.
+ */
+void send_alert(float temperature, AlertSensor sensor);
+
+/**
+ * @brief Closes the FIFO opened by send_alert(). The next alert opens it again.
  */
-void send_alert(float temperature, const char* sensor_name);
+void close_alert_fifo(void);
+
+/**
+ * @brief Makes send_alert() hand its records to a sink instead of writing them to the FIFO.
+ *
+ * @param sink The sink, or NULL to go back to the FIFO.
+ * @param arg Passed to the sink.
+ */
+void set_alert_sink(AlertSink sink, void* arg);
+
+/**
+ * @brief Builds the record of an alert.
+ *
+ * @param record Output record.
+ * @param sensor The sensor that raised the alert.
+ * @param temperature The temperature, rounded to tenths of degree.
+ * @param timestamp When the alert was raised.
+ */
+void alert_record_init(AlertRecord* record, AlertSensor sensor, float temperature, time_t timestamp);
+
+/**
+ * @brief Checks the version and the sensor of a record read from the FIFO.
+ *
+ * @param record The record.
+ * @return 1 if the record can be handled, 0 otherwise.
+ */
+int alert_record_valid(const AlertRecord* record);
+
+/**
+ * @brief Name of a sensor, e.g. "NORTH ENTRY".
+ *
+ * @param sensor The sensor.
+ * @return The name, or "UNKNOWN" for a value out of range.
+ */
+const char* alert_sensor_name(AlertSensor sensor);
+
+/**
+ * @brief Renders an alert as the text logged and sent to the clients, e.g. "NORTH ENTRY, ALERT, 39.5°C ".
+ *
+ * @param record The alert.
+ * @param buffer Output buffer, ALERT_TEXT_SIZE bytes are always enough.
+ * @param size Size of the buffer.
+ * @return Length of the text, as snprintf().
+ */
+int alert_record_format(const AlertRecord* record, char* buffer, size_t size);
 
 /**
  * @brief Generates a random temperature value.
  *
- * This function generates a random temperature value, simulating temperature readings from a sensor.
+ * This function generates a random temperature value, simulating temperature readings from a sensor, with the
+ * generator of the calling thread (prng_thread()). With the probability set by set_alert_probability() the temperature
+ * is high, between 38.1 and 43.0 degrees Celsius, and always raises an alert. Otherwise it is normal, between 35.0 and
+ * 37.9 degrees.
  *
  * @return A random float value representing the temperature.
  */
 float get_temperature();
 
+/**
+ * @brief Sets the probability that get_temperature() gives a high temperature.
+ *
+ * @param probability The probability, between 0 and 1. ALERT_DEFAULT_PROBABILITY until set.
+ */
+void set_alert_probability(float probability);
+
 /**
  * @brief Checks temperature thresholds and sends alerts if necessary.
  *
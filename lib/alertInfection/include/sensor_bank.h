@@ -0,0 +1,101 @@
+#pragma once
+
+#include "alertInfection.h"
+
+/**
+ * @file sensor_bank.h
+ * @brief Simulated temperature sensors stored as a struct of arrays.
+ *
+ * Every sensor watches one entry of the shelter (sensor i watches entry i % ALERT_SENSOR_COUNT), so the names are not
+ * stored per sensor: they come from alert_sensor_name() of the entry. The temperatures are one contiguous, aligned float
+ * array, updated and scanned in blocks of SENSOR_BANK_LANES sensors with no branch in the inner loops so that the
+ * compiler can vectorize them. Each lane of a block has its own xorshift32 state, which keeps the lanes independent
+ * instead of chaining every sensor on a single generator like rand() does.
+ */
+
+#define SENSOR_BANK_LANES 8
+#define SENSOR_BANK_MAX_SENSORS 1000000
+
+/**
+ * @struct SensorBank
+ * @brief A set of simulated sensors and the state of their generator.
+ *
+ * @var SensorBank::count
+ * Number of sensors.
+ *
+ * @var SensorBank::capacity
+ * count rounded up to SENSOR_BANK_LANES. The padding sensors are updated but never scanned.
+ *
+ * @var SensorBank::temperatures
+ * Last temperature of every sensor, in degrees Celsius.
+ *
+ * @var SensorBank::entries
+ * AlertSensor watched by every sensor.
+ *
+ * @var SensorBank::exceeding
+ * Indices found by the last sensor_bank_check_threshold(), room for count of them.
+ *
+ * @var SensorBank::alert_probability
+ * Probability that an update gives a sensor a temperature above THRESHOLD_TEMP.
+ *
+ * @var SensorBank::rng
+ * xorshift32 state of every lane, never zero.
+ */
+typedef struct
+{
+    size_t count;
+    size_t capacity;
+    float* temperatures;
+    uint8_t* entries;
+    uint32_t* exceeding;
+    float alert_probability;
+    uint32_t rng[SENSOR_BANK_LANES];
+} SensorBank;
+
+/**
+ * @brief Allocates a bank of sensors at a normal temperature.
+ *
+ * @param bank The bank.
+ * @param count Number of sensors, between 1 and SENSOR_BANK_MAX_SENSORS.
+ * @param seed Seed of the generator, the same seed gives the same temperatures.
+ * @param alert_probability Probability that an update gives a sensor a high temperature, between 0 and 1.
+ * @return 0 on success, -1 on error.
+ */
+int sensor_bank_init(SensorBank* bank, size_t count, uint64_t seed, float alert_probability);
+
+/**
+ * @brief Frees the arrays of a bank.
+ *
+ * @param bank The bank, may be freed already.
+ */
+void sensor_bank_free(SensorBank* bank);
+
+/**
+ * @brief Gives every sensor a new random temperature.
+ *
+ * Normal temperatures are between 35.0 and 38.0 degrees, high ones between 38.0 and 43.0.
+ *
+ * @param bank The bank.
+ */
+void sensor_bank_update(SensorBank* bank);
+
+/**
+ * @brief Finds the sensors above a temperature.
+ *
+ * Blocks of SENSOR_BANK_LANES sensors are compared at once into a bit mask, only the blocks with a bit set are looked
+ * at sensor by sensor.
+ *
+ * @param bank The bank.
+ * @param threshold The temperature.
+ * @param exceeding Output indices, in increasing order, room for bank->count of them.
+ * @return Number of sensors above the threshold.
+ */
+size_t sensor_bank_scan(const SensorBank* bank, float threshold, uint32_t* exceeding);
+
+/**
+ * @brief Sends an alert for every sensor above THRESHOLD_TEMP, like check_temperature_threshold().
+ *
+ * @param bank The bank.
+ * @return Number of alerts sent.
+ */
+size_t sensor_bank_check_threshold(SensorBank* bank);
@@ -1,4 +1,5 @@
 #include "alertInfection.h"
+#include "../../prng/include/prng.h"
 
 void update_sensor_values(Sensor sensors[], int num_sensors)
 {
@@ -14,62 +15,109 @@ void check_temperature_threshold(Sensor sensors[], int num_sensors)
     {
         if (sensors[i].temperature > THRESHOLD_TEMP)
         {
-            send_alert(sensors[i].temperature, sensors[i].name);
+            send_alert(sensors[i].temperature, sensors[i].id);
         }
     }
 }
 
-void send_alert(float temperature, const char* sensor_name)
+static int alert_fifo_fd = -1;
+static float alert_probability = ALERT_DEFAULT_PROBABILITY;
+static AlertSink alert_sink = NULL;
+static void* alert_sink_arg = NULL;
+
+static const char* const SENSOR_NAMES[ALERT_SENSOR_COUNT] = {
+    [ALERT_SENSOR_NORTH] = "NORTH ENTRY",
+    [ALERT_SENSOR_SOUTH] = "SOUTH ENTRY",
+    [ALERT_SENSOR_WEST] = "WEST ENTRY",
+    [ALERT_SENSOR_EAST] = "EAST ENTRY",
+};
+
+void send_alert(float temperature, AlertSensor sensor)
 {
-    int fd;
-    // Open FIFO for writing
-    fd = open(FIFO_PATH, O_WRONLY);
-    if (fd == -1)
+    AlertRecord record;
+    alert_record_init(&record, sensor, temperature, time(NULL));
+    if (alert_sink != NULL)
     {
-        perror("Error opening FIFO");
+        alert_sink(&record, alert_sink_arg);
         return;
     }
 
-    // Build alert message
-    char alert_message[BUFFER_SIZE];
-    memset(alert_message, 0, sizeof(alert_message));
-    sprintf(alert_message, "%s, ALERT, %.1f°C ", sensor_name, temperature);
+    // Open FIFO for writing, once for every alert of the process
+    if (alert_fifo_fd == -1)
+    {
+        alert_fifo_fd = open(FIFO_PATH, O_WRONLY | O_CLOEXEC);
+        if (alert_fifo_fd == -1)
+        {
+            perror("Error opening FIFO");
+            return;
+        }
+    }
 
-    ssize_t bytes_written = write(fd, alert_message, strlen(alert_message));
+    ssize_t bytes_written = write(alert_fifo_fd, &record, sizeof(record));
     if (bytes_written == -1)
     {
         perror("Error writing to FIFO");
+        // The reader may be gone, open the FIFO again for the next alert
+        close_alert_fifo();
     }
-    else if (bytes_written != (ssize_t)strlen(alert_message))
+    else if (bytes_written != (ssize_t)sizeof(record))
     {
         fprintf(stderr, "Not able to write all data to FIFO\n");
     }
-    else
+}
+
+void close_alert_fifo(void)
+{
+    if (alert_fifo_fd != -1)
     {
-        // printf("Sent alert to FIFO: %s\n", alert_message);
+        close(alert_fifo_fd);
+        alert_fifo_fd = -1;
     }
-    close(fd);
 }
 
-float get_temperature()
+void set_alert_sink(AlertSink sink, void* arg)
 {
-    // Generate a random float value between 0 and 1
-    float random_value = ((float)rand()) / (float)RAND_MAX;
+    alert_sink = sink;
+    alert_sink_arg = arg;
+}
 
-    // Probability of generating a high temperature (1 out of 1000 times)
-    float high_temperature_probability = 0.00000000001f;
+void alert_record_init(AlertRecord* record, AlertSensor sensor, float temperature, time_t timestamp)
+{
+    memset(record, 0, sizeof(AlertRecord));
+    record->version = ALERT_RECORD_VERSION;
+    record->sensor = (uint8_t)sensor;
+    record->temperature = (int16_t)(temperature * 10.0f + (temperature < 0 ? -0.5f : 0.5f));
+    record->timestamp = (int64_t)timestamp;
+}
 
-    // If the random value is less than the high temperature probability, generate a high temperature
-    if (random_value < high_temperature_probability)
-    {
-        // Generate a high temperature between 38 and 43 degrees Celsius
-        // printf("random tempeture is: %f\n", ((float)(rand() % 51 + 380) / 10.0f));
-        return ((float)(rand() % 51 + 380) / 10.0f); // Between 38.0 and 43.0
-    }
-    else
+int alert_record_valid(const AlertRecord* record)
+{
+    return record->version == ALERT_RECORD_VERSION && record->sensor < ALERT_SENSOR_COUNT;
+}
+
+const char* alert_sensor_name(AlertSensor sensor)
+{
+    return (unsigned int)sensor < ALERT_SENSOR_COUNT ? SENSOR_NAMES[sensor] : "UNKNOWN";
+}
+
+int alert_record_format(const AlertRecord* record, char* buffer, size_t size)
+{
+    int temperature = record->temperature;
+    return snprintf(buffer, size, "%s, ALERT, %s%d.%d°C ", alert_sensor_name((AlertSensor)record->sensor),
+                    temperature < 0 ? "-" : "", abs(temperature) / 10, abs(temperature) % 10);
+}
+
+float get_temperature()
+{
+    Prng* rng = prng_thread();
+    if (prng_chance(rng, alert_probability))
     {
-        // Generate a normal temperature between 35 and 37.9 degrees Celsius
-        // printf("random tempeture is: %f\n", ((float)(rand() % 40 + 350) / 10.0f));
-        return ((float)(rand() % 40 + 350) / 10.0f); // Between 35.0 and 37.9
+        return (float)(prng_below(rng, 50) + 381) / 10.0f; // Between 38.1 and 43.0
     }
+    return (float)(prng_below(rng, 30) + 350) / 10.0f; // Between 35.0 and 37.9
+}
+
+void set_alert_probability(float probability)
+{
+    alert_probability = probability;
 }
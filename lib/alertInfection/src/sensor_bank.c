@@ -0,0 +1,141 @@
+#include "sensor_bank.h"
+#include "../../prng/include/prng.h"
+
+#define SENSOR_BANK_ALIGNMENT 64
+
+// 2^-24: the 24 high bits of a draw give a uniform float in [0, 1)
+#define UNIT_SCALE (1.0f / 16777216.0f)
+
+static void* alloc_aligned(size_t size)
+{
+    // aligned_alloc() wants a multiple of the alignment
+    return aligned_alloc(SENSOR_BANK_ALIGNMENT,
+                         (size + SENSOR_BANK_ALIGNMENT - 1) / SENSOR_BANK_ALIGNMENT * SENSOR_BANK_ALIGNMENT);
+}
+
+int sensor_bank_init(SensorBank* bank, size_t count, uint64_t seed, float alert_probability)
+{
+    memset(bank, 0, sizeof(SensorBank));
+    if (count < 1 || count > SENSOR_BANK_MAX_SENSORS)
+    {
+        fprintf(stderr, "Invalid number of sensors: %zu\n", count);
+        return -1;
+    }
+
+    bank->count = count;
+    bank->capacity = (count + SENSOR_BANK_LANES - 1) / SENSOR_BANK_LANES * SENSOR_BANK_LANES;
+    bank->alert_probability = alert_probability;
+    bank->temperatures = alloc_aligned(bank->capacity * sizeof(float));
+    bank->entries = malloc(count * sizeof(uint8_t));
+    bank->exceeding = malloc(count * sizeof(uint32_t));
+    if (bank->temperatures == NULL || bank->entries == NULL || bank->exceeding == NULL)
+    {
+        perror("Error allocating memory for sensors");
+        sensor_bank_free(bank);
+        return -1;
+    }
+
+    for (size_t i = 0; i < bank->capacity; i++)
+    {
+        bank->temperatures[i] = 35.0f;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        bank->entries[i] = (uint8_t)(i % ALERT_SENSOR_COUNT);
+    }
+    // The lanes run their own xorshift32 to stay vectorizable, a generator of the seed spreads it over them
+    Prng lanes_rng;
+    prng_seed(&lanes_rng, seed, 0);
+    for (int lane = 0; lane < SENSOR_BANK_LANES; lane++)
+    {
+        bank->rng[lane] = prng_next(&lanes_rng) | 1;
+    }
+    return 0;
+}
+
+void sensor_bank_free(SensorBank* bank)
+{
+    free(bank->temperatures);
+    free(bank->entries);
+    free(bank->exceeding);
+    bank->temperatures = NULL;
+    bank->entries = NULL;
+    bank->exceeding = NULL;
+    bank->count = 0;
+    bank->capacity = 0;
+}
+
+static inline uint32_t xorshift32(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+void sensor_bank_update(SensorBank* bank)
+{
+    // Local copies, so that the compiler knows the stores to the temperatures never touch them
+    uint32_t rng[SENSOR_BANK_LANES];
+    memcpy(rng, bank->rng, sizeof(rng));
+    float* restrict temperatures = bank->temperatures;
+    const float alert_probability = bank->alert_probability;
+
+    for (size_t block = 0; block < bank->capacity; block += SENSOR_BANK_LANES)
+    {
+        for (int lane = 0; lane < SENSOR_BANK_LANES; lane++)
+        {
+            uint32_t trial = xorshift32(rng[lane]);
+            uint32_t value = xorshift32(trial);
+            rng[lane] = value;
+
+            // Through int32_t: 24 bits fit, and signed conversions have a vector instruction where unsigned ones do not
+            float unit = (float)(int32_t)(value >> 8) * UNIT_SCALE;
+            float high = (float)((float)(int32_t)(trial >> 8) * UNIT_SCALE < alert_probability);
+            temperatures[block + (size_t)lane] = 35.0f + 3.0f * unit + high * (3.0f + 2.0f * unit);
+        }
+    }
+    memcpy(bank->rng, rng, sizeof(rng));
+}
+
+size_t sensor_bank_scan(const SensorBank* bank, float threshold, uint32_t* exceeding)
+{
+    const float* restrict temperatures = bank->temperatures;
+    size_t found = 0;
+    size_t full_blocks = bank->count / SENSOR_BANK_LANES * SENSOR_BANK_LANES;
+
+    size_t block = 0;
+    for (; block < full_blocks; block += SENSOR_BANK_LANES)
+    {
+        unsigned int mask = 0;
+        for (int lane = 0; lane < SENSOR_BANK_LANES; lane++)
+        {
+            mask |= (unsigned int)(temperatures[block + (size_t)lane] > threshold) << lane;
+        }
+        // Almost every block is below the threshold and costs nothing more than the comparison
+        while (mask != 0)
+        {
+            exceeding[found++] = (uint32_t)(block + (size_t)__builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    for (; block < bank->count; block++)
+    {
+        if (temperatures[block] > threshold)
+        {
+            exceeding[found++] = (uint32_t)block;
+        }
+    }
+    return found;
+}
+
+size_t sensor_bank_check_threshold(SensorBank* bank)
+{
+    size_t found = sensor_bank_scan(bank, THRESHOLD_TEMP, bank->exceeding);
+    for (size_t i = 0; i < found; i++)
+    {
+        uint32_t sensor = bank->exceeding[i];
+        send_alert(bank->temperatures[sensor], (AlertSensor)bank->entries[sensor]);
+    }
+    return found;
+}
@@ -32,7 +32,8 @@ void simulate_electricity_failure(int sockfd);
 /**
  * @brief Generates a random number of minutes between 5 and 10.
  *
- * This function generates a random number of minutes between 5 and 10 (inclusive).
+ * This function generates a random number of minutes between 5 and 10 (inclusive), with the generator of the calling
+ * thread (prng_thread()).
  *
  * @return A random number of minutes between 5 and 10.
  */
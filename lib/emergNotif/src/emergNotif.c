@@ -1,4 +1,5 @@
 #include "emergNotif.h"
+#include "../../prng/include/prng.h"
 
 int init_emergency_notification()
 {
@@ -41,5 +42,5 @@ void simulate_electricity_failure(int sockfd)
 
 int get_random_failure_minutes()
 {
-    return (rand() % 6) + 5;
+    return (int)prng_below(prng_thread(), 6) + 5;
 }
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOGGER_RING_SLOTS 4096
+#define LOGGER_MESSAGE_SIZE 512
+#define LOGGER_BATCH_SIZE (64 * 1024)
+#define LOGGER_DEFAULT_FLUSH_MS 100
+#define LOGGER_MAX_FLUSH_MS 10000
+
+/**
+ * @file event_logger.h
+ * @brief Asynchronous event logger.
+ *
+ * Request handlers only copy their message into a lock-free bounded ring (multiple producers, single consumer). A
+ * background writer keeps the log file open, formats the timestamps and appends every pending record with one write()
+ * per batch. The writer wakes up every flush interval, or earlier when the ring is half full.
+ *
+ * When the ring is full the message is dropped instead of blocking the caller; the writer reports how many were lost.
+ */
+
+/**
+ * @enum LoggerFsyncPolicy
+ * @brief Durability of the batches written by the logger.
+ *
+ * @var LoggerFsyncPolicy::LOGGER_FSYNC_NONE
+ * Leave the data in the page cache, the kernel writes it back. Default policy.
+ *
+ * @var LoggerFsyncPolicy::LOGGER_FSYNC_BATCH
+ * fdatasync() after every batch, so at most one flush interval of events is lost on a crash of the machine.
+ */
+typedef enum
+{
+    LOGGER_FSYNC_NONE,
+    LOGGER_FSYNC_BATCH
+} LoggerFsyncPolicy;
+
+/**
+ * @struct LogRecord
+ * @brief Slot of the logger ring.
+ *
+ * @var LogRecord::sequence
+ * Position the slot is ready for: equal to the enqueue position when free, to position + 1 once written.
+ *
+ * @var LogRecord::timestamp
+ * Time the event was logged.
+ *
+ * @var LogRecord::length
+ * Length of the message.
+ *
+ * @var LogRecord::message
+ * The message, truncated to LOGGER_MESSAGE_SIZE - 1 bytes.
+ */
+typedef struct
+{
+    atomic_size_t sequence;
+    time_t timestamp;
+    size_t length;
+    char message[LOGGER_MESSAGE_SIZE];
+} LogRecord;
+
+/**
+ * @struct LoggerStats
+ * @brief Counters of a logger.
+ *
+ * @var LoggerStats::written
+ * Records written to the file.
+ *
+ * @var LoggerStats::dropped
+ * Records discarded because the ring was full.
+ *
+ * @var LoggerStats::batches
+ * write() calls made by the writer.
+ */
+typedef struct
+{
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t batches;
+} LoggerStats;
+
+/**
+ * @struct Logger
+ * @brief State of an asynchronous logger.
+ *
+ * @var Logger::ring
+ * Ring of LOGGER_RING_SLOTS records.
+ *
+ * @var Logger::enqueue_pos
+ * Next position claimed by a producer.
+ *
+ * @var Logger::dequeue_pos
+ * Position up to which records have been written to the file.
+ *
+ * @var Logger::dropped
+ * Records dropped since the start.
+ *
+ * @var Logger::reported_dropped
+ * Dropped records already reported in the file (writer only).
+ *
+ * @var Logger::batches
+ * Number of write() calls.
+ *
+ * @var Logger::fd
+ * Log file, opened in append mode.
+ *
+ * @var Logger::wakeup_fd
+ * eventfd used to wake the writer before its flush interval.
+ *
+ * @var Logger::flush_interval_ms
+ * Maximum time a record waits in the ring.
+ *
+ * @var Logger::fsync_policy
+ * LoggerFsyncPolicy of the batches.
+ *
+ * @var Logger::running
+ * Whether the writer thread accepts records.
+ *
+ * @var Logger::thread
+ * Writer thread.
+ *
+ * @var Logger::flush_lock
+ * Protects the wait of logger_flush().
+ *
+ * @var Logger::flushed
+ * Signaled by the writer after every batch.
+ */
+typedef struct
+{
+    LogRecord* ring;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    atomic_uint_fast64_t dropped;
+    uint64_t reported_dropped;
+    atomic_uint_fast64_t batches;
+    int fd;
+    int wakeup_fd;
+    int flush_interval_ms;
+    LoggerFsyncPolicy fsync_policy;
+    atomic_int running;
+    pthread_t thread;
+    pthread_mutex_t flush_lock;
+    pthread_cond_t flushed;
+} Logger;
+
+/**
+ * @brief Opens the log file and starts the writer thread. The thread blocks every signal.
+ *
+ * @param logger The logger to initialize.
+ * @param path Path of the log file, created if needed and opened in append mode.
+ * @param flush_interval_ms Maximum time a record waits in the ring before being written.
+ * @param fsync_policy Durability of the batches.
+ * @return 0 on success, -1 on error.
+ */
+int logger_start(Logger* logger, const char* path, int flush_interval_ms, LoggerFsyncPolicy fsync_policy);
+
+/**
+ * @brief Writes every pending record, stops the writer thread and closes the file.
+ *
+ * No other thread may log while the logger stops.
+ *
+ * @param logger The logger.
+ */
+void logger_stop(Logger* logger);
+
+/**
+ * @brief Queues a message. Lock-free and never blocks: no system call unless the ring crosses half full.
+ *
+ * @param logger The logger.
+ * @param message The message, truncated to LOGGER_MESSAGE_SIZE - 1 bytes.
+ * @return 0 if the message was queued, -1 if it was dropped (ring full or logger stopped).
+ */
+int logger_log(Logger* logger, const char* message);
+
+/**
+ * @brief Waits until every message queued before the call has been written to the file.
+ *
+ * @param logger The logger.
+ */
+void logger_flush(Logger* logger);
+
+/**
+ * @brief Reads the counters of the logger.
+ *
+ * @param logger The logger.
+ * @param stats Output counters.
+ */
+void logger_get_stats(Logger* logger, LoggerStats* stats);
+
+/**
+ * @brief Parses a fsync policy name ("none" or "batch").
+ *
+ * @param name The policy name.
+ * @param policy Output policy.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int logger_parse_fsync_policy(const char* name, LoggerFsyncPolicy* policy);
+
+/**
+ * @brief Returns the printable name of a fsync policy.
+ *
+ * @param policy The policy.
+ * @return "none" or "batch".
+ */
+const char* logger_fsync_policy_name(LoggerFsyncPolicy policy);
@@ -0,0 +1,302 @@
+#include "event_logger.h"
+
+#define LOGGER_TIMESTAMP_SIZE 32
+
+_Static_assert((LOGGER_RING_SLOTS & (LOGGER_RING_SLOTS - 1)) == 0, "logger ring size must be a power of two");
+
+static void wake_writer(Logger* logger)
+{
+    uint64_t wake = 1;
+    if (write(logger->wakeup_fd, &wake, sizeof(wake)) == -1 && errno != EAGAIN)
+    {
+        perror("write logger eventfd");
+    }
+}
+
+// Appends a whole batch to the file, retrying partial writes
+static void write_batch(Logger* logger, const char* batch, size_t len)
+{
+    size_t written = 0;
+    while (written < len)
+    {
+        ssize_t result = write(logger->fd, batch + written, len - written);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("Error writing log file");
+            return;
+        }
+        written += (size_t)result;
+    }
+    atomic_fetch_add_explicit(&logger->batches, 1, memory_order_relaxed);
+}
+
+// Formats "[YYYY-mm-dd HH:MM:SS]", reusing the previous result while the second does not change
+static size_t format_timestamp(time_t timestamp, time_t* cached_time, char* cached, size_t* cached_len)
+{
+    if (timestamp != *cached_time)
+    {
+        struct tm local_time;
+        localtime_r(&timestamp, &local_time);
+        *cached_len = strftime(cached, LOGGER_TIMESTAMP_SIZE, "[%Y-%m-%d %H:%M:%S]", &local_time);
+        *cached_time = timestamp;
+    }
+    return *cached_len;
+}
+
+static void* logger_thread(void* arg)
+{
+    Logger* logger = (Logger*)arg;
+    char* batch = malloc(LOGGER_BATCH_SIZE);
+    if (batch == NULL)
+    {
+        perror("malloc logger batch");
+        return NULL;
+    }
+
+    size_t pos = atomic_load(&logger->dequeue_pos);
+    time_t cached_time = (time_t)-1;
+    char cached[LOGGER_TIMESTAMP_SIZE];
+    size_t cached_len = 0;
+    for (;;)
+    {
+        // Records queued before logger_stop() cleared the flag are still written by this iteration
+        int running = atomic_load(&logger->running);
+        size_t len = 0;
+        size_t first = pos;
+
+        for (;;)
+        {
+            LogRecord* record = &logger->ring[pos & (LOGGER_RING_SLOTS - 1)];
+            if (atomic_load_explicit(&record->sequence, memory_order_acquire) != pos + 1)
+            {
+                break;
+            }
+            if (len + LOGGER_TIMESTAMP_SIZE + record->length + 2 > LOGGER_BATCH_SIZE)
+            {
+                write_batch(logger, batch, len);
+                len = 0;
+            }
+            size_t stamp_len = format_timestamp(record->timestamp, &cached_time, cached, &cached_len);
+            memcpy(batch + len, cached, stamp_len);
+            len += stamp_len;
+            batch[len++] = ' ';
+            memcpy(batch + len, record->message, record->length);
+            len += record->length;
+            batch[len++] = '\n';
+
+            // Hand the slot back to the producers, one lap ahead
+            atomic_store_explicit(&record->sequence, pos + LOGGER_RING_SLOTS, memory_order_release);
+            pos++;
+        }
+
+        uint64_t dropped = atomic_load_explicit(&logger->dropped, memory_order_relaxed);
+        if (dropped != logger->reported_dropped)
+        {
+            size_t stamp_len = format_timestamp(time(NULL), &cached_time, cached, &cached_len);
+            int note_len = snprintf(batch + len, LOGGER_BATCH_SIZE - len, "%.*s Logger dropped %llu events\n",
+                                    (int)stamp_len, cached, (unsigned long long)(dropped - logger->reported_dropped));
+            if (note_len > 0 && (size_t)note_len < LOGGER_BATCH_SIZE - len)
+            {
+                len += (size_t)note_len;
+                logger->reported_dropped = dropped;
+            }
+        }
+
+        if (len > 0)
+        {
+            write_batch(logger, batch, len);
+        }
+        if (pos != first && logger->fsync_policy == LOGGER_FSYNC_BATCH && fdatasync(logger->fd) == -1)
+        {
+            perror("fdatasync log file");
+        }
+
+        pthread_mutex_lock(&logger->flush_lock);
+        atomic_store(&logger->dequeue_pos, pos);
+        pthread_cond_broadcast(&logger->flushed);
+        pthread_mutex_unlock(&logger->flush_lock);
+
+        if (!running)
+        {
+            break;
+        }
+
+        struct pollfd wakeup = {.fd = logger->wakeup_fd, .events = POLLIN, .revents = 0};
+        if (poll(&wakeup, 1, logger->flush_interval_ms) > 0)
+        {
+            uint64_t wakes;
+            if (read(logger->wakeup_fd, &wakes, sizeof(wakes)) == -1 && errno != EAGAIN)
+            {
+                perror("read logger eventfd");
+            }
+        }
+    }
+
+    free(batch);
+    return NULL;
+}
+
+int logger_start(Logger* logger, const char* path, int flush_interval_ms, LoggerFsyncPolicy fsync_policy)
+{
+    memset(logger, 0, sizeof(Logger));
+    logger->flush_interval_ms = flush_interval_ms;
+    logger->fsync_policy = fsync_policy;
+
+    logger->ring = calloc(LOGGER_RING_SLOTS, sizeof(LogRecord));
+    if (logger->ring == NULL)
+    {
+        perror("calloc logger ring");
+        return -1;
+    }
+    for (size_t i = 0; i < LOGGER_RING_SLOTS; i++)
+    {
+        atomic_init(&logger->ring[i].sequence, i);
+    }
+
+    logger->fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (logger->fd == -1)
+    {
+        perror("Error opening log file");
+        free(logger->ring);
+        return -1;
+    }
+    logger->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (logger->wakeup_fd == -1)
+    {
+        perror("eventfd");
+        close(logger->fd);
+        free(logger->ring);
+        return -1;
+    }
+    pthread_mutex_init(&logger->flush_lock, NULL);
+    pthread_cond_init(&logger->flushed, NULL);
+    atomic_store(&logger->running, 1);
+
+    // Signals are left to the threads of the application
+    sigset_t all_signals;
+    sigset_t previous_set;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &previous_set);
+    int result = pthread_create(&logger->thread, NULL, logger_thread, logger);
+    pthread_sigmask(SIG_SETMASK, &previous_set, NULL);
+    if (result != 0)
+    {
+        fprintf(stderr, "pthread_create logger: %s\n", strerror(result));
+        atomic_store(&logger->running, 0);
+        pthread_mutex_destroy(&logger->flush_lock);
+        pthread_cond_destroy(&logger->flushed);
+        close(logger->wakeup_fd);
+        close(logger->fd);
+        free(logger->ring);
+        return -1;
+    }
+    return 0;
+}
+
+void logger_stop(Logger* logger)
+{
+    if (!atomic_exchange(&logger->running, 0))
+    {
+        return;
+    }
+    wake_writer(logger);
+    pthread_join(logger->thread, NULL);
+
+    pthread_mutex_destroy(&logger->flush_lock);
+    pthread_cond_destroy(&logger->flushed);
+    close(logger->wakeup_fd);
+    close(logger->fd);
+    free(logger->ring);
+    logger->ring = NULL;
+}
+
+int logger_log(Logger* logger, const char* message)
+{
+    if (!atomic_load_explicit(&logger->running, memory_order_relaxed))
+    {
+        return -1;
+    }
+
+    // Claim a slot: it is free when its sequence equals the position, a lap behind while the writer still owns it
+    size_t pos = atomic_load_explicit(&logger->enqueue_pos, memory_order_relaxed);
+    LogRecord* record;
+    for (;;)
+    {
+        record = &logger->ring[pos & (LOGGER_RING_SLOTS - 1)];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&logger->enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            atomic_fetch_add_explicit(&logger->dropped, 1, memory_order_relaxed);
+            return -1;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&logger->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    record->timestamp = time(NULL);
+    record->length = strnlen(message, LOGGER_MESSAGE_SIZE - 1);
+    memcpy(record->message, message, record->length);
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+
+    // Only the producer that fills half of the ring pays for a wakeup, the others wait for the flush interval
+    if (pos + 1 - atomic_load_explicit(&logger->dequeue_pos, memory_order_relaxed) == LOGGER_RING_SLOTS / 2)
+    {
+        wake_writer(logger);
+    }
+    return 0;
+}
+
+void logger_flush(Logger* logger)
+{
+    size_t target = atomic_load(&logger->enqueue_pos);
+    wake_writer(logger);
+
+    pthread_mutex_lock(&logger->flush_lock);
+    while (atomic_load(&logger->dequeue_pos) < target && atomic_load(&logger->running))
+    {
+        pthread_cond_wait(&logger->flushed, &logger->flush_lock);
+    }
+    pthread_mutex_unlock(&logger->flush_lock);
+}
+
+void logger_get_stats(Logger* logger, LoggerStats* stats)
+{
+    stats->written = atomic_load(&logger->dequeue_pos);
+    stats->dropped = atomic_load(&logger->dropped);
+    stats->batches = atomic_load(&logger->batches);
+}
+
+int logger_parse_fsync_policy(const char* name, LoggerFsyncPolicy* policy)
+{
+    if (strcmp(name, "none") == 0)
+    {
+        *policy = LOGGER_FSYNC_NONE;
+        return 0;
+    }
+    if (strcmp(name, "batch") == 0)
+    {
+        *policy = LOGGER_FSYNC_BATCH;
+        return 0;
+    }
+    return -1;
+}
+
+const char* logger_fsync_policy_name(LoggerFsyncPolicy policy)
+{
+    return policy == LOGGER_FSYNC_NONE ? "none" : "batch";
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#define EVENT_READ 0x01
+#define EVENT_WRITE 0x02
+#define EVENT_ERROR 0x04
+#define EVENT_LOOP_MAX_EVENTS 256
+#define EVENT_LOOP_INITIAL_SLOTS 64
+
+/**
+ * @enum EventBackend
+ * @brief Readiness notification mechanism used by an EventLoop.
+ *
+ * @var EventBackend::EVENT_BACKEND_EPOLL
+ * Linux epoll, O(ready fds) per wakeup. Default backend.
+ *
+ * @var EventBackend::EVENT_BACKEND_SELECT
+ * POSIX select, O(max fd) per wakeup and limited to FD_SETSIZE descriptors. Kept as a fallback.
+ */
+typedef enum
+{
+    EVENT_BACKEND_EPOLL,
+    EVENT_BACKEND_SELECT
+} EventBackend;
+
+/**
+ * @brief Callback invoked when a registered file descriptor is ready.
+ *
+ * @param fd The ready file descriptor.
+ * @param events Mask of EVENT_READ, EVENT_WRITE and EVENT_ERROR flags.
+ * @param data The user pointer given at registration time.
+ */
+typedef void (*EventHandler)(int fd, uint32_t events, void* data);
+
+/**
+ * @struct EventSlot
+ * @brief Registration of a single file descriptor, indexed by the descriptor itself.
+ *
+ * @var EventSlot::handler
+ * Callback to dispatch, NULL when the slot is free.
+ *
+ * @var EventSlot::data
+ * User pointer handed back to the callback.
+ *
+ * @var EventSlot::events
+ * Interest mask (EVENT_READ / EVENT_WRITE).
+ */
+typedef struct
+{
+    EventHandler handler;
+    void* data;
+    uint32_t events;
+} EventSlot;
+
+/**
+ * @struct EventLoop
+ * @brief Event loop state for either backend.
+ *
+ * @var EventLoop::backend
+ * Backend in use.
+ *
+ * @var EventLoop::epoll_fd
+ * epoll instance (epoll backend only).
+ *
+ * @var EventLoop::read_set
+ * Read interest set (select backend only).
+ *
+ * @var EventLoop::write_set
+ * Write interest set (select backend only).
+ *
+ * @var EventLoop::max_fd
+ * Highest registered descriptor (select backend only).
+ *
+ * @var EventLoop::slots
+ * Registrations indexed by file descriptor.
+ *
+ * @var EventLoop::capacity
+ * Number of entries in slots.
+ *
+ * @var EventLoop::num_registered
+ * Number of registered descriptors.
+ */
+typedef struct
+{
+    EventBackend backend;
+    int epoll_fd;
+    fd_set read_set;
+    fd_set write_set;
+    int max_fd;
+    EventSlot* slots;
+    int capacity;
+    int num_registered;
+} EventLoop;
+
+/**
+ * @brief Creates an event loop using the given backend.
+ *
+ * @param backend The readiness backend to use.
+ * @return A new EventLoop, or NULL on failure.
+ */
+EventLoop* event_loop_create(EventBackend backend);
+
+/**
+ * @brief Releases an event loop. Registered descriptors are not closed.
+ *
+ * @param loop The loop to destroy.
+ */
+void event_loop_destroy(EventLoop* loop);
+
+/**
+ * @brief Registers a file descriptor.
+ *
+ * @param loop The event loop.
+ * @param fd The descriptor to watch.
+ * @param events Interest mask (EVENT_READ and/or EVENT_WRITE).
+ * @param handler Callback invoked when the descriptor is ready.
+ * @param data User pointer passed to the callback.
+ * @return 0 on success, -1 on error (errno is set; EINVAL for fd >= FD_SETSIZE on select).
+ */
+int event_loop_add(EventLoop* loop, int fd, uint32_t events, EventHandler handler, void* data);
+
+/**
+ * @brief Changes the interest mask of a registered file descriptor.
+ *
+ * @param loop The event loop.
+ * @param fd The registered descriptor.
+ * @param events New interest mask.
+ * @return 0 on success, -1 on error.
+ */
+int event_loop_modify(EventLoop* loop, int fd, uint32_t events);
+
+/**
+ * @brief Unregisters a file descriptor. Must be called before closing it.
+ *
+ * Safe to call from inside a handler, including for descriptors that are pending in the current batch.
+ *
+ * @param loop The event loop.
+ * @param fd The registered descriptor.
+ * @return 0 on success, -1 if the descriptor was not registered.
+ */
+int event_loop_remove(EventLoop* loop, int fd);
+
+/**
+ * @brief Waits for readiness and dispatches the handlers of the ready descriptors.
+ *
+ * @param loop The event loop.
+ * @param timeout_ms Maximum time to wait in milliseconds, -1 to block.
+ * @return Number of dispatched events, 0 on timeout or EINTR, -1 on error.
+ */
+int event_loop_run_once(EventLoop* loop, int timeout_ms);
+
+/**
+ * @brief Parses a backend name ("epoll" or "select").
+ *
+ * @param name The backend name.
+ * @param backend Output backend.
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int event_loop_parse_backend(const char* name, EventBackend* backend);
+
+/**
+ * @brief Returns the printable name of a backend.
+ *
+ * @param backend The backend.
+ * @return "epoll" or "select".
+ */
+const char* event_loop_backend_name(EventBackend backend);
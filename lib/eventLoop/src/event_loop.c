@@ -0,0 +1,353 @@
+#include "event_loop.h"
+
+// Grow the slot table so that 'fd' is a valid index
+static int ensure_capacity(EventLoop* loop, int fd)
+{
+    if (fd < loop->capacity)
+    {
+        return 0;
+    }
+
+    int new_capacity = loop->capacity;
+    while (new_capacity <= fd)
+    {
+        new_capacity *= 2;
+    }
+
+    EventSlot* slots = realloc(loop->slots, sizeof(EventSlot) * (size_t)new_capacity);
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    memset(&slots[loop->capacity], 0, sizeof(EventSlot) * (size_t)(new_capacity - loop->capacity));
+    loop->slots = slots;
+    loop->capacity = new_capacity;
+    return 0;
+}
+
+static uint32_t to_epoll_events(uint32_t events)
+{
+    uint32_t epoll_events = 0;
+    if (events & EVENT_READ)
+    {
+        epoll_events |= EPOLLIN;
+    }
+    if (events & EVENT_WRITE)
+    {
+        epoll_events |= EPOLLOUT;
+    }
+    return epoll_events;
+}
+
+static uint32_t from_epoll_events(uint32_t epoll_events)
+{
+    uint32_t events = 0;
+    if (epoll_events & (EPOLLIN | EPOLLRDHUP))
+    {
+        events |= EVENT_READ;
+    }
+    if (epoll_events & EPOLLOUT)
+    {
+        events |= EVENT_WRITE;
+    }
+    if (epoll_events & (EPOLLERR | EPOLLHUP))
+    {
+        // Report errors as readable too, so handlers observe them on their next read
+        events |= EVENT_ERROR | EVENT_READ;
+    }
+    return events;
+}
+
+static void select_update_sets(EventLoop* loop, int fd, uint32_t events)
+{
+    FD_CLR(fd, &loop->read_set);
+    FD_CLR(fd, &loop->write_set);
+    if (events & EVENT_READ)
+    {
+        FD_SET(fd, &loop->read_set);
+    }
+    if (events & EVENT_WRITE)
+    {
+        FD_SET(fd, &loop->write_set);
+    }
+}
+
+EventLoop* event_loop_create(EventBackend backend)
+{
+    EventLoop* loop = calloc(1, sizeof(EventLoop));
+    if (loop == NULL)
+    {
+        perror("calloc event loop");
+        return NULL;
+    }
+
+    loop->backend = backend;
+    loop->epoll_fd = -1;
+    loop->max_fd = -1;
+    loop->capacity = EVENT_LOOP_INITIAL_SLOTS;
+    loop->slots = calloc((size_t)loop->capacity, sizeof(EventSlot));
+    if (loop->slots == NULL)
+    {
+        perror("calloc event slots");
+        free(loop);
+        return NULL;
+    }
+
+    if (backend == EVENT_BACKEND_EPOLL)
+    {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd == -1)
+        {
+            perror("epoll_create1");
+            free(loop->slots);
+            free(loop);
+            return NULL;
+        }
+    }
+    else
+    {
+        FD_ZERO(&loop->read_set);
+        FD_ZERO(&loop->write_set);
+    }
+
+    return loop;
+}
+
+void event_loop_destroy(EventLoop* loop)
+{
+    if (loop == NULL)
+    {
+        return;
+    }
+    if (loop->epoll_fd != -1)
+    {
+        close(loop->epoll_fd);
+    }
+    free(loop->slots);
+    free(loop);
+}
+
+int event_loop_add(EventLoop* loop, int fd, uint32_t events, EventHandler handler, void* data)
+{
+    if (fd < 0 || handler == NULL)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (loop->backend == EVENT_BACKEND_SELECT && fd >= FD_SETSIZE)
+    {
+        // select() cannot watch descriptors past FD_SETSIZE
+        errno = EINVAL;
+        return -1;
+    }
+    if (ensure_capacity(loop, fd) == -1)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (loop->slots[fd].handler != NULL)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    if (loop->backend == EVENT_BACKEND_EPOLL)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = to_epoll_events(events);
+        ev.data.fd = fd;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        select_update_sets(loop, fd, events);
+        if (fd > loop->max_fd)
+        {
+            loop->max_fd = fd;
+        }
+    }
+
+    loop->slots[fd].handler = handler;
+    loop->slots[fd].data = data;
+    loop->slots[fd].events = events;
+    loop->num_registered++;
+    return 0;
+}
+
+int event_loop_modify(EventLoop* loop, int fd, uint32_t events)
+{
+    if (fd < 0 || fd >= loop->capacity || loop->slots[fd].handler == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+    if (loop->slots[fd].events == events)
+    {
+        return 0;
+    }
+
+    if (loop->backend == EVENT_BACKEND_EPOLL)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = to_epoll_events(events);
+        ev.data.fd = fd;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        select_update_sets(loop, fd, events);
+    }
+
+    loop->slots[fd].events = events;
+    return 0;
+}
+
+int event_loop_remove(EventLoop* loop, int fd)
+{
+    if (fd < 0 || fd >= loop->capacity || loop->slots[fd].handler == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (loop->backend == EVENT_BACKEND_EPOLL)
+    {
+        // Failure here means the fd was already closed, which drops it from the epoll set anyway
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    else
+    {
+        FD_CLR(fd, &loop->read_set);
+        FD_CLR(fd, &loop->write_set);
+    }
+
+    memset(&loop->slots[fd], 0, sizeof(EventSlot));
+    loop->num_registered--;
+
+    if (loop->backend == EVENT_BACKEND_SELECT && fd == loop->max_fd)
+    {
+        // Shrink the scan range down to the highest descriptor still registered
+        while (loop->max_fd >= 0 && loop->slots[loop->max_fd].handler == NULL)
+        {
+            loop->max_fd--;
+        }
+    }
+    return 0;
+}
+
+static int run_once_epoll(EventLoop* loop, int timeout_ms)
+{
+    struct epoll_event ready[EVENT_LOOP_MAX_EVENTS];
+    int num_ready = epoll_wait(loop->epoll_fd, ready, EVENT_LOOP_MAX_EVENTS, timeout_ms);
+    if (num_ready == -1)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        perror("epoll_wait");
+        return -1;
+    }
+
+    for (int i = 0; i < num_ready; i++)
+    {
+        int fd = ready[i].data.fd;
+        // A previous handler of this batch may have removed the descriptor
+        if (fd >= loop->capacity || loop->slots[fd].handler == NULL)
+        {
+            continue;
+        }
+        EventSlot slot = loop->slots[fd];
+        slot.handler(fd, from_epoll_events(ready[i].events), slot.data);
+    }
+    return num_ready;
+}
+
+static int run_once_select(EventLoop* loop, int timeout_ms)
+{
+    fd_set read_fds = loop->read_set;
+    fd_set write_fds = loop->write_set;
+    struct timeval timeout;
+    struct timeval* timeout_ptr = NULL;
+    if (timeout_ms >= 0)
+    {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        timeout_ptr = &timeout;
+    }
+
+    int max_fd = loop->max_fd;
+    int num_ready = select(max_fd + 1, &read_fds, &write_fds, NULL, timeout_ptr);
+    if (num_ready == -1)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        perror("select");
+        return -1;
+    }
+
+    int dispatched = 0;
+    for (int fd = 0; fd <= max_fd && dispatched < num_ready; fd++)
+    {
+        uint32_t events = 0;
+        if (FD_ISSET(fd, &read_fds))
+        {
+            events |= EVENT_READ;
+        }
+        if (FD_ISSET(fd, &write_fds))
+        {
+            events |= EVENT_WRITE;
+        }
+        if (events == 0)
+        {
+            continue;
+        }
+        dispatched++;
+        if (fd >= loop->capacity || loop->slots[fd].handler == NULL)
+        {
+            continue;
+        }
+        EventSlot slot = loop->slots[fd];
+        slot.handler(fd, events, slot.data);
+    }
+    return dispatched;
+}
+
+int event_loop_run_once(EventLoop* loop, int timeout_ms)
+{
+    if (loop->backend == EVENT_BACKEND_EPOLL)
+    {
+        return run_once_epoll(loop, timeout_ms);
+    }
+    return run_once_select(loop, timeout_ms);
+}
+
+int event_loop_parse_backend(const char* name, EventBackend* backend)
+{
+    if (strcmp(name, "epoll") == 0)
+    {
+        *backend = EVENT_BACKEND_EPOLL;
+        return 0;
+    }
+    if (strcmp(name, "select") == 0)
+    {
+        *backend = EVENT_BACKEND_SELECT;
+        return 0;
+    }
+    return -1;
+}
+
+const char* event_loop_backend_name(EventBackend backend)
+{
+    return backend == EVENT_BACKEND_EPOLL ? "epoll" : "select";
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @file prng.h
+ * @brief Small reproducible pseudo-random generator for the simulators.
+ *
+ * PCG32 (XSH-RR output of a 64-bit LCG): 16 bytes of state, a few instructions per number and far better statistics
+ * than the LCG behind rand(). A generator is only ever used by one thread, so no lock is taken, unlike rand() which
+ * serializes every caller on a global lock in glibc.
+ *
+ * The same seed and stream always give the same sequence. prng_thread() gives every thread its own generator on the
+ * seed set with prng_set_seed(), on a different stream per thread, so that a simulation is reproducible from one seed.
+ */
+
+/**
+ * @struct Prng
+ * @brief State of a generator.
+ *
+ * @var Prng::state
+ * Current state of the LCG.
+ *
+ * @var Prng::increment
+ * Increment of the LCG, odd. Selects the stream.
+ */
+typedef struct
+{
+    uint64_t state;
+    uint64_t increment;
+} Prng;
+
+/**
+ * @brief Seeds a generator.
+ *
+ * @param rng The generator.
+ * @param seed The seed.
+ * @param stream The stream, generators with the same seed and different streams give independent sequences.
+ */
+void prng_seed(Prng* rng, uint64_t seed, uint64_t stream);
+
+/**
+ * @brief Next 32 random bits.
+ *
+ * @param rng The generator.
+ * @return A uniform number.
+ */
+uint32_t prng_next(Prng* rng);
+
+/**
+ * @brief Uniform number below a bound, without the modulo bias of rand() % bound.
+ *
+ * @param rng The generator.
+ * @param bound The bound, greater than 0.
+ * @return A number between 0 and bound - 1.
+ */
+uint32_t prng_below(Prng* rng, uint32_t bound);
+
+/**
+ * @brief Uniform float in [0, 1), with 24 bits of precision.
+ *
+ * @param rng The generator.
+ * @return The float.
+ */
+float prng_unit(Prng* rng);
+
+/**
+ * @brief Draws an event of a given probability.
+ *
+ * @param rng The generator.
+ * @param probability The probability, 0 never happens and 1 always does.
+ * @return 1 if the event happens, 0 otherwise.
+ */
+int prng_chance(Prng* rng, float probability);
+
+/**
+ * @brief Sets the seed of the generators given by prng_thread() and reseeds the one of the calling thread.
+ *
+ * Threads that already used prng_thread() keep their generator, so the seed is set before starting them. A forked
+ * process inherits the generator of its parent and calls it again to get its own sequence.
+ *
+ * @param seed The seed.
+ */
+void prng_set_seed(uint64_t seed);
+
+/**
+ * @brief Generator of the calling thread, seeded on first use.
+ *
+ * @return The generator, valid until the thread exits.
+ */
+Prng* prng_thread(void);
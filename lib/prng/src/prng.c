@@ -0,0 +1,73 @@
+#include "prng.h"
+#include <stdatomic.h>
+
+#define PCG_MULTIPLIER 6364136223846793005ULL
+
+static _Atomic uint64_t thread_seed = 0;
+static atomic_uint_fast64_t next_thread_stream = 1;
+static _Thread_local Prng thread_rng;
+static _Thread_local int thread_rng_seeded = 0;
+
+void prng_seed(Prng* rng, uint64_t seed, uint64_t stream)
+{
+    // Reference PCG32 initialization: the stream gives the increment, the seed is mixed in by two steps
+    rng->state = 0;
+    rng->increment = (stream << 1) | 1;
+    prng_next(rng);
+    rng->state += seed;
+    prng_next(rng);
+}
+
+uint32_t prng_next(Prng* rng)
+{
+    uint64_t state = rng->state;
+    rng->state = state * PCG_MULTIPLIER + rng->increment;
+    uint32_t xorshifted = (uint32_t)(((state >> 18) ^ state) >> 27);
+    uint32_t rotation = (uint32_t)(state >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31));
+}
+
+uint32_t prng_below(Prng* rng, uint32_t bound)
+{
+    // Lemire's multiply and shift, retrying the few values that would make the low results more likely
+    uint64_t product = (uint64_t)prng_next(rng) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound)
+    {
+        uint32_t threshold = (uint32_t)(-bound) % bound;
+        while (low < threshold)
+        {
+            product = (uint64_t)prng_next(rng) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+float prng_unit(Prng* rng)
+{
+    return (float)(prng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+int prng_chance(Prng* rng, float probability)
+{
+    return prng_unit(rng) < probability;
+}
+
+void prng_set_seed(uint64_t seed)
+{
+    atomic_store(&thread_seed, seed);
+    atomic_store(&next_thread_stream, 1);
+    prng_seed(&thread_rng, seed, 0);
+    thread_rng_seeded = 1;
+}
+
+Prng* prng_thread(void)
+{
+    if (!thread_rng_seeded)
+    {
+        prng_seed(&thread_rng, atomic_load(&thread_seed), atomic_fetch_add(&next_thread_stream, 1));
+        thread_rng_seeded = 1;
+    }
+    return &thread_rng;
+}
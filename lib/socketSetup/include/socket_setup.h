@@ -65,6 +65,8 @@ int set_udp_ipv6_socket(struct sockaddr_in6 address_ipv6, int port);
 
 /**
  * @brief Creates a TCP socket capable of handling both IPv4 and IPv6 connections.
+ *
+ * SO_REUSEADDR and SO_REUSEPORT are set, so several listeners can share the port.
  * 
  * @param port The port number for the TCP socket.
  * @param MAX_CONNECTIONS The maximum number of pending connections in the socket's listen queue.
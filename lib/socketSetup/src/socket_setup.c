@@ -176,6 +176,12 @@ int set_tcp_socket(struct sockaddr_in6 address_ipv6, int port, int MAX_CONNECTIO
         exit(EXIT_FAILURE);
     }
 
+    // Allow several listeners (one per worker thread) on the same port, the kernel balances connections among them
+    if (setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, (char *)&on, sizeof(on)) < 0) {
+        perror("setsockopt(SO_REUSEPORT) failed");
+        exit(EXIT_FAILURE);
+    }
+
     // Bind the socket to the specified port and any available address
     memset(&address_ipv6, 0, sizeof(address_ipv6));
     address_ipv6.sin6_family = AF_INET6;
@@ -222,7 +228,8 @@ int set_udp_socket(struct sockaddr_in6 address_ipv6, int port) {
         exit(EXIT_FAILURE);
     }
 
-    int option = 0;
+    // One socket per worker thread can be bound to the same port, datagrams are spread by flow
+    int option = 1;
     if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option)) < 0) {
         perror("ERROR setting UDP socket option");
         exit(EXIT_FAILURE);
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "../lib/cJSON/include/cJSON.h"
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+
+#define SUPPLIES_SEGMENT_KEY 1235
+#define SUPPLIES_CACHE_LINE 64
+
 // Define structures for food and medicine supplies
 typedef struct
 {
@@ -21,13 +28,55 @@ typedef struct
     int bandages;
 } MedicineSupply;
 
-// Function to initialize shared memory for supplies data
+// Both supplies in one shared segment, protected by a sequence lock. It fits in a single cache line.
+// Writers bump write_begin, apply their deltas with atomic read-modify-write and bump write_end, so any number of
+// processes can update at once without losing deltas. Readers retry until no write started or ended while they copied.
+typedef struct
+{
+    alignas(SUPPLIES_CACHE_LINE) atomic_uint write_begin;
+    atomic_uint write_end;
+    atomic_int meat;
+    atomic_int vegetables;
+    atomic_int fruits;
+    atomic_int water;
+    atomic_int antibiotics;
+    atomic_int analgesics;
+    atomic_int bandages;
+} SuppliesSegment;
+
+// Attachment of the supplies segment, made once and reused by every request
+typedef struct
+{
+    int shmid;
+    SuppliesSegment* segment;
+} SuppliesHandle;
+
+// Function to attach the supplies segment, creating it if needed. Returns 0 on success, -1 on error
+int supplies_attach(SuppliesHandle* handle);
+
+// Function to detach the supplies segment. The handle can be attached again afterwards
+void supplies_detach(SuppliesHandle* handle);
+
+// Function to get the handle used by get_supplies() and update_supplies_from_json()
+SuppliesHandle* supplies_default_handle();
+
+// Function to copy a consistent snapshot of the supplies. Never blocks writers. Returns 0, or -1 if not attached
+int supplies_read(SuppliesHandle* handle, FoodSupply* food_supply, MedicineSupply* medicine_supply);
+
+// Function to get the number of writes completed on the segment, which changes whenever the supplies may have changed
+unsigned int supplies_version(SuppliesHandle* handle);
+
+// Function to add deltas to the supplies, clamping every amount at 0. Returns 0, or -1 if not attached
+int supplies_add(SuppliesHandle* handle, const FoodSupply* food_delta, const MedicineSupply* medicine_delta);
+
+// Function to initialize shared memory for supplies data. Attaches the default handle, before any thread starts
 void init_shared_memory_supplies();
 
-// Function to get a pointer to the shared food supply data
-FoodSupply* get_food_supply();
+// Function to get a consistent snapshot of the shared supplies data. Returns 0 on success, -1 on error
+int get_supplies(FoodSupply* food_supply, MedicineSupply* medicine_supply);
 
-// Function to get a pointer to the shared medicine supply data
-MedicineSupply* get_medicine_supply();
+// Function to apply the "food" and "medicine" deltas of an update request to the shared supplies data
+void update_supplies_from_json(cJSON* json);
 
-void update_supplies_from_json(FoodSupply* food_supply, MedicineSupply* medicine_supply, cJSON* json);
+// Function to apply deltas already read from an update request to the shared supplies data
+void update_supplies(const FoodSupply* food_delta, const MedicineSupply* medicine_delta);
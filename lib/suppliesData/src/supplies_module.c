@@ -1,175 +1,224 @@
 #include "supplies_module.h"
 
-#define FOOD_SUPPLY_KEY 1234
-#define MEDICINE_SUPPLY_KEY 5678
+// Readers spin this many times on a busy segment before yielding the CPU to the writer
+#define SUPPLIES_READ_SPINS 64
 
-// Function to initialize shared memory for supplies data
-void init_shared_memory_supplies()
+// The segment is shared between processes, which is only safe with lock-free atomics
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "atomic_int must be lock-free to live in shared memory");
+_Static_assert(sizeof(SuppliesSegment) == SUPPLIES_CACHE_LINE, "supplies segment must fit in one cache line");
+
+// Attachment shared by every caller of get_supplies() and update_supplies_from_json()
+static SuppliesHandle default_handle = {-1, NULL};
+
+int supplies_attach(SuppliesHandle* handle)
 {
-    // Create shared memory for food supply
-    int food_shmid = shmget(FOOD_SUPPLY_KEY, sizeof(FoodSupply), IPC_CREAT | 0666);
-    if (food_shmid == -1)
+    if (handle->segment != NULL)
     {
-        perror("shmget for food supply");
-        return;
+        return 0;
     }
 
-    // Attach shared memory for food supply
-    FoodSupply* food_supply = (FoodSupply*)shmat(food_shmid, NULL, 0);
-    if (food_supply == (FoodSupply*)(-1))
+    // Create or get shared memory for the supplies
+    handle->shmid = shmget(SUPPLIES_SEGMENT_KEY, sizeof(SuppliesSegment), IPC_CREAT | 0666);
+    if (handle->shmid == -1)
     {
-        perror("shmat for food supply");
-        return;
+        perror("shmget for supplies");
+        return -1;
     }
 
-    // Initialize food supply data
-    food_supply->meat = 0;
-    food_supply->vegetables = 0;
-    food_supply->fruits = 0;
-    food_supply->water = 0;
+    // Attach shared memory for the supplies (page aligned, so the segment starts on a cache line)
+    SuppliesSegment* segment = (SuppliesSegment*)shmat(handle->shmid, NULL, 0);
+    if (segment == (SuppliesSegment*)(-1))
+    {
+        perror("shmat for supplies");
+        return -1;
+    }
 
-    // Create shared memory for medicine supply
-    int medicine_shmid = shmget(MEDICINE_SUPPLY_KEY, sizeof(MedicineSupply), IPC_CREAT | 0666);
-    if (medicine_shmid == -1)
+    handle->segment = segment;
+    return 0;
+}
+
+void supplies_detach(SuppliesHandle* handle)
+{
+    if (handle->segment != NULL && shmdt(handle->segment) == -1)
     {
-        perror("shmget for medicine supply");
-        return;
+        perror("shmdt for supplies");
     }
+    handle->segment = NULL;
+}
+
+SuppliesHandle* supplies_default_handle()
+{
+    return &default_handle;
+}
 
-    // Attach shared memory for medicine supply
-    MedicineSupply* medicine_supply = (MedicineSupply*)shmat(medicine_shmid, NULL, 0);
-    if (medicine_supply == (MedicineSupply*)(-1))
+int supplies_read(SuppliesHandle* handle, FoodSupply* food_supply, MedicineSupply* medicine_supply)
+{
+    SuppliesSegment* segment = handle->segment;
+    if (segment == NULL)
     {
-        perror("shmat for medicine supply");
-        return;
+        return -1;
     }
 
-    // Initialize medicine supply data
-    medicine_supply->antibiotics = 0;
-    medicine_supply->analgesics = 0;
-    medicine_supply->bandages = 0;
+    for (int attempt = 1;; attempt++)
+    {
+        // Every write that ended is visible after this load; begin == end means none is in progress
+        unsigned int sequence = atomic_load_explicit(&segment->write_end, memory_order_acquire);
+        if (atomic_load_explicit(&segment->write_begin, memory_order_relaxed) == sequence)
+        {
+            food_supply->meat = atomic_load_explicit(&segment->meat, memory_order_relaxed);
+            food_supply->vegetables = atomic_load_explicit(&segment->vegetables, memory_order_relaxed);
+            food_supply->fruits = atomic_load_explicit(&segment->fruits, memory_order_relaxed);
+            food_supply->water = atomic_load_explicit(&segment->water, memory_order_relaxed);
+            medicine_supply->antibiotics = atomic_load_explicit(&segment->antibiotics, memory_order_relaxed);
+            medicine_supply->analgesics = atomic_load_explicit(&segment->analgesics, memory_order_relaxed);
+            medicine_supply->bandages = atomic_load_explicit(&segment->bandages, memory_order_relaxed);
+
+            // If no write started while copying, the snapshot is consistent
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&segment->write_begin, memory_order_relaxed) == sequence)
+            {
+                return 0;
+            }
+        }
+        if (attempt % SUPPLIES_READ_SPINS == 0)
+        {
+            sched_yield();
+        }
+    }
 }
 
-// Function to get a pointer to the shared food supply data
-FoodSupply* get_food_supply()
+// Adds a delta to an amount, never letting it go below 0
+static void add_clamped(atomic_int* amount, int delta)
 {
-    // Get shared memory for food supply
-    int food_shmid = shmget(FOOD_SUPPLY_KEY, sizeof(FoodSupply), 0666);
-    if (food_shmid == -1)
+    if (delta == 0)
     {
-        perror("shmget for food supply");
-        return NULL;
+        return;
     }
+    int current = atomic_load_explicit(amount, memory_order_relaxed);
+    int updated;
+    do
+    {
+        updated = current + delta;
+        if (updated < 0)
+        {
+            updated = 0;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(amount, &current, updated, memory_order_relaxed,
+                                                    memory_order_relaxed));
+}
 
-    // Attach shared memory for food supply
-    FoodSupply* food_supply = (FoodSupply*)shmat(food_shmid, NULL, 0);
-    if (food_supply == (FoodSupply*)(-1))
+int supplies_add(SuppliesHandle* handle, const FoodSupply* food_delta, const MedicineSupply* medicine_delta)
+{
+    SuppliesSegment* segment = handle->segment;
+    if (segment == NULL)
     {
-        perror("shmat for food supply");
-        return NULL;
+        return -1;
     }
 
-    return food_supply;
+    // Announce the write before touching any amount, so readers that see one of them retry
+    atomic_fetch_add_explicit(&segment->write_begin, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    add_clamped(&segment->meat, food_delta->meat);
+    add_clamped(&segment->vegetables, food_delta->vegetables);
+    add_clamped(&segment->fruits, food_delta->fruits);
+    add_clamped(&segment->water, food_delta->water);
+    add_clamped(&segment->antibiotics, medicine_delta->antibiotics);
+    add_clamped(&segment->analgesics, medicine_delta->analgesics);
+    add_clamped(&segment->bandages, medicine_delta->bandages);
+
+    atomic_fetch_add_explicit(&segment->write_end, 1, memory_order_release);
+    return 0;
 }
 
-// Function to get a pointer to the shared medicine supply data
-MedicineSupply* get_medicine_supply()
+// Function to initialize shared memory for supplies data
+void init_shared_memory_supplies()
 {
-    // Get shared memory for medicine supply
-    int medicine_shmid = shmget(MEDICINE_SUPPLY_KEY, sizeof(MedicineSupply), 0666);
-    if (medicine_shmid == -1)
+    if (supplies_attach(&default_handle) == -1)
     {
-        perror("shmget for medicine supply");
-        return NULL;
+        return;
     }
 
-    // Attach shared memory for medicine supply
-    MedicineSupply* medicine_supply = (MedicineSupply*)shmat(medicine_shmid, NULL, 0);
-    if (medicine_supply == (MedicineSupply*)(-1))
+    // Initialize supplies data, before any reader or writer runs
+    SuppliesSegment* segment = default_handle.segment;
+    atomic_store(&segment->meat, 0);
+    atomic_store(&segment->vegetables, 0);
+    atomic_store(&segment->fruits, 0);
+    atomic_store(&segment->water, 0);
+    atomic_store(&segment->antibiotics, 0);
+    atomic_store(&segment->analgesics, 0);
+    atomic_store(&segment->bandages, 0);
+
+    // The reset counts as a write, so cached copies of the previous amounts are invalidated
+    unsigned int version = atomic_load(&segment->write_end) + 1;
+    atomic_store(&segment->write_end, version);
+    atomic_store(&segment->write_begin, version);
+}
+
+unsigned int supplies_version(SuppliesHandle* handle)
+{
+    if (handle->segment == NULL)
     {
-        perror("shmat for medicine supply");
-        return NULL;
+        return 0;
     }
+    return atomic_load_explicit(&handle->segment->write_end, memory_order_acquire);
+}
 
-    return medicine_supply;
+// Function to get a consistent snapshot of the shared supplies data
+int get_supplies(FoodSupply* food_supply, MedicineSupply* medicine_supply)
+{
+    // Attach on first use only, the attachment is kept until supplies_detach
+    if (default_handle.segment == NULL && supplies_attach(&default_handle) == -1)
+    {
+        return -1;
+    }
+    return supplies_read(&default_handle, food_supply, medicine_supply);
 }
 
-void update_supplies_from_json(FoodSupply* food_supply, MedicineSupply* medicine_supply, cJSON* json)
+// Reads the delta of one supply from a "food" or "medicine" object, 0 if absent
+static int json_delta(cJSON* object, const char* name)
 {
+    cJSON* item = cJSON_GetObjectItem(object, name);
+    if (item != NULL && item->type == cJSON_Number)
+    {
+        return item->valueint;
+    }
+    return 0;
+}
+
+void update_supplies_from_json(cJSON* json)
+{
+    FoodSupply food_delta = {0, 0, 0, 0};
+    MedicineSupply medicine_delta = {0, 0, 0};
+
     // Check if the JSON object contains the "food" field
     cJSON* food_object = cJSON_GetObjectItem(json, "food");
     if (food_object != NULL && food_object->type == cJSON_Object)
     {
-        // Extract and update food supplies
-        cJSON* fruits_item = cJSON_GetObjectItem(food_object, "fruits");
-        if (fruits_item != NULL && fruits_item->type == cJSON_Number)
-        {
-            food_supply->fruits += fruits_item->valueint;
-            if (food_supply->fruits < 0)
-            {
-                food_supply->fruits = 0;
-            }
-        }
-        cJSON* vegetables_item = cJSON_GetObjectItem(food_object, "vegetables");
-        if (vegetables_item != NULL && vegetables_item->type == cJSON_Number)
-        {
-            food_supply->vegetables += vegetables_item->valueint;
-            if (food_supply->vegetables < 0)
-            {
-                food_supply->vegetables = 0;
-            }
-        }
-        cJSON* meat_item = cJSON_GetObjectItem(food_object, "meat");
-        if (meat_item != NULL && meat_item->type == cJSON_Number)
-        {
-            food_supply->meat += meat_item->valueint;
-            if (food_supply->meat < 0)
-            {
-                food_supply->meat = 0;
-            }
-        }
-        cJSON* water_item = cJSON_GetObjectItem(food_object, "water");
-        if (water_item != NULL && water_item->type == cJSON_Number)
-        {
-            food_supply->water += water_item->valueint;
-            if (food_supply->water < 0)
-            {
-                food_supply->water = 0;
-            }
-        }
+        food_delta.meat = json_delta(food_object, "meat");
+        food_delta.vegetables = json_delta(food_object, "vegetables");
+        food_delta.fruits = json_delta(food_object, "fruits");
+        food_delta.water = json_delta(food_object, "water");
     }
 
     // Check if the JSON object contains the "medicine" field
     cJSON* medicine_object = cJSON_GetObjectItem(json, "medicine");
     if (medicine_object != NULL && medicine_object->type == cJSON_Object)
     {
-        // Extract and update medicine supplies
-        cJSON* antibiotics_item = cJSON_GetObjectItem(medicine_object, "antibiotics");
-        if (antibiotics_item != NULL && antibiotics_item->type == cJSON_Number)
-        {
-            medicine_supply->antibiotics += antibiotics_item->valueint;
-            if (medicine_supply->antibiotics < 0)
-            {
-                medicine_supply->antibiotics = 0;
-            }
-        }
-        cJSON* analgesics_item = cJSON_GetObjectItem(medicine_object, "analgesics");
-        if (analgesics_item != NULL && analgesics_item->type == cJSON_Number)
-        {
-            medicine_supply->analgesics += analgesics_item->valueint;
-            if (medicine_supply->analgesics < 0)
-            {
-                medicine_supply->analgesics = 0;
-            }
-        }
-        cJSON* bandages_item = cJSON_GetObjectItem(medicine_object, "bandages");
-        if (bandages_item != NULL && bandages_item->type == cJSON_Number)
-        {
-            medicine_supply->bandages += bandages_item->valueint;
-            if (medicine_supply->bandages < 0)
-            {
-                medicine_supply->bandages = 0;
-            }
-        }
+        medicine_delta.antibiotics = json_delta(medicine_object, "antibiotics");
+        medicine_delta.analgesics = json_delta(medicine_object, "analgesics");
+        medicine_delta.bandages = json_delta(medicine_object, "bandages");
+    }
+
+    update_supplies(&food_delta, &medicine_delta);
+}
+
+void update_supplies(const FoodSupply* food_delta, const MedicineSupply* medicine_delta)
+{
+    if (default_handle.segment == NULL && supplies_attach(&default_handle) == -1)
+    {
+        printf("Error attaching supplies data.\n");
+        return;
     }
+    supplies_add(&default_handle, food_delta, medicine_delta);
 }
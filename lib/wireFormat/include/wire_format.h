@@ -0,0 +1,235 @@
+#pragma once
+
+#include "../lib/cJSON/include/cJSON.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file wire_format.h
+ * @brief Compact binary encoding of the messages, offered alongside JSON.
+ *
+ * A message is WIRE_MAGIC, a WireType byte and a sequence of fields. Every field is a WireTag byte, the length of its
+ * value as a varint and the value: integers are zigzag varints, strings are raw bytes. A status response takes about
+ * 25 bytes instead of 150 of JSON, and is written and read without building a tree or printing a number.
+ *
+ * Readers skip the fields they do not know, so fields can be added without breaking older peers.
+ *
+ * WIRE_MAGIC cannot start a JSON text nor the length-prefixed framing, so a server tells the encodings apart from the
+ * first byte: of the connection for TCP, of every datagram for UDP.
+ */
+
+#define WIRE_MAGIC 0xB1
+#define WIRE_HEADER_SIZE 2
+#define WIRE_MAX_VARINT 10
+#define WIRE_MAX_MESSAGE 1024
+
+/**
+ * @enum WireType
+ * @brief Kind of a message, second byte of every message.
+ *
+ * Requests from the clients come first, then the messages sent by the server. WIRE_MSG_JSON carries a JSON text in a
+ * WIRE_TAG_TEXT field, for the rare messages without a binary form (e.g. the server statistics).
+ */
+typedef enum
+{
+    WIRE_MSG_AUTHENTICATE = 1,
+    WIRE_MSG_STATUS = 2,
+    WIRE_MSG_UPDATE = 3,
+    WIRE_MSG_SUMMARY = 4,
+    WIRE_MSG_STATS = 5,
+    WIRE_MSG_SUBSCRIBE = 6,
+    WIRE_MSG_AUTH_SUCCESS = 16,
+    WIRE_MSG_AUTH_FAILURE = 17,
+    WIRE_MSG_SUPPLIES = 18,
+    WIRE_MSG_SHELTER_SUMMARY = 19,
+    WIRE_MSG_ALERT = 20,
+    WIRE_MSG_DISCONNECT = 21,
+    WIRE_MSG_JSON = 22
+} WireType;
+
+/**
+ * @enum WireTag
+ * @brief Meaning of a field. The supplies, alert counts and alert fields are integers, the others strings.
+ *
+ * A subscription has one WIRE_TAG_TOPIC field per topic name, a single empty one when it names no topic.
+ */
+typedef enum
+{
+    WIRE_TAG_HOSTNAME = 1,
+    WIRE_TAG_TOKEN = 2,
+    WIRE_TAG_MEAT = 3,
+    WIRE_TAG_VEGETABLES = 4,
+    WIRE_TAG_FRUITS = 5,
+    WIRE_TAG_WATER = 6,
+    WIRE_TAG_ANTIBIOTICS = 7,
+    WIRE_TAG_ANALGESICS = 8,
+    WIRE_TAG_BANDAGES = 9,
+    WIRE_TAG_NORTH_ENTRY = 10,
+    WIRE_TAG_EAST_ENTRY = 11,
+    WIRE_TAG_WEST_ENTRY = 12,
+    WIRE_TAG_SOUTH_ENTRY = 13,
+    WIRE_TAG_LAST_KEEPALIVED = 14,
+    WIRE_TAG_LAST_EVENT = 15,
+    WIRE_TAG_ENTRY = 16,
+    WIRE_TAG_TEMPERATURE = 17,
+    WIRE_TAG_TIMESTAMP = 18,
+    WIRE_TAG_TEXT = 19,
+    WIRE_TAG_TOPIC = 20
+} WireTag;
+
+/**
+ * @struct WireWriter
+ * @brief Message being written into a caller's buffer.
+ *
+ * @var WireWriter::data
+ * The buffer.
+ *
+ * @var WireWriter::capacity
+ * Size of the buffer.
+ *
+ * @var WireWriter::len
+ * Bytes written so far.
+ *
+ * @var WireWriter::overflow
+ * Set when a field did not fit: the message is then incomplete and wire_writer_finish() fails.
+ */
+typedef struct
+{
+    uint8_t* data;
+    size_t capacity;
+    size_t len;
+    int overflow;
+} WireWriter;
+
+/**
+ * @struct WireReader
+ * @brief Position in a received message.
+ *
+ * @var WireReader::next
+ * Next field.
+ *
+ * @var WireReader::end
+ * End of the message.
+ */
+typedef struct
+{
+    const uint8_t* next;
+    const uint8_t* end;
+} WireReader;
+
+/**
+ * @struct WireField
+ * @brief A field of a received message, pointing into it.
+ *
+ * @var WireField::tag
+ * The tag, possibly one this version does not know.
+ *
+ * @var WireField::value
+ * The value bytes.
+ *
+ * @var WireField::len
+ * Length of the value.
+ */
+typedef struct
+{
+    int tag;
+    const uint8_t* value;
+    size_t len;
+} WireField;
+
+/**
+ * @brief Starts a message.
+ *
+ * @param writer The writer.
+ * @param buffer Output buffer, WIRE_MAX_MESSAGE bytes hold any message of the server.
+ * @param capacity Size of the buffer.
+ * @param type Kind of the message.
+ */
+void wire_writer_init(WireWriter* writer, void* buffer, size_t capacity, WireType type);
+
+/**
+ * @brief Appends an integer field.
+ *
+ * @param writer The writer.
+ * @param tag The tag.
+ * @param value The value.
+ */
+void wire_put_int(WireWriter* writer, WireTag tag, int64_t value);
+
+/**
+ * @brief Appends a string field.
+ *
+ * @param writer The writer.
+ * @param tag The tag.
+ * @param value The bytes, not necessarily NUL-terminated.
+ * @param len Number of bytes.
+ */
+void wire_put_bytes(WireWriter* writer, WireTag tag, const void* value, size_t len);
+
+/**
+ * @brief Appends a NUL-terminated string field.
+ *
+ * @param writer The writer.
+ * @param tag The tag.
+ * @param value The string.
+ */
+void wire_put_string(WireWriter* writer, WireTag tag, const char* value);
+
+/**
+ * @brief Ends a message.
+ *
+ * @param writer The writer.
+ * @return Length of the message, 0 if it did not fit in the buffer.
+ */
+size_t wire_writer_finish(const WireWriter* writer);
+
+/**
+ * @brief Opens a received message.
+ *
+ * @param reader The reader.
+ * @param data The message.
+ * @param len Length of the message.
+ * @param type Output kind of the message.
+ * @return 0 on success, -1 if the bytes are not a binary message.
+ */
+int wire_reader_init(WireReader* reader, const void* data, size_t len, int* type);
+
+/**
+ * @brief Reads the next field of a message.
+ *
+ * @param reader The reader.
+ * @param field Output field.
+ * @return 1 if a field was read, 0 at the end of the message, -1 if the message is truncated.
+ */
+int wire_next_field(WireReader* reader, WireField* field);
+
+/**
+ * @brief Decodes the value of an integer field.
+ *
+ * @param field The field.
+ * @param value Output value.
+ * @return 0 on success, -1 if the value is not a single varint.
+ */
+int wire_field_int(const WireField* field, int64_t* value);
+
+/**
+ * @brief Encodes a request built as JSON by a client, e.g. {"message":"status","hostname":"ubuntu"}.
+ *
+ * @param request The request: "message", "hostname", "token", the "food" and "medicine" deltas and the "topics" names
+ * are encoded.
+ * @param buffer Output buffer.
+ * @param capacity Size of the buffer.
+ * @return Length of the message, 0 if the message is unknown or the buffer too small.
+ */
+size_t wire_encode_json_request(const cJSON* request, void* buffer, size_t capacity);
+
+/**
+ * @brief Converts a message to the JSON the server would have sent instead, for display.
+ *
+ * Alerts, which the server sends as text, become {"message":"alert","entry":...,"temperature":...,"timestamp":...}.
+ *
+ * @param data The message.
+ * @param len Length of the message.
+ * @return The JSON tree, to be deleted by the caller, or NULL if the message is malformed.
+ */
+cJSON* wire_decode_to_json(const void* data, size_t len);
@@ -0,0 +1,353 @@
+#include "wire_format.h"
+#include <string.h>
+
+#define VARINT_CONTINUATION 0x80
+#define VARINT_PAYLOAD 0x7F
+
+/**
+ * @struct WireName
+ * @brief JSON name of a tag, the object it belongs to in the JSON messages (NULL for the top level) and whether its
+ * value is a string.
+ */
+typedef struct
+{
+    WireTag tag;
+    const char* name;
+    const char* object;
+    int text;
+} WireName;
+
+static const WireName wire_names[] = {
+    {WIRE_TAG_HOSTNAME, "hostname", NULL, 1},
+    {WIRE_TAG_TOKEN, "token", NULL, 1},
+    {WIRE_TAG_MEAT, "meat", "food", 0},
+    {WIRE_TAG_VEGETABLES, "vegetables", "food", 0},
+    {WIRE_TAG_FRUITS, "fruits", "food", 0},
+    {WIRE_TAG_WATER, "water", "food", 0},
+    {WIRE_TAG_ANTIBIOTICS, "antibiotics", "medicine", 0},
+    {WIRE_TAG_ANALGESICS, "analgesics", "medicine", 0},
+    {WIRE_TAG_BANDAGES, "bandages", "medicine", 0},
+    {WIRE_TAG_NORTH_ENTRY, "north_entry", "alerts", 0},
+    {WIRE_TAG_EAST_ENTRY, "east_entry", "alerts", 0},
+    {WIRE_TAG_WEST_ENTRY, "west_entry", "alerts", 0},
+    {WIRE_TAG_SOUTH_ENTRY, "south_entry", "alerts", 0},
+    {WIRE_TAG_LAST_KEEPALIVED, "last_keepalived", "emergency", 1},
+    {WIRE_TAG_LAST_EVENT, "last_event", "emergency", 1},
+    {WIRE_TAG_ENTRY, "entry", NULL, 1},
+    {WIRE_TAG_TEMPERATURE, "temperature", NULL, 0},
+    {WIRE_TAG_TIMESTAMP, "timestamp", NULL, 0},
+};
+
+#define WIRE_NAMES_COUNT (sizeof(wire_names) / sizeof(wire_names[0]))
+
+/**
+ * @struct WireMessageName
+ * @brief Value of "message" in the JSON form of a message, NULL when the JSON form has none.
+ */
+typedef struct
+{
+    WireType type;
+    const char* message;
+} WireMessageName;
+
+static const WireMessageName wire_messages[] = {
+    {WIRE_MSG_AUTHENTICATE, "authenticateme"},
+    {WIRE_MSG_STATUS, "status"},
+    {WIRE_MSG_UPDATE, "update"},
+    {WIRE_MSG_SUMMARY, "summary"},
+    {WIRE_MSG_STATS, "stats"},
+    {WIRE_MSG_SUBSCRIBE, "subscribe"},
+    {WIRE_MSG_AUTH_SUCCESS, "auth_success"},
+    {WIRE_MSG_AUTH_FAILURE, "auth_failure"},
+    {WIRE_MSG_SUPPLIES, NULL},
+    {WIRE_MSG_SHELTER_SUMMARY, NULL},
+    {WIRE_MSG_ALERT, "alert"},
+    {WIRE_MSG_DISCONNECT, "disconnect"},
+};
+
+#define WIRE_MESSAGES_COUNT (sizeof(wire_messages) / sizeof(wire_messages[0]))
+
+static size_t put_varint(uint8_t* out, uint64_t value)
+{
+    size_t len = 0;
+    while (value >= VARINT_CONTINUATION)
+    {
+        out[len++] = (uint8_t)(value | VARINT_CONTINUATION);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+// Reads a varint of at most WIRE_MAX_VARINT bytes, returns its length or 0 if it is truncated or too long
+static size_t get_varint(const uint8_t* in, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for (size_t i = 0; i < WIRE_MAX_VARINT && in + i < end; i++)
+    {
+        *value |= (uint64_t)(in[i] & VARINT_PAYLOAD) << (7 * i);
+        if ((in[i] & VARINT_CONTINUATION) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Small magnitudes of either sign take few bytes: 0, -1, 1, -2... become 0, 1, 2, 3...
+static uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+void wire_writer_init(WireWriter* writer, void* buffer, size_t capacity, WireType type)
+{
+    writer->data = buffer;
+    writer->capacity = capacity;
+    writer->len = WIRE_HEADER_SIZE;
+    writer->overflow = capacity < WIRE_HEADER_SIZE;
+    if (!writer->overflow)
+    {
+        writer->data[0] = WIRE_MAGIC;
+        writer->data[1] = (uint8_t)type;
+    }
+}
+
+void wire_put_int(WireWriter* writer, WireTag tag, int64_t value)
+{
+    uint8_t varint[WIRE_MAX_VARINT];
+    size_t len = put_varint(varint, zigzag_encode(value));
+    wire_put_bytes(writer, tag, varint, len);
+}
+
+void wire_put_bytes(WireWriter* writer, WireTag tag, const void* value, size_t len)
+{
+    uint8_t header[1 + WIRE_MAX_VARINT];
+    header[0] = (uint8_t)tag;
+    size_t header_len = 1 + put_varint(header + 1, len);
+    if (writer->overflow || writer->capacity - writer->len < header_len + len)
+    {
+        writer->overflow = 1;
+        return;
+    }
+    memcpy(writer->data + writer->len, header, header_len);
+    memcpy(writer->data + writer->len + header_len, value, len);
+    writer->len += header_len + len;
+}
+
+void wire_put_string(WireWriter* writer, WireTag tag, const char* value)
+{
+    wire_put_bytes(writer, tag, value, strlen(value));
+}
+
+size_t wire_writer_finish(const WireWriter* writer)
+{
+    return writer->overflow ? 0 : writer->len;
+}
+
+int wire_reader_init(WireReader* reader, const void* data, size_t len, int* type)
+{
+    const uint8_t* bytes = data;
+    if (len < WIRE_HEADER_SIZE || bytes[0] != WIRE_MAGIC)
+    {
+        return -1;
+    }
+    *type = bytes[1];
+    reader->next = bytes + WIRE_HEADER_SIZE;
+    reader->end = bytes + len;
+    return 0;
+}
+
+int wire_next_field(WireReader* reader, WireField* field)
+{
+    if (reader->next == reader->end)
+    {
+        return 0;
+    }
+    uint64_t len;
+    size_t header = get_varint(reader->next + 1, reader->end, &len);
+    if (header == 0 || len > (uint64_t)(reader->end - reader->next - 1 - (ptrdiff_t)header))
+    {
+        return -1;
+    }
+    field->tag = reader->next[0];
+    field->value = reader->next + 1 + header;
+    field->len = (size_t)len;
+    reader->next = field->value + len;
+    return 1;
+}
+
+int wire_field_int(const WireField* field, int64_t* value)
+{
+    uint64_t encoded;
+    if (field->len == 0 || get_varint(field->value, field->value + field->len, &encoded) != field->len)
+    {
+        return -1;
+    }
+    *value = zigzag_decode(encoded);
+    return 0;
+}
+
+static const WireName* name_of_tag(int tag)
+{
+    for (size_t i = 0; i < WIRE_NAMES_COUNT; i++)
+    {
+        if ((int)wire_names[i].tag == tag)
+        {
+            return &wire_names[i];
+        }
+    }
+    return NULL;
+}
+
+static void put_json_deltas(WireWriter* writer, const cJSON* request, const char* object)
+{
+    const cJSON* deltas = cJSON_GetObjectItemCaseSensitive(request, object);
+    for (size_t i = 0; i < WIRE_NAMES_COUNT; i++)
+    {
+        if (wire_names[i].object == NULL || strcmp(wire_names[i].object, object) != 0)
+        {
+            continue;
+        }
+        const cJSON* amount = cJSON_GetObjectItemCaseSensitive(deltas, wire_names[i].name);
+        if (cJSON_IsNumber(amount))
+        {
+            wire_put_int(writer, wire_names[i].tag, amount->valueint);
+        }
+    }
+}
+
+size_t wire_encode_json_request(const cJSON* request, void* buffer, size_t capacity)
+{
+    const cJSON* message = cJSON_GetObjectItemCaseSensitive(request, "message");
+    if (!cJSON_IsString(message))
+    {
+        return 0;
+    }
+    const WireMessageName* known = NULL;
+    for (size_t i = 0; i < WIRE_MESSAGES_COUNT && known == NULL; i++)
+    {
+        if (wire_messages[i].type <= WIRE_MSG_SUBSCRIBE && strcmp(wire_messages[i].message, message->valuestring) == 0)
+        {
+            known = &wire_messages[i];
+        }
+    }
+    if (known == NULL)
+    {
+        return 0;
+    }
+
+    WireWriter writer;
+    wire_writer_init(&writer, buffer, capacity, known->type);
+    const cJSON* hostname = cJSON_GetObjectItemCaseSensitive(request, "hostname");
+    if (cJSON_IsString(hostname))
+    {
+        wire_put_string(&writer, WIRE_TAG_HOSTNAME, hostname->valuestring);
+    }
+    const cJSON* token = cJSON_GetObjectItemCaseSensitive(request, "token");
+    if (cJSON_IsString(token))
+    {
+        wire_put_string(&writer, WIRE_TAG_TOKEN, token->valuestring);
+    }
+    put_json_deltas(&writer, request, "food");
+    put_json_deltas(&writer, request, "medicine");
+    const cJSON* topics = cJSON_GetObjectItemCaseSensitive(request, "topics");
+    if (cJSON_IsArray(topics))
+    {
+        const cJSON* topic;
+        int names = 0;
+        cJSON_ArrayForEach(topic, topics)
+        {
+            if (cJSON_IsString(topic))
+            {
+                wire_put_string(&writer, WIRE_TAG_TOPIC, topic->valuestring);
+                names++;
+            }
+        }
+        // An empty name stands for an empty list, which is not the same as no list
+        if (names == 0)
+        {
+            wire_put_bytes(&writer, WIRE_TAG_TOPIC, "", 0);
+        }
+    }
+    return wire_writer_finish(&writer);
+}
+
+// Object a field goes in, created on its first field
+static cJSON* parent_object(cJSON* json, const char* object, int type)
+{
+    if (object == NULL)
+    {
+        return json;
+    }
+    // The food and medicine of a summary are grouped under "supplies"
+    if (type == WIRE_MSG_SHELTER_SUMMARY && (strcmp(object, "food") == 0 || strcmp(object, "medicine") == 0))
+    {
+        cJSON* supplies = cJSON_GetObjectItemCaseSensitive(json, "supplies");
+        json = supplies != NULL ? supplies : cJSON_AddObjectToObject(json, "supplies");
+    }
+    cJSON* parent = cJSON_GetObjectItemCaseSensitive(json, object);
+    return parent != NULL ? parent : cJSON_AddObjectToObject(json, object);
+}
+
+cJSON* wire_decode_to_json(const void* data, size_t len)
+{
+    WireReader reader;
+    int type;
+    if (wire_reader_init(&reader, data, len, &type) == -1)
+    {
+        return NULL;
+    }
+
+    cJSON* json = cJSON_CreateObject();
+    for (size_t i = 0; i < WIRE_MESSAGES_COUNT; i++)
+    {
+        if ((int)wire_messages[i].type == type && wire_messages[i].message != NULL)
+        {
+            cJSON_AddStringToObject(json, "message", wire_messages[i].message);
+        }
+    }
+
+    WireField field;
+    int status;
+    while ((status = wire_next_field(&reader, &field)) == 1)
+    {
+        if (type == WIRE_MSG_JSON && field.tag == WIRE_TAG_TEXT)
+        {
+            cJSON_Delete(json);
+            return cJSON_ParseWithLength((const char*)field.value, field.len);
+        }
+        const WireName* name = name_of_tag(field.tag);
+        if (name == NULL)
+        {
+            continue; // A field of a newer peer
+        }
+        cJSON* parent = parent_object(json, name->object, type);
+        int64_t value;
+        if (name->text)
+        {
+            char text[WIRE_MAX_MESSAGE];
+            size_t text_len = field.len < sizeof(text) ? field.len : sizeof(text) - 1;
+            memcpy(text, field.value, text_len);
+            text[text_len] = '\0';
+            cJSON_AddStringToObject(parent, name->name, text);
+        }
+        else if (wire_field_int(&field, &value) == 0)
+        {
+            // Temperatures travel in tenths of degree
+            double number = field.tag == WIRE_TAG_TEMPERATURE ? (double)value / 10 : (double)value;
+            cJSON_AddNumberToObject(parent, name->name, number);
+        }
+    }
+    if (status == -1)
+    {
+        cJSON_Delete(json);
+        return NULL;
+    }
+    return json;
+}
@@ -4,8 +4,13 @@ int CONNECTED = 1;
 pid_t pid_child;
 pid_t pid_parent;
 int authenticated = 0;
+int binary_mode = 0;
 char* ip_address = NULL;
 
+// Bytes received from the server that don't form a complete line yet
+static char receive_buffer[RECEIVE_BUFFER_SIZE];
+static size_t receive_len = 0;
+
 int main(int argc, char* argv[])
 {
 
@@ -30,6 +35,18 @@ int main(int argc, char* argv[])
 
     int sockfd = establish_connection(port, is_ipv6);
 
+    // The first byte of the connection selects the binary encoding
+    if (binary_mode)
+    {
+        unsigned char magic = WIRE_MAGIC;
+        if (send(sockfd, &magic, 1, 0) == -1)
+        {
+            perror("send");
+            exit(EXIT_FAILURE);
+        }
+        printf("Speaking the binary protocol\n");
+    }
+
     // Authenticate the client with the server after establishing the connection
     if (!authenticated)
     {
@@ -67,7 +84,7 @@ void parse_command_line_args(int argc, char* argv[], int* port, int* ipv6, char*
     *ipv6 = 0; // Default to IPv4
 
     // Parse command-line arguments
-    while ((option = getopt(argc, argv, "p:a:t:")) != -1)
+    while ((option = getopt(argc, argv, "p:a:t:b")) != -1)
     {
         switch (option)
         {
@@ -109,8 +126,11 @@ void parse_command_line_args(int argc, char* argv[], int* port, int* ipv6, char*
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'b':
+            binary_mode = 1; // Binary messages instead of JSON
+            break;
         default:
-            fprintf(stderr, "Usage: %s [-p port] [-a ip_address] [-t 0|ipv6]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [-p port] [-a ip_address] [-t 0|ipv6] [-b]\n", argv[0]);
             exit(EXIT_FAILURE);
         }
     }
@@ -172,41 +192,47 @@ void disconnect(int sockfd)
     exit(EXIT_SUCCESS);
 }
 
-void send_json(int sockfd, cJSON* json)
+// Sends the request as a length-prefixed binary message, the JSON is only printed
+static void send_binary(int sockfd, cJSON* json)
 {
-    char* json_string = cJSON_Print(json);
-    send(sockfd, json_string, strlen(json_string), 0);
-    printf("JSON sent to server: %s\n", json_string);
+    uint8_t frame[FRAME_HEADER_SIZE + WIRE_MAX_MESSAGE];
+    size_t len = wire_encode_json_request(json, frame + FRAME_HEADER_SIZE, WIRE_MAX_MESSAGE);
+    if (len == 0)
+    {
+        fprintf(stderr, "Error: Unable to encode the request as a binary message\n");
+        return;
+    }
+    frame[0] = (uint8_t)(len >> 24);
+    frame[1] = (uint8_t)(len >> 16);
+    frame[2] = (uint8_t)(len >> 8);
+    frame[3] = (uint8_t)len;
+    send(sockfd, frame, FRAME_HEADER_SIZE + len, 0);
+    char* json_string = cJSON_PrintUnformatted(json);
+    printf("Binary message sent to server: %zu bytes for %s\n", len, json_string);
     free(json_string);
 }
 
-void receive_json(int sockfd)
+void send_json(int sockfd, cJSON* json)
 {
-    char buffer[BUFFER_SIZE];
-    memset(buffer, 0, BUFFER_SIZE); // Clear buffer
-
-    // Receive JSON data from server
-    ssize_t bytes_received = recv(sockfd, buffer, BUFFER_SIZE, 0);
-    if (bytes_received < 0)
-    {
-        perror("Error receiving JSON from server");
-        return;
-    }
-    else if (bytes_received == 0)
+    if (binary_mode)
     {
-        printf("\n Server closed the connection.. disconnecting\n");
-        disconnect(sockfd);
+        send_binary(sockfd, json);
         return;
     }
 
-    // Parse received JSON
-    cJSON* json = cJSON_Parse(buffer);
-    if (json == NULL)
-    {
-        printf("\nReceived message from server: %s\n", buffer);
-        return;
-    }
+    // Newline-delimited JSON: one compact object per line
+    char* json_string = cJSON_PrintUnformatted(json);
+    size_t json_len = strlen(json_string);
+    json_string[json_len] = '\n';
+    send(sockfd, json_string, json_len + 1, 0);
+    json_string[json_len] = '\0';
+    printf("JSON sent to server: %s\n", json_string);
+    free(json_string);
+}
 
+// Handles a message of the server, received as JSON or converted from its binary form
+static void handle_server_json(cJSON* json)
+{
     printf("\nReceived JSON from server:\n%s\n", cJSON_Print(json));
 
     // Handle the received JSON
@@ -239,6 +265,112 @@ void receive_json(int sockfd)
     cJSON_Delete(json);
 }
 
+// Reads one length-prefixed binary message
+static void receive_binary(int sockfd)
+{
+    uint8_t header[FRAME_HEADER_SIZE];
+    ssize_t bytes_received = recv(sockfd, header, FRAME_HEADER_SIZE, MSG_WAITALL);
+    if (bytes_received < 0)
+    {
+        perror("Error receiving message from server");
+        return;
+    }
+    size_t len = (size_t)header[0] << 24 | (size_t)header[1] << 16 | (size_t)header[2] << 8 | header[3];
+    uint8_t message[WIRE_MAX_MESSAGE];
+    if (bytes_received < FRAME_HEADER_SIZE || len > sizeof(message) ||
+        recv(sockfd, message, len, MSG_WAITALL) != (ssize_t)len)
+    {
+        printf("\n Server closed the connection.. disconnecting\n");
+        disconnect(sockfd);
+        return;
+    }
+
+    cJSON* json = wire_decode_to_json(message, len);
+    if (json == NULL)
+    {
+        printf("\nReceived malformed binary message from server (%zu bytes)\n", len);
+        return;
+    }
+    printf("\nReceived binary message from server: %zu bytes\n", len);
+    handle_server_json(json);
+}
+
+// Handles one line of the server: a JSON message, or an alert in text
+static void handle_server_line(const char* line)
+{
+    cJSON* json = cJSON_Parse(line);
+    if (json == NULL)
+    {
+        printf("\nReceived message from server: %s\n", line);
+        return;
+    }
+    handle_server_json(json);
+}
+
+void receive_json(int sockfd)
+{
+    if (binary_mode)
+    {
+        receive_binary(sockfd);
+        return;
+    }
+
+    // Receive JSON data from server, after what is left of the previous reads
+    ssize_t bytes_received = recv(sockfd, receive_buffer + receive_len, sizeof(receive_buffer) - receive_len - 1, 0);
+    if (bytes_received < 0)
+    {
+        perror("Error receiving JSON from server");
+        return;
+    }
+    else if (bytes_received == 0)
+    {
+        printf("\n Server closed the connection.. disconnecting\n");
+        disconnect(sockfd);
+        return;
+    }
+    receive_len += (size_t)bytes_received;
+
+    // Responses and alerts may arrive several per read or split across reads: handle every complete line
+    char* line = receive_buffer;
+    char* end;
+    while ((end = memchr(line, '\n', receive_len - (size_t)(line - receive_buffer))) != NULL)
+    {
+        *end = '\0';
+        handle_server_line(line);
+        line = end + 1;
+    }
+    receive_len -= (size_t)(line - receive_buffer);
+    memmove(receive_buffer, line, receive_len);
+
+    // A line that doesn't fit in the buffer is shown as it is
+    if (receive_len == sizeof(receive_buffer) - 1)
+    {
+        receive_buffer[receive_len] = '\0';
+        handle_server_line(receive_buffer);
+        receive_len = 0;
+    }
+}
+
+// Asks for the alert topics to receive and builds the subscription, NULL if the input cannot be read
+static cJSON* create_subscribe_json(void)
+{
+    char input[BUFFER_SIZE];
+    printf("Topics (north_entry, south_entry, west_entry, east_entry, power, temperature, all), comma separated: ");
+    if (fgets(input, BUFFER_SIZE, stdin) == NULL)
+    {
+        return NULL;
+    }
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "message", "subscribe");
+    cJSON* topics = cJSON_AddArrayToObject(json, "topics");
+    char* saveptr = NULL;
+    for (char* topic = strtok_r(input, ", \n", &saveptr); topic != NULL; topic = strtok_r(NULL, ", \n", &saveptr))
+    {
+        cJSON_AddItemToArray(topics, cJSON_CreateString(topic));
+    }
+    return json;
+}
+
 void handle_user_input(int sockfd)
 {
     char input[BUFFER_SIZE];
@@ -402,6 +534,15 @@ void handle_user_input(int sockfd)
             cJSON_Delete(json);
         }
         else if (strcmp(input, "4\n") == 0)
+        {
+            cJSON* json = create_subscribe_json();
+            if (json != NULL)
+            {
+                send_json(sockfd, json);
+                cJSON_Delete(json);
+            }
+        }
+        else if (strcmp(input, "5\n") == 0)
         {
             // Terminate the child process if it's running
             if (pid_child != 0)
@@ -471,6 +612,7 @@ void print_menu_options()
     printf("║  1. Request supplies status                            ║\n");
     printf("║  2. Update supplies status                             ║\n");
     printf("║  3. Summary                                            ║\n");
+    printf("║  4. Subscribe to alerts                                ║\n");
     printf("║  5. Exit                                               ║\n");
     printf("╚════════════════════════════════════════════════════════╝\n");
 
@@ -3,9 +3,13 @@
 static struct sockaddr_in server_addr;
 static struct sockaddr_in6 server_addrv6;
 
+// Token returned by the server on authentication, empty if it failed
+static char session_token[SESSION_TOKEN_SIZE];
+
 int CONNECTED = 1;
 pid_t pid_child;
 int ipv6;
+int binary_mode = 0;
 char* ip_address = NULL;
 
 int main(int argc, char* argv[])
@@ -21,6 +25,15 @@ int main(int argc, char* argv[])
 
     printf("Connecting to server at ip: %s\n", ip_address);
 
+    if (authenticate(sockfd, ipv6) == 0)
+    {
+        printf("Authenticated: updates are sent with the session token\n");
+    }
+    else
+    {
+        printf("Authentication failed: you can only check the status but can't update\n");
+    }
+
     pid_child = fork();
     if (pid_child == -1)
     {
@@ -48,7 +61,7 @@ void parse_command_line_args(int argc, char* argv[], int* port, int* ipv6, char*
     *port = -1; // Set default port value to -1
     *ipv6 = 0;  // Default to IPv4
 
-    while ((option = getopt(argc, argv, "p:a:t:")) != -1)
+    while ((option = getopt(argc, argv, "p:a:t:b")) != -1)
     {
         switch (option)
         {
@@ -89,8 +102,11 @@ void parse_command_line_args(int argc, char* argv[], int* port, int* ipv6, char*
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'b':
+            binary_mode = 1; // Binary messages instead of JSON
+            break;
         default:
-            fprintf(stderr, "Usage: %s [-p port] [-a ip_address] [-t 0|ipv6]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [-p port] [-a ip_address] [-t 0|ipv6] [-b]\n", argv[0]);
             exit(EXIT_FAILURE);
         }
     }
@@ -227,8 +243,33 @@ void disconnect(int sockfd)
     close(sockfd);
 }
 
+// Sends the request as one binary datagram, the JSON is only printed
+static void send_binary(int sockfd, cJSON* json, const struct sockaddr* server_addr, socklen_t addr_len)
+{
+    uint8_t message[WIRE_MAX_MESSAGE];
+    size_t len = wire_encode_json_request(json, message, sizeof(message));
+    if (len == 0)
+    {
+        fprintf(stderr, "Error: Unable to encode the request as a binary message\n");
+        return;
+    }
+    if (sendto(sockfd, message, len, 0, server_addr, addr_len) == -1)
+    {
+        perror("sendto");
+        return;
+    }
+    char* json_string = cJSON_PrintUnformatted(json);
+    printf("[+]Binary message sent: %zu bytes for %s\n", len, json_string);
+    free(json_string);
+}
+
 void sendJson_v4(int sockfd, cJSON* json, const struct sockaddr_in* server_addr)
 {
+    if (binary_mode)
+    {
+        send_binary(sockfd, json, (const struct sockaddr*)server_addr, sizeof(*server_addr));
+        return;
+    }
     char* json_string = cJSON_Print(json);
     if (json_string == NULL)
     {
@@ -241,6 +282,11 @@ void sendJson_v4(int sockfd, cJSON* json, const struct sockaddr_in* server_addr)
 
 void sendJson_v6(int sockfd, cJSON* json, const struct sockaddr_in6* server_addr)
 {
+    if (binary_mode)
+    {
+        send_binary(sockfd, json, (const struct sockaddr*)server_addr, sizeof(*server_addr));
+        return;
+    }
     char* json_string = cJSON_Print(json);
     if (json_string == NULL)
     {
@@ -287,6 +333,84 @@ void redirect_output_to_parent()
     }
 }
 
+int authenticate(int sockfd, int ipv6)
+{
+    char* utf8_os_id = encode_utf8(get_os_id());
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "hostname", utf8_os_id);
+    cJSON_AddStringToObject(json, "message", "authenticateme");
+    if (ipv6)
+    {
+        sendJson_v6(sockfd, json, &server_addrv6);
+    }
+    else
+    {
+        sendJson_v4(sockfd, json, &server_addr);
+    }
+    cJSON_Delete(json);
+    free(utf8_os_id);
+
+    // Only the answer is waited for here, the child process reads every later message
+    struct timeval timeout = {AUTH_TIMEOUT_SECONDS, 0};
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1)
+    {
+        perror("setsockopt");
+        return -1;
+    }
+    int authenticated = -1;
+    char buffer[BUFFER_SIZE];
+    ssize_t bytes_received;
+    while (authenticated == -1 && (bytes_received = recv(sockfd, buffer, BUFFER_SIZE - 1, 0)) > 0)
+    {
+        buffer[bytes_received] = '\0';
+        cJSON* response = (unsigned char)buffer[0] == WIRE_MAGIC ? wire_decode_to_json(buffer, (size_t)bytes_received)
+                                                                  : cJSON_Parse(buffer);
+        cJSON* message = cJSON_GetObjectItem(response, "message");
+        cJSON* token = cJSON_GetObjectItem(response, "token");
+        if (cJSON_IsString(message) && strcmp(message->valuestring, "auth_success") == 0 && cJSON_IsString(token) &&
+            strlen(token->valuestring) < SESSION_TOKEN_SIZE)
+        {
+            strcpy(session_token, token->valuestring);
+            authenticated = 0;
+        }
+        else if (cJSON_IsString(message) && strcmp(message->valuestring, "auth_failure") == 0)
+        {
+            cJSON_Delete(response);
+            break;
+        }
+        else
+        {
+            handle_received_message(buffer, (size_t)bytes_received); // e.g. an alert sent in the meantime
+        }
+        cJSON_Delete(response);
+    }
+
+    timeout.tv_sec = 0;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return authenticated;
+}
+
+// Asks for the alert topics to receive and builds the subscription of the host, NULL if the input cannot be read
+static cJSON* create_subscribe_json(const char* hostname)
+{
+    char input[BUFFER_SIZE];
+    printf("Topics (north_entry, south_entry, west_entry, east_entry, power, temperature, all), comma separated: ");
+    if (fgets(input, BUFFER_SIZE, stdin) == NULL)
+    {
+        return NULL;
+    }
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "hostname", hostname);
+    cJSON_AddStringToObject(json, "message", "subscribe");
+    cJSON* topics = cJSON_AddArrayToObject(json, "topics");
+    char* saveptr = NULL;
+    for (char* topic = strtok_r(input, ", \n", &saveptr); topic != NULL; topic = strtok_r(NULL, ", \n", &saveptr))
+    {
+        cJSON_AddItemToArray(topics, cJSON_CreateString(topic));
+    }
+    return json;
+}
+
 void handle_user_input(int sockfd, int ipv6)
 {
     char input[BUFFER_SIZE];
@@ -340,6 +464,10 @@ void handle_user_input(int sockfd, int ipv6)
             cJSON* json = cJSON_CreateObject();
             cJSON_AddStringToObject(json, "hostname", utf8_os_id);
             cJSON_AddStringToObject(json, "message", "update");
+            if (session_token[0] != '\0')
+            {
+                cJSON_AddStringToObject(json, "token", session_token);
+            }
 
             if (strcmp(input, "1\n") == 0)
             {
@@ -471,8 +599,23 @@ void handle_user_input(int sockfd, int ipv6)
             }
             cJSON_Delete(json);
         }
-
         else if (strcmp(input, "4\n") == 0)
+        {
+            cJSON* json = create_subscribe_json(utf8_os_id);
+            if (json != NULL)
+            {
+                if (ipv6)
+                {
+                    sendJson_v6(sockfd, json, &server_addrv6);
+                }
+                else
+                {
+                    sendJson_v4(sockfd, json, &server_addr);
+                }
+                cJSON_Delete(json);
+            }
+        }
+        else if (strcmp(input, "5\n") == 0)
         {
             // Terminate the child process if it's running
             if (pid_child != 0)
@@ -498,7 +641,7 @@ void receive_and_handle_json(int sockfd)
     if (bytes_received > 0)
     {
         buffer[bytes_received] = '\0'; // Add null terminator
-        handle_received_json(buffer);
+        handle_received_message(buffer, (size_t)bytes_received);
     }
     else if (bytes_received == 0)
     {
@@ -510,6 +653,25 @@ void receive_and_handle_json(int sockfd)
     }
 }
 
+void handle_received_message(const char* buffer, size_t len)
+{
+    if (len == 0 || (unsigned char)buffer[0] != WIRE_MAGIC)
+    {
+        handle_received_json(buffer);
+        return;
+    }
+    cJSON* json = wire_decode_to_json(buffer, len);
+    if (json == NULL)
+    {
+        printf("Received malformed binary message from server (%zu bytes)\n", len);
+        return;
+    }
+    char* formatted_json = cJSON_Print(json);
+    printf("Received binary message from server (%zu bytes): %s\n", len, formatted_json);
+    free(formatted_json);
+    cJSON_Delete(json);
+}
+
 void handle_received_json(const char* json_string)
 {
     cJSON* json = cJSON_Parse(json_string);
@@ -543,6 +705,7 @@ void print_menu_options()
     printf("║  1. Request supplies status                            ║\n");
     printf("║  2. Update supplies status                             ║\n");
     printf("║  3. Summary                                            ║\n");
+    printf("║  4. Subscribe to alerts                                ║\n");
     printf("║  5. Exit                                               ║\n");
     printf("╚════════════════════════════════════════════════════════╝\n");
 
@@ -0,0 +1,77 @@
+#include "alert_fifo.h"
+
+int alert_fifo_open(AlertFifo* fifo, const char* path)
+{
+    fifo->len = 0;
+    fifo->invalid = 0;
+    fifo->fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fifo->fd == -1)
+    {
+        perror("open alerts FIFO");
+        return -1;
+    }
+    return 0;
+}
+
+void alert_fifo_close(AlertFifo* fifo)
+{
+    if (fifo->fd != -1)
+    {
+        close(fifo->fd);
+        fifo->fd = -1;
+    }
+    fifo->len = 0;
+}
+
+// Handles the complete records of the buffer and keeps the partial one at its beginning
+static int split_records(AlertFifo* fifo, AlertHandler handler, void* arg)
+{
+    int alerts = 0;
+    size_t start = 0;
+    for (; fifo->len - start >= sizeof(AlertRecord); start += sizeof(AlertRecord))
+    {
+        // The buffer holds bytes, copy the record out to read it aligned
+        AlertRecord record;
+        memcpy(&record, fifo->buffer + start, sizeof(record));
+        if (!alert_record_valid(&record))
+        {
+            fifo->invalid++;
+            continue;
+        }
+        handler(&record, arg);
+        alerts++;
+    }
+
+    fifo->len -= start;
+    memmove(fifo->buffer, fifo->buffer + start, fifo->len);
+    return alerts;
+}
+
+int alert_fifo_read(AlertFifo* fifo, AlertHandler handler, void* arg)
+{
+    int alerts = 0;
+    for (int reads = 0; reads < ALERT_FIFO_MAX_READS; reads++)
+    {
+        ssize_t bytes_read = read(fifo->fd, fifo->buffer + fifo->len, sizeof(fifo->buffer) - fifo->len);
+        if (bytes_read == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            perror("Error reading from FIFO");
+            return -1;
+        }
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        fifo->len += (size_t)bytes_read;
+        alerts += split_records(fifo, handler, arg);
+    }
+    return alerts;
+}
@@ -0,0 +1,107 @@
+#include "alert_ring.h"
+
+int alert_ring_create(AlertRing* ring)
+{
+    ring->shared = mmap(NULL, sizeof(AlertRingShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring->shared == MAP_FAILED)
+    {
+        perror("mmap alert ring");
+        ring->shared = NULL;
+        return -1;
+    }
+    atomic_init(&ring->shared->head, 0);
+    atomic_init(&ring->shared->tail, 0);
+
+    ring->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (ring->event_fd == -1)
+    {
+        perror("eventfd alert ring");
+        munmap(ring->shared, sizeof(AlertRingShared));
+        ring->shared = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void alert_ring_destroy(AlertRing* ring)
+{
+    if (ring->shared != NULL)
+    {
+        munmap(ring->shared, sizeof(AlertRingShared));
+        ring->shared = NULL;
+    }
+    if (ring->event_fd != -1)
+    {
+        close(ring->event_fd);
+        ring->event_fd = -1;
+    }
+}
+
+int alert_ring_push(AlertRing* ring, const AlertRecord* record)
+{
+    AlertRingShared* shared = ring->shared;
+    uint_fast64_t head = atomic_load_explicit(&shared->head, memory_order_relaxed);
+    if (head - atomic_load(&shared->tail) == ALERT_RING_CAPACITY)
+    {
+        return -1;
+    }
+
+    shared->slots[head % ALERT_RING_CAPACITY] = *record;
+    atomic_store(&shared->head, head + 1);
+
+    // The consumer only sleeps on an empty ring: once it has caught up with this record, it needs a wakeup
+    if (atomic_load(&shared->tail) == head)
+    {
+        uint64_t wake = 1;
+        if (write(ring->event_fd, &wake, sizeof(wake)) == -1 && errno != EAGAIN)
+        {
+            perror("write alert ring eventfd");
+        }
+    }
+    return 0;
+}
+
+int alert_ring_drain(AlertRing* ring, AlertHandler handler, void* arg)
+{
+    // Reset the wakeup before looking at the ring, a push seen after this point signals again
+    uint64_t wakeups;
+    if (read(ring->event_fd, &wakeups, sizeof(wakeups)) == -1 && errno != EAGAIN)
+    {
+        perror("read alert ring eventfd");
+    }
+
+    AlertRingShared* shared = ring->shared;
+    uint_fast64_t tail = atomic_load_explicit(&shared->tail, memory_order_relaxed);
+    int alerts = 0;
+    while (tail != atomic_load(&shared->head))
+    {
+        AlertRecord record = shared->slots[tail % ALERT_RING_CAPACITY];
+        atomic_store(&shared->tail, ++tail);
+        if (alert_record_valid(&record))
+        {
+            handler(&record, arg);
+            alerts++;
+        }
+    }
+    return alerts;
+}
+
+int alert_transport_parse(const char* name, AlertTransport* transport)
+{
+    if (strcmp(name, "fifo") == 0)
+    {
+        *transport = ALERT_TRANSPORT_FIFO;
+        return 0;
+    }
+    if (strcmp(name, "ring") == 0)
+    {
+        *transport = ALERT_TRANSPORT_RING;
+        return 0;
+    }
+    return -1;
+}
+
+const char* alert_transport_name(AlertTransport transport)
+{
+    return transport == ALERT_TRANSPORT_RING ? "ring" : "fifo";
+}
@@ -0,0 +1,75 @@
+#include "alert_topics.h"
+
+static const char* const TOPIC_NAMES[ALERT_TOPIC_COUNT] = {
+    [ALERT_TOPIC_NORTH_ENTRY] = "north_entry", [ALERT_TOPIC_SOUTH_ENTRY] = "south_entry",
+    [ALERT_TOPIC_WEST_ENTRY] = "west_entry",   [ALERT_TOPIC_EAST_ENTRY] = "east_entry",
+    [ALERT_TOPIC_POWER] = "power",
+};
+
+static int name_is(const char* name, size_t len, const char* expected)
+{
+    return strlen(expected) == len && memcmp(name, expected, len) == 0;
+}
+
+uint32_t alert_topics_lookup(const char* name, size_t len)
+{
+    for (int topic = 0; topic < ALERT_TOPIC_COUNT; topic++)
+    {
+        if (name_is(name, len, TOPIC_NAMES[topic]))
+        {
+            return ALERT_TOPIC_BIT(topic);
+        }
+    }
+    if (name_is(name, len, "temperature"))
+    {
+        return ALERT_TOPICS_TEMPERATURE;
+    }
+    return name_is(name, len, "all") ? ALERT_TOPICS_ALL : 0;
+}
+
+const char* alert_topic_name(AlertTopic topic)
+{
+    return topic >= 0 && topic < ALERT_TOPIC_COUNT ? TOPIC_NAMES[topic] : "unknown";
+}
+
+long alert_topic_list_add(AlertTopicList* list, const void* member, size_t size)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity > 0 ? list->capacity * 2 : ALERT_TOPIC_LIST_MIN_CAPACITY;
+        void* members = realloc(list->members, size * capacity);
+        if (members == NULL)
+        {
+            perror("realloc topic subscribers");
+            return -1;
+        }
+        list->members = members;
+        list->capacity = capacity;
+    }
+    memcpy((char*)list->members + size * list->count, member, size);
+    return (long)list->count++;
+}
+
+int alert_topic_list_remove(AlertTopicList* list, size_t index, size_t size)
+{
+    list->count--;
+    if (index == list->count)
+    {
+        return 0;
+    }
+    memcpy((char*)list->members + size * index, (char*)list->members + size * list->count, size);
+    return 1;
+}
+
+void* alert_topic_list_at(const AlertTopicList* list, size_t index, size_t size)
+{
+    return (char*)list->members + size * index;
+}
+
+void alert_topic_list_clear(AlertTopicList* list)
+{
+    free(list->members);
+    list->members = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,159 @@
+#include "auth_token.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/random.h>
+
+#define TIME_DIGITS 8
+#define MAC_DIGITS 16
+#define MAX_PEER_LEN 64
+#define IPV4_MAPPED_PREFIX "::ffff:"
+
+static uint8_t auth_key[AUTH_KEY_SIZE];
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND                                                                                                       \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        v0 += v1;                                                                                                      \
+        v1 = ROTL(v1, 13);                                                                                             \
+        v1 ^= v0;                                                                                                      \
+        v0 = ROTL(v0, 32);                                                                                             \
+        v2 += v3;                                                                                                      \
+        v3 = ROTL(v3, 16);                                                                                             \
+        v3 ^= v2;                                                                                                      \
+        v0 += v3;                                                                                                      \
+        v3 = ROTL(v3, 21);                                                                                             \
+        v3 ^= v0;                                                                                                      \
+        v2 += v1;                                                                                                      \
+        v1 = ROTL(v1, 17);                                                                                             \
+        v1 ^= v2;                                                                                                      \
+        v2 = ROTL(v2, 32);                                                                                             \
+    } while (0)
+
+static uint64_t load_le64(const uint8_t* p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint64_t siphash24(const uint8_t key[AUTH_KEY_SIZE], const void* data, size_t len)
+{
+    const uint8_t* in = data;
+    uint64_t k0 = load_le64(key);
+    uint64_t k1 = load_le64(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+    const uint8_t* end = in + (len - len % 8);
+    for (; in != end; in += 8)
+    {
+        uint64_t m = load_le64(in);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    // Last block: the remaining bytes and the length in the top byte
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < len % 8; i++)
+    {
+        b |= (uint64_t)in[i] << (8 * i);
+    }
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// MAC of the issue time and the address, the address is cut at MAX_PEER_LEN bytes
+static uint64_t token_mac(uint32_t issued, const char* peer)
+{
+    // Dual-stack sockets report IPv4 clients as mapped IPv6 addresses, the token stays valid across both
+    if (strncmp(peer, IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX) - 1) == 0 &&
+        strchr(peer + sizeof(IPV4_MAPPED_PREFIX) - 1, '.') != NULL)
+    {
+        peer += sizeof(IPV4_MAPPED_PREFIX) - 1;
+    }
+    uint8_t message[4 + MAX_PEER_LEN];
+    size_t peer_len = strnlen(peer, MAX_PEER_LEN);
+    for (int i = 0; i < 4; i++)
+    {
+        message[i] = (uint8_t)(issued >> (8 * i));
+    }
+    memcpy(message + 4, peer, peer_len);
+    return siphash24(auth_key, message, 4 + peer_len);
+}
+
+static int parse_hex(const char* text, int digits, uint64_t* value)
+{
+    *value = 0;
+    for (int i = 0; i < digits; i++)
+    {
+        char c = text[i];
+        int digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = c - 'a' + 10;
+        }
+        else
+        {
+            return -1;
+        }
+        *value = (*value << 4) | (uint64_t)digit;
+    }
+    return 0;
+}
+
+int auth_token_init(void)
+{
+    if (getrandom(auth_key, sizeof(auth_key), 0) != (ssize_t)sizeof(auth_key))
+    {
+        perror("getrandom");
+        return -1;
+    }
+    return 0;
+}
+
+void auth_token_set_key(const uint8_t key[AUTH_KEY_SIZE])
+{
+    memcpy(auth_key, key, AUTH_KEY_SIZE);
+}
+
+void auth_token_issue(const char* peer, time_t now, char token[AUTH_TOKEN_LEN + 1])
+{
+    uint32_t issued = (uint32_t)now;
+    snprintf(token, AUTH_TOKEN_LEN + 1, "%08x%016llx", issued, (unsigned long long)token_mac(issued, peer));
+}
+
+int auth_token_verify(const char* token, size_t len, const char* peer, time_t now)
+{
+    uint64_t issued;
+    uint64_t mac;
+    if (len != AUTH_TOKEN_LEN || parse_hex(token, TIME_DIGITS, &issued) == -1 ||
+        parse_hex(token + TIME_DIGITS, MAC_DIGITS, &mac) == -1)
+    {
+        return 0;
+    }
+    // The age is computed on 32 bits like the issue time, so it stays right when the time wraps
+    uint32_t age = (uint32_t)now - (uint32_t)issued;
+    return age < AUTH_TOKEN_TTL_SECONDS && mac == token_mac((uint32_t)issued, peer);
+}
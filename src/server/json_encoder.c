@@ -0,0 +1,60 @@
+#include "json_encoder.h"
+#include <stdatomic.h>
+
+/*Output format shared by every thread, set once from the command line*/
+static atomic_int pretty_output;
+
+/*Reusable print buffer of the calling thread*/
+static _Thread_local char* encoder_buffer;
+static _Thread_local size_t encoder_capacity;
+
+void json_encoder_set_pretty(int pretty)
+{
+    atomic_store(&pretty_output, pretty != 0);
+}
+
+const char* json_encode(cJSON* json, size_t* len)
+{
+    int pretty = atomic_load_explicit(&pretty_output, memory_order_relaxed);
+    if (encoder_buffer == NULL)
+    {
+        encoder_buffer = malloc(JSON_ENCODER_INITIAL_SIZE);
+        if (encoder_buffer == NULL)
+        {
+            perror("malloc encoder buffer");
+            return NULL;
+        }
+        encoder_capacity = JSON_ENCODER_INITIAL_SIZE;
+    }
+
+    // cJSON reports a buffer that is too small by failing: grow it and print again
+    while (!cJSON_PrintPreallocated(json, encoder_buffer, (int)encoder_capacity, pretty))
+    {
+        if (encoder_capacity >= JSON_ENCODER_MAX_SIZE)
+        {
+            fprintf(stderr, "JSON message larger than %d bytes\n", JSON_ENCODER_MAX_SIZE);
+            return NULL;
+        }
+        char* bigger = realloc(encoder_buffer, encoder_capacity * 2);
+        if (bigger == NULL)
+        {
+            perror("realloc encoder buffer");
+            return NULL;
+        }
+        encoder_buffer = bigger;
+        encoder_capacity *= 2;
+    }
+
+    if (len != NULL)
+    {
+        *len = strlen(encoder_buffer);
+    }
+    return encoder_buffer;
+}
+
+void json_encoder_release(void)
+{
+    free(encoder_buffer);
+    encoder_buffer = NULL;
+    encoder_capacity = 0;
+}
@@ -34,7 +34,12 @@ int main(int argc, char* argv[])
         udp_port = get_available_port();
     }
 
-    srand((unsigned int)time(NULL));
+    // One seed drives every simulation, printed so that a run can be replayed with -g
+    if (server_config.random_seed < 0)
+    {
+        server_config.random_seed = (long long)time(NULL);
+    }
+    prng_set_seed((uint64_t)server_config.random_seed);
 
     printf(" _       __     __                             _____            ___       __          _     \n");
     printf("| |     / /__  / /________  ____ ___  ___     / ___/__  _______/   | ____/ /___ ___  (_)___ \n");
@@ -45,6 +50,7 @@ int main(int argc, char* argv[])
 
     printf("TCP port being used: %d\n", tcp_port);
     printf("UDP port being used: %d\n", udp_port);
+    printf("Random seed: %lld\n", server_config.random_seed);
     pid_t pid = getpid();
     // printf("Main process PID: %d\n", pid);
 
@@ -0,0 +1,288 @@
+#include "protocol.h"
+#include "server.h"
+
+// Logs an event of the request and, for the requests that change what the clients see, records it as the last event
+static void log_request(const ProtocolSession* session, const char* what, int record)
+{
+    char log_message[BUFFER_256];
+    snprintf(log_message, sizeof(log_message), "%s request from %s client %s", what,
+             protocol_transport_name(session->transport), session->peer);
+    if (record)
+    {
+        time_t rawtime;
+        struct tm timeinfo;
+        time(&rawtime);
+        localtime_r(&rawtime, &timeinfo);
+        char timestamp[20];
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        update_emergency_info(timestamp, log_message, &emergency_info);
+    }
+    log_event(log_message);
+}
+
+static void reply_cached(const ProtocolSession* session, ResponseCache* cache, uint64_t version)
+{
+    size_t len;
+    const char* response = response_cache_acquire(cache, version, &len);
+    if (response == NULL)
+    {
+        printf("Error encoding JSON for client\n");
+        return;
+    }
+    session->reply(response, len, session->reply_arg);
+    response_cache_release(cache);
+}
+
+// Binary responses cost less to build than to look up in a cache, they are built on the stack for every request
+static void reply_wire(const ProtocolSession* session, size_t (*encode)(uint8_t* buffer, size_t size))
+{
+    uint8_t message[WIRE_MAX_MESSAGE];
+    size_t len = encode(message, sizeof(message));
+    if (len == 0)
+    {
+        printf("Error encoding binary message for client\n");
+        return;
+    }
+    session->reply((const char*)message, len, session->reply_arg);
+}
+
+// Binary form of a response without its own, the JSON text in a WIRE_MSG_JSON message
+static void reply_json(const ProtocolSession* session, const char* json, size_t json_len)
+{
+    if (!session->binary)
+    {
+        session->reply(json, json_len, session->reply_arg);
+        return;
+    }
+    uint8_t message[WIRE_MAX_MESSAGE];
+    WireWriter writer;
+    wire_writer_init(&writer, message, sizeof(message), WIRE_MSG_JSON);
+    wire_put_bytes(&writer, WIRE_TAG_TEXT, json, json_len);
+    size_t len = wire_writer_finish(&writer);
+    if (len == 0)
+    {
+        printf("Error encoding binary message for client\n");
+        return;
+    }
+    session->reply((const char*)message, len, session->reply_arg);
+}
+
+static void reply_auth_failure(const ProtocolSession* session)
+{
+    if (!session->binary)
+    {
+        session->reply(PROTOCOL_AUTH_FAILURE, sizeof(PROTOCOL_AUTH_FAILURE) - 1, session->reply_arg);
+        return;
+    }
+    uint8_t message[WIRE_HEADER_SIZE];
+    WireWriter writer;
+    wire_writer_init(&writer, message, sizeof(message), WIRE_MSG_AUTH_FAILURE);
+    session->reply((const char*)message, wire_writer_finish(&writer), session->reply_arg);
+}
+
+static void reply_auth_success(const ProtocolSession* session, const char* token)
+{
+    if (!session->binary)
+    {
+        char response[sizeof(PROTOCOL_AUTH_SUCCESS_FORMAT) + AUTH_TOKEN_LEN];
+        int len = snprintf(response, sizeof(response), PROTOCOL_AUTH_SUCCESS_FORMAT, token);
+        session->reply(response, (size_t)len, session->reply_arg);
+        return;
+    }
+    uint8_t message[WIRE_HEADER_SIZE + 1 + WIRE_MAX_VARINT + AUTH_TOKEN_LEN];
+    WireWriter writer;
+    wire_writer_init(&writer, message, sizeof(message), WIRE_MSG_AUTH_SUCCESS);
+    wire_put_bytes(&writer, WIRE_TAG_TOKEN, token, AUTH_TOKEN_LEN);
+    session->reply((const char*)message, wire_writer_finish(&writer), session->reply_arg);
+}
+
+static ProtocolResult handle_authenticate(ProtocolSession* session, const Request* request)
+{
+    const char* transport = protocol_transport_name(session->transport);
+    if (request->hostname == NULL)
+    {
+        return PROTOCOL_DONE;
+    }
+    if (!request_hostname_is(request, ADMIN_USER))
+    {
+        char log_message[BUFFER_256];
+        snprintf(log_message, sizeof(log_message), "Authentication failed for %s client %s", transport,
+                 session->peer);
+        log_event(log_message);
+        printf("Client %s authentication failed: Invalid hostname.\n", transport);
+        reply_auth_failure(session);
+        return PROTOCOL_CLOSE;
+    }
+
+    session->authenticated = !session->stateless;
+    char log_message[BUFFER_256];
+    snprintf(log_message, sizeof(log_message), "Authenticated %s client %s", transport, session->peer);
+    log_event(log_message);
+    printf("Client %s authenticated successfully.\n", transport);
+
+    char token[AUTH_TOKEN_LEN + 1];
+    auth_token_issue(session->peer, time(NULL), token);
+    reply_auth_success(session, token);
+    return PROTOCOL_DONE;
+}
+
+// A flag for the authenticated connections, one MAC for the tokens, which connections then remember
+static int is_authorized(ProtocolSession* session, const Request* request)
+{
+    if (session->authenticated)
+    {
+        return 1;
+    }
+    if (request->token == NULL || !auth_token_verify(request->token, request->token_len, session->peer, time(NULL)))
+    {
+        return 0;
+    }
+    session->authenticated = !session->stateless;
+    return 1;
+}
+
+static void handle_update(ProtocolSession* session, const Request* request)
+{
+    const char* transport = protocol_transport_name(session->transport);
+    // Rejected before the deltas are applied or the request is logged as an update
+    if (!is_authorized(session, request))
+    {
+        printf("Not authenticated client tried to update data\n");
+        char log_message[BUFFER_256];
+        snprintf(log_message, sizeof(log_message), "Update request from not authenticated %s client %s", transport,
+                 session->peer);
+        log_event(log_message);
+        return;
+    }
+
+    printf("Received request from %s client: Update\n", transport);
+    // Deltas are applied atomically, concurrent updates from other clients are never lost
+    update_supplies(&request->food, &request->medicine);
+    log_request(session, "Update", 1);
+}
+
+static void log_invalid_request(const ProtocolSession* session)
+{
+    const char* transport = protocol_transport_name(session->transport);
+    char log_message[BUFFER_256];
+    snprintf(log_message, sizeof(log_message), "Invalid request received from %s client %s", transport, session->peer);
+    log_event(log_message);
+    printf("Invalid request received from %s client\n", transport);
+}
+
+static void handle_subscribe(const ProtocolSession* session, const Request* request)
+{
+    uint32_t topics = session->subscribe(request->topics, session->reply_arg);
+    printf("Received request from %s client: Subscribe\n", protocol_transport_name(session->transport));
+    log_request(session, "Subscribe", 0);
+
+    // The topics actually subscribed to, so that the client sees the names the server did not know
+    cJSON* response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "message", "subscribed");
+    cJSON* names = cJSON_AddArrayToObject(response, "topics");
+    for (int topic = 0; topic < ALERT_TOPIC_COUNT; topic++)
+    {
+        if (topics & ALERT_TOPIC_BIT(topic))
+        {
+            cJSON_AddItemToArray(names, cJSON_CreateString(alert_topic_name((AlertTopic)topic)));
+        }
+    }
+    size_t len;
+    const char* encoded = json_encode(response, &len);
+    if (encoded != NULL)
+    {
+        reply_json(session, encoded, len);
+    }
+    cJSON_Delete(response);
+}
+
+ProtocolResult protocol_handle(ProtocolSession* session, const Request* request)
+{
+    const char* transport = protocol_transport_name(session->transport);
+    if (request->type == REQUEST_NO_MESSAGE)
+    {
+        printf("No 'message' field found in request\n");
+        return PROTOCOL_REJECTED;
+    }
+    if (session->stateless && !request->has_hostname)
+    {
+        printf("No 'hostname' field found in request\n");
+        return PROTOCOL_REJECTED;
+    }
+
+    switch (request->type)
+    {
+    case REQUEST_AUTHENTICATE:
+        return handle_authenticate(session, request);
+    case REQUEST_STATUS:
+        log_request(session, "Status", 1);
+        printf("Received request from %s client: Status\n", transport);
+        if (session->binary)
+        {
+            reply_wire(session, encode_status_wire);
+        }
+        else
+        {
+            reply_cached(session, &status_cache, get_status_version());
+        }
+        break;
+    case REQUEST_UPDATE:
+        handle_update(session, request);
+        break;
+    case REQUEST_SUMMARY:
+        log_request(session, "Summary", 0);
+        printf("Received request from %s client: Summary\n", transport);
+        if (session->binary)
+        {
+            reply_wire(session, encode_summary_wire);
+        }
+        else
+        {
+            reply_cached(session, &summary_cache, get_summary_version());
+        }
+        break;
+    case REQUEST_STATS:
+    {
+        printf("Received request from %s client: Stats\n", transport);
+        cJSON* stats = create_stats_json();
+        size_t len;
+        const char* response = json_encode(stats, &len);
+        if (response != NULL)
+        {
+            reply_json(session, response, len);
+        }
+        cJSON_Delete(stats);
+        break;
+    }
+    case REQUEST_SUBSCRIBE:
+        // Transports without notifications have nothing to subscribe to
+        if (session->subscribe != NULL)
+        {
+            handle_subscribe(session, request);
+        }
+        else
+        {
+            log_invalid_request(session);
+        }
+        break;
+    default:
+        log_invalid_request(session);
+        break;
+    }
+    return PROTOCOL_DONE;
+}
+
+const char* protocol_transport_name(ProtocolTransport transport)
+{
+    switch (transport)
+    {
+    case PROTOCOL_TCP:
+        return "TCP";
+    case PROTOCOL_UDP:
+        return "UDP";
+    case PROTOCOL_UNIX:
+        return "Unix";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,703 @@
+#include "request_scanner.h"
+#include <strings.h>
+
+#define SCANNER_MAX_DEPTH 16
+
+// Known names, found by the length and first character switches below
+typedef enum
+{
+    NAME_OTHER,
+    NAME_MESSAGE,
+    NAME_HOSTNAME,
+    NAME_TOKEN,
+    NAME_FOOD,
+    NAME_MEDICINE,
+    NAME_MEAT,
+    NAME_VEGETABLES,
+    NAME_FRUITS,
+    NAME_WATER,
+    NAME_ANTIBIOTICS,
+    NAME_ANALGESICS,
+    NAME_BANDAGES,
+    NAME_TOPICS,
+    NAME_COUNT
+} FieldName;
+
+static const char* const FIELD_NAMES[NAME_COUNT] = {
+    [NAME_MESSAGE] = "message",         [NAME_HOSTNAME] = "hostname",     [NAME_TOKEN] = "token",
+    [NAME_FOOD] = "food",               [NAME_MEDICINE] = "medicine",     [NAME_MEAT] = "meat",
+    [NAME_VEGETABLES] = "vegetables",   [NAME_FRUITS] = "fruits",         [NAME_WATER] = "water",
+    [NAME_ANTIBIOTICS] = "antibiotics", [NAME_ANALGESICS] = "analgesics", [NAME_BANDAGES] = "bandages",
+    [NAME_TOPICS] = "topics",
+};
+
+static const char* const REQUEST_NAMES[] = {
+    [REQUEST_AUTHENTICATE] = "authenticateme", [REQUEST_STATUS] = "status", [REQUEST_UPDATE] = "update",
+    [REQUEST_SUMMARY] = "summary",             [REQUEST_STATS] = "stats",   [REQUEST_SUBSCRIBE] = "subscribe",
+};
+
+typedef struct
+{
+    const char* p;
+    const char* end;
+} Scanner;
+
+// Marks a name that cJSON would match, since its lookups ignore case, but the scanner does not
+#define NAME_FALLBACK (-1)
+
+static int match_name(const char* name, size_t len, FieldName candidate)
+{
+    const char* expected = FIELD_NAMES[candidate];
+    if (memcmp(name, expected, len) == 0)
+    {
+        return candidate;
+    }
+    return strncasecmp(name, expected, len) == 0 ? NAME_FALLBACK : NAME_OTHER;
+}
+
+// Names of the request object. hostname and medicine have the same length and different first characters
+static int top_level_name(const char* name, size_t len)
+{
+    switch (len)
+    {
+    case 4:
+        return match_name(name, len, NAME_FOOD);
+    case 5:
+        return match_name(name, len, NAME_TOKEN);
+    case 6:
+        return match_name(name, len, NAME_TOPICS);
+    case 7:
+        return match_name(name, len, NAME_MESSAGE);
+    case 8:
+        return match_name(name, len, (name[0] | 0x20) == 'h' ? NAME_HOSTNAME : NAME_MEDICINE);
+    default:
+        return NAME_OTHER;
+    }
+}
+
+static int food_name(const char* name, size_t len)
+{
+    switch (len)
+    {
+    case 4:
+        return match_name(name, len, NAME_MEAT);
+    case 5:
+        return match_name(name, len, NAME_WATER);
+    case 6:
+        return match_name(name, len, NAME_FRUITS);
+    case 10:
+        return match_name(name, len, NAME_VEGETABLES);
+    default:
+        return NAME_OTHER;
+    }
+}
+
+static int medicine_name(const char* name, size_t len)
+{
+    switch (len)
+    {
+    case 8:
+        return match_name(name, len, NAME_BANDAGES);
+    case 10:
+        return match_name(name, len, NAME_ANALGESICS);
+    case 11:
+        return match_name(name, len, NAME_ANTIBIOTICS);
+    default:
+        return NAME_OTHER;
+    }
+}
+
+RequestType request_type_lookup(const char* name, size_t len)
+{
+    RequestType candidate;
+    switch (len)
+    {
+    case 5:
+        candidate = REQUEST_STATS;
+        break;
+    case 6:
+        candidate = name[0] == 's' ? REQUEST_STATUS : REQUEST_UPDATE;
+        break;
+    case 7:
+        candidate = REQUEST_SUMMARY;
+        break;
+    case 9:
+        candidate = REQUEST_SUBSCRIBE;
+        break;
+    case 14:
+        candidate = REQUEST_AUTHENTICATE;
+        break;
+    default:
+        return REQUEST_UNKNOWN;
+    }
+    return memcmp(name, REQUEST_NAMES[candidate], len) == 0 ? candidate : REQUEST_UNKNOWN;
+}
+
+static void skip_whitespace(Scanner* s)
+{
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r'))
+    {
+        s->p++;
+    }
+}
+
+static int consume(Scanner* s, char c)
+{
+    skip_whitespace(s);
+    if (s->p < s->end && *s->p == c)
+    {
+        s->p++;
+        return 1;
+    }
+    return 0;
+}
+
+// A string without escapes, returned in place. Escaped strings are left to cJSON
+static int scan_string(Scanner* s, const char** str, size_t* len)
+{
+    if (!consume(s, '"'))
+    {
+        return -1;
+    }
+    const char* start = s->p;
+    while (s->p < s->end && *s->p != '"')
+    {
+        if (*s->p == '\\')
+        {
+            return -1;
+        }
+        s->p++;
+    }
+    if (s->p == s->end)
+    {
+        return -1;
+    }
+    *str = start;
+    *len = (size_t)(s->p - start);
+    s->p++;
+    return 0;
+}
+
+static int skip_value(Scanner* s, int depth);
+
+static int skip_digits(Scanner* s)
+{
+    const char* start = s->p;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+    {
+        s->p++;
+    }
+    return s->p > start ? 0 : -1;
+}
+
+// -?digits(.digits)?([eE][+-]?digits)?
+static int skip_number(Scanner* s)
+{
+    if (s->p < s->end && *s->p == '-')
+    {
+        s->p++;
+    }
+    if (skip_digits(s) == -1)
+    {
+        return -1;
+    }
+    if (s->p < s->end && *s->p == '.')
+    {
+        s->p++;
+        if (skip_digits(s) == -1)
+        {
+            return -1;
+        }
+    }
+    if (s->p < s->end && (*s->p == 'e' || *s->p == 'E'))
+    {
+        s->p++;
+        if (s->p < s->end && (*s->p == '+' || *s->p == '-'))
+        {
+            s->p++;
+        }
+        return skip_digits(s);
+    }
+    return 0;
+}
+
+static int skip_literal(Scanner* s, const char* literal)
+{
+    size_t len = strlen(literal);
+    if ((size_t)(s->end - s->p) < len || memcmp(s->p, literal, len) != 0)
+    {
+        return -1;
+    }
+    s->p += len;
+    return 0;
+}
+
+static int skip_container(Scanner* s, char close, int is_object, int depth)
+{
+    if (consume(s, close))
+    {
+        return 0;
+    }
+    do
+    {
+        if (is_object)
+        {
+            // Names of unknown objects may be escaped, they are never looked at
+            skip_whitespace(s);
+            if (s->p == s->end || *s->p != '"' || skip_value(s, depth) == -1 || !consume(s, ':'))
+            {
+                return -1;
+            }
+        }
+        if (skip_value(s, depth) == -1)
+        {
+            return -1;
+        }
+    } while (consume(s, ','));
+    return consume(s, close) ? 0 : -1;
+}
+
+static int skip_value(Scanner* s, int depth)
+{
+    if (depth >= SCANNER_MAX_DEPTH)
+    {
+        return -1;
+    }
+    skip_whitespace(s);
+    if (s->p == s->end)
+    {
+        return -1;
+    }
+    switch (*s->p)
+    {
+    case '"':
+        for (s->p++; s->p < s->end && *s->p != '"'; s->p++)
+        {
+            if (*s->p == '\\' && ++s->p == s->end)
+            {
+                return -1;
+            }
+        }
+        if (s->p == s->end)
+        {
+            return -1;
+        }
+        s->p++;
+        return 0;
+    case '{':
+        s->p++;
+        return skip_container(s, '}', 1, depth + 1);
+    case '[':
+        s->p++;
+        return skip_container(s, ']', 0, depth + 1);
+    case 't':
+        return skip_literal(s, "true");
+    case 'f':
+        return skip_literal(s, "false");
+    case 'n':
+        return skip_literal(s, "null");
+    default:
+        return skip_number(s);
+    }
+}
+
+// An amount: an integer in the range of int. cJSON truncates fractions and saturates, those are left to it
+static int scan_amount(Scanner* s, int* amount)
+{
+    skip_whitespace(s);
+    if (s->p == s->end || (*s->p != '-' && (*s->p < '0' || *s->p > '9')))
+    {
+        // Not a number, cJSON counts it as no delta
+        *amount = 0;
+        return skip_value(s, 1);
+    }
+
+    int negative = *s->p == '-';
+    if (negative)
+    {
+        s->p++;
+    }
+    long long value = 0;
+    const char* digits = s->p;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9')
+    {
+        value = value * 10 + (*s->p - '0');
+        if (value > (long long)INT_MAX + 1)
+        {
+            return -1;
+        }
+        s->p++;
+    }
+    if (s->p == digits || (s->p < s->end && (*s->p == '.' || *s->p == 'e' || *s->p == 'E')))
+    {
+        return -1;
+    }
+    value = negative ? -value : value;
+    if (value > INT_MAX)
+    {
+        return -1;
+    }
+    *amount = (int)value;
+    return 0;
+}
+
+// The food or medicine object, or any other value which cJSON ignores
+static int scan_supplies(Scanner* s, int (*lookup)(const char*, size_t), int* const* amounts)
+{
+    skip_whitespace(s);
+    if (s->p == s->end || *s->p != '{')
+    {
+        return skip_value(s, 1);
+    }
+    s->p++;
+    if (consume(s, '}'))
+    {
+        return 0;
+    }
+
+    unsigned int seen = 0;
+    do
+    {
+        const char* name;
+        size_t name_len;
+        if (scan_string(s, &name, &name_len) == -1 || !consume(s, ':'))
+        {
+            return -1;
+        }
+        int field = lookup(name, name_len);
+        if (field == NAME_FALLBACK || (field != NAME_OTHER && (seen & (1u << field))))
+        {
+            return -1;
+        }
+        if (field == NAME_OTHER)
+        {
+            if (skip_value(s, 1) == -1)
+            {
+                return -1;
+            }
+            continue;
+        }
+        seen |= 1u << field;
+        if (scan_amount(s, amounts[field]) == -1)
+        {
+            return -1;
+        }
+    } while (consume(s, ','));
+    return consume(s, '}') ? 0 : -1;
+}
+
+// The topics array, or any other value which cJSON ignores. Elements that are not strings are skipped
+static int scan_topics(Scanner* s, uint32_t* topics)
+{
+    skip_whitespace(s);
+    if (s->p == s->end || *s->p != '[')
+    {
+        return skip_value(s, 1);
+    }
+    s->p++;
+    *topics = 0;
+    if (consume(s, ']'))
+    {
+        return 0;
+    }
+    do
+    {
+        skip_whitespace(s);
+        if (s->p < s->end && *s->p == '"')
+        {
+            const char* name;
+            size_t name_len;
+            if (scan_string(s, &name, &name_len) == -1)
+            {
+                return -1;
+            }
+            *topics |= alert_topics_lookup(name, name_len);
+        }
+        else if (skip_value(s, 1) == -1)
+        {
+            return -1;
+        }
+    } while (consume(s, ','));
+    return consume(s, ']') ? 0 : -1;
+}
+
+int request_scan(const char* data, size_t len, Request* request)
+{
+    memset(request, 0, sizeof(Request));
+    request->type = REQUEST_NO_MESSAGE;
+    request->topics = ALERT_TOPICS_ALL;
+    Scanner s = {data, data + len};
+
+    int* amounts[NAME_COUNT] = {
+        [NAME_MEAT] = &request->food.meat,
+        [NAME_VEGETABLES] = &request->food.vegetables,
+        [NAME_FRUITS] = &request->food.fruits,
+        [NAME_WATER] = &request->food.water,
+        [NAME_ANTIBIOTICS] = &request->medicine.antibiotics,
+        [NAME_ANALGESICS] = &request->medicine.analgesics,
+        [NAME_BANDAGES] = &request->medicine.bandages,
+    };
+
+    if (!consume(&s, '{'))
+    {
+        return -1;
+    }
+    if (consume(&s, '}'))
+    {
+        return 0;
+    }
+
+    unsigned int seen = 0;
+    do
+    {
+        const char* name;
+        size_t name_len;
+        if (scan_string(&s, &name, &name_len) == -1 || !consume(&s, ':'))
+        {
+            return -1;
+        }
+        int field = top_level_name(name, name_len);
+        if (field == NAME_FALLBACK || (field != NAME_OTHER && (seen & (1u << field))))
+        {
+            return -1;
+        }
+        seen |= field != NAME_OTHER ? 1u << field : 0;
+
+        int scanned;
+        skip_whitespace(&s);
+        switch (field)
+        {
+        case NAME_MESSAGE:
+        case NAME_HOSTNAME:
+        case NAME_TOKEN:
+        {
+            if (s.p < s.end && *s.p == '"')
+            {
+                const char* value;
+                size_t value_len;
+                scanned = scan_string(&s, &value, &value_len);
+                if (field == NAME_MESSAGE)
+                {
+                    request->type = request_type_lookup(value, value_len);
+                }
+                else if (field == NAME_HOSTNAME)
+                {
+                    request->hostname = value;
+                    request->hostname_len = value_len;
+                }
+                else
+                {
+                    request->token = value;
+                    request->token_len = value_len;
+                }
+            }
+            else
+            {
+                scanned = skip_value(&s, 0);
+                request->type = field == NAME_MESSAGE ? REQUEST_INVALID : request->type;
+            }
+            request->has_hostname |= field == NAME_HOSTNAME;
+            break;
+        }
+        case NAME_FOOD:
+            scanned = scan_supplies(&s, food_name, amounts);
+            break;
+        case NAME_MEDICINE:
+            scanned = scan_supplies(&s, medicine_name, amounts);
+            break;
+        case NAME_TOPICS:
+            scanned = scan_topics(&s, &request->topics);
+            break;
+        default:
+            scanned = skip_value(&s, 0);
+            break;
+        }
+        if (scanned == -1)
+        {
+            return -1;
+        }
+    } while (consume(&s, ','));
+    return consume(&s, '}') ? 0 : -1;
+}
+
+// Same as the supplies module: a delta that is not a number counts as 0
+static int json_amount(cJSON* object, const char* name)
+{
+    cJSON* item = cJSON_GetObjectItem(object, name);
+    return cJSON_IsNumber(item) ? item->valueint : 0;
+}
+
+void request_from_json(cJSON* json, Request* request)
+{
+    memset(request, 0, sizeof(Request));
+
+    cJSON* message = cJSON_GetObjectItem(json, "message");
+    if (message == NULL)
+    {
+        request->type = REQUEST_NO_MESSAGE;
+    }
+    else if (!cJSON_IsString(message))
+    {
+        request->type = REQUEST_INVALID;
+    }
+    else
+    {
+        request->type = request_type_lookup(message->valuestring, strlen(message->valuestring));
+    }
+
+    cJSON* hostname = cJSON_GetObjectItem(json, "hostname");
+    request->has_hostname = hostname != NULL;
+    if (cJSON_IsString(hostname))
+    {
+        request->hostname = hostname->valuestring;
+        request->hostname_len = strlen(hostname->valuestring);
+    }
+    cJSON* token = cJSON_GetObjectItem(json, "token");
+    if (cJSON_IsString(token))
+    {
+        request->token = token->valuestring;
+        request->token_len = strlen(token->valuestring);
+    }
+
+    cJSON* food = cJSON_GetObjectItem(json, "food");
+    if (cJSON_IsObject(food))
+    {
+        request->food.meat = json_amount(food, "meat");
+        request->food.vegetables = json_amount(food, "vegetables");
+        request->food.fruits = json_amount(food, "fruits");
+        request->food.water = json_amount(food, "water");
+    }
+    cJSON* medicine = cJSON_GetObjectItem(json, "medicine");
+    if (cJSON_IsObject(medicine))
+    {
+        request->medicine.antibiotics = json_amount(medicine, "antibiotics");
+        request->medicine.analgesics = json_amount(medicine, "analgesics");
+        request->medicine.bandages = json_amount(medicine, "bandages");
+    }
+
+    request->topics = ALERT_TOPICS_ALL;
+    cJSON* topics = cJSON_GetObjectItem(json, "topics");
+    if (cJSON_IsArray(topics))
+    {
+        request->topics = 0;
+        cJSON* topic;
+        cJSON_ArrayForEach(topic, topics)
+        {
+            if (cJSON_IsString(topic))
+            {
+                request->topics |= alert_topics_lookup(topic->valuestring, strlen(topic->valuestring));
+            }
+        }
+    }
+}
+
+// Saturates like cJSON does for the valueint of out of range numbers
+static int wire_amount(int64_t value)
+{
+    return value > INT_MAX ? INT_MAX : value < INT_MIN ? INT_MIN : (int)value;
+}
+
+int request_from_wire(const char* data, size_t len, Request* request)
+{
+    memset(request, 0, sizeof(Request));
+    request->topics = ALERT_TOPICS_ALL;
+    WireReader reader;
+    int type;
+    if (wire_reader_init(&reader, data, len, &type) == -1)
+    {
+        return -1;
+    }
+    switch (type)
+    {
+    case WIRE_MSG_AUTHENTICATE:
+        request->type = REQUEST_AUTHENTICATE;
+        break;
+    case WIRE_MSG_STATUS:
+        request->type = REQUEST_STATUS;
+        break;
+    case WIRE_MSG_UPDATE:
+        request->type = REQUEST_UPDATE;
+        break;
+    case WIRE_MSG_SUMMARY:
+        request->type = REQUEST_SUMMARY;
+        break;
+    case WIRE_MSG_STATS:
+        request->type = REQUEST_STATS;
+        break;
+    case WIRE_MSG_SUBSCRIBE:
+        request->type = REQUEST_SUBSCRIBE;
+        break;
+    default:
+        request->type = REQUEST_UNKNOWN;
+        break;
+    }
+
+    WireField field;
+    int status;
+    int has_topics = 0;
+    while ((status = wire_next_field(&reader, &field)) == 1)
+    {
+        int64_t value = 0;
+        if (field.tag == WIRE_TAG_HOSTNAME)
+        {
+            request->has_hostname = 1;
+            request->hostname = (const char*)field.value;
+            request->hostname_len = field.len;
+            continue;
+        }
+        if (field.tag == WIRE_TAG_TOKEN)
+        {
+            request->token = (const char*)field.value;
+            request->token_len = field.len;
+            continue;
+        }
+        if (field.tag == WIRE_TAG_TOPIC)
+        {
+            request->topics = has_topics ? request->topics : 0;
+            request->topics |= alert_topics_lookup((const char*)field.value, field.len);
+            has_topics = 1;
+            continue;
+        }
+        // Supply deltas, anything else is a field of a newer client
+        if (field.tag < WIRE_TAG_MEAT || field.tag > WIRE_TAG_BANDAGES)
+        {
+            continue;
+        }
+        if (wire_field_int(&field, &value) == -1)
+        {
+            return -1;
+        }
+        int amount = wire_amount(value);
+        switch (field.tag)
+        {
+        case WIRE_TAG_MEAT:
+            request->food.meat = amount;
+            break;
+        case WIRE_TAG_VEGETABLES:
+            request->food.vegetables = amount;
+            break;
+        case WIRE_TAG_FRUITS:
+            request->food.fruits = amount;
+            break;
+        case WIRE_TAG_WATER:
+            request->food.water = amount;
+            break;
+        case WIRE_TAG_ANTIBIOTICS:
+            request->medicine.antibiotics = amount;
+            break;
+        case WIRE_TAG_ANALGESICS:
+            request->medicine.analgesics = amount;
+            break;
+        default:
+            request->medicine.bandages = amount;
+            break;
+        }
+    }
+    return status;
+}
+
+int request_hostname_is(const Request* request, const char* hostname)
+{
+    size_t len = strlen(hostname);
+    return request->hostname != NULL && request->hostname_len == len && memcmp(request->hostname, hostname, len) == 0;
+}
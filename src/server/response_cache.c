@@ -0,0 +1,91 @@
+#include "response_cache.h"
+
+// Builds and encodes the response, then installs it unless a newer one was installed meanwhile
+static int rebuild(ResponseCache* cache, uint64_t version)
+{
+    cJSON* json = cache->build();
+    if (json == NULL)
+    {
+        return -1;
+    }
+    size_t len;
+    const char* encoded = json_encode(json, &len);
+    if (encoded == NULL)
+    {
+        cJSON_Delete(json);
+        return -1;
+    }
+
+    int result = 0;
+    pthread_rwlock_wrlock(&cache->lock);
+    if (!cache->valid || cache->version < version)
+    {
+        if (len + 1 > cache->capacity)
+        {
+            char* data = realloc(cache->data, len + 1);
+            if (data == NULL)
+            {
+                perror("realloc response cache");
+                result = -1;
+            }
+            else
+            {
+                cache->data = data;
+                cache->capacity = len + 1;
+            }
+        }
+        if (result == 0)
+        {
+            memcpy(cache->data, encoded, len + 1);
+            cache->len = len;
+            cache->version = version;
+            cache->valid = 1;
+            atomic_fetch_add(&cache->rebuilds, 1);
+        }
+    }
+    pthread_rwlock_unlock(&cache->lock);
+    cJSON_Delete(json);
+    return result;
+}
+
+const char* response_cache_acquire(ResponseCache* cache, uint64_t version, size_t* len)
+{
+    int rebuilt = 0;
+    for (;;)
+    {
+        pthread_rwlock_rdlock(&cache->lock);
+        if (cache->valid && cache->version >= version)
+        {
+            if (!rebuilt)
+            {
+                atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+            }
+            *len = cache->len;
+            return cache->data;
+        }
+        pthread_rwlock_unlock(&cache->lock);
+
+        // The version is read before the state: a change during the build is caught by the next read
+        if (rebuild(cache, version) == -1)
+        {
+            return NULL;
+        }
+        rebuilt = 1;
+    }
+}
+
+void response_cache_release(ResponseCache* cache)
+{
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+void response_cache_clear(ResponseCache* cache)
+{
+    pthread_rwlock_wrlock(&cache->lock);
+    free(cache->data);
+    cache->data = NULL;
+    cache->len = 0;
+    cache->capacity = 0;
+    cache->valid = 0;
+    pthread_rwlock_unlock(&cache->lock);
+}
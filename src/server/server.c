@@ -14,27 +14,160 @@ int shmid = -1;
 int* alert_message;
 
 /*Global variables for stuctures*/
-TCPClientList tcp_clients;
-UDPClientList udp_clients;
+UDPClientRegistry udp_clients = UDP_REGISTRY_INITIALIZER(UDP_REGISTRY_DEFAULT_MAX_CLIENTS);
 EntryAlertsCount entry_alerts_count;
 EmergencyInfo emergency_info;
 
-void start_server(int tcp_port, int udp_port)
+/*Alerts FIFO, open while the server runs*/
+AlertFifo alert_fifo = {.fd = -1};
+
+/*Alerts ring, shared with the sensors process when selected*/
+AlertRing alert_ring = ALERT_RING_INITIALIZER;
+
+/*Locks protecting the state shared by the worker threads*/
+pthread_mutex_t tcp_clients_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t udp_clients_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t shelter_state_lock = PTHREAD_MUTEX_INITIALIZER; /* alerts count and emergency info */
+
+/*Bumped (under shelter_state_lock) whenever the alerts count or the emergency info change*/
+atomic_ullong shelter_state_version;
+
+/*Encoded status and summary responses, keyed by the version of the state they describe*/
+ResponseCache status_cache = RESPONSE_CACHE_INITIALIZER(create_status_json);
+ResponseCache summary_cache = RESPONSE_CACHE_INITIALIZER(create_summary_json);
+
+/*Runtime options*/
+ServerConfig server_config = {.event_backend = EVENT_BACKEND_EPOLL,
+                               .num_workers = 1,
+                               .slow_consumer_policy = SLOW_CONSUMER_DROP_OLDEST,
+                               .output_queue_limit = OUTPUT_QUEUE_DEFAULT_LIMIT,
+                               .log_flush_interval_ms = LOGGER_DEFAULT_FLUSH_MS,
+                               .log_fsync_policy = LOGGER_FSYNC_NONE,
+                               .pretty_json = 0,
+                               .udp_client_ttl = UDP_CLIENT_DEFAULT_TTL,
+                               .tcp_backlog = TCP_DEFAULT_BACKLOG,
+                               .alert_transport = ALERT_TRANSPORT_FIFO,
+                               .sensor_count = NUM_SENSORS,
+                               .sensor_period_ms = SENSOR_DEFAULT_PERIOD_MS,
+                               .alert_probability = ALERT_DEFAULT_PROBABILITY,
+                               .random_seed = -1};
+
+/*Asynchronous logger, written by a background thread while the server runs*/
+Logger event_logger;
+
+/*Workers serving the event loops, indexed by TCPConnection::owner*/
+ServerWorker* server_workers = NULL;
+int num_server_workers = 0;
+
+/*Eventfd used to wake up every worker on shutdown*/
+int shutdown_fd = -1;
+
+static void on_tcp_listener_ready(int fd, uint32_t events, void* data)
 {
-    log_event("Server started");
+    (void)events;
+    handle_new_tcp_connection(fd, (ServerWorker*)data);
+}
 
-    initialize_entry_alerts_count(&entry_alerts_count);
+static void on_tcp_client_ready(int fd, uint32_t events, void* data)
+{
+    ServerWorker* worker = (ServerWorker*)data;
+    if (events & EVENT_WRITE)
+    {
+        service_tcp_output(fd, worker);
+    }
+    // Draining the output may have closed the client
+    if ((events & EVENT_READ) && tcp_connection_get(fd) != NULL)
+    {
+        handle_tcp_socket_activity(fd, worker);
+    }
+}
 
-    struct sockaddr_in6 address_ipv6_tcp;
-    struct sockaddr_in6 address_ipv6_udp;
-    struct sockaddr_un address_unix;
+static void on_worker_wakeup(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    ServerWorker* worker = (ServerWorker*)data;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN)
+    {
+        perror("read wakeup eventfd");
+    }
+
+    pthread_mutex_lock(&worker->pending_lock);
+    int* pending_fds = worker->pending_fds;
+    size_t num_pending = worker->num_pending;
+    worker->pending_fds = NULL;
+    worker->num_pending = 0;
+    worker->pending_capacity = 0;
+    pthread_mutex_unlock(&worker->pending_lock);
+
+    for (size_t i = 0; i < num_pending; i++)
+    {
+        // The descriptor may have been closed, and even reused by another worker, since it was handed over
+        pthread_mutex_lock(&tcp_clients_lock);
+        TCPConnection* conn = tcp_connection_get(pending_fds[i]);
+        int owned = conn != NULL && atomic_load(&conn->owner) == worker->id;
+        pthread_mutex_unlock(&tcp_clients_lock);
+        if (owned)
+        {
+            service_tcp_output(pending_fds[i], worker);
+        }
+    }
+    free(pending_fds);
+}
 
-    struct sockaddr_storage client_addr;
-    socklen_t addrlen = sizeof(client_addr);
+static void close_tcp_client(int client_fd, ServerWorker* worker)
+{
+    event_loop_remove(worker->loop, client_fd);
+    remove_tcp_client(client_fd); // Release the state of the client
+    close(client_fd);
+}
 
-    memset(&address_ipv6_tcp, 0, sizeof(address_ipv6_tcp));
-    memset(&address_ipv6_udp, 0, sizeof(address_ipv6_udp));
-    memset(&address_unix, 0, sizeof(address_unix));
+static void on_udp_socket_ready(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    handle_udp_socket_activity(fd, ((ServerWorker*)data)->udp_batch);
+}
+
+static void on_unix_socket_ready(int fd, uint32_t events, void* data)
+{
+    (void)events;
+    (void)data;
+    handle_unix_socket_activity(fd, "Unix", 1);
+}
+
+static void on_fifo_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+    check_alerts();
+}
+
+static void on_alert_ring_ready(int fd, uint32_t events, void* data)
+{
+    (void)fd;
+    (void)events;
+    (void)data;
+    check_alert_ring();
+}
+
+static void on_shutdown_ready(int fd, uint32_t events, void* data)
+{
+    // Nothing to read: the eventfd stays readable so that every worker observes it
+    (void)fd;
+    (void)events;
+    (void)data;
+}
+
+void start_server(int tcp_port, int udp_port)
+{
+    if (start_event_logger() == -1)
+    {
+        printf("Logging synchronously.\n");
+    }
+    log_event("Server started");
+
+    initialize_entry_alerts_count(&entry_alerts_count);
 
     const char* UNIX_SOCK_PATH = SOCK_PATH;
 
@@ -47,148 +180,370 @@ void start_server(int tcp_port, int udp_port)
     share_ports_shared_memory(tcp_port, udp_port);
     printf("Ports written in shared memory....\n");
 
-    // Set up the TCP and UDP server sockets
-    int tcp_socket_fd = set_tcp_socket(address_ipv6_tcp, tcp_port, MAX_CONNECTIONS);
-    int udp_socket_fd = set_udp_socket(address_ipv6_udp, udp_port);
-    int unix_socket_fd = set_unix_socket(UNIX_SOCK_PATH, 1, 1); // 1 for connection-oriented unix socket
+    // Woken once on shutdown so that every worker leaves its event loop
+    shutdown_fd = eventfd(0, EFD_CLOEXEC);
+    if (shutdown_fd == -1)
+    {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
 
-    sleep(1); // wait to make sure that child process created the fifo
+    tcp_connection_set_output_policy(server_config.slow_consumer_policy, server_config.output_queue_limit);
+    json_encoder_set_pretty(server_config.pretty_json);
 
-    int fifo_fd = open(FIFO_PATH, O_RDWR); // O_RDWR O_RDONLY
-    if (fifo_fd < 0)
+    // A new key on every start: the session tokens of a previous run are not accepted
+    if (auth_token_init() == -1)
     {
-        perror("open");
         exit(EXIT_FAILURE);
     }
 
-    // init shared memory with the supplies data module
-    init_shared_memory_supplies();
+    // Each worker binds its own SO_REUSEPORT TCP and UDP sockets, the kernel balances clients between them
+    int num_workers = server_config.num_workers;
+    ServerWorker* workers = calloc((size_t)num_workers, sizeof(ServerWorker));
+    if (workers == NULL)
+    {
+        perror("calloc workers");
+        exit(EXIT_FAILURE);
+    }
+    server_workers = workers;
+    num_server_workers = num_workers;
+    for (int i = 0; i < num_workers; i++)
+    {
+        init_server_worker(&workers[i], i, tcp_port, udp_port);
+    }
 
-    // File descriptor set for select
-    fd_set master_fds;
-    fd_set read_fds;
-    int max_fd = tcp_socket_fd > udp_socket_fd ? tcp_socket_fd : udp_socket_fd;
-    max_fd = max_fd > fifo_fd ? max_fd : fifo_fd;
-    max_fd = max_fd > unix_socket_fd ? max_fd : unix_socket_fd;
+    int unix_socket_fd = set_unix_socket(UNIX_SOCK_PATH, 1, 1); // 1 for connection-oriented unix socket
+
+    // The ring was created before forking the sensors process, only the FIFO has to be opened
+    int alerts_fd = alert_ring.event_fd;
+    if (server_config.alert_transport == ALERT_TRANSPORT_FIFO)
+    {
+        sleep(1); // wait to make sure that child process created the fifo
+
+        if (alert_fifo_open(&alert_fifo, FIFO_PATH) == -1)
+        {
+            exit(EXIT_FAILURE);
+        }
+        alerts_fd = alert_fifo.fd;
+    }
+
+    // init shared memory with the supplies data module, attached once for every request of every worker
+    init_shared_memory_supplies();
 
-    FD_ZERO(&master_fds);
-    FD_SET(tcp_socket_fd, &master_fds);
-    FD_SET(udp_socket_fd, &master_fds);
-    FD_SET(unix_socket_fd, &master_fds);
-    FD_SET(fifo_fd, &master_fds);
+    // The alerts and the emergency Unix socket are served by the first worker only
+    if (event_loop_add(workers[0].loop, unix_socket_fd, EVENT_READ, on_unix_socket_ready, NULL) == -1 ||
+        event_loop_add(workers[0].loop, alerts_fd, EVENT_READ,
+                       server_config.alert_transport == ALERT_TRANSPORT_RING ? on_alert_ring_ready : on_fifo_ready,
+                       NULL) == -1)
+    {
+        perror("event_loop_add");
+        exit(EXIT_FAILURE);
+    }
 
-    printf("\U0001F4CB Logs available at: %s%s%s\n", get_home_dir(), LOG_DIR, LOG_FILENAME);
+    printf("Event loop backend: %s, workers: %d, slow consumer policy: %s (%zu bytes per client), alerts: %s\n",
+           event_loop_backend_name(server_config.event_backend), num_workers,
+           tcp_connection_policy_name(server_config.slow_consumer_policy), server_config.output_queue_limit,
+           alert_transport_name(server_config.alert_transport));
+    printf("\U0001F4CB Logs available at: %s%s%s (flushed every %d ms, fsync: %s)\n", get_home_dir(), LOG_DIR,
+           LOG_FILENAME, server_config.log_flush_interval_ms, logger_fsync_policy_name(server_config.log_fsync_policy));
     printf("################################################\n");
     printf("############## Events - Messages ###############\n");
     printf("################################################\n");
 
-    while (SERVER_RUNNING)
+    // SIGINT must be delivered to the main thread, which runs the first worker
+    sigset_t sigint_set;
+    sigset_t previous_set;
+    sigemptyset(&sigint_set);
+    sigaddset(&sigint_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint_set, &previous_set);
+    for (int i = 1; i < num_workers; i++)
     {
-        read_fds = master_fds;
-
-        // Esperar por eventos de lectura en los sockets TCP y UDP
-        if (select(max_fd + 1, &read_fds, NULL, NULL, NULL) == -1)
+        if (pthread_create(&workers[i].thread, NULL, run_server_worker, &workers[i]) != 0)
         {
-            perror("select");
+            perror("pthread_create");
             exit(EXIT_FAILURE);
         }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous_set, NULL);
+
+    run_server_worker(&workers[0]);
+
+    uint64_t wake = 1;
+    if (write(shutdown_fd, &wake, sizeof(wake)) != sizeof(wake))
+    {
+        perror("write shutdown eventfd");
+    }
+    for (int i = 1; i < num_workers; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+    for (int i = 0; i < num_workers; i++)
+    {
+        event_loop_destroy(workers[i].loop);
+        close(workers[i].tcp_socket_fd);
+        close(workers[i].udp_socket_fd);
+        close(workers[i].wakeup_fd);
+        pthread_mutex_destroy(&workers[i].pending_lock);
+        free(workers[i].pending_fds);
+    }
+    server_workers = NULL;
+    num_server_workers = 0;
+    free(workers);
+    close(shutdown_fd);
+    alert_fifo_close(&alert_fifo);
+    alert_ring_destroy(&alert_ring);
+    supplies_detach(supplies_default_handle());
+    log_event("Server turned off");
+    stop_event_logger();
+}
 
-        // Handle activity on the TCP and UDP sockets
-        for (int fd = tcp_socket_fd; fd <= max_fd; fd++)
+void init_server_worker(ServerWorker* worker, int id, int tcp_port, int udp_port)
+{
+    struct sockaddr_in6 address_ipv6_tcp;
+    struct sockaddr_in6 address_ipv6_udp;
+    memset(&address_ipv6_tcp, 0, sizeof(address_ipv6_tcp));
+    memset(&address_ipv6_udp, 0, sizeof(address_ipv6_udp));
+
+    worker->id = id;
+    worker->tcp_socket_fd = set_tcp_socket(address_ipv6_tcp, tcp_port, server_config.tcp_backlog);
+    // The listen queue is drained until accept4() would block
+    int flags = fcntl(worker->tcp_socket_fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(worker->tcp_socket_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        perror("fcntl O_NONBLOCK");
+        exit(EXIT_FAILURE);
+    }
+    worker->udp_socket_fd = set_udp_socket(address_ipv6_udp, udp_port);
+    worker->loop = event_loop_create(server_config.event_backend);
+    if (worker->loop == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+    worker->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker->wakeup_fd == -1)
+    {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&worker->pending_lock, NULL);
+    // Without a batch the worker still serves UDP, one datagram per wakeup
+    worker->udp_batch = udp_batch_create();
+
+    if (event_loop_add(worker->loop, worker->tcp_socket_fd, EVENT_READ, on_tcp_listener_ready, worker) == -1 ||
+        event_loop_add(worker->loop, worker->udp_socket_fd, EVENT_READ, on_udp_socket_ready, worker) == -1 ||
+        event_loop_add(worker->loop, worker->wakeup_fd, EVENT_READ, on_worker_wakeup, worker) == -1 ||
+        event_loop_add(worker->loop, shutdown_fd, EVENT_READ, on_shutdown_ready, NULL) == -1)
+    {
+        perror("event_loop_add");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void* run_server_worker(void* arg)
+{
+    ServerWorker* worker = (ServerWorker*)arg;
+
+    // Only the descriptors that are ready are dispatched to their handlers
+    while (SERVER_RUNNING)
+    {
+        if (event_loop_run_once(worker->loop, -1) == -1)
         {
-            if (FD_ISSET(fd, &read_fds))
-            {
-                if (fd == tcp_socket_fd)
-                {
-                    int new_tcp_client_fd =
-                        accept_tcp_connection(tcp_socket_fd, (struct sockaddr*)&client_addr, addrlen);
-                    if (new_tcp_client_fd != -1)
-                    {
-                        FD_SET(new_tcp_client_fd, &master_fds);
-                        if (new_tcp_client_fd > max_fd)
-                        {
-                            max_fd = new_tcp_client_fd;
-                        }
-                    }
-                }
-                else if (fd == udp_socket_fd)
-                {
-                    handle_udp_socket_activity(udp_socket_fd);
-                }
-                else if (fd == unix_socket_fd)
-                {
-                    handle_unix_socket_activity(unix_socket_fd, "Unix", 1);
-                }
-                else if (fd == fifo_fd)
-                {
-                    check_alerts();
-                }
-                else
-                {
-                    // printf("Connected TCP client activity\n");
-                    handle_tcp_socket_activity(fd, &master_fds);
-                }
-            }
+            exit(EXIT_FAILURE);
         }
     }
-    log_event("Server turned off");
+    json_encoder_release();
+    udp_batch_destroy(worker->udp_batch);
+    worker->udp_batch = NULL;
+    return NULL;
 }
 
-void handle_tcp_socket_activity(int client_fd, fd_set* master_fds)
+void handle_tcp_socket_activity(int client_fd, ServerWorker* worker)
 {
-    // Obtener la dirección IP del cliente
-    struct sockaddr_storage client_addr;
-    socklen_t addrlen = sizeof(client_addr);
-    if (getpeername(client_fd, (struct sockaddr*)&client_addr, &addrlen) == 0)
+    if (!check_tcp_clients_messages(client_fd))
+    {
+        char fallback[INET6_ADDRSTRLEN];
+        const char* client_ip = get_tcp_client_peer(client_fd, fallback);
+        // Print white circle
+        printf("\033[37m\u25CF ");
+        printf("\033[0m");
+        printf("Error or disconnection occurred with TCP client at IP: %s\n", client_ip);
+        char log_message[BUFFER_256]; // Allocate space for the log message
+        snprintf(log_message, sizeof(log_message), "TCP client disconnected from IP: %s", client_ip);
+        log_event(log_message);
+        close_tcp_client(client_fd, worker);
+    }
+    else
+    {
+        service_tcp_output(client_fd, worker);
+    }
+}
+
+void service_tcp_output(int client_fd, ServerWorker* worker)
+{
+    TCPConnection* conn = tcp_connection_get(client_fd);
+    if (conn == NULL)
+    {
+        return;
+    }
+    if (atomic_load(&conn->overflowed))
     {
-        char client_ip[INET6_ADDRSTRLEN]; // Use INET6_ADDRSTRLEN to accommodate IPv6 addresses
-        if (client_addr.ss_family == AF_INET)
+        printf("Disconnecting slow TCP client (fd %d): output queue full\n", client_fd);
+        log_event("TCP client disconnected: output queue full");
+        close_tcp_client(client_fd, worker);
+        return;
+    }
+    if (tcp_connection_flush(conn) == -1)
+    {
+        perror("Error sending to TCP client");
+        close_tcp_client(client_fd, worker);
+        return;
+    }
+
+    // Watch for writability only while output is pending, or the loop would spin on an idle socket
+    int write_interest = tcp_connection_has_output(conn);
+    if (write_interest != conn->write_interest &&
+        event_loop_modify(worker->loop, client_fd, write_interest ? EVENT_READ | EVENT_WRITE : EVENT_READ) == 0)
+    {
+        conn->write_interest = write_interest;
+    }
+}
+
+void notify_tcp_owner(TCPConnection* conn)
+{
+    int owner = atomic_load(&conn->owner);
+    if (owner < 0 || owner >= num_server_workers)
+    {
+        return;
+    }
+
+    ServerWorker* worker = &server_workers[owner];
+    pthread_mutex_lock(&worker->pending_lock);
+    if (worker->num_pending == worker->pending_capacity)
+    {
+        size_t new_capacity = worker->pending_capacity > 0 ? worker->pending_capacity * 2 : MAX_CLIENTS;
+        int* pending_fds = realloc(worker->pending_fds, sizeof(int) * new_capacity);
+        if (pending_fds == NULL)
         {
-            struct sockaddr_in* addr_ipv4 = (struct sockaddr_in*)&client_addr;
-            inet_ntop(AF_INET, &(addr_ipv4->sin_addr), client_ip, INET6_ADDRSTRLEN);
+            pthread_mutex_unlock(&worker->pending_lock);
+            perror("realloc pending clients");
+            return;
         }
-        else if (client_addr.ss_family == AF_INET6)
+        worker->pending_fds = pending_fds;
+        worker->pending_capacity = new_capacity;
+    }
+    worker->pending_fds[worker->num_pending++] = conn->fd;
+    pthread_mutex_unlock(&worker->pending_lock);
+
+    uint64_t wake = 1;
+    if (write(worker->wakeup_fd, &wake, sizeof(wake)) == -1 && errno != EAGAIN)
+    {
+        perror("write wakeup eventfd");
+    }
+}
+
+static void print_udp_message(const char* buffer, struct sockaddr_storage* client_addr)
+{
+    // Get client information
+    char client_ip[INET6_ADDRSTRLEN];
+    int client_port;
+    get_udp_client_info(client_addr, client_ip, sizeof(client_ip), &client_port);
+
+    // Print the received message and client information
+    printf("Received UDP message from %s:%d: %s\n", client_ip, client_port, buffer);
+}
+
+// A datagram is binary when it starts with WIRE_MAGIC, JSON otherwise. The buffer is NUL-terminated
+static int handle_udp_datagram(int sockfd, const char* buffer, size_t len, struct sockaddr_storage* client_addr,
+                               socklen_t client_addrlen, UDPBatch* replies)
+{
+    Request request;
+    if (len > 0 && (unsigned char)buffer[0] == WIRE_MAGIC)
+    {
+        if (request_from_wire(buffer, len, &request) == -1)
         {
-            struct sockaddr_in6* addr_ipv6 = (struct sockaddr_in6*)&client_addr;
-            inet_ntop(AF_INET6, &(addr_ipv6->sin6_addr), client_ip, INET6_ADDRSTRLEN);
+            fprintf(stderr, "Malformed binary message of %zu bytes\n", len);
+            return 0;
         }
-        else
+        char client_ip[INET6_ADDRSTRLEN];
+        int client_port;
+        get_udp_client_info(client_addr, client_ip, sizeof(client_ip), &client_port);
+        printf("Received binary UDP message from %s:%d: %zu bytes\n", client_ip, client_port, len);
+        return dispatch_udp_request(sockfd, &request, client_addr, client_addrlen, replies, 1);
+    }
+    if (request_scan(buffer, len, &request) == 0)
+    {
+        print_udp_message(buffer, client_addr);
+        return dispatch_udp_request(sockfd, &request, client_addr, client_addrlen, replies, 0);
+    }
+    cJSON* received_json = parse_udp_json(buffer, client_addr);
+    return received_json != NULL && handle_udp_json(sockfd, received_json, client_addr, client_addrlen, replies);
+}
+
+void handle_udp_socket_activity(int sockfd, UDPBatch* batch)
+{
+    if (batch == NULL)
+    {
+        // Manejar actividad en el socket UDP
+        if (!check_udp_clients_messages(sockfd))
         {
-            strcpy(client_ip, "Unknown");
+            // Error o desconexión del cliente UDP
+            printf("Error or disconnection occurred with UDP client.\n");
         }
-        if (!check_tcp_clients_messages(client_fd))
+        return;
+    }
+
+    // Every datagram already waiting, up to UDP_BATCH_SIZE: the loop wakes up again if more are left
+    int received = udp_batch_receive(batch, sockfd);
+    for (int i = 0; i < received; i++)
+    {
+        if (!handle_udp_datagram(sockfd, batch->buffers[i], batch->messages[i].msg_len, &batch->addresses[i],
+                                 batch->messages[i].msg_hdr.msg_namelen, batch))
         {
-            // Print white circle
-            printf("\033[37m\u25CF ");
-            printf("\033[0m");
-            printf("Error or disconnection occurred with TCP client at IP: %s\n", client_ip);
-            char log_message[BUFFER_256]; // Allocate space for the log message
-            snprintf(log_message, sizeof(log_message), "TCP client disconnected from IP: %s", client_ip);
-            log_event(log_message);
-            close(client_fd);
-            FD_CLR(client_fd, master_fds);
-            remove_tcp_client(client_fd, &tcp_clients);
+            printf("Error or disconnection occurred with UDP client.\n");
         }
     }
-    else
+    if (batch->num_replies > 0)
     {
-        perror("getpeername");
-        close(client_fd);
-        FD_CLR(client_fd, master_fds);
-        remove_tcp_client(client_fd, &tcp_clients); // Remove the client from the list of connected clients
+        int sent = udp_batch_flush(batch, sockfd);
+        printf("Sent %d UDP responses for %d messages\n", sent, received);
     }
 }
 
-void handle_udp_socket_activity(int sockfd)
+static void reply_to_unix_client(const char* response, size_t len, void* arg)
 {
-    // Manejar actividad en el socket UDP
-    if (!check_udp_clients_messages(sockfd))
+    if (send(*(int*)arg, response, len, MSG_NOSIGNAL) == -1)
     {
-        // Error o desconexión del cliente UDP
-        printf("Error or disconnection occurred with UDP client.\n");
+        perror("send");
     }
 }
 
+// Requests from local clients are served like the network ones, any other message is an emergency notification
+static int handle_unix_request(int client_fd, const char* buffer, size_t len)
+{
+    Request request;
+    cJSON* received_json = NULL;
+    if (request_scan(buffer, len, &request) == -1)
+    {
+        received_json = cJSON_ParseWithLength(buffer, len);
+        if (!cJSON_IsObject(received_json))
+        {
+            cJSON_Delete(received_json);
+            return 0;
+        }
+        request_from_json(received_json, &request);
+    }
+    if (request.type == REQUEST_NO_MESSAGE)
+    {
+        cJSON_Delete(received_json);
+        return 0;
+    }
+
+    ProtocolSession session = {PROTOCOL_UNIX, SOCK_PATH, 0, 0, reply_to_unix_client, &client_fd, 0, NULL};
+    protocol_handle(&session, &request);
+    cJSON_Delete(received_json);
+    return 1;
+}
+
 void handle_unix_socket_activity(int sockfd, const char* client_type, int connection_oriented)
 {
     if (connection_oriented)
@@ -203,11 +558,26 @@ void handle_unix_socket_activity(int sockfd, const char* client_type, int connec
             {
                 buffer[bytes_received] = '\0'; // Add null terminator
                 printf("Message received from %s client: %s\n", client_type, buffer);
+                if (handle_unix_request(client_fd, buffer, (size_t)bytes_received))
+                {
+                    close(client_fd);
+                    return;
+                }
 
                 cJSON* disconnect_json = cJSON_CreateObject();
                 cJSON_AddStringToObject(disconnect_json, "message", "disconnect");
-                char* disconnect = cJSON_Print(disconnect_json);
-                send_to_all_tcp_clients(disconnect);
+                BroadcastMessage disconnect;
+                disconnect.topic = ALERT_TOPIC_POWER;
+                disconnect.text = json_encode(disconnect_json, &disconnect.text_len);
+                uint8_t binary[WIRE_HEADER_SIZE];
+                WireWriter writer;
+                wire_writer_init(&writer, binary, sizeof(binary), WIRE_MSG_DISCONNECT);
+                disconnect.binary = binary;
+                disconnect.binary_len = wire_writer_finish(&writer);
+                if (disconnect.text != NULL)
+                {
+                    publish_to_tcp_clients(&disconnect);
+                }
                 log_event(buffer);
                 cJSON_Delete(disconnect_json);
             }
@@ -374,16 +744,20 @@ void redirect_output_to_parent()
 
 int accept_tcp_connection(int sockfd, struct sockaddr* addr, socklen_t addrlen)
 {
-    int client_fd = accept(sockfd, addr, &addrlen);
+    // Replies and alerts must never block the event loop on a slow client
+    int client_fd = accept4(sockfd, addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (client_fd == -1)
     {
-        printf("Error accepting connection\n");
-        perror("accept");
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            printf("Error accepting connection\n");
+            perror("accept4");
+        }
     }
     else
     {
-        char client_ip[INET6_ADDRSTRLEN]; // Use INET6_ADDRSTRLEN to accommodate IPv6 addresses
-        char log_message[BUFFER_256];     // Allocate space for the log message
+        char client_ip[INET6_ADDRSTRLEN] = "Unknown"; // Use INET6_ADDRSTRLEN to accommodate IPv6 addresses
+        char log_message[BUFFER_256] = "New TCP client connected";
         if (addr->sa_family == AF_INET6)
         {
             struct sockaddr_in6* client_addr_ipv6 = (struct sockaddr_in6*)addr;
@@ -416,7 +790,13 @@ int accept_tcp_connection(int sockfd, struct sockaddr* addr, socklen_t addrlen)
             snprintf(log_message, sizeof(log_message), "New IPv4 client connected from IP: %s", client_ip);
         }
         log_event(log_message);
-        add_tcp_client(client_fd, &tcp_clients); // add the client to the list of connected clients
+        // Reassembly buffer, framing and output state of the client
+        if (add_tcp_client(client_fd, client_ip) == -1)
+        {
+            close(client_fd);
+            errno = EMFILE; // Out of connection records, like running out of descriptors
+            return -1;
+        }
     }
     return client_fd;
 }
@@ -431,215 +811,282 @@ int accept_unix_connection(int sockfd, struct sockaddr* addr, socklen_t addrlen)
     return client_fd;
 }
 
-cJSON* receive_tcp_json(int sockfd)
+int send_tcp_message(int sockfd, const char* message, size_t message_len, int kind)
 {
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_received = recv(sockfd, buffer, BUFFER_SIZE, 0);
-    if (bytes_received > 0)
+    TCPConnection* conn = tcp_connection_get(sockfd);
+    if (conn == NULL)
     {
-        buffer[bytes_received] = '\0'; // add null terminator
+        // Descriptors without state (e.g. not accepted by this server) get a best-effort delimited write
+        struct iovec iov[2] = {{(void*)message, message_len}, {"\n", 1}};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        return sendmsg(sockfd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) == -1 ? -1 : 0;
+    }
 
-        cJSON* json = cJSON_Parse(buffer);
-        if (!json)
-        {
-            fprintf(stderr, "Error parsing JSON: %s\n", cJSON_GetErrorPtr());
-            return NULL;
-        }
+    if (tcp_connection_queue(conn, message, message_len, kind) == -1)
+    {
+        notify_tcp_owner(conn); // the policy may have marked the client to be disconnected
+        return -1;
+    }
+
+    // Write what the socket accepts now, the owner worker drains the rest when the socket becomes writable
+    if (tcp_connection_flush(conn) == -1 || tcp_connection_has_output(conn))
+    {
+        notify_tcp_owner(conn);
+    }
+    return 0;
+}
 
-        printf("JSON received from client: %s\n", buffer);
-        return json;
+void send_json_to_tcp_client(int sockfd, cJSON* json)
+{
+    size_t json_len;
+    const char* json_string = json_encode(json, &json_len);
+    if (json_string == NULL)
+    {
+        printf("Error encoding JSON for client\n");
+        return;
     }
-    else if (bytes_received == 0)
+    send_encoded_to_tcp_client(sockfd, json_string, json_len, TCP_MESSAGE_RESPONSE);
+}
+
+static void print_sent_to_tcp_client(const TCPConnection* conn, const char* response, size_t len)
+{
+    if (conn != NULL && atomic_load(&conn->framing) == FRAMING_BINARY)
     {
-        // printf("No data received from client\n");
+        printf("Binary message sent to client: %zu bytes\n", len);
     }
     else
     {
-        perror("recv");
+        printf("JSON sent to client: %s\n", response);
     }
-
-    return NULL;
 }
 
-void send_json_to_tcp_client(int sockfd, cJSON* json)
+void send_encoded_to_tcp_client(int sockfd, const char* json_string, size_t json_len, int kind)
 {
-    char* json_string = cJSON_Print(json);
-    ssize_t bytes_sent = send(sockfd, json_string, strlen(json_string), 0);
-
-    if (bytes_sent < 0)
+    // While a read is being processed the responses are batched and flushed together
+    TCPConnection* conn = tcp_connection_get(sockfd);
+    if (conn != NULL && conn->batching)
     {
-        perror("Error sending JSON to client");
+        print_sent_to_tcp_client(conn, json_string, json_len);
+        if (tcp_connection_queue(conn, json_string, json_len, kind) == -1)
+        {
+            printf("Output queue of TCP client full, response dropped\n");
+        }
+        return;
     }
-    else if (bytes_sent == 0)
+
+    if (send_tcp_message(sockfd, json_string, json_len, kind) == -1)
     {
-        printf("No data sent to client\n");
+        printf("Error sending JSON to client\n");
     }
     else
     {
-        printf("JSON sent to client: %s\n", json_string);
+        print_sent_to_tcp_client(conn, json_string, json_len);
     }
-
-    free(json_string);
 }
 
 int check_tcp_clients_messages(int client_fd)
 {
-    // Receive JSON message from client
-    cJSON* received_json = receive_tcp_json(client_fd);
-    if (received_json)
+    TCPConnection* conn = tcp_connection_get(client_fd);
+    if (conn == NULL)
+    {
+        return 0; // Not registered by add_tcp_client()
+    }
+
+    ssize_t bytes_received = tcp_connection_read(conn);
+    if (bytes_received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        return 1; // Spurious wakeup of a non-blocking socket
+    }
+    if (bytes_received <= 0)
+    {
+        return 0; // Error o desconexión
+    }
+
+    // One read may carry several requests, and a request may span several reads. Their responses are batched and
+    // leave with a single write once every request has been processed
+    const char* frame;
+    size_t frame_len;
+    int status = 0;
+    int keep_connection = 1;
+    conn->batching = 1;
+    while (keep_connection && (status = tcp_connection_next_frame(conn, &frame, &frame_len)) == 1)
     {
-        // Access the 'message' field in the JSON object
-        cJSON* message = cJSON_GetObjectItem(received_json, "message");
-        if (message)
+        // Most requests are read in place, cJSON only builds a tree for the ones the scanner gives up on
+        Request request;
+        if (atomic_load(&conn->framing) == FRAMING_BINARY)
         {
-            // Verify type of message
-            const char* message_value = message->valuestring;
-            if (strcmp(message_value, "authenticateme") == 0)
+            if (request_from_wire(frame, frame_len, &request) == -1)
             {
-                // Authentication message
-                cJSON* hostname = cJSON_GetObjectItem(received_json, "hostname");
-                if (hostname)
-                {
-                    const char* hostname_value = hostname->valuestring;
-                    // Verify if the hostname is the same as the admin user
-                    if (strcmp(hostname_value, ADMIN_USER) == 0)
-                    {
-                        char client_ip[INET6_ADDRSTRLEN];
-                        get_tcp_client_ip(client_fd, client_ip);
-                        char log_message[BUFFER_256];
-                        snprintf(log_message, sizeof(log_message), "Update request from authenticated TCP client %s",
-                                 client_ip);
-                        log_event(log_message);
-                        printf("Client TCP authenticated successfully.\n");
-                        // Send authentication confirmation to client
-                        cJSON* auth_confirmation = cJSON_CreateObject();
-                        cJSON_AddStringToObject(auth_confirmation, "message", "auth_success");
-                        send_json_to_tcp_client(client_fd, auth_confirmation);
-                        cJSON_Delete(auth_confirmation);
-                        cJSON_Delete(received_json);
-                        return 1; // Successful authentication
-                    }
-                    else
-                    {
-                        char client_ip[INET6_ADDRSTRLEN];
-                        get_tcp_client_ip(client_fd, client_ip);
-                        char log_message[BUFFER_256];
-                        snprintf(log_message, sizeof(log_message),
-                                 "Update request from not authenticated TCP client %s", client_ip);
-                        log_event(log_message);
-                        printf("Client TCP authentication failed: Invalid hostname.\n");
-                        cJSON* auth_failure = cJSON_CreateObject();
-                        cJSON_AddStringToObject(auth_failure, "message", "auth_failure");
-                        send_json_to_tcp_client(client_fd, auth_failure);
-                        cJSON_Delete(auth_failure);
-                        cJSON_Delete(received_json);
-                        return 0; // Failed authentication
-                    }
-                }
-            }
-            else
-            {
-                FoodSupply* food_supply = get_food_supply();
-                MedicineSupply* medicine_supply = get_medicine_supply();
-                if (strcmp(message_value, "status") == 0)
-                {
-                    char client_ip[INET6_ADDRSTRLEN];
-                    get_tcp_client_ip(client_fd, client_ip);
-                    char log_message[BUFFER_256];
-
-                    time_t rawtime;
-                    struct tm* timeinfo;
-                    time(&rawtime);
-                    timeinfo = localtime(&rawtime);
-                    char timestamp[20];
-                    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-
-                    snprintf(log_message, sizeof(log_message), "Status request from TCP client %s", client_ip);
-                    update_emergency_info(timestamp, log_message, &emergency_info);
-                    log_event(log_message);
-                    printf("Received request from client TCP: Status\n");
-                    send_json_to_tcp_client(client_fd, convert_supplies_to_json(food_supply, medicine_supply));
-                }
-                else if (strcmp(message_value, "update") == 0)
-                {
-                    char client_ip[INET6_ADDRSTRLEN];
-                    get_tcp_client_ip(client_fd, client_ip);
-                    char log_message[BUFFER_256];
-
-                    snprintf(log_message, sizeof(log_message), "Update request from TCP client %s", client_ip);
-
-                    time_t rawtime;
-                    struct tm* timeinfo;
-                    time(&rawtime);
-                    timeinfo = localtime(&rawtime);
-                    char timestamp[20];
-                    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-                    update_emergency_info(timestamp, log_message, &emergency_info);
-
-                    log_event(log_message);
-                    printf("Received request from client TCP: Update\n");
-
-                    // Verify valid pointers to supplies data
-                    if (food_supply != NULL && medicine_supply != NULL)
-                    {
-                        update_supplies_from_json(food_supply, medicine_supply, received_json);
-                    }
-                    else
-                    {
-                        printf("Error obtaining pointers to supplies data.\n");
-                    }
-                }
-                else if (strcmp(message_value, "summary") == 0)
-                {
-                    char client_ip[INET6_ADDRSTRLEN];
-                    get_tcp_client_ip(client_fd, client_ip);
-                    char log_message[BUFFER_256];
-                    snprintf(log_message, sizeof(log_message), "Summary request from TCP client %s", client_ip);
-                    log_event(log_message); // Registrar evento
-                    printf("Received request from client TCP: Summary\n");
-
-                    cJSON* summary = create_summary_json();
-                    send_json_to_tcp_client(client_fd, summary);
-                }
-                else
-                {
-                    char client_ip[INET6_ADDRSTRLEN];
-                    get_tcp_client_ip(client_fd, client_ip);
-                    char log_message[BUFFER_256];
-                    snprintf(log_message, sizeof(log_message), "Invalid request received from TCP client %s",
-                             client_ip);
-                    log_event(log_message); // Registrar evento
-                    printf("Invalid request received from client TCP\n");
-                }
+                fprintf(stderr, "Malformed binary message of %zu bytes received from TCP client\n", frame_len);
+                continue;
             }
+            printf("Binary message received from client: %zu bytes\n", frame_len);
+            keep_connection = dispatch_tcp_request(client_fd, &request);
+            continue;
+        }
+        if (request_scan(frame, frame_len, &request) == 0)
+        {
+            printf("JSON received from client: %.*s\n", (int)frame_len, frame);
+            keep_connection = dispatch_tcp_request(client_fd, &request);
+            continue;
         }
+        cJSON* received_json = cJSON_ParseWithLength(frame, frame_len);
+        if (!received_json)
+        {
+            fprintf(stderr, "Error parsing JSON: %.*s\n", (int)frame_len, frame);
+            continue;
+        }
+        printf("JSON received from client: %.*s\n", (int)frame_len, frame);
+
+        keep_connection = process_tcp_request(client_fd, received_json);
         cJSON_Delete(received_json);
-        return 1; // Lectura exitosa
     }
-    else
+    conn->batching = 0;
+    if (tcp_connection_flush(conn) == -1)
     {
-        return 0; // Error o desconexión
+        perror("Error sending JSON to client");
+        return 0;
+    }
+
+    if (!keep_connection)
+    {
+        return 0;
     }
+    if (status == -1)
+    {
+        fprintf(stderr, "Frame larger than %d bytes received from TCP client\n", MAX_FRAME_SIZE);
+        return 0;
+    }
+    return 1; // Lectura exitosa
 }
 
-void handle_new_tcp_connection(int tcp_socket_fd)
+int process_tcp_request(int client_fd, cJSON* received_json)
 {
-    struct sockaddr_storage client_addr;
-    socklen_t addrlen = sizeof(client_addr);
-    accept_tcp_connection(tcp_socket_fd, (struct sockaddr*)&client_addr, addrlen);
+    Request request;
+    request_from_json(received_json, &request);
+    return dispatch_tcp_request(client_fd, &request);
+}
+
+// Client of a request, and the TCPMessageKind of its responses
+typedef struct
+{
+    int fd;
+    int kind;
+} TCPReplyTarget;
+
+// Status and summary responses are snapshots that a newer one supersedes, the others answer one request each
+static int tcp_response_kind(RequestType type)
+{
+    switch (type)
+    {
+    case REQUEST_STATUS:
+        return TCP_MESSAGE_STATUS;
+    case REQUEST_SUMMARY:
+        return TCP_MESSAGE_SUMMARY;
+    default:
+        return TCP_MESSAGE_RESPONSE;
+    }
+}
+
+static void reply_to_tcp_client(const char* response, size_t len, void* arg)
+{
+    const TCPReplyTarget* target = arg;
+    send_encoded_to_tcp_client(target->fd, response, len, target->kind);
+}
+
+static uint32_t subscribe_tcp_client(uint32_t topics, void* arg)
+{
+    TCPConnection* conn = tcp_connection_get(((const TCPReplyTarget*)arg)->fd);
+    if (conn == NULL)
+    {
+        return 0;
+    }
+    if (tcp_connection_subscribe(conn, topics) == -1)
+    {
+        printf("Error subscribing TCP client to its topics\n");
+    }
+    // Subscriptions only change on the thread serving the connection: this one
+    return conn->topics;
+}
+
+int dispatch_tcp_request(int client_fd, const Request* request)
+{
+    char fallback[INET6_ADDRSTRLEN];
+    TCPConnection* conn = tcp_connection_get(client_fd);
+    TCPReplyTarget target = {client_fd, tcp_response_kind(request->type)};
+    ProtocolSession session = {PROTOCOL_TCP, get_tcp_client_peer(client_fd, fallback), 0,
+                               conn != NULL && conn->authenticated, reply_to_tcp_client, &target,
+                               conn != NULL && atomic_load(&conn->framing) == FRAMING_BINARY, subscribe_tcp_client};
+    ProtocolResult result = protocol_handle(&session, request);
+    if (conn != NULL)
+    {
+        conn->authenticated = session.authenticated;
+    }
+    // Malformed requests are ignored, the connection only closes on a failed authentication
+    return result != PROTOCOL_CLOSE;
+}
+
+void handle_new_tcp_connection(int tcp_socket_fd, ServerWorker* worker)
+{
+    for (int accepted = 0; accepted < TCP_ACCEPT_BATCH; accepted++)
+    {
+        struct sockaddr_storage client_addr;
+        socklen_t addrlen = sizeof(client_addr);
+        int client_fd = accept_tcp_connection(tcp_socket_fd, (struct sockaddr*)&client_addr, addrlen);
+        if (client_fd == -1)
+        {
+            // The peer of an aborted connection gave up, the next ones may still be waiting
+            if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO)
+            {
+                continue;
+            }
+            // Queue drained, or out of descriptors: the level-triggered listener reports the rest later
+            return;
+        }
+        if (event_loop_add(worker->loop, client_fd, EVENT_READ, on_tcp_client_ready, worker) == -1)
+        {
+            // e.g. select backend past FD_SETSIZE: refuse the client instead of leaving it unserved
+            perror("event_loop_add");
+            remove_tcp_client(client_fd);
+            close(client_fd);
+            continue;
+        }
+
+        TCPConnection* conn = tcp_connection_get(client_fd);
+        if (conn != NULL)
+        {
+            atomic_store(&conn->owner, worker->id);
+            // An alert broadcast before the owner was known may have left output behind
+            service_tcp_output(client_fd, worker);
+        }
+    }
 }
 
 void send_json_to_udp_client(int sockfd, struct sockaddr* client_addr, socklen_t client_addrlen, cJSON* json_response)
 {
-    // Convert cJSON object to JSON string
-    char* json_string = cJSON_Print(json_response);
+    // Convert cJSON object to JSON string, in the reusable buffer of this thread
+    size_t json_len;
+    const char* json_string = json_encode(json_response, &json_len);
+    if (json_string != NULL)
+    {
+        send_encoded_to_udp_client(sockfd, client_addr, client_addrlen, json_string, json_len);
+    }
 
+    // Clean up cJSON object
+    cJSON_Delete(json_response);
+}
+
+void send_encoded_to_udp_client(int sockfd, struct sockaddr* client_addr, socklen_t client_addrlen,
+                                const char* json_string, size_t json_len)
+{
     // Send response back to client
-    ssize_t bytes_sent = sendto(sockfd, json_string, strlen(json_string), 0, client_addr, client_addrlen);
+    ssize_t bytes_sent = sendto(sockfd, json_string, json_len, 0, client_addr, client_addrlen);
     if (bytes_sent == -1)
     {
         perror("sendto");
-        free(json_string);
         return;
     }
 
@@ -650,10 +1097,6 @@ void send_json_to_udp_client(int sockfd, struct sockaddr* client_addr, socklen_t
     get_udp_client_info((struct sockaddr_storage*)client_addr, client_ip, sizeof(client_ip), &client_port);
 
     printf("Message sent to %s:%d\n", client_ip, client_port);
-
-    // Clean up cJSON object and JSON string
-    cJSON_Delete(json_response);
-    free(json_string);
 }
 
 void get_udp_client_info(struct sockaddr_storage* client_addr, char* client_ip, size_t ip_buffer_size, int* client_port)
@@ -693,13 +1136,12 @@ cJSON* receive_udp_json(int sockfd, struct sockaddr_storage* client_addr, sockle
     // Null-terminate the received data
     buffer[bytes_received] = '\0';
 
-    // Get client information
-    char client_ip[INET6_ADDRSTRLEN];
-    int client_port;
-    get_udp_client_info(client_addr, client_ip, sizeof(client_ip), &client_port);
+    return parse_udp_json(buffer, client_addr);
+}
 
-    // Print the received message and client information
-    printf("Received UDP message from %s:%d: %s\n", client_ip, client_port, buffer);
+cJSON* parse_udp_json(const char* buffer, struct sockaddr_storage* client_addr)
+{
+    print_udp_message(buffer, client_addr);
 
     // Parse the received JSON string
     cJSON* json = cJSON_Parse(buffer);
@@ -714,141 +1156,237 @@ cJSON* receive_udp_json(int sockfd, struct sockaddr_storage* client_addr, sockle
 
 int check_udp_clients_messages(int sockfd)
 {
-    // Receive JSON message from client
+    // Receive a message from client, JSON or binary
+    char buffer[BUFFER_SIZE];
     struct sockaddr_storage client_addr;
     socklen_t client_addrlen = sizeof(client_addr);
-    cJSON* received_json = receive_udp_json(sockfd, &client_addr, &client_addrlen);
-    if (!received_json)
+    ssize_t bytes_received =
+        recvfrom(sockfd, buffer, BUFFER_SIZE - 1, 0, (struct sockaddr*)&client_addr, &client_addrlen);
+    if (bytes_received == -1)
     {
-        // Error occurred while receiving JSON or parsing it
+        perror("recvfrom");
         return 0; // Error or disconnection
     }
+    buffer[bytes_received] = '\0';
+    return handle_udp_datagram(sockfd, buffer, (size_t)bytes_received, &client_addr, client_addrlen, NULL);
+}
 
+int handle_udp_json(int sockfd, cJSON* received_json, struct sockaddr_storage* client_addr, socklen_t client_addrlen,
+                    UDPBatch* replies)
+{
+    Request request;
+    request_from_json(received_json, &request);
+    int handled = dispatch_udp_request(sockfd, &request, client_addr, client_addrlen, replies, 0);
+    cJSON_Delete(received_json);
+    return handled;
+}
+
+/**
+ * @struct UDPReplyTarget
+ * @brief Where the responses to a datagram go.
+ */
+typedef struct
+{
+    int sockfd;
+    struct sockaddr* client_addr;
+    socklen_t client_addrlen;
+    UDPBatch* replies;
+} UDPReplyTarget;
+
+static void reply_to_udp_client(const char* response, size_t len, void* arg)
+{
+    UDPReplyTarget* target = arg;
+    // A full batch falls back to a direct send
+    if (target->replies == NULL ||
+        udp_batch_queue_reply(target->replies, target->client_addr, target->client_addrlen, response, len) == -1)
+    {
+        send_encoded_to_udp_client(target->sockfd, target->client_addr, target->client_addrlen, response, len);
+    }
+}
+
+static uint32_t subscribe_udp_client(uint32_t topics, void* arg)
+{
+    UDPReplyTarget* target = arg;
+    pthread_mutex_lock(&udp_clients_lock);
+    if (udp_registry_subscribe(&udp_clients, target->client_addr, target->client_addrlen, topics) == -1)
+    {
+        printf("Error subscribing UDP client to its topics\n");
+    }
+    UDPClientEntry* entry = udp_registry_find(&udp_clients, target->client_addr, target->client_addrlen);
+    uint32_t subscribed = entry != NULL ? entry->topics : 0;
+    pthread_mutex_unlock(&udp_clients_lock);
+    return subscribed;
+}
+
+int dispatch_udp_request(int sockfd, const Request* request, struct sockaddr_storage* client_addr,
+                         socklen_t client_addrlen, UDPBatch* replies, int binary)
+{
     // Get client information
     char client_ip[INET6_ADDRSTRLEN];
     int client_port;
-    get_udp_client_info(&client_addr, client_ip, sizeof(client_ip), &client_port);
+    get_udp_client_info(client_addr, client_ip, sizeof(client_ip), &client_port);
 
     // Add the new UDP client to the list of connected clients
     UDPClientData new_client;
     new_client.sockfd = sockfd;
-    new_client.client_addr = client_addr;
+    new_client.client_addr = *client_addr;
     new_client.addr_len = client_addrlen;
+    new_client.binary = binary;
     add_udp_client(&udp_clients, new_client);
 
-    // Check if data has the 'message' field
-    cJSON* message = cJSON_GetObjectItem(received_json, "message");
-    if (!message)
-    {
-        printf("No 'message' field found in JSON\n");
-        cJSON_Delete(received_json);
-        return 0; // Error
-    }
-    // Check if data has the 'hostname' field
-    cJSON* hostname = cJSON_GetObjectItem(received_json, "hostname");
-    if (!hostname)
-    {
-        printf("No 'hostname' field found in JSON\n");
-        cJSON_Delete(received_json);
-        return 0; // Error
-    }
-
-    // Check the value of the 'message' and 'hostname' fields
-    const char* value = message->valuestring;
-    const char* auth = hostname->valuestring;
-
-    FoodSupply* food_supply = get_food_supply();
-    MedicineSupply* medicine_supply = get_medicine_supply();
-
-    if (strcmp(value, "update") == 0)
-    {
-        printf("Received request from UDP client: Update\n");
-        if (strcmp(auth, ADMIN_USER) == 0)
-        {
-            printf("Client successfully authenticated\n");
-            update_supplies_from_json(food_supply, medicine_supply, received_json);
-            // Log event for update request from authenticated client
-            char log_message[BUFFER_256];
-            snprintf(log_message, sizeof(log_message), "Update request from authenticated UDP client %s", client_ip);
-            log_event(log_message);
-        }
-        else
-        {
-            printf("Not authenticated client tried to update data\n");
-            // Log event for update request from non-authenticated client
-            char log_message[BUFFER_256];
-            snprintf(log_message, sizeof(log_message), "Update request from not authenticated UDP client %s",
-                     client_ip);
-            log_event(log_message);
-        }
-    }
-    else if (strcmp(value, "status") == 0)
-    {
-        printf("Received request from UDP client: Status\n");
-        // Log event for status request from UDP client
-        char log_message[BUFFER_256];
-        snprintf(log_message, sizeof(log_message), "Status request from UDP client %s", client_ip);
-        log_event(log_message);
-        send_json_to_udp_client(sockfd, (struct sockaddr*)&client_addr, client_addrlen,
-                                convert_supplies_to_json(food_supply, medicine_supply));
-    }
-    else if (strcmp(value, "summary") == 0)
-    {
-        printf("Received request from UDP client: Summary\n");
-        char log_message[BUFFER_256];
-        snprintf(log_message, sizeof(log_message), "Summary request from UDP client %s", client_ip);
-        log_event(log_message);
-        cJSON* summary = create_summary_json();
-        send_json_to_udp_client(sockfd, (struct sockaddr*)&client_addr, client_addrlen, summary);
-    }
-    else
-    {
-        printf("Invalid request received from UDP client\n");
-    }
-    cJSON_Delete(received_json);
-    return 1; // Successful read
+    // Datagrams carry no session: every update is authorized by its own token
+    UDPReplyTarget target = {sockfd, (struct sockaddr*)client_addr, client_addrlen, replies};
+    ProtocolSession session = {PROTOCOL_UDP, client_ip, 1, 0, reply_to_udp_client, &target, binary,
+                               subscribe_udp_client};
+    return protocol_handle(&session, request) != PROTOCOL_REJECTED;
 }
 
 void parse_command_line_arguments(int argc, char* argv[], int* tcp_port, int* udp_port)
 {
     int opt;
-    while ((opt = getopt(argc, argv, "p:")) != -1)
+    while ((opt = getopt(argc, argv, "p:e:w:s:q:l:f:t:b:a:n:i:r:g:d")) != -1)
     {
         switch (opt)
         {
         case 'p':
             if (strcmp(optarg, "tcp") == 0)
             {
-                if (optind < argc)
-                {
-                    *tcp_port = atoi(argv[optind]);
-                }
-                else
-                {
-                    printf("TCP port must be specified.\n");
-                    exit(EXIT_FAILURE);
-                }
+                if (optind < argc)
+                {
+                    *tcp_port = atoi(argv[optind]);
+                }
+                else
+                {
+                    printf("TCP port must be specified.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if (strcmp(optarg, "udp") == 0)
+            {
+                if (optind < argc)
+                {
+                    *udp_port = atoi(argv[optind]);
+                }
+                else
+                {
+                    printf("UDP port must be specified.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else
+            {
+                printf("Invalid -p option. It should be 'tcp' or 'udp'.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'e':
+            if (event_loop_parse_backend(optarg, &server_config.event_backend) == -1)
+            {
+                printf("Invalid -e option. It should be 'epoll' or 'select'.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'w':
+            server_config.num_workers = atoi(optarg);
+            if (server_config.num_workers < 1 || server_config.num_workers > MAX_WORKERS)
+            {
+                printf("Invalid -w option. The number of workers must be between 1 and %d.\n", MAX_WORKERS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 's':
+            if (tcp_connection_parse_policy(optarg, &server_config.slow_consumer_policy) == -1)
+            {
+                printf("Invalid -s option. It should be 'drop-oldest', 'disconnect' or 'coalesce'.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'q':
+            if (atol(optarg) < BUFFER_SIZE)
+            {
+                printf("Invalid -q option. The output queue limit must be at least %d bytes.\n", BUFFER_SIZE);
+                exit(EXIT_FAILURE);
+            }
+            server_config.output_queue_limit = (size_t)atol(optarg);
+            break;
+        case 'l':
+            server_config.log_flush_interval_ms = atoi(optarg);
+            if (server_config.log_flush_interval_ms < 1 || server_config.log_flush_interval_ms > LOGGER_MAX_FLUSH_MS)
+            {
+                printf("Invalid -l option. The log flush interval must be between 1 and %d ms.\n", LOGGER_MAX_FLUSH_MS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            if (logger_parse_fsync_policy(optarg, &server_config.log_fsync_policy) == -1)
+            {
+                printf("Invalid -f option. It should be 'none' or 'batch'.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 't':
+            server_config.udp_client_ttl = atoi(optarg);
+            if (server_config.udp_client_ttl < 1 || server_config.udp_client_ttl > UDP_CLIENT_MAX_TTL)
+            {
+                printf("Invalid -t option. The UDP client TTL must be between 1 and %d seconds.\n", UDP_CLIENT_MAX_TTL);
+                exit(EXIT_FAILURE);
             }
-            else if (strcmp(optarg, "udp") == 0)
+            break;
+        case 'b':
+            server_config.tcp_backlog = atoi(optarg);
+            if (server_config.tcp_backlog < 1 || server_config.tcp_backlog > TCP_MAX_BACKLOG)
             {
-                if (optind < argc)
-                {
-                    *udp_port = atoi(argv[optind]);
-                }
-                else
-                {
-                    printf("UDP port must be specified.\n");
-                    exit(EXIT_FAILURE);
-                }
+                printf("Invalid -b option. The TCP backlog must be between 1 and %d connections.\n", TCP_MAX_BACKLOG);
+                exit(EXIT_FAILURE);
             }
-            else
+            break;
+        case 'a':
+            if (alert_transport_parse(optarg, &server_config.alert_transport) == -1)
             {
-                printf("Invalid -p option. It should be 'tcp' or 'udp'.\n");
+                printf("Invalid -a option. It should be 'fifo' or 'ring'.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'n':
+            server_config.sensor_count = atoi(optarg);
+            if (server_config.sensor_count < 1 || server_config.sensor_count > SENSOR_BANK_MAX_SENSORS)
+            {
+                printf("Invalid -n option. The number of sensors must be between 1 and %d.\n", SENSOR_BANK_MAX_SENSORS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'i':
+            server_config.sensor_period_ms = atoi(optarg);
+            if (server_config.sensor_period_ms < 1 || server_config.sensor_period_ms > SENSOR_MAX_PERIOD_MS)
+            {
+                printf("Invalid -i option. The sensor period must be between 1 and %d ms.\n", SENSOR_MAX_PERIOD_MS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'r':
+            server_config.alert_probability = strtof(optarg, NULL);
+            if (!(server_config.alert_probability >= 0.0f && server_config.alert_probability <= 1.0f))
+            {
+                printf("Invalid -r option. The alert probability must be between 0 and 1.\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'g':
+            server_config.random_seed = atoll(optarg);
+            if (server_config.random_seed < 0)
+            {
+                printf("Invalid -g option. The random seed must be a positive number.\n");
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'd':
+            server_config.pretty_json = 1;
+            break;
         default:
-            printf("Usage: %s -p tcp <tcp_port> -p udp <udp_port>\n", argv[0]);
+            printf("Usage: %s -p tcp <tcp_port> -p udp <udp_port> [-e epoll|select] [-w <threads>] "
+                   "[-s drop-oldest|disconnect|coalesce] [-q <bytes>] [-l <ms>] [-f none|batch] [-t <seconds>] "
+                   "[-b <connections>] [-a fifo|ring] [-n <sensors>] [-i <ms>] [-r <probability>] [-g <seed>] [-d]\n",
+                   argv[0]);
             exit(EXIT_FAILURE);
         }
     }
@@ -923,13 +1461,17 @@ cJSON* convert_supplies_to_json(FoodSupply* food_supply, MedicineSupply* medicin
     return supplies_json;
 }
 
-Sensor* initiateAlertModule()
+static void create_alerts_fifo(void)
 {
-
     if (mkfifo(FIFO_PATH, 0666) == -1)
     {
         perror("Error creating FIFO");
     }
+}
+
+Sensor* initiateAlertModule()
+{
+    create_alerts_fifo();
 
     Sensor* sensors = malloc(sizeof(Sensor) * NUM_SENSORS);
     if (sensors == NULL)
@@ -938,82 +1480,61 @@ Sensor* initiateAlertModule()
         exit(EXIT_FAILURE);
     }
 
-    sprintf(sensors[0].name, "NORTH ENTRY");
-    sprintf(sensors[1].name, "SOUTH ENTRY");
-    sprintf(sensors[2].name, "WEST ENTRY");
-    sprintf(sensors[3].name, "EAST ENTRY");
+    for (int i = 0; i < NUM_SENSORS; i++)
+    {
+        sensors[i].id = (AlertSensor)i;
+        snprintf(sensors[i].name, sizeof(sensors[i].name), "%s", alert_sensor_name(sensors[i].id));
+    }
 
     return sensors;
 }
 
-void check_alerts()
+static void handle_alert_record(const AlertRecord* alert, void* arg)
 {
-    int fd;
-    char alert_message[BUFFER_SIZE];
-
-    memset(alert_message, 0, sizeof(alert_message)); // Fill alert_message with 0
-
-    fd = open(FIFO_PATH, O_RDONLY);
-    if (fd == -1)
-    {
-        perror("Error opening FIFO");
-        return;
-    }
-
-    // Read any available alerts from the FIFO
-    ssize_t bytes_read = read(fd, alert_message, sizeof(alert_message));
-    if (bytes_read > 0)
-    {
-        log_event(alert_message);
-
-        time_t rawtime;
-        struct tm* timeinfo;
-        time(&rawtime);
-        timeinfo = localtime(&rawtime);
-        char timestamp[20];
-        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-        update_emergency_info(timestamp, alert_message, &emergency_info);
+    (void)arg;
+    handle_alert(alert);
+}
 
-        send_to_all_tcp_clients(alert_message);
-        send_to_all_udp_clients(&udp_clients, alert_message, strlen(alert_message));
-        log_event("Sent alert notification to all connected clients");
+void check_alerts()
+{
+    alert_fifo_read(&alert_fifo, handle_alert_record, NULL);
+}
 
-        const char* entry = detect_entry(alert_message);
-        if (entry != NULL)
-        {
-            // Found a valid entry in the alert message
-            printf("\u26A0 Detected alert at entry: %s\n", entry);
-            printf("\U0001F4E2 Sent alert notification to all connected clients\n");
+void check_alert_ring()
+{
+    alert_ring_drain(&alert_ring, handle_alert_record, NULL);
+}
 
-            // Increase corresponding entry count
-            if (strcmp(entry, "NORTH") == 0)
-            {
-                entry_alerts_count.north++;
-            }
-            else if (strcmp(entry, "SOUTH") == 0)
-            {
-                entry_alerts_count.south++;
-            }
-            else if (strcmp(entry, "EAST") == 0)
-            {
-                entry_alerts_count.east++;
-            }
-            else if (strcmp(entry, "WEST") == 0)
-            {
-                entry_alerts_count.west++;
-            }
-        }
-    }
-    else if (bytes_read == 0)
-    {
-        // No data available
-        // printf("No data available\n");
-    }
-    else
-    {
-        perror("Error reading from FIFO");
-    }
-    close(fd);
+void handle_alert(const AlertRecord* alert)
+{
+    // Text is only rendered for the log and the clients
+    char alert_message[ALERT_TEXT_SIZE];
+    alert_record_format(alert, alert_message, sizeof(alert_message));
+    log_event(alert_message);
+
+    time_t rawtime = (time_t)alert->timestamp;
+    struct tm timeinfo;
+    localtime_r(&rawtime, &timeinfo);
+    char timestamp[20];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    update_emergency_info(timestamp, alert_message, &emergency_info);
+
+    // Only the clients subscribed to the entry are notified
+    uint8_t binary[WIRE_MAX_MESSAGE];
+    BroadcastMessage notification = {(AlertTopic)alert->sensor, alert_message, strlen(alert_message), binary,
+                                     encode_alert_wire(alert, binary, sizeof(binary))};
+    publish_to_tcp_clients(&notification);
+    publish_to_udp_clients(&udp_clients, &notification);
+    log_event("Sent alert notification to the subscribed clients");
+
+    printf("\u26A0 Detected alert at entry: %s\n", alert_sensor_name((AlertSensor)alert->sensor));
+    printf("\U0001F4E2 Sent alert notification to the subscribed clients\n");
+
+    // Increase corresponding entry count
+    pthread_mutex_lock(&shelter_state_lock);
+    entry_alerts_count.entries[alert->sensor]++;
+    atomic_fetch_add(&shelter_state_version, 1);
+    pthread_mutex_unlock(&shelter_state_lock);
 }
 
 void cleanup_fifo(const char* fifo_path)
@@ -1048,125 +1569,197 @@ int fifo_not_empty(int fd)
     return FD_ISSET(fd, &read_fds);
 }
 
-void add_tcp_client(int client_fd, TCPClientList* tcp_clients_list)
+int add_tcp_client(int client_fd, const char* client_ip)
 {
-    if (tcp_clients_list->num_clients < MAX_CLIENTS)
+    pthread_mutex_lock(&tcp_clients_lock);
+    TCPConnection* conn = tcp_connection_open(client_fd);
+    if (conn != NULL)
     {
-        tcp_clients_list->client_fds[tcp_clients_list->num_clients++] = client_fd;
-        char num_clients_str[10]; // Space to hold the number of clients as text
-        snprintf(num_clients_str, sizeof(num_clients_str), "%d", tcp_clients_list->num_clients);
-        char log_message[BUFFER_256]; // space to store the log message
-        snprintf(log_message, sizeof(log_message), "Added TCP client. Total connected: %s", num_clients_str);
-        log_event(log_message);
+        snprintf(conn->peer, sizeof(conn->peer), "%s", client_ip);
     }
-    else
+    size_t num_clients = tcp_connection_count();
+    pthread_mutex_unlock(&tcp_clients_lock);
+
+    if (conn == NULL)
     {
         printf("Can't add more clients\n");
+        return -1;
     }
+    char log_message[BUFFER_256]; // space to store the log message
+    snprintf(log_message, sizeof(log_message), "Added TCP client. Total connected: %zu", num_clients);
+    log_event(log_message);
+    return 0;
 }
 
-void remove_tcp_client(int client_fd, TCPClientList* tcp_clients)
+void remove_tcp_client(int client_fd)
 {
-    int i;
-    for (i = 0; i < tcp_clients->num_clients; ++i)
+    pthread_mutex_lock(&tcp_clients_lock);
+    int known = tcp_connection_get(client_fd) != NULL;
+    tcp_connection_close(client_fd);
+    size_t num_clients = tcp_connection_count();
+    pthread_mutex_unlock(&tcp_clients_lock);
+
+    if (known)
     {
-        if (tcp_clients->client_fds[i] == client_fd)
-        {
-            // Move the rest of the clients one position to the left
-            for (; i < tcp_clients->num_clients - 1; ++i)
-            {
-                tcp_clients->client_fds[i] = tcp_clients->client_fds[i + 1];
-            }
-            tcp_clients->num_clients--;
-            char num_clients_str[10]; // Space to store the number as a string
-            snprintf(num_clients_str, sizeof(num_clients_str), "%d", tcp_clients->num_clients);
-            char log_message[BUFFER_256]; // Space for the log message
-            snprintf(log_message, sizeof(log_message), "TCP client disconnected. Total connected: %s", num_clients_str);
-            log_event(log_message);
-            return;
-        }
+        char log_message[BUFFER_256]; // Space for the log message
+        snprintf(log_message, sizeof(log_message), "TCP client disconnected. Total connected: %zu", num_clients);
+        log_event(log_message);
     }
 }
 
-void send_to_all_tcp_clients(const char* message)
+static void send_broadcast(TCPConnection* conn, void* arg)
 {
-    for (int i = 0; i < tcp_clients.num_clients; i++)
+    const BroadcastMessage* message = arg;
+    int framing = atomic_load(&conn->framing);
+    if (framing == FRAMING_PENDING)
+    {
+        return; // Framed now, it would corrupt the stream of a client that then opens with another framing
+    }
+    // Notifications of the same topic supersede each other in the queue of a slow client
+    int kind = TCP_MESSAGE_TOPIC(message->topic);
+    if (framing == FRAMING_BINARY)
+    {
+        send_tcp_message(conn->fd, (const char*)message->binary, message->binary_len, kind);
+    }
+    else
     {
-        send(tcp_clients.client_fds[i], message, strlen(message), 0);
+        send_tcp_message(conn->fd, message->text, message->text_len, kind);
     }
 }
 
-void add_udp_client(UDPClientList* udp_clients, UDPClientData client)
+void publish_to_tcp_clients(const BroadcastMessage* message)
 {
-    // Check if the client already exists in the list
-    for (int i = 0; i < udp_clients->num_clients; ++i)
-    {
-        struct sockaddr_in* existing_addr = (struct sockaddr_in*)&udp_clients->clients[i].client_addr;
-        struct sockaddr_in* new_addr = (struct sockaddr_in*)&client.client_addr;
+    // Holding the lock keeps a client from being closed (and its fd reused) while it is written
+    pthread_mutex_lock(&tcp_clients_lock);
+    tcp_connection_for_each_subscriber(message->topic, send_broadcast, (void*)message);
+    pthread_mutex_unlock(&tcp_clients_lock);
+}
 
-        // Compare client address and port
-        if (existing_addr->sin_addr.s_addr == new_addr->sin_addr.s_addr &&
-            existing_addr->sin_port == new_addr->sin_port)
-        {
-            // Client already exists, do not add
-            printf("Client already exists in the UDP client list.\n");
-            return;
-        }
+// Sweeps the clients idle for longer than the TTL, at most every quarter of it. Called with udp_clients_lock held
+static void expire_udp_clients(UDPClientRegistry* udp_clients, time_t now, int force)
+{
+    time_t ttl = server_config.udp_client_ttl;
+    time_t interval = ttl / 4 > 0 ? ttl / 4 : 1;
+    if (!force && now - udp_clients->last_sweep < interval)
+    {
+        return;
     }
+    size_t expired = udp_registry_expire(udp_clients, now, ttl);
+    if (expired > 0)
+    {
+        printf("Expired %zu idle UDP clients.\n", expired);
+    }
+}
 
-    // Check if the maximum number of clients has been reached
-    if (udp_clients->num_clients < MAX_CLIENTS)
+void add_udp_client(UDPClientRegistry* udp_clients, UDPClientData client)
+{
+    time_t now = time(NULL);
+    pthread_mutex_lock(&udp_clients_lock);
+    expire_udp_clients(udp_clients, now, 0);
+    int result = udp_registry_touch(udp_clients, (struct sockaddr*)&client.client_addr, client.addr_len, client.sockfd,
+                                    now);
+    // Alerts follow the encoding of the last datagram
+    UDPClientEntry* entry =
+        result == -1 ? NULL : udp_registry_find(udp_clients, (struct sockaddr*)&client.client_addr, client.addr_len);
+    if (entry != NULL)
     {
-        // Add the new client to the list
-        udp_clients->clients[udp_clients->num_clients++] = client;
+        entry->binary = client.binary;
+    }
+    size_t num_clients = udp_clients->count;
+    pthread_mutex_unlock(&udp_clients_lock);
 
+    if (result == 1)
+    {
         // Generate log event
-        char num_clients_str[10]; // String to store the number of clients as text
-        snprintf(num_clients_str, sizeof(num_clients_str), "%d", udp_clients->num_clients);
         char log_message[BUFFER_256];
-        snprintf(log_message, sizeof(log_message), "Added UDP client. Total cached: %s", num_clients_str);
+        snprintf(log_message, sizeof(log_message), "Added UDP client. Total cached: %zu", num_clients);
         log_event(log_message); // Register the event
     }
-    else
+    else if (result == -1)
     {
         printf("Maximum number of clients reached. Cannot add more clients.\n");
     }
 }
 
-void remove_udp_client(UDPClientList* udp_clients, int sockfd)
+int remove_udp_client(UDPClientRegistry* udp_clients, struct sockaddr_storage* client_addr, socklen_t addr_len)
+{
+    pthread_mutex_lock(&udp_clients_lock);
+    int removed = udp_registry_remove(udp_clients, (struct sockaddr*)client_addr, addr_len);
+    pthread_mutex_unlock(&udp_clients_lock);
+    return removed;
+}
+
+static int compare_udp_socket(const void* a, const void* b)
+{
+    int first = ((const UDPClientEntry*)a)->sockfd;
+    int second = ((const UDPClientEntry*)b)->sockfd;
+    return (first > second) - (first < second);
+}
+
+void publish_to_udp_clients(UDPClientRegistry* udp_clients, const BroadcastMessage* message)
 {
-    for (int i = 0; i < udp_clients->num_clients; ++i)
+    // Send from a copy of the subscribers, so that workers adding clients don't wait for the broadcast
+    pthread_mutex_lock(&udp_clients_lock);
+    expire_udp_clients(udp_clients, time(NULL), 1);
+    size_t count = udp_clients->topics[message->topic].count;
+    UDPClientEntry* clients = count > 0 ? malloc(sizeof(UDPClientEntry) * count) : NULL;
+    if (clients != NULL)
+    {
+        count = udp_registry_collect(udp_clients, message->topic, clients);
+    }
+    pthread_mutex_unlock(&udp_clients_lock);
+    if (clients == NULL)
+    {
+        return;
+    }
+
+    // Clients are cached with the socket of the worker that heard them: group them to send with sendmmsg()
+    qsort(clients, count, sizeof(UDPClientEntry), compare_udp_socket);
+    struct iovec text = {.iov_base = (void*)message->text, .iov_len = message->text_len};
+    struct iovec binary = {.iov_base = (void*)message->binary, .iov_len = message->binary_len};
+    struct mmsghdr messages[UDP_BATCH_SIZE];
+    memset(messages, 0, sizeof(messages));
+    for (size_t i = 0; i < UDP_BATCH_SIZE; i++)
+    {
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for (size_t first = 0; first < count;)
     {
-        if (udp_clients->clients[i].sockfd == sockfd)
+        unsigned int batch = 0;
+        while (batch < UDP_BATCH_SIZE && first + batch < count &&
+               clients[first + batch].sockfd == clients[first].sockfd)
+        {
+            messages[batch].msg_hdr.msg_name = &clients[first + batch].address;
+            messages[batch].msg_hdr.msg_namelen = clients[first + batch].addr_len;
+            messages[batch].msg_hdr.msg_iov = clients[first + batch].binary ? &binary : &text;
+            batch++;
+        }
+
+        // A client the kernel refuses is skipped, the others still get the alert
+        unsigned int next = 0;
+        while (next < batch)
         {
-            // Shift remaining clients to fill the gap
-            for (int j = i; j < udp_clients->num_clients - 1; ++j)
+            int result = sendmmsg(clients[first].sockfd, messages + next, batch - next, 0);
+            if (result == -1)
             {
-                udp_clients->clients[j] = udp_clients->clients[j + 1];
+                perror("sendmmsg");
+                next++;
+            }
+            else
+            {
+                next += (unsigned int)result;
             }
-            udp_clients->num_clients--;
-            break;
         }
+        first += batch;
     }
+    free(clients);
 }
 
-void send_to_all_udp_clients(UDPClientList* udp_clients, const char* message, size_t message_len)
-{
-    for (int i = 0; i < udp_clients->num_clients; ++i)
-    {
-        sendto(udp_clients->clients[i].sockfd, message, message_len, 0,
-               (struct sockaddr*)&(udp_clients->clients[i].client_addr), udp_clients->clients[i].addr_len);
-    }
-}
-
-void log_event(const char* message)
+// Builds the path of the log file, creating ~/.refuge if it doesn't exist
+static int get_log_file_path(char* logFilePath, size_t size)
 {
-    FILE* logFile;
-    time_t currentTime;
-    struct tm* localTime;
-    char timestamp[BUFFER_256];
     char logDirPath[BUFFER_256];
-    char logFilePath[BUFFER_521];
 
     // Get the user's home directory
     const char* homeDir = get_home_dir();
@@ -1181,13 +1774,51 @@ void log_event(const char* message)
         if (mkdir(logDirPath, 0700) == -1)
         {
             perror("Error creating directory");
-            return;
+            return -1;
         }
         printf("Directory created: %s\n", logDirPath);
     }
 
     // Construct log file path
-    snprintf(logFilePath, sizeof(logFilePath), "%s%s", logDirPath, LOG_FILENAME);
+    snprintf(logFilePath, size, "%s%s", logDirPath, LOG_FILENAME);
+    return 0;
+}
+
+int start_event_logger()
+{
+    char logFilePath[BUFFER_521];
+    if (get_log_file_path(logFilePath, sizeof(logFilePath)) == -1)
+    {
+        return -1;
+    }
+    return logger_start(&event_logger, logFilePath, server_config.log_flush_interval_ms,
+                        server_config.log_fsync_policy);
+}
+
+void stop_event_logger()
+{
+    logger_stop(&event_logger);
+}
+
+void log_event(const char* message)
+{
+    // Hot path: the writer thread formats and appends the event
+    if (atomic_load(&event_logger.running))
+    {
+        logger_log(&event_logger, message);
+        return;
+    }
+
+    FILE* logFile;
+    time_t currentTime;
+    struct tm localTime;
+    char timestamp[BUFFER_256];
+    char logFilePath[BUFFER_521];
+
+    if (get_log_file_path(logFilePath, sizeof(logFilePath)) == -1)
+    {
+        return;
+    }
 
     // Open the log file in append mode
     logFile = fopen(logFilePath, "a+");
@@ -1199,10 +1830,10 @@ void log_event(const char* message)
 
     // Get current time
     currentTime = time(NULL);
-    localTime = localtime(&currentTime);
+    localtime_r(&currentTime, &localTime);
 
     // Format date and time
-    strftime(timestamp, sizeof(timestamp), "[%Y-%m-%d %H:%M:%S]", localTime);
+    strftime(timestamp, sizeof(timestamp), "[%Y-%m-%d %H:%M:%S]", &localTime);
 
     // Write timestamp and message to the log file
     fprintf(logFile, "%s %s\n", timestamp, message);
@@ -1213,9 +1844,11 @@ void log_event(const char* message)
 
 void log_event_json(cJSON* json)
 {
-    char* jsonString = cJSON_Print(json);
-    log_event(jsonString);
-    free(jsonString); // Free the allocated memory for JSON string
+    const char* jsonString = json_encode(json, NULL);
+    if (jsonString != NULL)
+    {
+        log_event(jsonString);
+    }
 }
 
 void get_tcp_client_ip(int client_fd, char* client_ip)
@@ -1231,11 +1864,15 @@ void get_tcp_client_ip(int client_fd, char* client_ip)
             struct sockaddr_in* s = (struct sockaddr_in*)&addr;
             inet_ntop(AF_INET, &s->sin_addr, ip, sizeof(ip));
         }
-        else // AF_INET6
+        else if (addr.ss_family == AF_INET6)
         {
             struct sockaddr_in6* s = (struct sockaddr_in6*)&addr;
             inet_ntop(AF_INET6, &s->sin6_addr, ip, sizeof(ip));
         }
+        else
+        {
+            strcpy(ip, "Unknown");
+        }
     }
     else
     {
@@ -1247,8 +1884,43 @@ void get_tcp_client_ip(int client_fd, char* client_ip)
     strcpy(client_ip, ip);
 }
 
+_Static_assert(TCP_PEER_ADDRESS_SIZE >= INET6_ADDRSTRLEN, "the peer of a connection must hold any IP address");
+
+const char* get_tcp_client_peer(int client_fd, char* fallback)
+{
+    TCPConnection* conn = tcp_connection_get(client_fd);
+    if (conn == NULL)
+    {
+        get_tcp_client_ip(client_fd, fallback);
+        return fallback;
+    }
+    if (conn->peer[0] == '\0')
+    {
+        // Connections opened without add_tcp_client() resolve their address once, on their first request
+        get_tcp_client_ip(client_fd, conn->peer);
+    }
+    return conn->peer;
+}
+
+// A full ring makes the sensors wait for the server, like a full FIFO blocks their write()
+static void push_alert_to_ring(const AlertRecord* record, void* arg)
+{
+    AlertRing* ring = (AlertRing*)arg;
+    const struct timespec retry = {0, ALERT_RING_RETRY_NS};
+    while (alert_ring_push(ring, record) == -1 && SERVER_RUNNING)
+    {
+        nanosleep(&retry, NULL);
+    }
+}
+
 void create_infection_alerts_process()
 {
+    // The ring must be mapped before the fork to be shared with the sensors process
+    if (server_config.alert_transport == ALERT_TRANSPORT_RING && alert_ring_create(&alert_ring) == -1)
+    {
+        exit(EXIT_FAILURE);
+    }
+
     // Create a child process for handling infection alerts
     alerts_pid = fork();
     if (alerts_pid < 0)
@@ -1260,16 +1932,42 @@ void create_infection_alerts_process()
     {
         cleanup_fifo(FIFO_PATH); // Remove the FIFO file if it already exists
         // printf("PID sensor updates: %d\n", getpid());
-        Sensor* sensors = initiateAlertModule();
+        create_alerts_fifo();
+        // The sensors draw from their own stream of the seed, independent of the other simulations
+        SensorBank sensors;
+        Prng* rng = prng_thread();
+        prng_seed(rng, (uint64_t)server_config.random_seed, PRNG_STREAM_SENSORS);
+        set_alert_probability(server_config.alert_probability);
+        uint64_t bank_seed = (uint64_t)prng_next(rng) << 32;
+        bank_seed |= prng_next(rng);
+        if (sensor_bank_init(&sensors, (size_t)server_config.sensor_count, bank_seed,
+                             server_config.alert_probability) == -1)
+        {
+            exit(EXIT_FAILURE);
+        }
+        if (alert_ring.shared != NULL)
+        {
+            set_alert_sink(push_alert_to_ring, &alert_ring);
+        }
 
+        // Absolute deadlines, so that the time spent updating the sensors does not stretch the period
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
         while (SERVER_RUNNING)
         {
-            sleep((unsigned int)30);
-            update_sensor_values(sensors, NUM_SENSORS);
-            check_temperature_threshold(sensors,
-                                        NUM_SENSORS); // writes fifo if temperature in some sensor higher than 38
+            next.tv_sec += server_config.sensor_period_ms / 1000;
+            next.tv_nsec += (long)(server_config.sensor_period_ms % 1000) * 1000000;
+            if (next.tv_nsec >= 1000000000)
+            {
+                next.tv_sec++;
+                next.tv_nsec -= 1000000000;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            sensor_bank_update(&sensors);
+            sensor_bank_check_threshold(&sensors); // sends an alert for every sensor higher than 38
         }
-        free(sensors);
+        sensor_bank_free(&sensors);
+        close_alert_fifo();
         exit(EXIT_SUCCESS);
     }
 }
@@ -1288,7 +1986,7 @@ void create_power_outage_alert_process()
         // Code for the emergency notification handling child process
         // printf("PID power outage simulator: %d\n", getpid());
         sleep(1); // Wait for the parent to create the socket
-        srand((unsigned int)time(NULL));
+        prng_seed(prng_thread(), (uint64_t)server_config.random_seed, PRNG_STREAM_POWER_OUTAGE);
         while (SERVER_RUNNING)
         {
             // sleep(20);
@@ -1304,88 +2002,151 @@ void create_power_outage_alert_process()
 
 void initialize_entry_alerts_count(EntryAlertsCount* ealerts)
 {
-    ealerts->north = 0;
-    ealerts->south = 0;
-    ealerts->east = 0;
-    ealerts->west = 0;
+    memset(ealerts->entries, 0, sizeof(ealerts->entries));
 }
 
-int get_alerts_for_entry(const char* entry)
+int get_alerts_for_entry(AlertSensor entry)
 {
-    if (strcmp(entry, "NORTH") == 0)
-    {
-        return entry_alerts_count.north;
-    }
-    else if (strcmp(entry, "SOUTH") == 0)
-    {
-        return entry_alerts_count.south;
-    }
-    else if (strcmp(entry, "EAST") == 0)
-    {
-        return entry_alerts_count.east;
-    }
-    else if (strcmp(entry, "WEST") == 0)
-    {
-        return entry_alerts_count.west;
-    }
-    else
+    if ((unsigned int)entry >= ALERT_SENSOR_COUNT)
     {
         // invalid entry
         return -1;
     }
-}
-
-const char* detect_entry(const char* alert_message)
-{
-    if (strstr(alert_message, "NORTH") != NULL)
-    {
-        return "NORTH";
-    }
-    else if (strstr(alert_message, "SOUTH") != NULL)
-    {
-        return "SOUTH";
-    }
-    else if (strstr(alert_message, "EAST") != NULL)
-    {
-        return "EAST";
-    }
-    else if (strstr(alert_message, "WEST") != NULL)
-    {
-        return "WEST";
-    }
-    else
-    {
-        return NULL; // No se encontró ninguna entrada válida en el mensaje
-    }
+    return entry_alerts_count.entries[entry];
 }
 
 cJSON* create_summary_json()
 {
     cJSON* summary = cJSON_CreateObject();
 
+    // Take a consistent snapshot of counters, supplies and emergency info
+    pthread_mutex_lock(&shelter_state_lock);
+
     cJSON* alerts = cJSON_AddObjectToObject(summary, "alerts");
-    cJSON_AddNumberToObject(alerts, "north_entry", get_alerts_for_entry("NORTH"));
-    cJSON_AddNumberToObject(alerts, "east_entry", get_alerts_for_entry("EAST"));
-    cJSON_AddNumberToObject(alerts, "west_entry", get_alerts_for_entry("WEST"));
-    cJSON_AddNumberToObject(alerts, "south_entry", get_alerts_for_entry("SOUTH"));
-
-    FoodSupply* food_supply = get_food_supply();
-    MedicineSupply* medicine_supply = get_medicine_supply();
-    cJSON* supplies = convert_supplies_to_json(food_supply, medicine_supply);
+    cJSON_AddNumberToObject(alerts, "north_entry", get_alerts_for_entry(ALERT_SENSOR_NORTH));
+    cJSON_AddNumberToObject(alerts, "east_entry", get_alerts_for_entry(ALERT_SENSOR_EAST));
+    cJSON_AddNumberToObject(alerts, "west_entry", get_alerts_for_entry(ALERT_SENSOR_WEST));
+    cJSON_AddNumberToObject(alerts, "south_entry", get_alerts_for_entry(ALERT_SENSOR_SOUTH));
+
+    FoodSupply food_supply = {0, 0, 0, 0};
+    MedicineSupply medicine_supply = {0, 0, 0};
+    get_supplies(&food_supply, &medicine_supply);
+    cJSON* supplies = convert_supplies_to_json(&food_supply, &medicine_supply);
     cJSON_AddItemToObject(summary, "supplies", supplies);
 
     // Add emergency information
     cJSON* emergency = cJSON_AddObjectToObject(summary, "emergency");
     cJSON_AddStringToObject(emergency, "last_keepalived", get_last_keepalived(&emergency_info));
     cJSON_AddStringToObject(emergency, "last_event", get_last_event(&emergency_info));
+    pthread_mutex_unlock(&shelter_state_lock);
 
     return summary;
 }
 
+cJSON* create_status_json(void)
+{
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    if (get_supplies(&food_supply, &medicine_supply) == -1)
+    {
+        printf("Error reading supplies data.\n");
+        return NULL;
+    }
+    return convert_supplies_to_json(&food_supply, &medicine_supply);
+}
+
+static void put_supplies_wire(WireWriter* writer, const FoodSupply* food, const MedicineSupply* medicine)
+{
+    wire_put_int(writer, WIRE_TAG_MEAT, food->meat);
+    wire_put_int(writer, WIRE_TAG_VEGETABLES, food->vegetables);
+    wire_put_int(writer, WIRE_TAG_FRUITS, food->fruits);
+    wire_put_int(writer, WIRE_TAG_WATER, food->water);
+    wire_put_int(writer, WIRE_TAG_ANTIBIOTICS, medicine->antibiotics);
+    wire_put_int(writer, WIRE_TAG_ANALGESICS, medicine->analgesics);
+    wire_put_int(writer, WIRE_TAG_BANDAGES, medicine->bandages);
+}
+
+size_t encode_status_wire(uint8_t* buffer, size_t size)
+{
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    if (get_supplies(&food_supply, &medicine_supply) == -1)
+    {
+        printf("Error reading supplies data.\n");
+        return 0;
+    }
+    WireWriter writer;
+    wire_writer_init(&writer, buffer, size, WIRE_MSG_SUPPLIES);
+    put_supplies_wire(&writer, &food_supply, &medicine_supply);
+    return wire_writer_finish(&writer);
+}
+
+size_t encode_summary_wire(uint8_t* buffer, size_t size)
+{
+    WireWriter writer;
+    wire_writer_init(&writer, buffer, size, WIRE_MSG_SHELTER_SUMMARY);
+
+    // Same snapshot as create_summary_json()
+    pthread_mutex_lock(&shelter_state_lock);
+    wire_put_int(&writer, WIRE_TAG_NORTH_ENTRY, get_alerts_for_entry(ALERT_SENSOR_NORTH));
+    wire_put_int(&writer, WIRE_TAG_EAST_ENTRY, get_alerts_for_entry(ALERT_SENSOR_EAST));
+    wire_put_int(&writer, WIRE_TAG_WEST_ENTRY, get_alerts_for_entry(ALERT_SENSOR_WEST));
+    wire_put_int(&writer, WIRE_TAG_SOUTH_ENTRY, get_alerts_for_entry(ALERT_SENSOR_SOUTH));
+
+    FoodSupply food_supply = {0, 0, 0, 0};
+    MedicineSupply medicine_supply = {0, 0, 0};
+    get_supplies(&food_supply, &medicine_supply);
+    put_supplies_wire(&writer, &food_supply, &medicine_supply);
+
+    wire_put_string(&writer, WIRE_TAG_LAST_KEEPALIVED, get_last_keepalived(&emergency_info));
+    wire_put_string(&writer, WIRE_TAG_LAST_EVENT, get_last_event(&emergency_info));
+    pthread_mutex_unlock(&shelter_state_lock);
+    return wire_writer_finish(&writer);
+}
+
+size_t encode_alert_wire(const AlertRecord* alert, uint8_t* buffer, size_t size)
+{
+    WireWriter writer;
+    wire_writer_init(&writer, buffer, size, WIRE_MSG_ALERT);
+    wire_put_string(&writer, WIRE_TAG_ENTRY, alert_sensor_name((AlertSensor)alert->sensor));
+    wire_put_int(&writer, WIRE_TAG_TEMPERATURE, alert->temperature);
+    wire_put_int(&writer, WIRE_TAG_TIMESTAMP, alert->timestamp);
+    return wire_writer_finish(&writer);
+}
+
+uint64_t get_status_version(void)
+{
+    return supplies_version(supplies_default_handle());
+}
+
+uint64_t get_summary_version(void)
+{
+    // Both counters only grow, so their sum changes whenever either does
+    return get_status_version() + atomic_load(&shelter_state_version);
+}
+
+cJSON* create_stats_json(void)
+{
+    TCPOutputStats stats;
+    tcp_connection_get_stats(&stats);
+
+    cJSON* stats_json = cJSON_CreateObject();
+    cJSON* output = cJSON_AddObjectToObject(stats_json, "tcp_output");
+    cJSON_AddNumberToObject(output, "queued_bytes", (double)stats.queued_bytes);
+    cJSON_AddNumberToObject(output, "dropped_messages", (double)stats.dropped_messages);
+    cJSON_AddNumberToObject(output, "coalesced_messages", (double)stats.coalesced_messages);
+    cJSON_AddNumberToObject(output, "slow_consumer_disconnects", (double)stats.slow_consumer_disconnects);
+    cJSON_AddStringToObject(output, "policy", tcp_connection_policy_name(server_config.slow_consumer_policy));
+    return stats_json;
+}
+
 void update_emergency_info(const char* keepalived, const char* event, EmergencyInfo* emergency_info)
 {
+    pthread_mutex_lock(&shelter_state_lock);
     strncpy(emergency_info->last_keepalived, keepalived, sizeof(emergency_info->last_keepalived));
     strncpy(emergency_info->last_event, event, sizeof(emergency_info->last_event));
+    atomic_fetch_add(&shelter_state_version, 1);
+    pthread_mutex_unlock(&shelter_state_lock);
 }
 
 const char* get_last_keepalived(EmergencyInfo* emergency_info)
@@ -0,0 +1,817 @@
+#include "tcp_connection.h"
+
+/*Connections indexed by file descriptor, in lazily allocated chunks so that lookups never race with a resize. The
+directory of chunks covers every descriptor RLIMIT_NOFILE allows*/
+typedef _Atomic(TCPConnection*) ConnectionSlot;
+typedef _Atomic(ConnectionSlot*) ConnectionChunk;
+static ConnectionChunk* _Atomic connection_chunks;
+static size_t num_connection_chunks;
+
+/*Connection records, carved from slabs and recycled through a free list, and the open ones packed for iteration*/
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static TCPConnection* free_connections;
+static TCPConnection** open_connections;
+static size_t num_open_connections;
+static size_t open_connections_capacity;
+
+/*Connections subscribed to each topic, also protected by registry_lock*/
+static AlertTopicList topic_subscribers[ALERT_TOPIC_COUNT];
+
+/*Output queue configuration and counters, shared by every connection*/
+static SlowConsumerPolicy output_policy = SLOW_CONSUMER_DROP_OLDEST;
+static size_t output_limit = OUTPUT_QUEUE_DEFAULT_LIMIT;
+static atomic_ullong queued_bytes;
+static atomic_ullong dropped_messages;
+static atomic_ullong coalesced_messages;
+static atomic_ullong slow_consumer_disconnects;
+
+// Allocates the directory of chunks, sized for the highest descriptor the process may open. Called with registry_lock
+static ConnectionChunk* create_directory(void)
+{
+    struct rlimit limit;
+    rlim_t max_fds = CONNECTION_DEFAULT_MAX_FDS;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        // The soft limit can be raised up to the hard one, which only privileged processes can raise
+        max_fds = limit.rlim_max != RLIM_INFINITY ? limit.rlim_max : limit.rlim_cur;
+        if (max_fds == RLIM_INFINITY)
+        {
+            max_fds = CONNECTION_DEFAULT_MAX_FDS;
+        }
+    }
+
+    size_t num_chunks = (size_t)(max_fds + CONNECTION_CHUNK_SIZE - 1) / CONNECTION_CHUNK_SIZE;
+    ConnectionChunk* directory = calloc(num_chunks, sizeof(ConnectionChunk));
+    if (directory == NULL)
+    {
+        perror("calloc connection directory");
+        return NULL;
+    }
+    num_connection_chunks = num_chunks;
+    atomic_store(&connection_chunks, directory);
+    return directory;
+}
+
+static ConnectionSlot* get_slot(int fd, int create)
+{
+    ConnectionChunk* directory = atomic_load(&connection_chunks);
+    if (directory == NULL && create)
+    {
+        pthread_mutex_lock(&registry_lock);
+        directory = atomic_load(&connection_chunks);
+        if (directory == NULL)
+        {
+            directory = create_directory();
+        }
+        pthread_mutex_unlock(&registry_lock);
+    }
+    if (directory == NULL || fd < 0 || (size_t)fd / CONNECTION_CHUNK_SIZE >= num_connection_chunks)
+    {
+        return NULL;
+    }
+
+    size_t chunk_index = (size_t)fd / CONNECTION_CHUNK_SIZE;
+    ConnectionSlot* chunk = atomic_load(&directory[chunk_index]);
+    if (chunk == NULL && create)
+    {
+        pthread_mutex_lock(&registry_lock);
+        chunk = atomic_load(&directory[chunk_index]);
+        if (chunk == NULL)
+        {
+            chunk = calloc(CONNECTION_CHUNK_SIZE, sizeof(ConnectionSlot));
+            atomic_store(&directory[chunk_index], chunk);
+        }
+        pthread_mutex_unlock(&registry_lock);
+    }
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+    return &chunk[(size_t)fd % CONNECTION_CHUNK_SIZE];
+}
+
+// Takes a record from the free list, carving a new slab when it is empty. Called with registry_lock
+static TCPConnection* take_record(void)
+{
+    if (free_connections == NULL)
+    {
+        TCPConnection* slab = calloc(CONNECTION_SLAB_SIZE, sizeof(TCPConnection));
+        if (slab == NULL)
+        {
+            perror("calloc connection slab");
+            return NULL;
+        }
+        for (size_t i = 0; i < CONNECTION_SLAB_SIZE; i++)
+        {
+            slab[i].next_free = i + 1 < CONNECTION_SLAB_SIZE ? &slab[i + 1] : NULL;
+        }
+        free_connections = slab;
+    }
+    TCPConnection* conn = free_connections;
+    free_connections = conn->next_free;
+    return conn;
+}
+
+// Adds a record to the open connections, growing the array if needed. Called with registry_lock
+static int register_open(TCPConnection* conn)
+{
+    if (num_open_connections == open_connections_capacity)
+    {
+        size_t capacity = open_connections_capacity > 0 ? open_connections_capacity * 2 : CONNECTION_SLAB_SIZE;
+        TCPConnection** connections = realloc(open_connections, sizeof(TCPConnection*) * capacity);
+        if (connections == NULL)
+        {
+            perror("realloc open connections");
+            return -1;
+        }
+        open_connections = connections;
+        open_connections_capacity = capacity;
+    }
+    conn->registry_index = num_open_connections;
+    open_connections[num_open_connections++] = conn;
+    return 0;
+}
+
+// Removes a record from the open connections by moving the last one into its place. Called with registry_lock
+static void unregister_open(TCPConnection* conn)
+{
+    TCPConnection* last = open_connections[--num_open_connections];
+    open_connections[conn->registry_index] = last;
+    last->registry_index = conn->registry_index;
+}
+
+// Makes the subscriptions of a connection match the topics, leaving out those that did not fit. Called with
+// registry_lock
+static int set_topics(TCPConnection* conn, uint32_t topics)
+{
+    int result = 0;
+    for (int topic = 0; topic < ALERT_TOPIC_COUNT; topic++)
+    {
+        uint32_t bit = ALERT_TOPIC_BIT(topic);
+        AlertTopicList* list = &topic_subscribers[topic];
+        if ((topics & bit) && !(conn->topics & bit))
+        {
+            long index = alert_topic_list_add(list, &conn, sizeof(TCPConnection*));
+            if (index == -1)
+            {
+                result = -1;
+                continue;
+            }
+            conn->topic_index[topic] = (size_t)index;
+            conn->topics |= bit;
+        }
+        else if (!(topics & bit) && (conn->topics & bit))
+        {
+            if (alert_topic_list_remove(list, conn->topic_index[topic], sizeof(TCPConnection*)))
+            {
+                TCPConnection* moved = *(TCPConnection**)alert_topic_list_at(list, conn->topic_index[topic],
+                                                                              sizeof(TCPConnection*));
+                moved->topic_index[topic] = conn->topic_index[topic];
+            }
+            conn->topics &= ~bit;
+        }
+    }
+    return result;
+}
+
+// Move the unconsumed bytes to the front and make room for at least 'needed' more bytes
+static int reserve_input(TCPConnection* conn, size_t needed)
+{
+    if (conn->frame_start > 0)
+    {
+        size_t pending = conn->input_len - conn->frame_start;
+        memmove(conn->input, conn->input + conn->frame_start, pending);
+        conn->input_len = pending;
+        conn->scan_offset -= conn->frame_start;
+        conn->frame_start = 0;
+    }
+
+    if (conn->input_capacity - conn->input_len >= needed)
+    {
+        return 0;
+    }
+
+    size_t new_capacity = conn->input_capacity > 0 ? conn->input_capacity : INPUT_BUFFER_INITIAL;
+    while (new_capacity - conn->input_len < needed)
+    {
+        new_capacity *= 2;
+    }
+    char* input = realloc(conn->input, new_capacity);
+    if (input == NULL)
+    {
+        perror("realloc input buffer");
+        return -1;
+    }
+    conn->input = input;
+    conn->input_capacity = new_capacity;
+    return 0;
+}
+
+static void reset_scanner(TCPConnection* conn)
+{
+    conn->scan_offset = conn->frame_start;
+    conn->depth = 0;
+    conn->in_string = 0;
+    conn->escaped = 0;
+}
+
+static int next_length_prefixed_frame(TCPConnection* conn, const char** frame, size_t* frame_len)
+{
+    size_t available = conn->input_len - conn->frame_start;
+    if (available < FRAME_LENGTH_HEADER)
+    {
+        return 0;
+    }
+
+    const unsigned char* header = (const unsigned char*)conn->input + conn->frame_start;
+    uint32_t payload_len = ((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) |
+                           (uint32_t)header[3];
+    if (payload_len > MAX_FRAME_SIZE)
+    {
+        return -1;
+    }
+    if (available < FRAME_LENGTH_HEADER + payload_len)
+    {
+        return 0;
+    }
+
+    *frame = conn->input + conn->frame_start + FRAME_LENGTH_HEADER;
+    *frame_len = payload_len;
+    conn->frame_start += FRAME_LENGTH_HEADER + payload_len;
+    reset_scanner(conn);
+    return 1;
+}
+
+static int next_delimited_frame(TCPConnection* conn, const char** frame, size_t* frame_len)
+{
+    // Skip the separators between two frames
+    if (conn->depth == 0 && !conn->in_string)
+    {
+        while (conn->frame_start < conn->input_len &&
+               (conn->input[conn->frame_start] == '\n' || conn->input[conn->frame_start] == '\r' ||
+                conn->input[conn->frame_start] == ' ' || conn->input[conn->frame_start] == '\t'))
+        {
+            conn->frame_start++;
+        }
+        if (conn->scan_offset < conn->frame_start)
+        {
+            conn->scan_offset = conn->frame_start;
+        }
+    }
+
+    // Resume the scan where the previous call stopped, so every byte is only looked at once
+    for (size_t i = conn->scan_offset; i < conn->input_len; i++)
+    {
+        char c = conn->input[i];
+        if (conn->in_string)
+        {
+            if (conn->escaped)
+            {
+                conn->escaped = 0;
+            }
+            else if (c == '\\')
+            {
+                conn->escaped = 1;
+            }
+            else if (c == '"')
+            {
+                conn->in_string = 0;
+            }
+            continue;
+        }
+
+        size_t frame_end = 0;
+        size_t next_start = 0;
+        if (c == '"')
+        {
+            conn->in_string = 1;
+        }
+        else if (c == '{' || c == '[')
+        {
+            conn->depth++;
+        }
+        else if (c == '}' || c == ']')
+        {
+            if (conn->depth > 0)
+            {
+                conn->depth--;
+            }
+            if (conn->depth == 0)
+            {
+                frame_end = i + 1;
+                next_start = i + 1;
+            }
+        }
+        else if (c == '\n' && conn->depth == 0)
+        {
+            // A line that is not a JSON object: hand it over so that it is reported as invalid
+            frame_end = i;
+            next_start = i + 1;
+        }
+
+        if (next_start != 0)
+        {
+            *frame = conn->input + conn->frame_start;
+            *frame_len = frame_end - conn->frame_start;
+            conn->frame_start = next_start;
+            reset_scanner(conn);
+            return 1;
+        }
+    }
+
+    conn->scan_offset = conn->input_len;
+    if (conn->input_len - conn->frame_start > MAX_FRAME_SIZE)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static size_t framed_len(const PendingResponse* message)
+{
+    return message->header_len + message->payload_len + message->trailer_len;
+}
+
+// Takes a buffer of at least 'len' bytes, recycled from a sent message when one is large enough
+static char* take_buffer(TCPConnection* conn, size_t len, size_t* capacity)
+{
+    for (size_t i = conn->spare_count; i > 0; i--)
+    {
+        if (conn->spare_capacity[i - 1] >= len)
+        {
+            char* buffer = conn->spare[i - 1];
+            *capacity = conn->spare_capacity[i - 1];
+            conn->spare_count--;
+            conn->spare[i - 1] = conn->spare[conn->spare_count];
+            conn->spare_capacity[i - 1] = conn->spare_capacity[conn->spare_count];
+            return buffer;
+        }
+    }
+
+    *capacity = len < OUTPUT_BUFFER_MIN ? OUTPUT_BUFFER_MIN : len;
+    char* buffer = malloc(*capacity);
+    if (buffer == NULL)
+    {
+        perror("malloc message");
+    }
+    return buffer;
+}
+
+// Keeps the buffer of a released message for the next ones, unless the pool is full or the buffer is oversized
+static void give_back_buffer(TCPConnection* conn, char* buffer, size_t capacity)
+{
+    if (conn->spare_count < OUTPUT_SPARE_BUFFERS && capacity <= OUTPUT_SPARE_MAX_CAPACITY)
+    {
+        conn->spare[conn->spare_count] = buffer;
+        conn->spare_capacity[conn->spare_count] = capacity;
+        conn->spare_count++;
+        return;
+    }
+    free(buffer);
+}
+
+// Remove the message at position 'index' of the queue (0 is the oldest), keeping the order of the others
+static void remove_queued(TCPConnection* conn, size_t index)
+{
+    PendingResponse* message = &conn->out[(conn->out_head + index) % OUTPUT_QUEUE_SLOTS];
+    size_t remaining = framed_len(message) - message->sent;
+    conn->out_bytes -= remaining;
+    atomic_fetch_sub(&queued_bytes, remaining);
+    give_back_buffer(conn, message->payload, message->payload_capacity);
+
+    if (index == 0)
+    {
+        conn->out_head = (conn->out_head + 1) % OUTPUT_QUEUE_SLOTS;
+    }
+    else
+    {
+        for (size_t i = index; i + 1 < conn->out_count; i++)
+        {
+            conn->out[(conn->out_head + i) % OUTPUT_QUEUE_SLOTS] =
+                conn->out[(conn->out_head + i + 1) % OUTPUT_QUEUE_SLOTS];
+        }
+    }
+    conn->out_count--;
+}
+
+// Apply the slow consumer policy until 'needed' more bytes fit. Returns 0 if they fit, -1 otherwise
+static int make_room(TCPConnection* conn, size_t needed, int kind)
+{
+    while (conn->out_count > 0 && (conn->out_count == OUTPUT_QUEUE_SLOTS || conn->out_bytes + needed > output_limit))
+    {
+        // A message that started to be sent must be completed, or the stream would be corrupted
+        size_t first_evictable = conn->out[conn->out_head].sent > 0 ? 1 : 0;
+        size_t victim = conn->out_count;
+
+        if (output_policy == SLOW_CONSUMER_DROP_OLDEST)
+        {
+            if (first_evictable < conn->out_count)
+            {
+                victim = first_evictable;
+                atomic_fetch_add(&dropped_messages, 1);
+            }
+        }
+        else if (output_policy == SLOW_CONSUMER_COALESCE)
+        {
+            // Only a message of the same kind is superseded: other alerts and other replies are kept
+            for (size_t i = first_evictable; kind != TCP_MESSAGE_RESPONSE && i < conn->out_count; i++)
+            {
+                if (conn->out[(conn->out_head + i) % OUTPUT_QUEUE_SLOTS].kind == kind)
+                {
+                    victim = i;
+                    atomic_fetch_add(&coalesced_messages, 1);
+                    break;
+                }
+            }
+        }
+        else if (atomic_exchange(&conn->overflowed, 1) == 0)
+        {
+            atomic_fetch_add(&slow_consumer_disconnects, 1);
+        }
+
+        if (victim == conn->out_count)
+        {
+            return -1;
+        }
+        remove_queued(conn, victim);
+    }
+    return 0;
+}
+
+// Releases the buffers of a connection and returns its record to the free list
+static void free_connection(TCPConnection* conn)
+{
+    while (conn->out_count > 0)
+    {
+        remove_queued(conn, 0);
+    }
+    while (conn->spare_count > 0)
+    {
+        free(conn->spare[--conn->spare_count]);
+    }
+    pthread_mutex_destroy(&conn->out_lock);
+    free(conn->input);
+
+    pthread_mutex_lock(&registry_lock);
+    set_topics(conn, 0);
+    unregister_open(conn);
+    conn->next_free = free_connections;
+    free_connections = conn;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+TCPConnection* tcp_connection_open(int fd)
+{
+    ConnectionSlot* slot = get_slot(fd, 1);
+    if (slot == NULL)
+    {
+        fprintf(stderr, "No connection slot for descriptor %d\n", fd);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    TCPConnection* conn = take_record();
+    if (conn == NULL)
+    {
+        pthread_mutex_unlock(&registry_lock);
+        return NULL;
+    }
+    memset(conn, 0, sizeof(TCPConnection));
+    conn->fd = fd;
+    atomic_init(&conn->owner, -1);
+    atomic_init(&conn->framing, FRAMING_PENDING);
+    atomic_init(&conn->overflowed, 0);
+    pthread_mutex_init(&conn->out_lock, NULL);
+    // Clients receive every notification until they subscribe
+    int opened = register_open(conn);
+    if (opened == 0 && set_topics(conn, ALERT_TOPICS_ALL) == -1)
+    {
+        set_topics(conn, 0);
+        unregister_open(conn);
+        opened = -1;
+    }
+    if (opened == -1)
+    {
+        pthread_mutex_destroy(&conn->out_lock);
+        conn->next_free = free_connections;
+        free_connections = conn;
+        pthread_mutex_unlock(&registry_lock);
+        return NULL;
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    // A stale entry means the descriptor was closed without releasing its state
+    TCPConnection* previous = atomic_exchange(slot, conn);
+    if (previous != NULL)
+    {
+        free_connection(previous);
+    }
+    return conn;
+}
+
+TCPConnection* tcp_connection_get(int fd)
+{
+    ConnectionSlot* slot = get_slot(fd, 0);
+    if (slot == NULL)
+    {
+        return NULL;
+    }
+    return atomic_load(slot);
+}
+
+void tcp_connection_close(int fd)
+{
+    ConnectionSlot* slot = get_slot(fd, 0);
+    if (slot == NULL)
+    {
+        return;
+    }
+    TCPConnection* conn = atomic_exchange(slot, NULL);
+    if (conn != NULL)
+    {
+        free_connection(conn);
+    }
+}
+
+size_t tcp_connection_count(void)
+{
+    pthread_mutex_lock(&registry_lock);
+    size_t count = num_open_connections;
+    pthread_mutex_unlock(&registry_lock);
+    return count;
+}
+
+void tcp_connection_for_each(void (*visit)(TCPConnection* conn, void* arg), void* arg)
+{
+    pthread_mutex_lock(&registry_lock);
+    for (size_t i = 0; i < num_open_connections; i++)
+    {
+        visit(open_connections[i], arg);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+int tcp_connection_subscribe(TCPConnection* conn, uint32_t topics)
+{
+    pthread_mutex_lock(&registry_lock);
+    int result = set_topics(conn, topics & ALERT_TOPICS_ALL);
+    pthread_mutex_unlock(&registry_lock);
+    return result;
+}
+
+void tcp_connection_for_each_subscriber(AlertTopic topic, void (*visit)(TCPConnection* conn, void* arg), void* arg)
+{
+    pthread_mutex_lock(&registry_lock);
+    AlertTopicList* list = &topic_subscribers[topic];
+    for (size_t i = 0; i < list->count; i++)
+    {
+        visit(*(TCPConnection**)alert_topic_list_at(list, i, sizeof(TCPConnection*)), arg);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+ssize_t tcp_connection_read(TCPConnection* conn)
+{
+    if (reserve_input(conn, BUFFER_READ_SIZE) == -1)
+    {
+        return -1;
+    }
+
+    ssize_t bytes_received = recv(conn->fd, conn->input + conn->input_len, conn->input_capacity - conn->input_len, 0);
+    if (bytes_received > 0)
+    {
+        conn->input_len += (size_t)bytes_received;
+        conn->bytes_received += (uint64_t)bytes_received;
+    }
+    else if (bytes_received == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        perror("recv");
+    }
+    return bytes_received;
+}
+
+int tcp_connection_append(TCPConnection* conn, const char* data, size_t len)
+{
+    if (reserve_input(conn, len) == -1)
+    {
+        return -1;
+    }
+    memcpy(conn->input + conn->input_len, data, len);
+    conn->input_len += len;
+    return 0;
+}
+
+int tcp_connection_next_frame(TCPConnection* conn, const char** frame, size_t* frame_len)
+{
+    int framing = atomic_load(&conn->framing);
+    if (framing == FRAMING_PENDING)
+    {
+        if (conn->frame_start >= conn->input_len)
+        {
+            return 0;
+        }
+        // The first byte decides the framing: the magic bytes cannot start a JSON text
+        unsigned char first = (unsigned char)conn->input[conn->frame_start];
+        if (first == FRAMING_LENGTH_PREFIX_MAGIC || first == WIRE_MAGIC)
+        {
+            framing = first == WIRE_MAGIC ? FRAMING_BINARY : FRAMING_LENGTH_PREFIXED;
+            conn->frame_start++;
+            reset_scanner(conn);
+        }
+        else
+        {
+            framing = FRAMING_DELIMITED;
+        }
+        atomic_store(&conn->framing, framing);
+    }
+
+    int result = framing == FRAMING_DELIMITED ? next_delimited_frame(conn, frame, frame_len)
+                                              : next_length_prefixed_frame(conn, frame, frame_len);
+    if (result == 1)
+    {
+        conn->frames_received++;
+    }
+    return result;
+}
+
+void tcp_frame_response(int framing, size_t payload_len, unsigned char* header, size_t* header_len,
+                        const char** trailer, size_t* trailer_len)
+{
+    if (framing == FRAMING_LENGTH_PREFIXED || framing == FRAMING_BINARY)
+    {
+        uint32_t len = (uint32_t)payload_len;
+        header[0] = (unsigned char)(len >> 24);
+        header[1] = (unsigned char)(len >> 16);
+        header[2] = (unsigned char)(len >> 8);
+        header[3] = (unsigned char)len;
+        *header_len = FRAME_LENGTH_HEADER;
+        *trailer = "";
+        *trailer_len = 0;
+    }
+    else
+    {
+        *header_len = 0;
+        *trailer = "\n";
+        *trailer_len = 1;
+    }
+}
+
+void tcp_connection_set_output_policy(SlowConsumerPolicy policy, size_t limit)
+{
+    output_policy = policy;
+    output_limit = limit;
+}
+
+int tcp_connection_parse_policy(const char* name, SlowConsumerPolicy* policy)
+{
+    if (strcmp(name, "drop-oldest") == 0)
+    {
+        *policy = SLOW_CONSUMER_DROP_OLDEST;
+        return 0;
+    }
+    if (strcmp(name, "disconnect") == 0)
+    {
+        *policy = SLOW_CONSUMER_DISCONNECT;
+        return 0;
+    }
+    if (strcmp(name, "coalesce") == 0)
+    {
+        *policy = SLOW_CONSUMER_COALESCE;
+        return 0;
+    }
+    return -1;
+}
+
+const char* tcp_connection_policy_name(SlowConsumerPolicy policy)
+{
+    switch (policy)
+    {
+    case SLOW_CONSUMER_DISCONNECT:
+        return "disconnect";
+    case SLOW_CONSUMER_COALESCE:
+        return "coalesce";
+    default:
+        return "drop-oldest";
+    }
+}
+
+int tcp_connection_queue(TCPConnection* conn, const char* payload, size_t payload_len, int kind)
+{
+    PendingResponse message;
+    message.payload_len = payload_len;
+    message.sent = 0;
+    message.kind = kind;
+    tcp_frame_response(atomic_load(&conn->framing), payload_len, message.header, &message.header_len,
+                       &message.trailer, &message.trailer_len);
+    size_t len = framed_len(&message);
+
+    pthread_mutex_lock(&conn->out_lock);
+    if (make_room(conn, len, kind) == -1)
+    {
+        pthread_mutex_unlock(&conn->out_lock);
+        atomic_fetch_add(&dropped_messages, 1);
+        return -1;
+    }
+    message.payload = take_buffer(conn, payload_len, &message.payload_capacity);
+    if (message.payload == NULL)
+    {
+        pthread_mutex_unlock(&conn->out_lock);
+        return -1;
+    }
+    memcpy(message.payload, payload, payload_len);
+    conn->out[(conn->out_head + conn->out_count) % OUTPUT_QUEUE_SLOTS] = message;
+    conn->out_count++;
+    conn->out_bytes += len;
+    atomic_fetch_add(&queued_bytes, len);
+    pthread_mutex_unlock(&conn->out_lock);
+    return 0;
+}
+
+ssize_t tcp_connection_flush(TCPConnection* conn)
+{
+    struct iovec iov[OUTPUT_MAX_IOV];
+    ssize_t total = 0;
+
+    pthread_mutex_lock(&conn->out_lock);
+    while (conn->out_count > 0)
+    {
+        // Unsent parts of header, payload and trailer of as many messages as fit in one write
+        int iovcnt = 0;
+        for (size_t i = 0; i < conn->out_count && iovcnt + 3 <= OUTPUT_MAX_IOV; i++)
+        {
+            PendingResponse* message = &conn->out[(conn->out_head + i) % OUTPUT_QUEUE_SLOTS];
+            char* parts[3] = {(char*)message->header, message->payload, (char*)message->trailer};
+            size_t lens[3] = {message->header_len, message->payload_len, message->trailer_len};
+            size_t skip = message->sent;
+            for (int part = 0; part < 3; part++)
+            {
+                if (skip >= lens[part])
+                {
+                    skip -= lens[part];
+                    continue;
+                }
+                iov[iovcnt].iov_base = parts[part] + skip;
+                iov[iovcnt++].iov_len = lens[part] - skip;
+                skip = 0;
+            }
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+        ssize_t written = sendmsg(conn->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                total = -1;
+            }
+            break;
+        }
+        total += written;
+        conn->bytes_sent += (uint64_t)written;
+
+        // Release the messages written completely and remember how far the last one went
+        size_t remaining = (size_t)written;
+        while (remaining > 0)
+        {
+            PendingResponse* message = &conn->out[conn->out_head];
+            size_t unsent = framed_len(message) - message->sent;
+            if (remaining < unsent)
+            {
+                message->sent += remaining;
+                conn->out_bytes -= remaining;
+                atomic_fetch_sub(&queued_bytes, remaining);
+                remaining = 0;
+            }
+            else
+            {
+                remaining -= unsent;
+                remove_queued(conn, 0);
+            }
+        }
+    }
+    pthread_mutex_unlock(&conn->out_lock);
+    return total;
+}
+
+int tcp_connection_has_output(TCPConnection* conn)
+{
+    pthread_mutex_lock(&conn->out_lock);
+    int has_output = conn->out_count > 0;
+    pthread_mutex_unlock(&conn->out_lock);
+    return has_output;
+}
+
+void tcp_connection_get_stats(TCPOutputStats* stats)
+{
+    stats->queued_bytes = atomic_load(&queued_bytes);
+    stats->dropped_messages = atomic_load(&dropped_messages);
+    stats->coalesced_messages = atomic_load(&coalesced_messages);
+    stats->slow_consumer_disconnects = atomic_load(&slow_consumer_disconnects);
+}
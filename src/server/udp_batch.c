@@ -0,0 +1,135 @@
+#include "udp_batch.h"
+
+UDPBatch* udp_batch_create(void)
+{
+    UDPBatch* batch = calloc(1, sizeof(UDPBatch));
+    if (batch == NULL)
+    {
+        perror("calloc UDP batch");
+        return NULL;
+    }
+
+    // The receive headers always point at the same buffers, only their lengths are reset before each call
+    for (int i = 0; i < UDP_BATCH_SIZE; i++)
+    {
+        batch->iovecs[i].iov_base = batch->buffers[i];
+        batch->iovecs[i].iov_len = UDP_DATAGRAM_SIZE - 1;
+        batch->messages[i].msg_hdr.msg_iov = &batch->iovecs[i];
+        batch->messages[i].msg_hdr.msg_iovlen = 1;
+        batch->messages[i].msg_hdr.msg_name = &batch->addresses[i];
+
+        batch->replies[i].msg_hdr.msg_iov = &batch->reply_iovecs[i];
+        batch->replies[i].msg_hdr.msg_iovlen = 1;
+        batch->replies[i].msg_hdr.msg_name = &batch->reply_addresses[i];
+    }
+    return batch;
+}
+
+void udp_batch_destroy(UDPBatch* batch)
+{
+    if (batch == NULL)
+    {
+        return;
+    }
+    free(batch->reply_data);
+    free(batch);
+}
+
+int udp_batch_receive(UDPBatch* batch, int sockfd)
+{
+    batch->num_received = 0;
+    for (int i = 0; i < UDP_BATCH_SIZE; i++)
+    {
+        batch->messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        batch->messages[i].msg_hdr.msg_flags = 0;
+    }
+
+    int received;
+    do
+    {
+        received = recvmmsg(sockfd, batch->messages, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    } while (received == -1 && errno == EINTR);
+    if (received == -1)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        }
+        perror("recvmmsg");
+        return -1;
+    }
+
+    for (int i = 0; i < received; i++)
+    {
+        batch->buffers[i][batch->messages[i].msg_len] = '\0';
+    }
+    batch->num_received = (unsigned int)received;
+    return received;
+}
+
+int udp_batch_queue_reply(UDPBatch* batch, const struct sockaddr* address, socklen_t address_len, const char* data,
+                          size_t len)
+{
+    if (batch->num_replies == UDP_BATCH_SIZE || address_len > sizeof(struct sockaddr_storage))
+    {
+        return -1;
+    }
+    if (batch->reply_len + len > batch->reply_capacity)
+    {
+        size_t capacity = batch->reply_capacity > 0 ? batch->reply_capacity : UDP_REPLY_MIN_CAPACITY;
+        while (capacity < batch->reply_len + len)
+        {
+            capacity *= 2;
+        }
+        char* reply_data = realloc(batch->reply_data, capacity);
+        if (reply_data == NULL)
+        {
+            perror("realloc UDP replies");
+            return -1;
+        }
+        batch->reply_data = reply_data;
+        batch->reply_capacity = capacity;
+    }
+
+    unsigned int index = batch->num_replies++;
+    memcpy(batch->reply_data + batch->reply_len, data, len);
+    memcpy(&batch->reply_addresses[index], address, address_len);
+    batch->replies[index].msg_hdr.msg_namelen = address_len;
+    batch->reply_offsets[index] = batch->reply_len;
+    batch->reply_iovecs[index].iov_len = len;
+    batch->reply_len += len;
+    return 0;
+}
+
+int udp_batch_flush(UDPBatch* batch, int sockfd)
+{
+    // reply_data may have moved while replies were queued, so the iovecs are only filled now
+    for (unsigned int i = 0; i < batch->num_replies; i++)
+    {
+        batch->reply_iovecs[i].iov_base = batch->reply_data + batch->reply_offsets[i];
+    }
+
+    unsigned int sent = 0;
+    unsigned int next = 0;
+    while (next < batch->num_replies)
+    {
+        int result = sendmmsg(sockfd, batch->replies + next, batch->num_replies - next, 0);
+        if (result == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // The first remaining reply failed: skip it and keep sending the others
+            perror("sendmmsg");
+            next++;
+            continue;
+        }
+        sent += (unsigned int)result;
+        next += (unsigned int)result;
+    }
+
+    batch->num_replies = 0;
+    batch->reply_len = 0;
+    return (int)sent;
+}
@@ -0,0 +1,270 @@
+#include "udp_registry.h"
+
+_Static_assert((UDP_REGISTRY_MIN_CAPACITY & (UDP_REGISTRY_MIN_CAPACITY - 1)) == 0,
+               "registry capacity must be a power of two");
+
+// Mixes the bits of a word (finalizer of splitmix64)
+static uint64_t mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+static uint64_t hash_key(const UDPClientKey* key)
+{
+    uint64_t high;
+    uint64_t low;
+    memcpy(&high, key->address, sizeof(high));
+    memcpy(&low, key->address + sizeof(high), sizeof(low));
+    uint64_t tail = ((uint64_t)key->scope_id << 32) | ((uint64_t)key->port << 16) | key->family;
+    return mix(high ^ mix(low ^ mix(tail)));
+}
+
+int udp_client_key(const struct sockaddr* address, socklen_t addr_len, UDPClientKey* key)
+{
+    memset(key, 0, sizeof(UDPClientKey));
+    if (address->sa_family == AF_INET && addr_len >= sizeof(struct sockaddr_in))
+    {
+        const struct sockaddr_in* ipv4 = (const struct sockaddr_in*)address;
+        memcpy(key->address, &ipv4->sin_addr, sizeof(ipv4->sin_addr));
+        key->port = ipv4->sin_port;
+    }
+    else if (address->sa_family == AF_INET6 && addr_len >= sizeof(struct sockaddr_in6))
+    {
+        const struct sockaddr_in6* ipv6 = (const struct sockaddr_in6*)address;
+        memcpy(key->address, &ipv6->sin6_addr, sizeof(ipv6->sin6_addr));
+        key->scope_id = ipv6->sin6_scope_id;
+        key->port = ipv6->sin6_port;
+    }
+    else
+    {
+        return -1;
+    }
+    key->family = address->sa_family;
+    return 0;
+}
+
+// Returns the slot holding the key, or the empty slot that ends its probe sequence
+static UDPClientEntry* probe(UDPClientRegistry* registry, const UDPClientKey* key, uint64_t hash)
+{
+    size_t mask = registry->capacity - 1;
+    for (size_t index = (size_t)hash & mask;; index = (index + 1) & mask)
+    {
+        UDPClientEntry* slot = &registry->slots[index];
+        if (!slot->used || (slot->hash == hash && memcmp(&slot->key, key, sizeof(UDPClientKey)) == 0))
+        {
+            return slot;
+        }
+    }
+}
+
+static int resize(UDPClientRegistry* registry, size_t capacity)
+{
+    UDPClientEntry* slots = calloc(capacity, sizeof(UDPClientEntry));
+    if (slots == NULL)
+    {
+        perror("calloc UDP registry");
+        return -1;
+    }
+
+    UDPClientEntry* old_slots = registry->slots;
+    size_t old_capacity = registry->capacity;
+    registry->slots = slots;
+    registry->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old_slots[i].used)
+        {
+            *probe(registry, &old_slots[i].key, old_slots[i].hash) = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return 0;
+}
+
+static void remove_slot(UDPClientRegistry* registry, size_t hole);
+
+// Makes the subscriptions of an entry match the topics, leaving out those that did not fit
+static int set_topics(UDPClientRegistry* registry, UDPClientEntry* entry, uint32_t topics)
+{
+    int result = 0;
+    for (int topic = 0; topic < ALERT_TOPIC_COUNT; topic++)
+    {
+        uint32_t bit = ALERT_TOPIC_BIT(topic);
+        AlertTopicList* list = &registry->topics[topic];
+        if ((topics & bit) && !(entry->topics & bit))
+        {
+            long index = alert_topic_list_add(list, &entry->key, sizeof(UDPClientKey));
+            if (index == -1)
+            {
+                result = -1;
+                continue;
+            }
+            entry->topic_index[topic] = (uint32_t)index;
+            entry->topics |= bit;
+        }
+        else if (!(topics & bit) && (entry->topics & bit))
+        {
+            size_t index = entry->topic_index[topic];
+            if (alert_topic_list_remove(list, index, sizeof(UDPClientKey)))
+            {
+                const UDPClientKey* moved = alert_topic_list_at(list, index, sizeof(UDPClientKey));
+                probe(registry, moved, hash_key(moved))->topic_index[topic] = (uint32_t)index;
+            }
+            entry->topics &= ~bit;
+        }
+    }
+    return result;
+}
+
+int udp_registry_touch(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len, int sockfd,
+                       time_t now)
+{
+    UDPClientKey key;
+    if (udp_client_key(address, addr_len, &key) == -1)
+    {
+        return -1;
+    }
+    uint64_t hash = hash_key(&key);
+
+    if (registry->capacity > 0)
+    {
+        UDPClientEntry* slot = probe(registry, &key, hash);
+        if (slot->used)
+        {
+            slot->sockfd = sockfd;
+            slot->last_seen = now;
+            return 0;
+        }
+    }
+    if (registry->count >= registry->max_clients)
+    {
+        return -1;
+    }
+
+    // Keep the load factor under 3/4 so that probe sequences stay short
+    if ((registry->count + 1) * 4 > registry->capacity * 3 &&
+        resize(registry, registry->capacity > 0 ? registry->capacity * 2 : UDP_REGISTRY_MIN_CAPACITY) == -1)
+    {
+        return -1;
+    }
+
+    UDPClientEntry* slot = probe(registry, &key, hash);
+    slot->key = key;
+    slot->hash = hash;
+    slot->used = 1;
+    slot->sockfd = sockfd;
+    slot->binary = 0;
+    slot->addr_len = addr_len < sizeof(slot->address) ? addr_len : (socklen_t)sizeof(slot->address);
+    memcpy(&slot->address, address, slot->addr_len);
+    slot->last_seen = now;
+    slot->topics = 0;
+    registry->count++;
+    // Clients receive every notification until they subscribe
+    if (set_topics(registry, slot, ALERT_TOPICS_ALL) == -1)
+    {
+        remove_slot(registry, (size_t)(slot - registry->slots));
+        return -1;
+    }
+    return 1;
+}
+
+UDPClientEntry* udp_registry_find(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len)
+{
+    UDPClientKey key;
+    if (registry->capacity == 0 || udp_client_key(address, addr_len, &key) == -1)
+    {
+        return NULL;
+    }
+    UDPClientEntry* slot = probe(registry, &key, hash_key(&key));
+    return slot->used ? slot : NULL;
+}
+
+// Empties a slot and moves back the entries of its cluster that can no longer be reached from their home slot
+static void remove_slot(UDPClientRegistry* registry, size_t hole)
+{
+    set_topics(registry, &registry->slots[hole], 0);
+    size_t mask = registry->capacity - 1;
+    for (size_t index = (hole + 1) & mask; registry->slots[index].used; index = (index + 1) & mask)
+    {
+        size_t home = (size_t)registry->slots[index].hash & mask;
+        // Move the entry unless its home lies cyclically in (hole, index], where it is still reachable
+        if (((index - home) & mask) >= ((index - hole) & mask))
+        {
+            registry->slots[hole] = registry->slots[index];
+            hole = index;
+        }
+    }
+    registry->slots[hole].used = 0;
+    registry->count--;
+}
+
+int udp_registry_remove(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len)
+{
+    UDPClientEntry* slot = udp_registry_find(registry, address, addr_len);
+    if (slot == NULL)
+    {
+        return 0;
+    }
+    remove_slot(registry, (size_t)(slot - registry->slots));
+    return 1;
+}
+
+size_t udp_registry_expire(UDPClientRegistry* registry, time_t now, time_t ttl)
+{
+    size_t removed = 0;
+    registry->last_sweep = now;
+    for (size_t index = 0; index < registry->capacity;)
+    {
+        UDPClientEntry* slot = &registry->slots[index];
+        if (slot->used && now - slot->last_seen > ttl)
+        {
+            // Another entry may have been moved into this slot, check it again
+            remove_slot(registry, index);
+            removed++;
+        }
+        else
+        {
+            index++;
+        }
+    }
+    return removed;
+}
+
+int udp_registry_subscribe(UDPClientRegistry* registry, const struct sockaddr* address, socklen_t addr_len,
+                           uint32_t topics)
+{
+    UDPClientEntry* entry = udp_registry_find(registry, address, addr_len);
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    return set_topics(registry, entry, topics & ALERT_TOPICS_ALL);
+}
+
+size_t udp_registry_collect(UDPClientRegistry* registry, AlertTopic topic, UDPClientEntry* clients)
+{
+    const AlertTopicList* list = &registry->topics[topic];
+    for (size_t i = 0; i < list->count; i++)
+    {
+        const UDPClientKey* key = alert_topic_list_at(list, i, sizeof(UDPClientKey));
+        clients[i] = *probe(registry, key, hash_key(key));
+    }
+    return list->count;
+}
+
+void udp_registry_clear(UDPClientRegistry* registry)
+{
+    for (int topic = 0; topic < ALERT_TOPIC_COUNT; topic++)
+    {
+        alert_topic_list_clear(&registry->topics[topic]);
+    }
+    free(registry->slots);
+    registry->slots = NULL;
+    registry->capacity = 0;
+    registry->count = 0;
+}
@@ -4,23 +4,19 @@
 
 void test_add_tcp_client(void)
 {
-    TCPClientList* tcp_clients = malloc(sizeof(TCPClientList)); // Allocate memory for the TCPClientList
-    if (tcp_clients == NULL)
-    {
-        // Handle memory allocation failure
-        TEST_FAIL_MESSAGE("Failed to allocate memory for tcp_clients");
-        return;
-    }
-
-    tcp_clients->num_clients = 0;
+    size_t initial = tcp_connection_count();
 
-    add_tcp_client(324, tcp_clients);
-    add_tcp_client(234, tcp_clients);
-    add_tcp_client(123, tcp_clients);
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(324, "10.0.0.1"));
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(234, "10.0.0.2"));
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(123, "2001:db8::1"));
 
-    TEST_ASSERT_EQUAL(3, tcp_clients->num_clients);
+    TEST_ASSERT_EQUAL_UINT(initial + 3, tcp_connection_count());
+    TEST_ASSERT_EQUAL_STRING("2001:db8::1", tcp_connection_get(123)->peer);
 
-    free(tcp_clients); // Free allocated memory
+    remove_tcp_client(324);
+    remove_tcp_client(234);
+    remove_tcp_client(123);
+    TEST_ASSERT_EQUAL_UINT(initial, tcp_connection_count());
 }
 
 void test_get_available_port(void)
@@ -174,6 +170,333 @@ void test_cleanup_fifo()
     TEST_ASSERT_TRUE(access(fifo_path, F_OK) == -1);
 }
 
+typedef struct
+{
+    int alerts;
+    int malformed;
+} AlertTally;
+
+static void tally_alert(const AlertRecord* alert, void* arg)
+{
+    AlertTally* tally = (AlertTally*)arg;
+    tally->alerts++;
+    if (alert->sensor != ALERT_SENSOR_NORTH || alert->temperature != 400)
+    {
+        tally->malformed++;
+    }
+}
+
+void test_alert_fifo_splits_records(void)
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe2(fds, O_NONBLOCK));
+    AlertFifo fifo = {.fd = fds[0], .len = 0, .invalid = 0};
+    AlertTally tally = {0, 0};
+    AlertRecord records[4];
+    for (int i = 0; i < 4; i++)
+    {
+        alert_record_init(&records[i], ALERT_SENSOR_NORTH, 40.0f, 1700000000 + i);
+    }
+    const char* data = (const char*)records;
+
+    // A record cut by the end of a read is completed by the next one
+    size_t first = sizeof(AlertRecord) + sizeof(AlertRecord) / 2;
+    TEST_ASSERT_EQUAL_INT((int)first, (int)write(fds[1], data, first));
+    TEST_ASSERT_EQUAL_INT(1, alert_fifo_read(&fifo, tally_alert, &tally));
+    TEST_ASSERT_EQUAL_INT((int)(3 * sizeof(AlertRecord) - first),
+                          (int)write(fds[1], data + first, 3 * sizeof(AlertRecord) - first));
+    TEST_ASSERT_EQUAL_INT(2, alert_fifo_read(&fifo, tally_alert, &tally));
+    TEST_ASSERT_EQUAL_INT(3, tally.alerts);
+    TEST_ASSERT_EQUAL_INT(0, tally.malformed);
+
+    // An invalid record is dropped, the next one is still read
+    records[0].sensor = ALERT_SENSOR_COUNT;
+    TEST_ASSERT_EQUAL_INT((int)sizeof(records), (int)write(fds[1], records, sizeof(records)));
+    TEST_ASSERT_EQUAL_INT(3, alert_fifo_read(&fifo, tally_alert, &tally));
+    TEST_ASSERT_EQUAL_UINT(1, fifo.invalid);
+    TEST_ASSERT_EQUAL_INT(0, tally.malformed);
+
+    alert_fifo_close(&fifo);
+    close(fds[1]);
+}
+
+#define ALERT_BURST 10000
+#define ALERTS_PER_MS 10
+
+// Sends ALERT_BURST alerts through send_alert() at 10k alerts/s
+static void* send_alert_burst(void* arg)
+{
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int sent = 0; sent < ALERT_BURST; sent += ALERTS_PER_MS)
+    {
+        for (int i = 0; i < ALERTS_PER_MS; i++)
+        {
+            send_alert(40.0f, ALERT_SENSOR_NORTH);
+        }
+        next.tv_nsec += 1000000;
+        if (next.tv_nsec >= 1000000000)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    close_alert_fifo();
+    return NULL;
+}
+
+void test_alert_fifo_burst_loses_nothing(void)
+{
+    cleanup_fifo(FIFO_PATH);
+    TEST_ASSERT_EQUAL_INT(0, mkfifo(FIFO_PATH, 0666));
+    AlertFifo fifo;
+    TEST_ASSERT_EQUAL_INT(0, alert_fifo_open(&fifo, FIFO_PATH));
+
+    pthread_t writer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, send_alert_burst, NULL));
+    AlertTally tally = {0, 0};
+    struct pollfd ready = {.fd = fifo.fd, .events = POLLIN, .revents = 0};
+    // Every alert is read whole and separately, until the FIFO stays quiet
+    while (tally.alerts < ALERT_BURST && poll(&ready, 1, 2000) > 0)
+    {
+        TEST_ASSERT_TRUE(alert_fifo_read(&fifo, tally_alert, &tally) >= 0);
+    }
+    pthread_join(writer, NULL);
+
+    TEST_ASSERT_EQUAL_INT(ALERT_BURST, tally.alerts);
+    TEST_ASSERT_EQUAL_INT(0, tally.malformed);
+    alert_fifo_close(&fifo);
+    cleanup_fifo(FIFO_PATH);
+}
+
+static void push_alert_until_accepted(const AlertRecord* record, void* arg)
+{
+    while (alert_ring_push((AlertRing*)arg, record) == -1)
+    {
+        sched_yield();
+    }
+}
+
+void test_alert_ring_crosses_fork(void)
+{
+    AlertRing ring = ALERT_RING_INITIALIZER;
+    TEST_ASSERT_EQUAL_INT(0, alert_ring_create(&ring));
+    AlertTally tally = {0, 0};
+    AlertRecord record;
+    alert_record_init(&record, ALERT_SENSOR_NORTH, 40.0f, 1700000000);
+
+    // Filling the ring wakes the consumer once, the next record is refused until it drains
+    for (int i = 0; i < ALERT_RING_CAPACITY; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(0, alert_ring_push(&ring, &record));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, alert_ring_push(&ring, &record));
+    uint64_t wakeups = 0;
+    TEST_ASSERT_EQUAL_INT((int)sizeof(wakeups), (int)read(ring.event_fd, &wakeups, sizeof(wakeups)));
+    TEST_ASSERT_EQUAL_UINT64(1, wakeups);
+    TEST_ASSERT_EQUAL_INT(ALERT_RING_CAPACITY, alert_ring_drain(&ring, tally_alert, &tally));
+    TEST_ASSERT_EQUAL_INT(0, alert_ring_drain(&ring, tally_alert, &tally));
+
+    // A forked sensors process sends through the ring with send_alert(), past the end of the slots many times
+    tally.alerts = 0;
+    pid_t child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if (child == 0)
+    {
+        set_alert_sink(push_alert_until_accepted, &ring);
+        for (int i = 0; i < ALERT_BURST; i++)
+        {
+            send_alert(40.0f, ALERT_SENSOR_NORTH);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+    struct pollfd ready = {.fd = ring.event_fd, .events = POLLIN, .revents = 0};
+    while (tally.alerts < ALERT_BURST && poll(&ready, 1, 2000) > 0)
+    {
+        alert_ring_drain(&ring, tally_alert, &tally);
+    }
+    waitpid(child, NULL, 0);
+
+    TEST_ASSERT_EQUAL_INT(ALERT_BURST, tally.alerts);
+    TEST_ASSERT_EQUAL_INT(0, tally.malformed);
+    alert_ring_destroy(&ring);
+}
+
+static void count_alerts_by_entry(const AlertRecord* record, void* arg)
+{
+    ((int*)arg)[record->sensor]++;
+}
+
+void test_sensor_bank_scan_reports_exceeding(void)
+{
+    // Not a multiple of the lanes, so that the last sensors are scanned one by one
+    SensorBank bank;
+    TEST_ASSERT_EQUAL_INT(0, sensor_bank_init(&bank, 1003, 7, 0.0f));
+    sensor_bank_update(&bank);
+    for (size_t i = 0; i < bank.count; i++)
+    {
+        TEST_ASSERT_TRUE(bank.temperatures[i] >= 35.0f && bank.temperatures[i] < 38.0f);
+    }
+    TEST_ASSERT_EQUAL_size_t(0, sensor_bank_scan(&bank, THRESHOLD_TEMP, bank.exceeding));
+
+    const uint32_t hot[] = {0, 7, 8, 517, 1000, 1002};
+    for (size_t i = 0; i < sizeof(hot) / sizeof(hot[0]); i++)
+    {
+        bank.temperatures[hot[i]] = 40.0f;
+    }
+    TEST_ASSERT_EQUAL_size_t(sizeof(hot) / sizeof(hot[0]), sensor_bank_scan(&bank, THRESHOLD_TEMP, bank.exceeding));
+    TEST_ASSERT_EQUAL_MEMORY(hot, bank.exceeding, sizeof(hot));
+
+    // Every sensor alerts for the entry it watches
+    int alerts[ALERT_SENSOR_COUNT] = {0};
+    set_alert_sink(count_alerts_by_entry, alerts);
+    bank.alert_probability = 1.0f;
+    sensor_bank_update(&bank);
+    TEST_ASSERT_EQUAL_size_t(bank.count, sensor_bank_check_threshold(&bank));
+    set_alert_sink(NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(251, alerts[ALERT_SENSOR_NORTH]);
+    TEST_ASSERT_EQUAL_INT(251, alerts[ALERT_SENSOR_SOUTH]);
+    TEST_ASSERT_EQUAL_INT(251, alerts[ALERT_SENSOR_WEST]);
+    TEST_ASSERT_EQUAL_INT(250, alerts[ALERT_SENSOR_EAST]);
+
+    // The same seed gives the same temperatures
+    SensorBank twin;
+    TEST_ASSERT_EQUAL_INT(0, sensor_bank_init(&twin, 1003, 7, 1.0f));
+    sensor_bank_update(&twin);
+    sensor_bank_update(&twin);
+    TEST_ASSERT_EQUAL_MEMORY(bank.temperatures, twin.temperatures, bank.count * sizeof(float));
+    sensor_bank_free(&twin);
+    sensor_bank_free(&bank);
+}
+
+static void* first_thread_draw(void* arg)
+{
+    *(uint32_t*)arg = prng_next(prng_thread());
+    return NULL;
+}
+
+void test_prng_is_reproducible(void)
+{
+    // Same seed and stream, same sequence; another stream, another sequence
+    Prng first, second, other;
+    prng_seed(&first, 42, 1);
+    prng_seed(&second, 42, 1);
+    prng_seed(&other, 42, 2);
+    int same_as_other = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        uint32_t draw = prng_next(&first);
+        TEST_ASSERT_EQUAL_UINT32(draw, prng_next(&second));
+        same_as_other += draw == prng_next(&other);
+        TEST_ASSERT_TRUE(prng_below(&other, 6) < 6);
+        float unit = prng_unit(&other);
+        TEST_ASSERT_TRUE(unit >= 0.0f && unit < 1.0f);
+    }
+    TEST_ASSERT_TRUE(same_as_other < 5);
+
+    // Every thread gets its own generator on the seed
+    prng_set_seed(7);
+    uint32_t main_draw = prng_next(prng_thread());
+    uint32_t thread_draw = 0;
+    pthread_t thread;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, first_thread_draw, &thread_draw));
+    pthread_join(thread, NULL);
+    TEST_ASSERT_NOT_EQUAL(main_draw, thread_draw);
+    prng_set_seed(7);
+    TEST_ASSERT_EQUAL_UINT32(main_draw, prng_next(prng_thread()));
+
+    // The alert probability is honored at both ends
+    set_alert_probability(0.0f);
+    for (int i = 0; i < 1000; i++)
+    {
+        float temperature = get_temperature();
+        TEST_ASSERT_TRUE(temperature >= 35.0f && temperature <= 37.95f);
+        int minutes = get_random_failure_minutes();
+        TEST_ASSERT_TRUE(minutes >= 5 && minutes <= 10);
+    }
+    set_alert_probability(1.0f);
+    for (int i = 0; i < 1000; i++)
+    {
+        float temperature = get_temperature();
+        TEST_ASSERT_TRUE(temperature > THRESHOLD_TEMP && temperature <= 43.0f);
+    }
+    set_alert_probability(ALERT_DEFAULT_PROBABILITY);
+}
+
+// Scans a request and checks that cJSON reads the same one
+static void assert_scan_matches_cjson(const char* data, Request* scanned)
+{
+    TEST_ASSERT_EQUAL_INT(0, request_scan(data, strlen(data), scanned));
+    cJSON* json = cJSON_Parse(data);
+    TEST_ASSERT_NOT_NULL(json);
+    Request parsed;
+    request_from_json(json, &parsed);
+    TEST_ASSERT_EQUAL_INT(parsed.type, scanned->type);
+    TEST_ASSERT_EQUAL_INT(parsed.has_hostname, scanned->has_hostname);
+    TEST_ASSERT_EQUAL_size_t(parsed.hostname_len, scanned->hostname_len);
+    if (parsed.hostname != NULL)
+    {
+        TEST_ASSERT_EQUAL_MEMORY(parsed.hostname, scanned->hostname, parsed.hostname_len);
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&parsed.food, &scanned->food, sizeof(FoodSupply));
+    TEST_ASSERT_EQUAL_MEMORY(&parsed.medicine, &scanned->medicine, sizeof(MedicineSupply));
+    cJSON_Delete(json);
+}
+
+void test_request_scan_matches_cjson(void)
+{
+    Request request;
+    assert_scan_matches_cjson("{\"message\": \"authenticateme\", \"hostname\": \"ubuntu\"}", &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_AUTHENTICATE, request.type);
+    TEST_ASSERT_TRUE(request_hostname_is(&request, "ubuntu"));
+    TEST_ASSERT_FALSE(request_hostname_is(&request, "ubunt"));
+
+    // Unknown fields of any shape are skipped, missing deltas stay at 0
+    assert_scan_matches_cjson("{\"extra\": [1, {\"a\": null}, -2.5e3], \"message\": \"update\", \"hostname\": \"h\", "
+                              "\"food\": {\"water\": 20, \"meat\": -3, \"other\": true}, "
+                              "\"medicine\": {\"bandages\": 4}}",
+                              &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_UPDATE, request.type);
+    TEST_ASSERT_EQUAL_INT(20, request.food.water);
+    TEST_ASSERT_EQUAL_INT(-3, request.food.meat);
+    TEST_ASSERT_EQUAL_INT(0, request.food.fruits);
+    TEST_ASSERT_EQUAL_INT(4, request.medicine.bandages);
+
+    assert_scan_matches_cjson("{\"message\": \"stats\"}", &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_STATS, request.type);
+    TEST_ASSERT_FALSE(request.has_hostname);
+    assert_scan_matches_cjson("{\"message\": \"statuses\", \"hostname\": 3}", &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_UNKNOWN, request.type);
+    TEST_ASSERT_TRUE(request.has_hostname);
+    TEST_ASSERT_NULL(request.hostname);
+    assert_scan_matches_cjson("{\"message\": 1, \"food\": {\"meat\": \"10\"}}", &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_INVALID, request.type);
+    assert_scan_matches_cjson("{\"hostname\": \"h\"}", &request);
+    TEST_ASSERT_EQUAL_INT(REQUEST_NO_MESSAGE, request.type);
+
+    // Left to cJSON: escapes, names cJSON matches regardless of case, duplicates, fractions and invalid JSON
+    const char* fallbacks[] = {
+        "{\"message\": \"sta\\u0074us\"}",
+        "{\"Message\": \"status\"}",
+        "{\"message\": \"status\", \"message\": \"update\"}",
+        "{\"message\": \"update\", \"food\": {\"water\": 1.5}}",
+        "{\"message\": \"status\"",
+        "[\"status\"]",
+    };
+    for (size_t i = 0; i < sizeof(fallbacks) / sizeof(fallbacks[0]); i++)
+    {
+        TEST_ASSERT_EQUAL_INT(-1, request_scan(fallbacks[i], strlen(fallbacks[i]), &request));
+    }
+
+    TEST_ASSERT_EQUAL_INT(REQUEST_SUMMARY, request_type_lookup("summary", 7));
+    TEST_ASSERT_EQUAL_INT(REQUEST_STATUS, request_type_lookup("status", 6));
+    TEST_ASSERT_EQUAL_INT(REQUEST_UPDATE, request_type_lookup("update", 6));
+    TEST_ASSERT_EQUAL_INT(REQUEST_UNKNOWN, request_type_lookup("updatf", 6));
+    TEST_ASSERT_EQUAL_INT(REQUEST_UNKNOWN, request_type_lookup("", 0));
+}
+
 void test_fifo_not_empty()
 {
     const char* fifo_path = "/tmp/testFifo"; // Adjust the path as needed
@@ -214,29 +537,85 @@ void test_fifo_not_empty()
 
 void test_remove_tcp_client()
 {
-    TCPClientList tcp_clients;
-    tcp_clients.num_clients = 3;
-    tcp_clients.client_fds[0] = 1;
-    tcp_clients.client_fds[1] = 2;
-    tcp_clients.client_fds[2] = 3;
+    size_t initial = tcp_connection_count();
+    add_tcp_client(1, "10.0.0.1");
+    add_tcp_client(2, "10.0.0.2");
+    add_tcp_client(3, "10.0.0.3");
 
     // Remove one of the clients
-    int client_fd_to_remove = 2;
-    remove_tcp_client(client_fd_to_remove, &tcp_clients);
+    remove_tcp_client(2);
 
     // Check if the client was removed successfully
-    TEST_ASSERT_EQUAL_INT(2, tcp_clients.num_clients);
-    TEST_ASSERT_EQUAL_INT(1, tcp_clients.client_fds[0]);
-    TEST_ASSERT_EQUAL_INT(3, tcp_clients.client_fds[1]);
+    TEST_ASSERT_EQUAL_UINT(initial + 2, tcp_connection_count());
+    TEST_ASSERT_NOT_NULL(tcp_connection_get(1));
+    TEST_ASSERT_NULL(tcp_connection_get(2));
+    TEST_ASSERT_NOT_NULL(tcp_connection_get(3));
 
-    // Add additional assertions as needed
+    remove_tcp_client(1);
+    remove_tcp_client(3);
+}
+
+// Counts the open connections on descriptors in [first, first + count)
+static void count_in_range(TCPConnection* conn, void* arg)
+{
+    int* range = (int*)arg;
+    if (conn->fd >= range[0] && conn->fd < range[0] + range[1])
+    {
+        range[2]++;
+    }
+}
+
+void test_tcp_connection_registry_recycles_records()
+{
+    // Far more clients than the old fixed list held, on descriptors spread over several chunks
+    int range[3] = {4000, 6000, 0};
+    size_t initial = tcp_connection_count();
+    for (int fd = range[0]; fd < range[0] + range[1]; fd++)
+    {
+        TEST_ASSERT_NOT_NULL(tcp_connection_open(fd));
+    }
+    TEST_ASSERT_EQUAL_UINT(initial + 6000, tcp_connection_count());
+    tcp_connection_for_each(count_in_range, range);
+    TEST_ASSERT_EQUAL_INT(6000, range[2]);
+
+    // Closing every other client keeps the others reachable, by descriptor and by iteration
+    for (int fd = range[0]; fd < range[0] + range[1]; fd += 2)
+    {
+        tcp_connection_close(fd);
+    }
+    range[2] = 0;
+    tcp_connection_for_each(count_in_range, range);
+    TEST_ASSERT_EQUAL_INT(3000, range[2]);
+    TEST_ASSERT_NULL(tcp_connection_get(4000));
+    TEST_ASSERT_EQUAL_INT(4001, tcp_connection_get(4001)->fd);
+
+    // The record of the last closed connection is reused first
+    TCPConnection* last = tcp_connection_get(9999);
+    tcp_connection_close(9999);
+    TCPConnection* reused = tcp_connection_open(9999);
+    TEST_ASSERT_EQUAL_PTR(last, reused);
+    TEST_ASSERT_EQUAL_INT(FRAMING_PENDING, atomic_load(&reused->framing));
+    TEST_ASSERT_EQUAL_UINT(0, reused->bytes_received);
+
+    for (int fd = range[0] + 1; fd < range[0] + range[1]; fd += 2)
+    {
+        tcp_connection_close(fd);
+    }
+    TEST_ASSERT_EQUAL_UINT(initial, tcp_connection_count());
+
+    // Descriptors past RLIMIT_NOFILE can't exist, and have no slot
+    struct rlimit limit;
+    TEST_ASSERT_EQUAL_INT(0, getrlimit(RLIMIT_NOFILE, &limit));
+    if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < INT32_MAX - CONNECTION_CHUNK_SIZE)
+    {
+        TEST_ASSERT_NULL(tcp_connection_open((int)limit.rlim_max + CONNECTION_CHUNK_SIZE));
+    }
 }
 
 void test_add_udp_client()
 {
-    // Create an empty UDPClientList
-    UDPClientList udp_clients;
-    udp_clients.num_clients = 0;
+    // Create an empty registry
+    UDPClientRegistry udp_clients = UDP_REGISTRY_INITIALIZER(UDP_REGISTRY_DEFAULT_MAX_CLIENTS);
 
     // Create a new UDP client to add
     UDPClientData new_client;
@@ -244,6 +623,7 @@ void test_add_udp_client()
 
     // Set the address family to AF_INET
     new_client.client_addr.ss_family = AF_INET;
+    new_client.addr_len = sizeof(struct sockaddr_in);
 
     // Cast sockaddr_storage to sockaddr_in since we're using AF_INET
     struct sockaddr_in* addr_in = (struct sockaddr_in*)&new_client.client_addr;
@@ -251,38 +631,93 @@ void test_add_udp_client()
     addr_in->sin_port = htons(1234);                         // Example port number
     inet_pton(AF_INET, "192.168.1.100", &addr_in->sin_addr); // Example IP address
 
-    // Call the function under test
+    // Call the function under test, twice: the second datagram only refreshes the client
+    add_udp_client(&udp_clients, new_client);
     add_udp_client(&udp_clients, new_client);
 
     // Check if the client was added successfully
-    TEST_ASSERT_EQUAL_INT(1, udp_clients.num_clients);
-
-    // Cast the sockaddr_storage in the UDPClientList to sockaddr_in for comparison
-    struct sockaddr_in* added_client_addr = (struct sockaddr_in*)&udp_clients.clients[0].client_addr;
+    TEST_ASSERT_EQUAL_UINT(1, udp_clients.count);
+
+    UDPClientEntry* added = udp_registry_find(&udp_clients, (struct sockaddr*)&new_client.client_addr,
+                                              new_client.addr_len);
+    TEST_ASSERT_NOT_NULL(added);
+    TEST_ASSERT_EQUAL_UINT(AF_INET, added->address.v4.sin_family);
+    TEST_ASSERT_EQUAL_UINT(htons(1234), added->address.v4.sin_port);
+    TEST_ASSERT_EQUAL_STRING("192.168.1.100", inet_ntoa(added->address.v4.sin_addr));
+    udp_registry_clear(&udp_clients);
+}
 
-    TEST_ASSERT_EQUAL_UINT(AF_INET, added_client_addr->sin_family);
-    TEST_ASSERT_EQUAL_UINT(htons(1234), added_client_addr->sin_port);
-    TEST_ASSERT_EQUAL_STRING("192.168.1.100", inet_ntoa(added_client_addr->sin_addr));
+// Builds the address of an IPv6 UDP client
+static UDPClientData make_udp6_client(const char* ip, uint16_t port)
+{
+    UDPClientData client;
+    memset(&client, 0, sizeof(client));
+    struct sockaddr_in6* addr = (struct sockaddr_in6*)&client.client_addr;
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(port);
+    inet_pton(AF_INET6, ip, &addr->sin6_addr);
+    client.addr_len = sizeof(struct sockaddr_in6);
+    return client;
 }
 
 void test_remove_udp_client()
 {
-    UDPClientList udp_clients;
-    udp_clients.num_clients = 3;
-    UDPClientData client1, client2, client3;
-    client1.sockfd = 1001;
-    client2.sockfd = 1002;
-    client3.sockfd = 1003;
-    udp_clients.clients[0] = client1;
-    udp_clients.clients[1] = client2;
-    udp_clients.clients[2] = client3;
+    UDPClientRegistry udp_clients = UDP_REGISTRY_INITIALIZER(UDP_REGISTRY_DEFAULT_MAX_CLIENTS);
+
+    // Every client shares the socket of the worker, only their addresses tell them apart
+    UDPClientData client1 = make_udp6_client("2001:db8::1", 5000);
+    UDPClientData client2 = make_udp6_client("2001:db8::2", 5000);
+    UDPClientData client3 = make_udp6_client("::ffff:10.0.0.1", 5000);
+    client1.sockfd = client2.sockfd = client3.sockfd = 1001;
+    add_udp_client(&udp_clients, client1);
+    add_udp_client(&udp_clients, client2);
+    add_udp_client(&udp_clients, client3);
+    TEST_ASSERT_EQUAL_UINT(3, udp_clients.count);
+
+    TEST_ASSERT_EQUAL_INT(1, remove_udp_client(&udp_clients, &client2.client_addr, client2.addr_len));
+    TEST_ASSERT_EQUAL_INT(0, remove_udp_client(&udp_clients, &client2.client_addr, client2.addr_len));
+
+    TEST_ASSERT_EQUAL_UINT(2, udp_clients.count);
+    TEST_ASSERT_NOT_NULL(udp_registry_find(&udp_clients, (struct sockaddr*)&client1.client_addr, client1.addr_len));
+    TEST_ASSERT_NULL(udp_registry_find(&udp_clients, (struct sockaddr*)&client2.client_addr, client2.addr_len));
+    TEST_ASSERT_NOT_NULL(udp_registry_find(&udp_clients, (struct sockaddr*)&client3.client_addr, client3.addr_len));
+    udp_registry_clear(&udp_clients);
+}
 
-    int sockfd_to_remove = 1002;
-    remove_udp_client(&udp_clients, sockfd_to_remove);
+void test_udp_registry_scales_and_expires()
+{
+    UDPClientRegistry registry = UDP_REGISTRY_INITIALIZER(40000);
 
-    TEST_ASSERT_EQUAL_INT(2, udp_clients.num_clients);
-    TEST_ASSERT_EQUAL_INT(1001, udp_clients.clients[0].sockfd);
-    TEST_ASSERT_EQUAL_INT(1003, udp_clients.clients[1].sockfd);
+    // Clients that only differ in the last bytes of their IPv6 address or in their port are distinct
+    char ip[INET6_ADDRSTRLEN];
+    for (int i = 0; i < 40000; i++)
+    {
+        snprintf(ip, sizeof(ip), "2001:db8::%x", i / 2);
+        UDPClientData client = make_udp6_client(ip, (uint16_t)(6000 + i % 2));
+        TEST_ASSERT_EQUAL_INT(1, udp_registry_touch(&registry, (struct sockaddr*)&client.client_addr,
+                                                    client.addr_len, 3, i % 4 == 0 ? 100 : 200));
+    }
+    TEST_ASSERT_EQUAL_UINT(40000, registry.count);
+
+    // Full: new clients are refused, known ones are still refreshed
+    UDPClientData extra = make_udp6_client("2001:db8::1:0", 6000);
+    TEST_ASSERT_EQUAL_INT(-1, udp_registry_touch(&registry, (struct sockaddr*)&extra.client_addr, extra.addr_len, 3,
+                                                 200));
+    UDPClientData first = make_udp6_client("2001:db8::", 6000);
+    TEST_ASSERT_EQUAL_INT(0, udp_registry_touch(&registry, (struct sockaddr*)&first.client_addr, first.addr_len, 3,
+                                                200));
+
+    // The clients last seen at 100 expire, every other one is still found
+    TEST_ASSERT_EQUAL_UINT(9999, udp_registry_expire(&registry, 250, 60));
+    TEST_ASSERT_EQUAL_UINT(30001, registry.count);
+    for (int i = 0; i < 40000; i++)
+    {
+        snprintf(ip, sizeof(ip), "2001:db8::%x", i / 2);
+        UDPClientData client = make_udp6_client(ip, (uint16_t)(6000 + i % 2));
+        UDPClientEntry* entry = udp_registry_find(&registry, (struct sockaddr*)&client.client_addr, client.addr_len);
+        TEST_ASSERT_EQUAL_INT(i == 0 || i % 4 != 0, entry != NULL);
+    }
+    udp_registry_clear(&registry);
 }
 
 void test_logEvent()
@@ -397,30 +832,124 @@ void test_get_tcp_client_ip()
     close(server_socket);
 }
 
-void test_detect_entry_valid_entries()
+static void collect_loopback_clients(TCPConnection* conn, void* arg)
 {
-    TEST_ASSERT_EQUAL_STRING("NORTH", detect_entry("Alert in NORTH area"));
-    TEST_ASSERT_EQUAL_STRING("SOUTH", detect_entry("SOUTH entry alert"));
-    TEST_ASSERT_EQUAL_STRING("EAST", detect_entry("EAST side alarm"));
-    TEST_ASSERT_EQUAL_STRING("WEST", detect_entry("Warning: WEST gate breached"));
+    int* fds = (int*)arg;
+    if (strcmp(conn->peer, "127.0.0.1") == 0)
+    {
+        fds[++fds[0]] = conn->fd;
+    }
 }
 
-void test_detect_entry_no_entry()
+void test_handle_new_tcp_connection_drains_listen_queue(void)
 {
-    TEST_ASSERT_NULL(detect_entry("No entry specified in the alert"));
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    TEST_ASSERT_EQUAL_INT(0, bind(listener, (struct sockaddr*)&address, address_len));
+    TEST_ASSERT_EQUAL_INT(0, getsockname(listener, (struct sockaddr*)&address, &address_len));
+    TEST_ASSERT_EQUAL_INT(0, listen(listener, 16));
+
+    int clients[5];
+    for (int i = 0; i < 5; i++)
+    {
+        clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+        TEST_ASSERT_EQUAL_INT(0, connect(clients[i], (struct sockaddr*)&address, address_len));
+    }
+
+    // One readiness event admits every pending connection, non-blocking and close-on-exec
+    ServerWorker worker;
+    memset(&worker, 0, sizeof(worker));
+    worker.loop = event_loop_create(EVENT_BACKEND_EPOLL);
+    TEST_ASSERT_NOT_NULL(worker.loop);
+    handle_new_tcp_connection(listener, &worker);
+
+    int accepted[1 + 5 + 1] = {0};
+    tcp_connection_for_each(collect_loopback_clients, accepted);
+    TEST_ASSERT_EQUAL_INT(5, accepted[0]);
+    for (int i = 1; i <= accepted[0]; i++)
+    {
+        TEST_ASSERT_TRUE(fcntl(accepted[i], F_GETFL) & O_NONBLOCK);
+        TEST_ASSERT_TRUE(fcntl(accepted[i], F_GETFD) & FD_CLOEXEC);
+        event_loop_remove(worker.loop, accepted[i]);
+        remove_tcp_client(accepted[i]);
+        close(accepted[i]);
+    }
+
+    event_loop_destroy(worker.loop);
+    for (int i = 0; i < 5; i++)
+    {
+        close(clients[i]);
+    }
+    close(listener);
+}
+
+void test_get_tcp_client_peer_uses_accepted_address(void)
+{
+    // fd 777 is not a socket: getpeername() would fail, the address must come from the connection state
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(777, "192.0.2.7"));
+    char fallback[INET6_ADDRSTRLEN];
+    TEST_ASSERT_EQUAL_STRING("192.0.2.7", get_tcp_client_peer(777, fallback));
+    remove_tcp_client(777);
+
+    TEST_ASSERT_EQUAL_STRING("Unknown", get_tcp_client_peer(777, fallback));
+}
+
+void test_alert_record_format()
+{
+    AlertRecord record;
+    char text[ALERT_TEXT_SIZE];
+
+    alert_record_init(&record, ALERT_SENSOR_NORTH, 39.46f, 1700000000);
+    TEST_ASSERT_EQUAL_INT(395, record.temperature);
+    TEST_ASSERT_TRUE(alert_record_valid(&record));
+    alert_record_format(&record, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("NORTH ENTRY, ALERT, 39.5°C ", text);
+
+    alert_record_init(&record, ALERT_SENSOR_WEST, -0.4f, 1700000000);
+    alert_record_format(&record, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("WEST ENTRY, ALERT, -0.4°C ", text);
+
+    // Records of another version or of an unknown sensor are refused
+    record.sensor = ALERT_SENSOR_COUNT;
+    TEST_ASSERT_FALSE(alert_record_valid(&record));
+    record.sensor = ALERT_SENSOR_EAST;
+    record.version = ALERT_RECORD_VERSION + 1;
+    TEST_ASSERT_FALSE(alert_record_valid(&record));
+}
+
+void test_handle_alert_counts_by_sensor()
+{
+    int east = get_alerts_for_entry(ALERT_SENSOR_EAST);
+    int north = get_alerts_for_entry(ALERT_SENSOR_NORTH);
+    AlertRecord record;
+    alert_record_init(&record, ALERT_SENSOR_EAST, 41.0f, time(NULL));
+    handle_alert(&record);
+
+    TEST_ASSERT_EQUAL_INT(east + 1, get_alerts_for_entry(ALERT_SENSOR_EAST));
+    TEST_ASSERT_EQUAL_INT(north, get_alerts_for_entry(ALERT_SENSOR_NORTH));
+    cJSON* summary = create_summary_json();
+    cJSON* emergency = cJSON_GetObjectItemCaseSensitive(summary, "emergency");
+    TEST_ASSERT_EQUAL_STRING("EAST ENTRY, ALERT, 41.0°C ",
+                             cJSON_GetObjectItemCaseSensitive(emergency, "last_event")->valuestring);
+    cJSON_Delete(summary);
+    TEST_ASSERT_EQUAL_INT(-1, get_alerts_for_entry(ALERT_SENSOR_COUNT));
 }
 
 void test_initialize_entry_alerts_count()
 {
     EntryAlertsCount ealerts;
-    memset(&ealerts, 0, sizeof(EntryAlertsCount)); // Clear memory before initialization
+    memset(&ealerts, 0x7f, sizeof(EntryAlertsCount)); // Fill memory before initialization
     initialize_entry_alerts_count(&ealerts);
 
-    // Check if each member is initialized to zero
-    TEST_ASSERT_EQUAL(0, ealerts.north);
-    TEST_ASSERT_EQUAL(0, ealerts.south);
-    TEST_ASSERT_EQUAL(0, ealerts.east);
-    TEST_ASSERT_EQUAL(0, ealerts.west);
+    // Check if each entry is initialized to zero
+    for (int i = 0; i < ALERT_SENSOR_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(0, ealerts.entries[i]);
+    }
 }
 
 void test_update_emergency_info()
@@ -471,6 +1000,890 @@ void test_get_home_dir(void)
     TEST_ASSERT_MESSAGE(strlen(homeDir) > 0, "Home directory should not be empty");
 }
 
+static void count_ready_event(int fd, uint32_t events, void* data)
+{
+    char byte;
+    if ((events & EVENT_READ) && read(fd, &byte, 1) == 1)
+    {
+        (*(int*)data)++;
+    }
+}
+
+static void check_event_loop_dispatch(EventBackend backend)
+{
+    EventLoop* loop = event_loop_create(backend);
+    TEST_ASSERT_NOT_NULL(loop);
+
+    int idle[2];
+    int active[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(idle));
+    TEST_ASSERT_EQUAL_INT(0, pipe(active));
+
+    int idle_count = 0;
+    int active_count = 0;
+    TEST_ASSERT_EQUAL_INT(0, event_loop_add(loop, idle[0], EVENT_READ, count_ready_event, &idle_count));
+    TEST_ASSERT_EQUAL_INT(0, event_loop_add(loop, active[0], EVENT_READ, count_ready_event, &active_count));
+
+    // Nothing ready: the wait times out without dispatching
+    TEST_ASSERT_EQUAL_INT(0, event_loop_run_once(loop, 0));
+
+    // Only the ready descriptor is dispatched
+    TEST_ASSERT_EQUAL_INT(1, write(active[1], "x", 1));
+    TEST_ASSERT_EQUAL_INT(1, event_loop_run_once(loop, 100));
+    TEST_ASSERT_EQUAL_INT(1, active_count);
+    TEST_ASSERT_EQUAL_INT(0, idle_count);
+
+    // Removed descriptors are no longer dispatched
+    TEST_ASSERT_EQUAL_INT(0, event_loop_remove(loop, active[0]));
+    TEST_ASSERT_EQUAL_INT(1, write(active[1], "x", 1));
+    TEST_ASSERT_EQUAL_INT(0, event_loop_run_once(loop, 0));
+    TEST_ASSERT_EQUAL_INT(1, active_count);
+
+    event_loop_destroy(loop);
+    close(idle[0]);
+    close(idle[1]);
+    close(active[0]);
+    close(active[1]);
+}
+
+void test_event_loop_epoll_dispatches_ready_fds()
+{
+    check_event_loop_dispatch(EVENT_BACKEND_EPOLL);
+}
+
+void test_event_loop_select_dispatches_ready_fds()
+{
+    check_event_loop_dispatch(EVENT_BACKEND_SELECT);
+}
+
+void test_event_loop_parse_backend()
+{
+    EventBackend backend = EVENT_BACKEND_EPOLL;
+    TEST_ASSERT_EQUAL_INT(0, event_loop_parse_backend("select", &backend));
+    TEST_ASSERT_EQUAL_INT(EVENT_BACKEND_SELECT, backend);
+    TEST_ASSERT_EQUAL_INT(0, event_loop_parse_backend("epoll", &backend));
+    TEST_ASSERT_EQUAL_INT(EVENT_BACKEND_EPOLL, backend);
+    TEST_ASSERT_EQUAL_INT(-1, event_loop_parse_backend("kqueue", &backend));
+}
+
+void test_parse_command_line_arguments_runtime_options()
+{
+    int tcp_port = -1;
+    int udp_port = -1;
+    ServerConfig saved_config = server_config;
+
+    char* argv[] = {"program_name", "-w", "4", "-e", "select", "-s", "coalesce", "-q", "4096", "-l", "50", "-f", "batch",
+                    "-b", "8192", "-a", "ring", "-n", "100000", "-i", "250", "-r", "0.25", "-g", "1234", "-d"};
+    int argc = sizeof(argv) / sizeof(argv[0]);
+
+    optind = 1; // restart getopt, previous tests already parsed other vectors
+    parse_command_line_arguments(argc, argv, &tcp_port, &udp_port);
+
+    TEST_ASSERT_EQUAL_INT(4, server_config.num_workers);
+    TEST_ASSERT_EQUAL_INT(EVENT_BACKEND_SELECT, server_config.event_backend);
+    TEST_ASSERT_EQUAL_INT(SLOW_CONSUMER_COALESCE, server_config.slow_consumer_policy);
+    TEST_ASSERT_EQUAL_INT(4096, server_config.output_queue_limit);
+    TEST_ASSERT_EQUAL_INT(50, server_config.log_flush_interval_ms);
+    TEST_ASSERT_EQUAL_INT(LOGGER_FSYNC_BATCH, server_config.log_fsync_policy);
+    TEST_ASSERT_EQUAL_INT(8192, server_config.tcp_backlog);
+    TEST_ASSERT_EQUAL_INT(ALERT_TRANSPORT_RING, server_config.alert_transport);
+    TEST_ASSERT_EQUAL_INT(100000, server_config.sensor_count);
+    TEST_ASSERT_EQUAL_INT(250, server_config.sensor_period_ms);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, server_config.alert_probability);
+    TEST_ASSERT_EQUAL_INT(1234, (int)server_config.random_seed);
+    TEST_ASSERT_TRUE(server_config.pretty_json);
+
+    server_config = saved_config;
+}
+
+void test_tcp_connection_delimited_frames()
+{
+    TCPConnection* conn = tcp_connection_open(1000);
+    TEST_ASSERT_NOT_NULL(conn);
+    const char* frame;
+    size_t frame_len;
+
+    // Two coalesced requests and the beginning of a third one
+    const char* data = "{\"message\":\"status\"}\n{\"message\":\"summary\"}\n{\"message\":\"upd";
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, data, strlen(data)));
+    TEST_ASSERT_EQUAL_INT(1, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_INT(FRAMING_DELIMITED, atomic_load(&conn->framing));
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"message\":\"status\"}", frame, frame_len);
+    TEST_ASSERT_EQUAL_INT(1, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"message\":\"summary\"}", frame, frame_len);
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_next_frame(conn, &frame, &frame_len));
+
+    // The split request completes with the next read
+    data = "ate\",\"food\":{\"meat\":1}}\n";
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, data, strlen(data)));
+    TEST_ASSERT_EQUAL_INT(1, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"message\":\"update\",\"food\":{\"meat\":1}}", frame, frame_len);
+
+    // Pretty-printed objects, with braces and newlines inside strings, are still one frame
+    data = "{\n\t\"message\":\t\"a}\\\"b\n\"\n}";
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, data, strlen(data)));
+    TEST_ASSERT_EQUAL_INT(1, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_STRING_LEN(data, frame, frame_len);
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_next_frame(conn, &frame, &frame_len));
+
+    tcp_connection_close(1000);
+    TEST_ASSERT_NULL(tcp_connection_get(1000));
+}
+
+void test_tcp_connection_length_prefixed_frames()
+{
+    TCPConnection* conn = tcp_connection_open(1001);
+    TEST_ASSERT_NOT_NULL(conn);
+    const char* frame;
+    size_t frame_len;
+
+    // Magic byte, then a 20-byte frame delivered in two parts
+    const char first[] = {FRAMING_LENGTH_PREFIX_MAGIC, 0, 0, 0, 20, '{', '"', 'm', 'e'};
+    const char* rest = "ssage\":\"status\"}";
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, first, sizeof(first)));
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_INT(FRAMING_LENGTH_PREFIXED, atomic_load(&conn->framing));
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, rest, strlen(rest)));
+    TEST_ASSERT_EQUAL_INT(1, tcp_connection_next_frame(conn, &frame, &frame_len));
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"message\":\"status\"}", frame, frame_len);
+
+    // Frames over MAX_FRAME_SIZE are a protocol error
+    const char oversized[] = {0x7f, 0, 0, 0};
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_append(conn, oversized, sizeof(oversized)));
+    TEST_ASSERT_EQUAL_INT(-1, tcp_connection_next_frame(conn, &frame, &frame_len));
+
+    // Responses get the same framing
+    unsigned char header[FRAME_LENGTH_HEADER];
+    size_t header_len;
+    const char* trailer;
+    size_t trailer_len;
+    tcp_frame_response(FRAMING_LENGTH_PREFIXED, 258, header, &header_len, &trailer, &trailer_len);
+    TEST_ASSERT_EQUAL_INT(FRAME_LENGTH_HEADER, header_len);
+    TEST_ASSERT_EQUAL_UINT8(1, header[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, header[3]);
+    TEST_ASSERT_EQUAL_INT(0, trailer_len);
+    tcp_frame_response(FRAMING_DELIMITED, 258, header, &header_len, &trailer, &trailer_len);
+    TEST_ASSERT_EQUAL_INT(0, header_len);
+    TEST_ASSERT_EQUAL_STRING("\n", trailer);
+
+    tcp_connection_close(1001);
+}
+
+void test_broadcast_waits_for_framing()
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(fds[0], "127.0.0.1"));
+    init_shared_memory_supplies();
+    const uint8_t binary[] = {WIRE_MAGIC, WIRE_MSG_ALERT, 0, 0};
+    BroadcastMessage alert = {ALERT_TOPIC_NORTH_ENTRY, "NORTH ENTRY, ALERT", 18, binary, sizeof(binary)};
+
+    // An alert before the first byte of the client is not sent in a framing the client may not use
+    publish_to_tcp_clients(&alert);
+    char buffer[BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_INT(-1, recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT));
+
+    // The client then opens with length-prefixed framing: its stream starts with the frame of its response
+    const char* request = "{\"message\":\"status\"}";
+    char frame[1 + FRAME_LENGTH_HEADER + BUFFER_256] = {FRAMING_LENGTH_PREFIX_MAGIC, 0, 0, 0, (char)strlen(request)};
+    memcpy(frame + 1 + FRAME_LENGTH_HEADER, request, strlen(request));
+    size_t frame_len = 1 + FRAME_LENGTH_HEADER + strlen(request);
+    TEST_ASSERT_EQUAL_INT((int)frame_len, send(fds[1], frame, frame_len, 0));
+    TEST_ASSERT_EQUAL_INT(1, check_tcp_clients_messages(fds[0]));
+    ssize_t received = recv(fds[1], buffer, sizeof(buffer), 0);
+    TEST_ASSERT_TRUE(received > FRAME_LENGTH_HEADER);
+    size_t payload_len = ((size_t)(unsigned char)buffer[2] << 8) | (unsigned char)buffer[3];
+    TEST_ASSERT_EQUAL_INT(received - FRAME_LENGTH_HEADER, (ssize_t)payload_len);
+    TEST_ASSERT_EQUAL_INT('{', buffer[FRAME_LENGTH_HEADER]);
+
+    // Later alerts get the framing of the client
+    publish_to_tcp_clients(&alert);
+    received = recv(fds[1], buffer, sizeof(buffer), 0);
+    TEST_ASSERT_EQUAL_INT(FRAME_LENGTH_HEADER + 18, received);
+    TEST_ASSERT_EQUAL_INT(18, buffer[3]);
+    TEST_ASSERT_EQUAL_STRING_LEN("NORTH ENTRY, ALERT", buffer + FRAME_LENGTH_HEADER, 18);
+
+    remove_tcp_client(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void test_tcp_connection_batched_responses()
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    // Descriptors the server did not accept are never read
+    TEST_ASSERT_EQUAL_INT(0, check_tcp_clients_messages(fds[0]));
+    TEST_ASSERT_EQUAL_INT(0, add_tcp_client(fds[0], "127.0.0.1"));
+    TCPConnection* conn = tcp_connection_get(fds[0]);
+    TEST_ASSERT_NOT_NULL(conn);
+    atomic_store(&conn->framing, FRAMING_DELIMITED);
+
+    // Nothing is written until the batch is flushed, then every response arrives at once
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_queue(conn, "{\"a\":1}", 7, TCP_MESSAGE_RESPONSE));
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_queue(conn, "{\"b\":2}", 7, TCP_MESSAGE_RESPONSE));
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_queue(conn, "{\"c\":3}", 7, TCP_MESSAGE_RESPONSE));
+    char buffer[BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_INT(-1, recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT));
+    TEST_ASSERT_EQUAL_INT(24, tcp_connection_flush(conn));
+    TEST_ASSERT_EQUAL_INT(0, conn->out_count);
+    TEST_ASSERT_FALSE(tcp_connection_has_output(conn));
+
+    ssize_t received = recv(fds[1], buffer, sizeof(buffer), 0);
+    TEST_ASSERT_EQUAL_INT(24, received);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"a\":1}\n{\"b\":2}\n{\"c\":3}\n", buffer, 24);
+
+    // The buffers of the sent responses are kept for the next ones
+    TEST_ASSERT_EQUAL_INT(3, conn->spare_count);
+    char* recycled = conn->spare[2];
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_queue(conn, "{\"d\":4}", 7, TCP_MESSAGE_RESPONSE));
+    TEST_ASSERT_EQUAL_PTR(recycled, conn->out[conn->out_head].payload);
+    TEST_ASSERT_EQUAL_INT(2, conn->spare_count);
+
+    remove_tcp_client(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void queue_message(TCPConnection* conn, const char* message, int kind, int expected)
+{
+    TEST_ASSERT_EQUAL_INT(expected, tcp_connection_queue(conn, message, strlen(message), kind));
+}
+
+void test_tcp_connection_slow_consumer_policies()
+{
+    TCPConnection* conn = tcp_connection_open(1002);
+    TEST_ASSERT_NOT_NULL(conn);
+    atomic_store(&conn->framing, FRAMING_DELIMITED);
+    TCPOutputStats before;
+    TCPOutputStats after;
+    tcp_connection_get_stats(&before);
+
+    // Room for two 8-byte frames: the third message evicts the oldest one
+    const int north = TCP_MESSAGE_TOPIC(ALERT_TOPIC_NORTH_ENTRY);
+    tcp_connection_set_output_policy(SLOW_CONSUMER_DROP_OLDEST, 20);
+    queue_message(conn, "north-1", north, 0);
+    queue_message(conn, "reply-1", TCP_MESSAGE_RESPONSE, 0);
+    queue_message(conn, "north-2", north, 0);
+    TEST_ASSERT_EQUAL_INT(2, conn->out_count);
+    TEST_ASSERT_EQUAL_STRING_LEN("reply-1", conn->out[conn->out_head].payload, 7);
+
+    // Coalescing replaces the queued alert of the same entry
+    tcp_connection_set_output_policy(SLOW_CONSUMER_COALESCE, 20);
+    queue_message(conn, "north-3", north, 0);
+    TEST_ASSERT_EQUAL_INT(2, conn->out_count);
+    TEST_ASSERT_EQUAL_STRING_LEN("reply-1", conn->out[conn->out_head].payload, 7);
+    TEST_ASSERT_EQUAL_STRING_LEN("north-3", conn->out[(conn->out_head + 1) % OUTPUT_QUEUE_SLOTS].payload, 7);
+
+    // but never an alert of another entry or the reply to another request: the new message is dropped instead
+    queue_message(conn, "east-1", TCP_MESSAGE_TOPIC(ALERT_TOPIC_EAST_ENTRY), -1);
+    queue_message(conn, "status", TCP_MESSAGE_STATUS, -1);
+    queue_message(conn, "reply-2", TCP_MESSAGE_RESPONSE, -1);
+    TEST_ASSERT_EQUAL_STRING_LEN("reply-1", conn->out[conn->out_head].payload, 7);
+    TEST_ASSERT_EQUAL_STRING_LEN("north-3", conn->out[(conn->out_head + 1) % OUTPUT_QUEUE_SLOTS].payload, 7);
+
+    // Disconnect drops the message and marks the client
+    tcp_connection_set_output_policy(SLOW_CONSUMER_DISCONNECT, 20);
+    queue_message(conn, "north-4", north, -1);
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&conn->overflowed));
+
+    tcp_connection_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT64(before.dropped_messages + 5, after.dropped_messages);
+    TEST_ASSERT_EQUAL_UINT64(before.coalesced_messages + 1, after.coalesced_messages);
+    TEST_ASSERT_EQUAL_UINT64(before.slow_consumer_disconnects + 1, after.slow_consumer_disconnects);
+    TEST_ASSERT_EQUAL_UINT64(before.queued_bytes + 16, after.queued_bytes);
+
+    tcp_connection_set_output_policy(SLOW_CONSUMER_DROP_OLDEST, OUTPUT_QUEUE_DEFAULT_LIMIT);
+    tcp_connection_close(1002);
+    tcp_connection_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT64(before.queued_bytes, after.queued_bytes);
+}
+
+void test_supplies_handle_attaches_once()
+{
+    SuppliesHandle handle = {-1, NULL};
+    TEST_ASSERT_EQUAL_INT(0, supplies_attach(&handle));
+    SuppliesSegment* segment = handle.segment;
+    TEST_ASSERT_NOT_NULL(segment);
+    TEST_ASSERT_EQUAL_INT(0, (int)((uintptr_t)segment % SUPPLIES_CACHE_LINE));
+
+    // Attaching again keeps the same mapping
+    TEST_ASSERT_EQUAL_INT(0, supplies_attach(&handle));
+    TEST_ASSERT_EQUAL_PTR(segment, handle.segment);
+
+    supplies_detach(&handle);
+    TEST_ASSERT_NULL(handle.segment);
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    TEST_ASSERT_EQUAL_INT(-1, supplies_read(&handle, &food_supply, &medicine_supply));
+}
+
+void test_update_supplies_clamps_at_zero()
+{
+    init_shared_memory_supplies();
+    cJSON* update = cJSON_Parse("{\"food\":{\"meat\":5,\"water\":2},\"medicine\":{\"bandages\":-3}}");
+    update_supplies_from_json(update);
+    cJSON_Delete(update);
+
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    TEST_ASSERT_EQUAL_INT(0, get_supplies(&food_supply, &medicine_supply));
+    TEST_ASSERT_EQUAL_INT(5, food_supply.meat);
+    TEST_ASSERT_EQUAL_INT(2, food_supply.water);
+    TEST_ASSERT_EQUAL_INT(0, food_supply.fruits);
+    TEST_ASSERT_EQUAL_INT(0, medicine_supply.bandages);
+    init_shared_memory_supplies();
+}
+
+void test_auth_token_verification()
+{
+    // Reference vectors of SipHash-2-4: key 00..0f, messages 00..(n-1)
+    uint8_t key[AUTH_KEY_SIZE];
+    uint8_t message[15];
+    for (int i = 0; i < AUTH_KEY_SIZE; i++)
+    {
+        key[i] = (uint8_t)i;
+    }
+    for (int i = 0; i < 15; i++)
+    {
+        message[i] = (uint8_t)i;
+    }
+    TEST_ASSERT_TRUE(siphash24(key, message, 0) == 0x726fdb47dd0e0e31ULL);
+    TEST_ASSERT_TRUE(siphash24(key, message, 8) == 0x93f5f5799a932462ULL);
+    TEST_ASSERT_TRUE(siphash24(key, message, 15) == 0xa129ca6149be45e5ULL);
+
+    auth_token_set_key(key);
+    char token[AUTH_TOKEN_LEN + 1];
+    auth_token_issue("192.168.0.7", 1000, token);
+    TEST_ASSERT_EQUAL_size_t(AUTH_TOKEN_LEN, strlen(token));
+    TEST_ASSERT_TRUE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.7", 1000 + AUTH_TOKEN_TTL_SECONDS - 1));
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.7", 1000 + AUTH_TOKEN_TTL_SECONDS));
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.7", 999));
+    TEST_ASSERT_TRUE(auth_token_verify(token, AUTH_TOKEN_LEN, "::ffff:192.168.0.7", 1000));
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.8", 1000));
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN - 1, "192.168.0.7", 1000));
+    token[AUTH_TOKEN_LEN - 1] = token[AUTH_TOKEN_LEN - 1] == '0' ? '1' : '0';
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.7", 1000));
+
+    // A new key invalidates the tokens issued before
+    auth_token_issue("192.168.0.7", 1000, token);
+    TEST_ASSERT_EQUAL_INT(0, auth_token_init());
+    TEST_ASSERT_FALSE(auth_token_verify(token, AUTH_TOKEN_LEN, "192.168.0.7", 1000));
+}
+
+// Keeps the last response of a session
+static void capture_reply(const char* response, size_t len, void* arg)
+{
+    snprintf((char*)arg, BUFFER_SIZE, "%.*s", (int)len, response);
+}
+
+static ProtocolResult handle_text(ProtocolSession* session, const char* data)
+{
+    Request request;
+    TEST_ASSERT_EQUAL_INT(0, request_scan(data, strlen(data), &request));
+    return protocol_handle(session, &request);
+}
+
+void test_protocol_handle_without_sockets()
+{
+    init_shared_memory_supplies();
+    char reply[BUFFER_SIZE] = "";
+    ProtocolSession connection = {PROTOCOL_TCP, "127.0.0.1", 0, 0, capture_reply, reply, 0, NULL};
+    ProtocolSession datagram = {PROTOCOL_UDP, "127.0.0.1", 1, 0, capture_reply, reply, 0, NULL};
+
+    // Updates need an authenticated session or a token, the admin hostname alone is not enough
+    auth_token_init();
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&connection, "{\"message\":\"update\",\"food\":{\"meat\":4}}"));
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&datagram, "{\"message\":\"update\",\"hostname\":\"" ADMIN_USER
+                                                                "\",\"food\":{\"meat\":4}}"));
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE,
+                          handle_text(&connection, "{\"message\":\"authenticateme\",\"hostname\":\"" ADMIN_USER "\"}"));
+    const char* token_field = "{\"message\":\"auth_success\",\"token\":\"";
+    TEST_ASSERT_EQUAL_INT(0, strncmp(token_field, reply, strlen(token_field)));
+    TEST_ASSERT_TRUE(connection.authenticated);
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&connection, "{\"message\":\"update\",\"food\":{\"meat\":3}}"));
+
+    // The token authorizes datagrams from the same address only, and is not remembered
+    char update[BUFFER_SIZE];
+    snprintf(update, sizeof(update),
+             "{\"message\":\"update\",\"hostname\":\"x\",\"token\":\"%.*s\",\"food\":{\"meat\":2}}", AUTH_TOKEN_LEN,
+             reply + strlen(token_field));
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&datagram, update));
+    TEST_ASSERT_FALSE(datagram.authenticated);
+    ProtocolSession other = {PROTOCOL_UDP, "10.0.0.1", 1, 0, capture_reply, reply, 0, NULL};
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&other, update));
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    TEST_ASSERT_EQUAL_INT(0, get_supplies(&food_supply, &medicine_supply));
+    TEST_ASSERT_EQUAL_INT(5, food_supply.meat);
+
+    // Every transport gets the same bytes for the same request
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&connection, "{\"message\":\"status\"}"));
+    char connection_reply[BUFFER_SIZE];
+    snprintf(connection_reply, sizeof(connection_reply), "%s", reply);
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&datagram, "{\"message\":\"status\",\"hostname\":\"x\"}"));
+    TEST_ASSERT_EQUAL_STRING(connection_reply, reply);
+    TEST_ASSERT_NOT_NULL(strstr(reply, "\"meat\":5"));
+
+    // Datagrams must name their host, a failed authentication closes connections
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_REJECTED, handle_text(&datagram, "{\"message\":\"status\"}"));
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_REJECTED, handle_text(&connection, "{\"hostname\":\"x\"}"));
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_CLOSE,
+                          handle_text(&connection, "{\"message\":\"authenticateme\",\"hostname\":\"x\"}"));
+    TEST_ASSERT_EQUAL_STRING(PROTOCOL_AUTH_FAILURE, reply);
+    init_shared_memory_supplies();
+}
+
+// Keeps the last binary response of a session
+typedef struct
+{
+    uint8_t data[WIRE_MAX_MESSAGE];
+    size_t len;
+} CapturedMessage;
+
+static void capture_message(const char* response, size_t len, void* arg)
+{
+    CapturedMessage* message = arg;
+    TEST_ASSERT_TRUE(len <= sizeof(message->data));
+    memcpy(message->data, response, len);
+    message->len = len;
+}
+
+void test_wire_format_roundtrip()
+{
+    // Negative and multi-byte integers survive, unknown fields are skipped
+    uint8_t buffer[WIRE_MAX_MESSAGE];
+    WireWriter writer;
+    wire_writer_init(&writer, buffer, sizeof(buffer), WIRE_MSG_UPDATE);
+    wire_put_string(&writer, WIRE_TAG_HOSTNAME, "host");
+    wire_put_int(&writer, WIRE_TAG_MEAT, -3);
+    wire_put_bytes(&writer, (WireTag)99, "future", 6);
+    wire_put_int(&writer, WIRE_TAG_WATER, 300);
+    wire_put_int(&writer, WIRE_TAG_BANDAGES, 1);
+    size_t len = wire_writer_finish(&writer);
+    TEST_ASSERT_TRUE(len > WIRE_HEADER_SIZE);
+
+    Request request;
+    TEST_ASSERT_EQUAL_INT(0, request_from_wire((const char*)buffer, len, &request));
+    TEST_ASSERT_EQUAL_INT(REQUEST_UPDATE, request.type);
+    TEST_ASSERT_EQUAL_size_t(4, request.hostname_len);
+    TEST_ASSERT_EQUAL_INT(0, strncmp("host", request.hostname, 4));
+    TEST_ASSERT_EQUAL_INT(-3, request.food.meat);
+    TEST_ASSERT_EQUAL_INT(300, request.food.water);
+    TEST_ASSERT_EQUAL_INT(1, request.medicine.bandages);
+    TEST_ASSERT_EQUAL_INT(-1, request_from_wire((const char*)buffer, len - 1, &request));
+    TEST_ASSERT_EQUAL_INT(-1, request_from_wire("{}", 2, &request));
+
+    // A message that does not fit is never cut short silently
+    wire_writer_init(&writer, buffer, 4, WIRE_MSG_STATUS);
+    wire_put_string(&writer, WIRE_TAG_HOSTNAME, "host");
+    TEST_ASSERT_EQUAL_size_t(0, wire_writer_finish(&writer));
+
+    // A binary session gets the same content as a JSON one
+    init_shared_memory_supplies();
+    CapturedMessage reply = {{0}, 0};
+    ProtocolSession session = {PROTOCOL_TCP, "127.0.0.1", 0, 0, capture_message, &reply, 1, NULL};
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&session, "{\"message\":\"status\"}"));
+    TEST_ASSERT_EQUAL_INT(WIRE_MAGIC, reply.data[0]);
+    TEST_ASSERT_EQUAL_INT(WIRE_MSG_SUPPLIES, reply.data[1]);
+    cJSON* decoded = wire_decode_to_json(reply.data, reply.len);
+    cJSON* expected = create_status_json();
+    TEST_ASSERT_TRUE(cJSON_Compare(expected, decoded, 1));
+    cJSON_Delete(decoded);
+    cJSON_Delete(expected);
+
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&session, "{\"message\":\"summary\"}"));
+    TEST_ASSERT_EQUAL_INT(WIRE_MSG_SHELTER_SUMMARY, reply.data[1]);
+    decoded = wire_decode_to_json(reply.data, reply.len);
+    expected = create_summary_json();
+    TEST_ASSERT_TRUE(cJSON_Compare(expected, decoded, 1));
+    cJSON_Delete(decoded);
+    cJSON_Delete(expected);
+
+    // Responses without a binary form travel as JSON text
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&session, "{\"message\":\"stats\"}"));
+    TEST_ASSERT_EQUAL_INT(WIRE_MSG_JSON, reply.data[1]);
+    decoded = wire_decode_to_json(reply.data, reply.len);
+    TEST_ASSERT_NOT_NULL(cJSON_GetObjectItem(decoded, "tcp_output"));
+    cJSON_Delete(decoded);
+}
+
+// Stands in for a registry: subscribes to the known topics
+static uint32_t accept_topics(uint32_t topics, void* arg)
+{
+    (void)arg;
+    return topics & ALERT_TOPICS_ALL;
+}
+
+static void count_subscriber(TCPConnection* conn, void* arg)
+{
+    (void)conn;
+    (*(int*)arg)++;
+}
+
+void test_alert_topic_subscriptions()
+{
+    // Topics are read from text and binary requests alike, every topic when none is named
+    const char* text = "{\"message\":\"subscribe\",\"topics\":[\"north_entry\",\"power\",\"volcano\"]}";
+    const uint32_t north_power = ALERT_TOPIC_BIT(ALERT_TOPIC_NORTH_ENTRY) | ALERT_TOPIC_BIT(ALERT_TOPIC_POWER);
+    Request request;
+    TEST_ASSERT_EQUAL_INT(0, request_scan(text, strlen(text), &request));
+    TEST_ASSERT_EQUAL_INT(REQUEST_SUBSCRIBE, request.type);
+    TEST_ASSERT_EQUAL_UINT32(north_power, request.topics);
+    cJSON* json = cJSON_Parse(text);
+    uint8_t buffer[WIRE_MAX_MESSAGE];
+    size_t len = wire_encode_json_request(json, buffer, sizeof(buffer));
+    cJSON_Delete(json);
+    TEST_ASSERT_EQUAL_INT(0, request_from_wire((const char*)buffer, len, &request));
+    TEST_ASSERT_EQUAL_INT(REQUEST_SUBSCRIBE, request.type);
+    TEST_ASSERT_EQUAL_UINT32(north_power, request.topics);
+    const char* empty = "{\"message\":\"subscribe\",\"topics\":[]}";
+    json = cJSON_Parse(empty);
+    len = wire_encode_json_request(json, buffer, sizeof(buffer));
+    cJSON_Delete(json);
+    TEST_ASSERT_EQUAL_INT(0, request_from_wire((const char*)buffer, len, &request));
+    TEST_ASSERT_EQUAL_UINT32(0, request.topics);
+    const char* temperature = "{\"message\":\"subscribe\",\"topics\":[\"temperature\"]}";
+    TEST_ASSERT_EQUAL_INT(0, request_scan(temperature, strlen(temperature), &request));
+    TEST_ASSERT_EQUAL_UINT32(ALERT_TOPICS_TEMPERATURE, request.topics);
+    TEST_ASSERT_EQUAL_INT(0, request_scan("{\"message\":\"subscribe\"}", 23, &request));
+    TEST_ASSERT_EQUAL_UINT32(ALERT_TOPICS_ALL, request.topics);
+
+    // The reply names the topics the client is now subscribed to
+    char reply[BUFFER_SIZE] = "";
+    ProtocolSession session = {PROTOCOL_TCP, "127.0.0.1", 0, 0, capture_reply, reply, 0, accept_topics};
+    TEST_ASSERT_EQUAL_INT(PROTOCOL_DONE, handle_text(&session, text));
+    TEST_ASSERT_EQUAL_STRING("{\"message\":\"subscribed\",\"topics\":[\"north_entry\",\"power\"]}", reply);
+
+    // Only the UDP subscribers of a topic are collected, and the lists follow removals and expirations
+    UDPClientRegistry registry = UDP_REGISTRY_INITIALIZER(UDP_REGISTRY_DEFAULT_MAX_CLIENTS);
+    struct sockaddr_in addresses[3];
+    for (int i = 0; i < 3; i++)
+    {
+        addresses[i] = (struct sockaddr_in){.sin_family = AF_INET, .sin_port = htons((uint16_t)(7000 + i)),
+                                            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+        TEST_ASSERT_EQUAL_INT(1, udp_registry_touch(&registry, (struct sockaddr*)&addresses[i],
+                                                    sizeof(addresses[i]), 3, i == 2 ? 200 : 100));
+    }
+    TEST_ASSERT_EQUAL_INT(0, udp_registry_subscribe(&registry, (struct sockaddr*)&addresses[0],
+                                                    sizeof(addresses[0]), north_power));
+    TEST_ASSERT_EQUAL_INT(0, udp_registry_subscribe(&registry, (struct sockaddr*)&addresses[1],
+                                                    sizeof(addresses[1]), ALERT_TOPIC_BIT(ALERT_TOPIC_POWER)));
+    UDPClientEntry clients[3];
+    TEST_ASSERT_EQUAL_size_t(2, udp_registry_collect(&registry, ALERT_TOPIC_NORTH_ENTRY, clients));
+    TEST_ASSERT_EQUAL_size_t(1, udp_registry_collect(&registry, ALERT_TOPIC_SOUTH_ENTRY, clients));
+    TEST_ASSERT_EQUAL_INT(7002, ntohs(clients[0].address.v4.sin_port));
+    TEST_ASSERT_EQUAL_size_t(3, udp_registry_collect(&registry, ALERT_TOPIC_POWER, clients));
+    TEST_ASSERT_EQUAL_INT(1, udp_registry_remove(&registry, (struct sockaddr*)&addresses[0], sizeof(addresses[0])));
+    TEST_ASSERT_EQUAL_size_t(1, udp_registry_collect(&registry, ALERT_TOPIC_NORTH_ENTRY, clients));
+    TEST_ASSERT_EQUAL_size_t(2, udp_registry_collect(&registry, ALERT_TOPIC_POWER, clients));
+    TEST_ASSERT_EQUAL_UINT(1, udp_registry_expire(&registry, 200, 60));
+    TEST_ASSERT_EQUAL_size_t(1, udp_registry_collect(&registry, ALERT_TOPIC_POWER, clients));
+    TEST_ASSERT_EQUAL_INT(7002, ntohs(clients[0].address.v4.sin_port));
+    TEST_ASSERT_EQUAL_size_t(1, udp_registry_collect(&registry, ALERT_TOPIC_NORTH_ENTRY, clients));
+    udp_registry_clear(&registry);
+
+    // The same for TCP connections, which are subscribed to everything when they open
+    int initial = 0, initial_power = 0;
+    tcp_connection_for_each_subscriber(ALERT_TOPIC_WEST_ENTRY, count_subscriber, &initial);
+    tcp_connection_for_each_subscriber(ALERT_TOPIC_POWER, count_subscriber, &initial_power);
+    for (int fd = 3000; fd < 3003; fd++)
+    {
+        TEST_ASSERT_NOT_NULL(tcp_connection_open(fd));
+    }
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_subscribe(tcp_connection_get(3000), ALERT_TOPICS_TEMPERATURE));
+    TEST_ASSERT_EQUAL_INT(0, tcp_connection_subscribe(tcp_connection_get(3001), ALERT_TOPIC_BIT(ALERT_TOPIC_POWER)));
+    int subscribers = 0;
+    tcp_connection_for_each_subscriber(ALERT_TOPIC_WEST_ENTRY, count_subscriber, &subscribers);
+    TEST_ASSERT_EQUAL_INT(initial + 2, subscribers);
+    tcp_connection_close(3000);
+    subscribers = 0;
+    tcp_connection_for_each_subscriber(ALERT_TOPIC_WEST_ENTRY, count_subscriber, &subscribers);
+    TEST_ASSERT_EQUAL_INT(initial + 1, subscribers);
+    subscribers = 0;
+    tcp_connection_for_each_subscriber(ALERT_TOPIC_POWER, count_subscriber, &subscribers);
+    TEST_ASSERT_EQUAL_INT(initial_power + 2, subscribers);
+    tcp_connection_close(3001);
+    tcp_connection_close(3002);
+
+    // Datagrams are stateless: a subscription names its host like any other request, and applies to its sender only
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT_TRUE(sockfd >= 0);
+    struct sockaddr_storage subscriber, other;
+    memcpy(&subscriber, &addresses[0], sizeof(addresses[0]));
+    memcpy(&other, &addresses[1], sizeof(addresses[1]));
+    const char* anonymous = "{\"message\":\"subscribe\",\"topics\":[\"east_entry\"]}";
+    TEST_ASSERT_EQUAL_INT(0, request_scan(anonymous, strlen(anonymous), &request));
+    TEST_ASSERT_EQUAL_INT(0, dispatch_udp_request(sockfd, &request, &subscriber, sizeof(addresses[0]), NULL, 0));
+    const char* east = "{\"message\":\"subscribe\",\"hostname\":\"h\",\"topics\":[\"east_entry\"]}";
+    TEST_ASSERT_EQUAL_INT(0, request_scan(east, strlen(east), &request));
+    TEST_ASSERT_EQUAL_INT(1, dispatch_udp_request(sockfd, &request, &subscriber, sizeof(addresses[0]), NULL, 0));
+    const char* status = "{\"message\":\"status\",\"hostname\":\"h\"}";
+    TEST_ASSERT_EQUAL_INT(0, request_scan(status, strlen(status), &request));
+    TEST_ASSERT_EQUAL_INT(1, dispatch_udp_request(sockfd, &request, &other, sizeof(addresses[1]), NULL, 0));
+    TEST_ASSERT_EQUAL_size_t(2, udp_registry_collect(&udp_clients, ALERT_TOPIC_EAST_ENTRY, clients));
+    TEST_ASSERT_EQUAL_size_t(1, udp_registry_collect(&udp_clients, ALERT_TOPIC_NORTH_ENTRY, clients));
+    TEST_ASSERT_EQUAL_INT(7001, ntohs(clients[0].address.v4.sin_port));
+    udp_registry_remove(&udp_clients, (struct sockaddr*)&subscriber, sizeof(addresses[0]));
+    udp_registry_remove(&udp_clients, (struct sockaddr*)&other, sizeof(addresses[1]));
+    close(sockfd);
+}
+
+#define SUPPLIES_STRESS_WRITERS 3
+#define SUPPLIES_STRESS_READERS 2
+#define SUPPLIES_STRESS_UPDATES 20000
+
+// Every update adds 1 meat, 2 water and 1 bandage, so a consistent snapshot always has water == 2 * meat == 2 * bandages
+static int supplies_stress_child(int writer)
+{
+    SuppliesHandle handle = {-1, NULL};
+    if (supplies_attach(&handle) == -1)
+    {
+        return 2;
+    }
+    FoodSupply delta_food = {1, 0, 0, 2};
+    MedicineSupply delta_medicine = {0, 0, 1};
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    for (int i = 0; i < SUPPLIES_STRESS_UPDATES; i++)
+    {
+        if (writer)
+        {
+            supplies_add(&handle, &delta_food, &delta_medicine);
+        }
+        supplies_read(&handle, &food_supply, &medicine_supply);
+        if (food_supply.water != 2 * food_supply.meat || medicine_supply.bandages != food_supply.meat)
+        {
+            return 1;
+        }
+    }
+    supplies_detach(&handle);
+    return 0;
+}
+
+void test_supplies_concurrent_processes()
+{
+    init_shared_memory_supplies();
+
+    pid_t children[SUPPLIES_STRESS_WRITERS + SUPPLIES_STRESS_READERS];
+    for (int i = 0; i < SUPPLIES_STRESS_WRITERS + SUPPLIES_STRESS_READERS; i++)
+    {
+        children[i] = fork();
+        TEST_ASSERT_NOT_EQUAL(-1, children[i]);
+        if (children[i] == 0)
+        {
+            _exit(supplies_stress_child(i < SUPPLIES_STRESS_WRITERS));
+        }
+    }
+
+    // No child may have seen a torn snapshot
+    for (int i = 0; i < SUPPLIES_STRESS_WRITERS + SUPPLIES_STRESS_READERS; i++)
+    {
+        int status;
+        TEST_ASSERT_EQUAL_INT(children[i], waitpid(children[i], &status, 0));
+        TEST_ASSERT_TRUE(WIFEXITED(status));
+        TEST_ASSERT_EQUAL_INT(0, WEXITSTATUS(status));
+    }
+
+    // And no delta may have been lost
+    FoodSupply food_supply;
+    MedicineSupply medicine_supply;
+    TEST_ASSERT_EQUAL_INT(0, get_supplies(&food_supply, &medicine_supply));
+    TEST_ASSERT_EQUAL_INT(SUPPLIES_STRESS_WRITERS * SUPPLIES_STRESS_UPDATES, food_supply.meat);
+    TEST_ASSERT_EQUAL_INT(2 * SUPPLIES_STRESS_WRITERS * SUPPLIES_STRESS_UPDATES, food_supply.water);
+    TEST_ASSERT_EQUAL_INT(SUPPLIES_STRESS_WRITERS * SUPPLIES_STRESS_UPDATES, medicine_supply.bandages);
+    init_shared_memory_supplies();
+}
+
+void test_event_logger_batches_records()
+{
+    char path[] = "/tmp/test_event_logger_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+    close(fd);
+
+    // A long interval: only the flush below writes the records, all of them in one batch
+    Logger logger;
+    TEST_ASSERT_EQUAL_INT(0, logger_start(&logger, path, LOGGER_MAX_FLUSH_MS, LOGGER_FSYNC_NONE));
+    char message[64];
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(message, sizeof(message), "event %d", i);
+        TEST_ASSERT_EQUAL_INT(0, logger_log(&logger, message));
+    }
+    logger_flush(&logger);
+
+    LoggerStats stats;
+    logger_get_stats(&logger, &stats);
+    TEST_ASSERT_EQUAL_UINT64(100, stats.written);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.dropped);
+    TEST_ASSERT_LESS_THAN(10, stats.batches);
+    logger_stop(&logger);
+    TEST_ASSERT_EQUAL_INT(-1, logger_log(&logger, "after stop"));
+
+    // Every record is on its own timestamped line, in order
+    FILE* log_file = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL(log_file);
+    char line[256];
+    int lines = 0;
+    while (fgets(line, sizeof(line), log_file))
+    {
+        snprintf(message, sizeof(message), "] event %d\n", lines);
+        TEST_ASSERT_EQUAL_INT('[', line[0]);
+        TEST_ASSERT_NOT_NULL(strstr(line, message));
+        lines++;
+    }
+    fclose(log_file);
+    unlink(path);
+    TEST_ASSERT_EQUAL_INT(100, lines);
+}
+
+void test_json_encoder_compact_output()
+{
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddStringToObject(json, "message", "status");
+    cJSON* food = cJSON_AddObjectToObject(json, "food");
+    cJSON_AddNumberToObject(food, "meat", 5);
+
+    size_t len;
+    const char* encoded = json_encode(json, &len);
+    TEST_ASSERT_EQUAL_STRING("{\"message\":\"status\",\"food\":{\"meat\":5}}", encoded);
+    TEST_ASSERT_EQUAL_size_t(strlen(encoded), len);
+
+    // The buffer of the thread is reused by the next message
+    TEST_ASSERT_EQUAL_PTR(encoded, json_encode(food, NULL));
+    TEST_ASSERT_EQUAL_STRING("{\"meat\":5}", encoded);
+
+    // Messages larger than the initial buffer make it grow
+    char big[4 * JSON_ENCODER_INITIAL_SIZE];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    cJSON_AddStringToObject(json, "padding", big);
+    TEST_ASSERT_NOT_NULL(json_encode(json, &len));
+    TEST_ASSERT_GREATER_THAN(sizeof(big), len);
+
+    json_encoder_set_pretty(1);
+    TEST_ASSERT_NOT_NULL(strchr(json_encode(food, NULL), '\n'));
+    json_encoder_set_pretty(0);
+
+    json_encoder_release();
+    cJSON_Delete(json);
+}
+
+static int cached_builds;
+
+static cJSON* build_counted_response(void)
+{
+    cached_builds++;
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "build", cached_builds);
+    return json;
+}
+
+void test_response_cache_rebuilds_on_version_change()
+{
+    ResponseCache cache = RESPONSE_CACHE_INITIALIZER(build_counted_response);
+    cached_builds = 0;
+    size_t len;
+
+    // Built on the first read, then served as is while the version does not change
+    const char* response = response_cache_acquire(&cache, 1, &len);
+    TEST_ASSERT_EQUAL_STRING("{\"build\":1}", response);
+    TEST_ASSERT_EQUAL_size_t(strlen(response), len);
+    response_cache_release(&cache);
+    TEST_ASSERT_EQUAL_STRING("{\"build\":1}", response_cache_acquire(&cache, 1, &len));
+    response_cache_release(&cache);
+    TEST_ASSERT_EQUAL_INT(1, cached_builds);
+
+    // A newer version rebuilds it once
+    TEST_ASSERT_EQUAL_STRING("{\"build\":2}", response_cache_acquire(&cache, 2, &len));
+    response_cache_release(&cache);
+    TEST_ASSERT_EQUAL_STRING("{\"build\":2}", response_cache_acquire(&cache, 2, &len));
+    response_cache_release(&cache);
+    TEST_ASSERT_EQUAL_INT(2, cached_builds);
+    TEST_ASSERT_EQUAL_UINT64(2, atomic_load(&cache.hits));
+    TEST_ASSERT_EQUAL_UINT64(2, atomic_load(&cache.rebuilds));
+
+    response_cache_clear(&cache);
+    pthread_rwlock_destroy(&cache.lock);
+}
+
+void test_response_versions_follow_state_changes()
+{
+    init_shared_memory_supplies();
+    uint64_t status_version = get_status_version();
+    uint64_t summary_version = get_summary_version();
+
+    // Supplies invalidate both responses
+    cJSON* update = cJSON_Parse("{\"food\":{\"meat\":1}}");
+    update_supplies_from_json(update);
+    cJSON_Delete(update);
+    TEST_ASSERT_NOT_EQUAL(status_version, get_status_version());
+    TEST_ASSERT_NOT_EQUAL(summary_version, get_summary_version());
+
+    // The emergency info only invalidates the summary
+    status_version = get_status_version();
+    summary_version = get_summary_version();
+    EmergencyInfo info;
+    update_emergency_info("2024-04-18 19:11:52", "Test event", &info);
+    TEST_ASSERT_EQUAL_UINT64(status_version, get_status_version());
+    TEST_ASSERT_NOT_EQUAL(summary_version, get_summary_version());
+    init_shared_memory_supplies();
+}
+
+void test_udp_batch_answers_burst()
+{
+    init_shared_memory_supplies();
+    int server_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int client_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT_TRUE(server_fd >= 0 && client_fd >= 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    TEST_ASSERT_EQUAL_INT(0, bind(server_fd, (struct sockaddr*)&address, address_len));
+    TEST_ASSERT_EQUAL_INT(0, getsockname(server_fd, (struct sockaddr*)&address, &address_len));
+
+    // A burst of requests waits on the socket before the worker wakes up
+    const char* requests[] = {"{\"message\":\"status\",\"hostname\":\"test\"}", "not json",
+                              "{\"message\":\"summary\",\"hostname\":\"test\"}",
+                              "{\"message\":\"status\",\"hostname\":\"test\"}"};
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_INT((int)strlen(requests[i]), (int)sendto(client_fd, requests[i], strlen(requests[i]), 0,
+                                                                    (struct sockaddr*)&address, address_len));
+    }
+
+    UDPBatch* batch = udp_batch_create();
+    TEST_ASSERT_NOT_NULL(batch);
+    handle_udp_socket_activity(server_fd, batch);
+    TEST_ASSERT_EQUAL_UINT(4, batch->num_received);
+    TEST_ASSERT_EQUAL_UINT(0, batch->num_replies);
+
+    // One response per valid request, in order
+    char response[BUFFER_SIZE];
+    for (int i = 0; i < 3; i++)
+    {
+        ssize_t len = recv(client_fd, response, sizeof(response) - 1, MSG_DONTWAIT);
+        TEST_ASSERT_TRUE(len > 0);
+        response[len] = '\0';
+        cJSON* json = cJSON_Parse(response);
+        TEST_ASSERT_NOT_NULL(json);
+        TEST_ASSERT_EQUAL_INT(i == 1, cJSON_GetObjectItem(json, "alerts") != NULL);
+        cJSON_Delete(json);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, (int)recv(client_fd, response, sizeof(response), MSG_DONTWAIT));
+
+    // Nothing left: the next wakeup receives nothing and does not block
+    handle_udp_socket_activity(server_fd, batch);
+    TEST_ASSERT_EQUAL_UINT(0, batch->num_received);
+
+    udp_batch_destroy(batch);
+    close(server_fd);
+    close(client_fd);
+}
+
 void tearDown()
 {
     // Run after all tests
@@ -496,19 +1909,50 @@ int main(void)
     RUN_TEST(test_initiateAlertModule);
     RUN_TEST(test_cleanup_fifo);
     RUN_TEST(test_fifo_not_empty);
+    RUN_TEST(test_alert_fifo_splits_records);
+    RUN_TEST(test_alert_fifo_burst_loses_nothing);
+    RUN_TEST(test_alert_ring_crosses_fork);
+    RUN_TEST(test_sensor_bank_scan_reports_exceeding);
+    RUN_TEST(test_prng_is_reproducible);
+    RUN_TEST(test_request_scan_matches_cjson);
     RUN_TEST(test_remove_tcp_client);
+    RUN_TEST(test_tcp_connection_registry_recycles_records);
     RUN_TEST(test_add_udp_client);
     RUN_TEST(test_remove_udp_client);
+    RUN_TEST(test_udp_registry_scales_and_expires);
     RUN_TEST(test_logEvent);
     RUN_TEST(test_logEventJSON);
     RUN_TEST(test_get_tcp_client_ip);
+    RUN_TEST(test_get_tcp_client_peer_uses_accepted_address);
+    RUN_TEST(test_handle_new_tcp_connection_drains_listen_queue);
     RUN_TEST(test_initialize_entry_alerts_count);
-    RUN_TEST(test_detect_entry_valid_entries);
-    RUN_TEST(test_detect_entry_no_entry);
+    RUN_TEST(test_alert_record_format);
+    RUN_TEST(test_handle_alert_counts_by_sensor);
     RUN_TEST(test_update_emergency_info);
     RUN_TEST(test_get_last_keepalived);
     RUN_TEST(test_get_last_event);
     RUN_TEST(test_get_home_dir);
+    RUN_TEST(test_event_loop_epoll_dispatches_ready_fds);
+    RUN_TEST(test_event_loop_select_dispatches_ready_fds);
+    RUN_TEST(test_event_loop_parse_backend);
+    RUN_TEST(test_parse_command_line_arguments_runtime_options);
+    RUN_TEST(test_tcp_connection_delimited_frames);
+    RUN_TEST(test_tcp_connection_length_prefixed_frames);
+    RUN_TEST(test_tcp_connection_batched_responses);
+    RUN_TEST(test_broadcast_waits_for_framing);
+    RUN_TEST(test_tcp_connection_slow_consumer_policies);
+    RUN_TEST(test_supplies_handle_attaches_once);
+    RUN_TEST(test_update_supplies_clamps_at_zero);
+    RUN_TEST(test_protocol_handle_without_sockets);
+    RUN_TEST(test_wire_format_roundtrip);
+    RUN_TEST(test_alert_topic_subscriptions);
+    RUN_TEST(test_auth_token_verification);
+    RUN_TEST(test_supplies_concurrent_processes);
+    RUN_TEST(test_event_logger_batches_records);
+    RUN_TEST(test_json_encoder_compact_output);
+    RUN_TEST(test_response_cache_rebuilds_on_version_change);
+    RUN_TEST(test_response_versions_follow_state_changes);
+    RUN_TEST(test_udp_batch_answers_burst);
 
     return UNITY_END();
 }